@@ -129,7 +129,42 @@ auto Binder::BindIndex(duckdb_libpgquery::PGIndexStmt *stmt) -> std::unique_ptr<
     }
   }
 
-  return std::make_unique<IndexStatement>(stmt->idxname, std::move(table), std::move(cols));
+  // the parser has no INCLUDE clause, included columns come as the option `WITH (include = 'col, ...')`
+  std::vector<std::unique_ptr<BoundColumnRef>> include_cols;
+  if (stmt->options != nullptr) {
+    for (auto cell = stmt->options->head; cell != nullptr; cell = cell->next) {
+      auto option = reinterpret_cast<duckdb_libpgquery::PGDefElem *>(cell->data.ptr_value);
+      auto value = reinterpret_cast<duckdb_libpgquery::PGValue *>(option->arg);
+      if (StringUtil::Lower(option->defname) != "include" || value == nullptr ||
+          value->type != duckdb_libpgquery::T_PGString) {
+        throw NotImplementedException(fmt::format("index option {} is not supported", option->defname));
+      }
+      for (const auto &name : StringUtil::Split(value->val.str, ',')) {
+        auto column_ref = ResolveColumn(*table, std::vector{StringUtil::Strip(name, ' ')});
+        include_cols.emplace_back(std::make_unique<BoundColumnRef>(dynamic_cast<const BoundColumnRef &>(*column_ref)));
+      }
+    }
+  }
+
+  // the parser defaults to its own "art" without a USING clause
+  auto index_type = IndexType::BPlusTreeIndex;
+  std::string access_method = stmt->accessMethod == nullptr ? "" : StringUtil::Lower(stmt->accessMethod);
+  if (access_method == "lsm") {
+    index_type = IndexType::LSMTreeIndex;
+    if (!include_cols.empty()) {
+      throw NotImplementedException("an LSM tree index cannot include columns");
+    }
+  } else if (access_method == "hash") {
+    index_type = IndexType::HashIndex;
+    if (!include_cols.empty()) {
+      throw NotImplementedException("a hash index cannot include columns");
+    }
+  } else if (access_method != "art" && access_method != "btree" && !access_method.empty()) {
+    throw NotImplementedException(fmt::format("index type {} is not supported", access_method));
+  }
+
+  return std::make_unique<IndexStatement>(stmt->idxname, std::move(table), std::move(cols), stmt->unique,
+                                          std::move(include_cols), index_type, stmt->concurrent);
 }
 
 }  // namespace bustub
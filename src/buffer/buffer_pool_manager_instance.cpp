@@ -25,6 +25,11 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManag
   page_table_ = new ExtendibleHashTable<page_id_t, frame_id_t>(bucket_size_);
   replacer_ = new LRUKReplacer(pool_size, replacer_k);
 
+  // Pages already in the database file are never handed out again when it is reopened.
+  if (disk_manager_ != nullptr) {
+    next_page_id_ = disk_manager_->GetNumPages();
+  }
+
   // Initially, every page is in the free list.
   for (size_t i = 0; i < pool_size_; ++i) {
     free_list_.emplace_back(static_cast<int>(i));
@@ -147,7 +152,7 @@ auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
   }
   if (pages_[frame_id].IsDirty()) {
     disk_manager_->WritePage(pages_[frame_id].GetPageId(), pages_[frame_id].GetData());
-    pages_->is_dirty_ = false;
+    pages_[frame_id].is_dirty_ = false;
   }
   page_table_->Remove(page_id);
   replacer_->Remove(frame_id);
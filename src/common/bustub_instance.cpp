@@ -33,6 +33,7 @@
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/disk/disk_manager_memory.h"
+#include "storage/page/header_page.h"
 #include "type/value_factory.h"
 
 namespace bustub {
@@ -66,11 +67,19 @@ BustubInstance::BustubInstance(const std::string &db_file_name) {
   // Checkpoint related.
   checkpoint_manager_ = new CheckpointManager(txn_manager_, log_manager_, buffer_pool_manager_);
 
-  // Catalog.
-  catalog_ = new Catalog(buffer_pool_manager_, lock_manager_, log_manager_);
+  // Catalog. Tables of a database file are reopened from the system tables on first reference.
+  if (buffer_pool_manager_ != nullptr) {
+    ReserveHeaderPage();
+  }
+  catalog_ = new Catalog(buffer_pool_manager_, lock_manager_, log_manager_, buffer_pool_manager_ != nullptr);
 
   // Execution engine.
   execution_engine_ = new ExecutionEngine(buffer_pool_manager_, txn_manager_, catalog_);
+
+  // Logging. Without the flush thread, `SET synchronous_commit` has nothing to defer commits to.
+  if (enable_logging_on_startup && buffer_pool_manager_ != nullptr) {
+    log_manager_->RunFlushThread();
+  }
 }
 
 BustubInstance::BustubInstance() {
@@ -99,12 +108,28 @@ BustubInstance::BustubInstance() {
   checkpoint_manager_ = new CheckpointManager(txn_manager_, log_manager_, buffer_pool_manager_);
 
   // Catalog.
+  if (buffer_pool_manager_ != nullptr) {
+    ReserveHeaderPage();
+  }
   catalog_ = new Catalog(buffer_pool_manager_, lock_manager_, log_manager_);
 
   // Execution engine.
   execution_engine_ = new ExecutionEngine(buffer_pool_manager_, txn_manager_, catalog_);
 }
 
+void BustubInstance::ReserveHeaderPage() {
+  if (disk_manager_->GetNumPages() > HEADER_PAGE_ID) {
+    return;
+  }
+  // A new database: the first page becomes the header page, flushed right away so that a reopened file has it
+  page_id_t header_page_id;
+  auto *header_page = reinterpret_cast<HeaderPage *>(buffer_pool_manager_->NewPage(&header_page_id));
+  BUSTUB_ASSERT(header_page != nullptr && header_page_id == HEADER_PAGE_ID, "header page must be the first page");
+  header_page->Init();
+  buffer_pool_manager_->FlushPage(HEADER_PAGE_ID);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+}
+
 void BustubInstance::CmdDisplayTables(ResultWriter &writer) {
   auto table_names = catalog_->GetTableNames();
   writer.BeginTable(false);
@@ -146,6 +171,44 @@ void BustubInstance::CmdDisplayIndices(ResultWriter &writer) {
   writer.EndTable();
 }
 
+void BustubInstance::CmdDisplayIndexStats(ResultWriter &writer, Transaction *txn) {
+  auto *stats_info = catalog_->RefreshIndexStats(txn);
+  if (stats_info == Catalog::NULL_TABLE_INFO) {
+    throw Exception("index statistics need a buffer pool");
+  }
+  const auto &schema = stats_info->schema_;
+  writer.BeginTable(false);
+  writer.BeginHeader();
+  for (const auto &column : schema.GetColumns()) {
+    writer.WriteHeaderCell(column.GetName());
+  }
+  writer.EndHeader();
+  auto *heap = stats_info->table_.get();
+  for (auto row = heap->Begin(txn); row != heap->End(); ++row) {
+    writer.BeginRow();
+    for (uint32_t i = 0; i < schema.GetColumnCount(); i++) {
+      writer.WriteCell(row->GetValue(&schema, i).ToString());
+    }
+    writer.EndRow();
+  }
+  writer.EndTable();
+}
+
+void BustubInstance::CmdReindex(const std::string &table_name, ResultWriter &writer, Transaction *txn) {
+  // the indexes stay registered while they are rebuilt, lookups and scans keep running on them
+  std::shared_lock<std::shared_mutex> l(catalog_lock_);
+  if (catalog_->GetTable(table_name) == Catalog::NULL_TABLE_INFO) {
+    throw Exception(fmt::format("table {} does not exist", table_name));
+  }
+  size_t rebuilt = 0;
+  for (auto *index_info : catalog_->GetTableIndexes(table_name)) {
+    if (index_info->index_->Rebuild(txn, INDEX_FILL_FACTOR)) {
+      rebuilt++;
+    }
+  }
+  WriteOneCell(fmt::format("{} indices of {} rebuilt", rebuilt, table_name), writer);
+}
+
 void BustubInstance::WriteOneCell(const std::string &cell, ResultWriter &writer) {
   writer.BeginTable(true);
   writer.BeginRow();
@@ -159,6 +222,8 @@ void BustubInstance::CmdDisplayHelp(ResultWriter &writer) {
 
 \dt: show all tables
 \di: show all indices
+\dis: show the height, fill and wasted space of all B+ tree indices (refreshes __index_stats)
+\reindex <table>: compact the B+ tree indices of a table into new pages, lookups keep running meanwhile
 \help: show this message again
 
 BusTub shell currently only supports a small set of Postgres queries. We'll set
@@ -191,6 +256,14 @@ auto BustubInstance::ExecuteSqlTxn(const std::string &sql, ResultWriter &writer,
       CmdDisplayIndices(writer);
       return true;
     }
+    if (sql == "\\dis") {
+      CmdDisplayIndexStats(writer, txn);
+      return true;
+    }
+    if (sql.rfind("\\reindex ", 0) == 0) {
+      CmdReindex(sql.substr(std::string("\\reindex ").size()), writer, txn);
+      return true;
+    }
     if (sql == "\\help") {
       CmdDisplayHelp(writer);
       return true;
@@ -226,22 +299,35 @@ auto BustubInstance::ExecuteSqlTxn(const std::string &sql, ResultWriter &writer,
 
         std::vector<uint32_t> col_ids;
         for (const auto &col : index_stmt.cols_) {
-          auto idx = index_stmt.table_->schema_.GetColIdx(col->col_name_.back());
-          col_ids.push_back(idx);
-          if (index_stmt.table_->schema_.GetColumn(idx).GetType() != TypeId::INTEGER) {
-            throw NotImplementedException("only support creating index on integer column");
-          }
-        }
-        if (col_ids.size() != 1) {
-          throw NotImplementedException("only support creating index with exactly one column");
+          col_ids.push_back(index_stmt.table_->schema_.GetColIdx(col->col_name_.back()));
         }
         auto key_schema = Schema::CopySchema(&index_stmt.table_->schema_, col_ids);
+        std::vector<uint32_t> include_ids;
+        for (const auto &col : index_stmt.include_cols_) {
+          include_ids.push_back(index_stmt.table_->schema_.GetColIdx(col->col_name_.back()));
+        }
 
-        std::unique_lock<std::shared_mutex> l(catalog_lock_);
-        auto info = catalog_->CreateIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>(
-            txn, index_stmt.index_name_, index_stmt.table_->table_, index_stmt.table_->schema_, key_schema, col_ids,
-            INTEGER_SIZE, IntegerHashFunctionType{});
-        l.unlock();
+        // the key size follows from the key and included columns, the keys of a non-unique index carry the RID as well.
+        // CONCURRENTLY lets other statements be planned while the table is scanned, the catalog only latches briefly
+        std::unique_lock<std::shared_mutex> l(catalog_lock_, std::defer_lock);
+        if (!index_stmt.concurrently_) {
+          l.lock();
+        }
+        IndexInfo *info;
+        if (index_stmt.index_type_ == IndexType::LSMTreeIndex) {
+          info = catalog_->CreateLSMTreeIndex(txn, index_stmt.index_name_, index_stmt.table_->table_,
+                                              index_stmt.table_->schema_, key_schema, col_ids, index_stmt.is_unique_);
+        } else if (index_stmt.index_type_ == IndexType::HashIndex) {
+          info = catalog_->CreateHashIndex(txn, index_stmt.index_name_, index_stmt.table_->table_,
+                                           index_stmt.table_->schema_, key_schema, col_ids, index_stmt.is_unique_);
+        } else {
+          info = catalog_->CreateBPlusTreeIndex(txn, index_stmt.index_name_, index_stmt.table_->table_,
+                                                index_stmt.table_->schema_, key_schema, col_ids, INDEX_FILL_FACTOR,
+                                                index_stmt.is_unique_, include_ids);
+        }
+        if (l.owns_lock()) {
+          l.unlock();
+        }
 
         if (info == nullptr) {
           throw bustub::Exception("Failed to create index");
@@ -258,6 +344,11 @@ auto BustubInstance::ExecuteSqlTxn(const std::string &sql, ResultWriter &writer,
       case StatementType::VARIABLE_SET_STATEMENT: {
         const auto &set_stmt = dynamic_cast<const VariableSetStatement &>(*statement);
         session_variables_[set_stmt.variable_] = set_stmt.value_;
+        if (set_stmt.variable_ == "synchronous_commit") {
+          // applies to the running transaction and every transaction begun later
+          txn->SetSynchronousCommit(IsSynchronousCommit());
+          txn_manager_->SetSynchronousCommit(IsSynchronousCommit());
+        }
         continue;
       }
       case StatementType::EXPLAIN_STATEMENT: {
@@ -389,7 +480,11 @@ void BustubInstance::GenerateMockTable() {
 
 BustubInstance::~BustubInstance() {
   if (enable_logging) {
-    log_manager_->StopFlushThread();
+    log_manager_->StopFlushThread();  // flushes the log, before the pages it covers
+  }
+  // a clean shutdown writes back every page, without logging nothing else would keep the session's writes
+  if (buffer_pool_manager_ != nullptr && !crashed_) {
+    buffer_pool_manager_->FlushAllPages();
   }
   delete execution_engine_;
   delete catalog_;
@@ -10,8 +10,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -19,6 +22,7 @@
 #include "common/logger.h"
 #include "common/rid.h"
 #include "container/disk/hash/disk_extendible_hash_table.h"
+#include "storage/index/normalized_key.h"
 
 namespace bustub {
 
@@ -26,7 +30,23 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::DiskExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
                                          const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
     : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
-  //  implement me!
+  // a directory of global depth 0 pointing to a single empty bucket
+  Page *dir_page = buffer_pool_manager_->NewPage(&directory_page_id_);
+  if (dir_page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate the directory page of a hash table");
+  }
+  page_id_t bucket_page_id;
+  if (buffer_pool_manager_->NewPage(&bucket_page_id) == nullptr) {
+    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+    buffer_pool_manager_->DeletePage(directory_page_id_);
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate a bucket page of a hash table");
+  }
+  auto *dir = reinterpret_cast<HashTableDirectoryPage *>(dir_page->GetData());
+  dir->SetPageId(directory_page_id_);
+  dir->SetBucketPageId(0, bucket_page_id);
+  dir->SetLocalDepth(0, 0);
+  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
 }
 
 /*****************************************************************************
@@ -46,22 +66,31 @@ auto HASH_TABLE_TYPE::Hash(KeyType key) -> uint32_t {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 inline auto HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t {
-  return 0;
+  return Hash(key) & dir_page->GetGlobalDepthMask();
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 inline auto HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> page_id_t {
-  return 0;
+  return dir_page->GetBucketPageId(KeyToDirectoryIndex(key, dir_page));
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::FetchPage(page_id_t page_id) -> Page * {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch a page of a hash table");
+  }
+  return page;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::FetchDirectoryPage() -> HashTableDirectoryPage * {
-  return nullptr;
+  return reinterpret_cast<HashTableDirectoryPage *>(FetchPage(directory_page_id_)->GetData());
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BUCKET_TYPE * {
-  return nullptr;
+  return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(FetchPage(bucket_page_id)->GetData());
 }
 
 /*****************************************************************************
@@ -69,7 +98,17 @@ auto HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BU
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool {
-  return false;
+  table_latch_.RLock();
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
+  Page *page = FetchPage(bucket_page_id);
+  page->RLatch();
+  bool found = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(page->GetData())->GetValue(key, comparator_, result);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  table_latch_.RUnlock();
+  return found;
 }
 
 /*****************************************************************************
@@ -77,12 +116,93 @@ auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  return false;
+  // the common case only latches the bucket, a full bucket is split with the whole table latched
+  table_latch_.RLock();
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
+  Page *page = FetchPage(bucket_page_id);
+  page->WLatch();
+  auto *bucket = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(page->GetData());
+  bool full = bucket->IsFull();
+  bool inserted = !full && bucket->Insert(key, value, comparator_);
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, inserted);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  table_latch_.RUnlock();
+  if (full) {
+    return SplitInsert(transaction, key, value);
+  }
+  return inserted;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  return false;
+  table_latch_.WLock();
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  bool dir_dirty = false;
+  bool inserted = false;
+  // another split may have made room in the meantime, and one split may not be enough if all entries move together
+  while (true) {
+    uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
+    page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
+    HASH_TABLE_BUCKET_TYPE *bucket = FetchBucketPage(bucket_page_id);
+    if (!bucket->IsFull()) {
+      inserted = bucket->Insert(key, value, comparator_);
+      buffer_pool_manager_->UnpinPage(bucket_page_id, inserted);
+      break;
+    }
+    std::vector<ValueType> values;
+    bucket->GetValue(key, comparator_, &values);
+    uint32_t local_depth = dir_page->GetLocalDepth(bucket_idx);
+    bool duplicate = std::find(values.begin(), values.end(), value) != values.end();
+    // splits only separate entries by their hash, when all of them share the key's hash none would ever move
+    bool one_hash = true;
+    const uint32_t hash = Hash(key);
+    for (uint32_t slot = 0; slot < BUCKET_ARRAY_SIZE && bucket->IsOccupied(slot) && one_hash; slot++) {
+      one_hash = !bucket->IsReadable(slot) || Hash(bucket->KeyAt(slot)) == hash;
+    }
+    if (duplicate || one_hash ||
+        (local_depth == dir_page->GetGlobalDepth() && dir_page->Size() == DIRECTORY_ARRAY_SIZE)) {
+      // the bucket cannot be split, or the directory cannot grow any further: too many entries share the low bits
+      // of their hash
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+      break;
+    }
+    page_id_t image_page_id;
+    Page *image_page = buffer_pool_manager_->NewPage(&image_page_id);
+    if (image_page == nullptr) {
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+      buffer_pool_manager_->UnpinPage(directory_page_id_, dir_dirty);
+      table_latch_.WUnlock();
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate a bucket page of a hash table");
+    }
+    auto *image = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(image_page->GetData());
+    if (local_depth == dir_page->GetGlobalDepth()) {
+      dir_page->IncrGlobalDepth();
+    }
+    dir_dirty = true;
+    // the indexes of the bucket with the new local depth bit set now point to the split image
+    const uint32_t split_bit = 1U << local_depth;
+    for (uint32_t idx = 0; idx < dir_page->Size(); idx++) {
+      if (dir_page->GetBucketPageId(idx) == bucket_page_id) {
+        dir_page->IncrLocalDepth(idx);
+        if ((idx & split_bit) != 0) {
+          dir_page->SetBucketPageId(idx, image_page_id);
+        }
+      }
+    }
+    for (uint32_t slot = 0; slot < BUCKET_ARRAY_SIZE && bucket->IsOccupied(slot); slot++) {
+      if (bucket->IsReadable(slot) && (Hash(bucket->KeyAt(slot)) & split_bit) != 0) {
+        image->Insert(bucket->KeyAt(slot), bucket->ValueAt(slot), comparator_);
+        bucket->RemoveAt(slot);
+      }
+    }
+    buffer_pool_manager_->UnpinPage(image_page_id, true);
+    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  }
+  buffer_pool_manager_->UnpinPage(directory_page_id_, dir_dirty);
+  table_latch_.WUnlock();
+  return inserted;
 }
 
 /*****************************************************************************
@@ -90,14 +210,123 @@ auto HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key,
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  return false;
+  table_latch_.RLock();
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
+  Page *page = FetchPage(bucket_page_id);
+  page->WLatch();
+  auto *bucket = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(page->GetData());
+  bool removed = bucket->Remove(key, value, comparator_);
+  bool empty = removed && bucket->IsEmpty();
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, removed);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  table_latch_.RUnlock();
+  if (empty) {
+    Merge(transaction, key, value);
+  }
+  return removed;
 }
 
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {}
+void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {
+  table_latch_.WLock();
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  bool dir_dirty = false;
+  // fold the key's bucket into its split image for as long as one of the two is empty
+  while (true) {
+    uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
+    uint32_t local_depth = dir_page->GetLocalDepth(bucket_idx);
+    if (local_depth == 0) {
+      break;
+    }
+    uint32_t image_idx = dir_page->GetSplitImageIndex(bucket_idx);
+    if (dir_page->GetLocalDepth(image_idx) != local_depth) {
+      break;
+    }
+    page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
+    page_id_t image_page_id = dir_page->GetBucketPageId(image_idx);
+    bool bucket_empty = FetchBucketPage(bucket_page_id)->IsEmpty();
+    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+    bool image_empty = FetchBucketPage(image_page_id)->IsEmpty();
+    buffer_pool_manager_->UnpinPage(image_page_id, false);
+    if (!bucket_empty && !image_empty) {
+      break;
+    }
+    page_id_t kept_page_id = bucket_empty ? image_page_id : bucket_page_id;
+    page_id_t dropped_page_id = bucket_empty ? bucket_page_id : image_page_id;
+    for (uint32_t idx = 0; idx < dir_page->Size(); idx++) {
+      page_id_t page_id = dir_page->GetBucketPageId(idx);
+      if (page_id == bucket_page_id || page_id == image_page_id) {
+        dir_page->SetBucketPageId(idx, kept_page_id);
+        dir_page->DecrLocalDepth(idx);
+      }
+    }
+    buffer_pool_manager_->DeletePage(dropped_page_id);
+    dir_dirty = true;
+  }
+  while (dir_page->CanShrink()) {
+    dir_page->DecrGlobalDepth();
+    dir_dirty = true;
+  }
+  buffer_pool_manager_->UnpinPage(directory_page_id_, dir_dirty);
+  table_latch_.WUnlock();
+}
+
+/*****************************************************************************
+ * CLEAR
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::Clear() {
+  table_latch_.WLock();
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  // the bucket of slot 0 is emptied in place and kept, every other bucket goes
+  page_id_t kept_page_id = dir_page->GetBucketPageId(0);
+  std::unordered_set<page_id_t> dropped_page_ids;
+  for (uint32_t idx = 0; idx < dir_page->Size(); idx++) {
+    if (dir_page->GetBucketPageId(idx) != kept_page_id) {
+      dropped_page_ids.insert(dir_page->GetBucketPageId(idx));
+    }
+  }
+  Page *page = FetchPage(kept_page_id);
+  page->WLatch();
+  std::memset(page->GetData(), 0, BUSTUB_PAGE_SIZE);
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(kept_page_id, true);
+  for (auto page_id : dropped_page_ids) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  while (dir_page->GetGlobalDepth() > 0) {
+    dir_page->DecrGlobalDepth();
+  }
+  dir_page->SetBucketPageId(0, kept_page_id);
+  dir_page->SetLocalDepth(0, 0);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
+  table_latch_.WUnlock();
+}
+
+/*****************************************************************************
+ * DROP
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::Drop() {
+  table_latch_.WLock();
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  std::unordered_set<page_id_t> bucket_page_ids;
+  for (uint32_t idx = 0; idx < dir_page->Size(); idx++) {
+    bucket_page_ids.insert(dir_page->GetBucketPageId(idx));
+  }
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  for (auto page_id : bucket_page_ids) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  buffer_pool_manager_->DeletePage(directory_page_id_);
+  directory_page_id_ = INVALID_PAGE_ID;
+  table_latch_.WUnlock();
+}
 
 /*****************************************************************************
  * GETGLOBALDEPTH - DO NOT TOUCH
@@ -135,4 +364,10 @@ template class DiskExtendibleHashTable<GenericKey<16>, RID, GenericComparator<16
 template class DiskExtendibleHashTable<GenericKey<32>, RID, GenericComparator<32>>;
 template class DiskExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class DiskExtendibleHashTable<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class DiskExtendibleHashTable<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class DiskExtendibleHashTable<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class DiskExtendibleHashTable<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class DiskExtendibleHashTable<NormalizedKey<64>, RID, NormalizedComparator<64>>;
+
 }  // namespace bustub
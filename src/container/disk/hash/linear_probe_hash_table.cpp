@@ -10,13 +10,17 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/macros.h"
 #include "common/rid.h"
 #include "container/disk/hash/linear_probe_hash_table.h"
 
@@ -26,21 +30,216 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::LinearProbeHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
                                       const KeyComparator &comparator, size_t num_buckets,
                                       HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {}
+    : buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      size_(std::max<size_t>(num_buckets, 1)),
+      hash_fn_(std::move(hash_fn)) {
+  header_page_id_ = CreateTable(size_);
+}
+
+/*****************************************************************************
+ * HELPERS
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::FetchPage(page_id_t page_id) -> Page * {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch a page of a hash table");
+  }
+  return page;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::CreateTable(size_t num_slots) -> page_id_t {
+  const size_t num_blocks = (num_slots - 1) / BLOCK_ARRAY_SIZE + 1;
+  if (num_blocks > HashTableHeaderPage::MaxBlocks()) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "too many slots for a linear probing hash table");
+  }
+  page_id_t header_page_id;
+  Page *page = buffer_pool_manager_->NewPage(&header_page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate the header page of a hash table");
+  }
+  auto *header = reinterpret_cast<HashTableHeaderPage *>(page->GetData());
+  header->SetPageId(header_page_id);
+  header->SetSize(num_slots);
+  for (size_t i = 0; i < num_blocks; i++) {
+    header->AddBlockPageId(INVALID_PAGE_ID);
+  }
+  buffer_pool_manager_->UnpinPage(header_page_id, true);
+  return header_page_id;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::DeleteTable(page_id_t header_page_id) {
+  auto *header = reinterpret_cast<HashTableHeaderPage *>(FetchPage(header_page_id)->GetData());
+  for (size_t i = 0; i < header->NumBlocks(); i++) {
+    if (header->GetBlockPageId(i) != INVALID_PAGE_ID) {
+      buffer_pool_manager_->DeletePage(header->GetBlockPageId(i));
+    }
+  }
+  buffer_pool_manager_->UnpinPage(header_page_id, false);
+  buffer_pool_manager_->DeletePage(header_page_id);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::FetchBlock(Page *header_page, size_t slot, bool create) -> Page * {
+  auto *header = reinterpret_cast<HashTableHeaderPage *>(header_page->GetData());
+  const size_t block_index = slot / BLOCK_ARRAY_SIZE;
+  header_page->RLatch();
+  page_id_t block_page_id = header->GetBlockPageId(block_index);
+  header_page->RUnlatch();
+  if (block_page_id != INVALID_PAGE_ID) {
+    return FetchPage(block_page_id);
+  }
+  if (!create) {
+    return nullptr;
+  }
+  Page *block_page = buffer_pool_manager_->NewPage(&block_page_id);
+  if (block_page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate a block page of a hash table");
+  }
+  header_page->WLatch();
+  header->SetBlockPageId(block_index, block_page_id);
+  header_page->WUnlatch();
+  return block_page;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename Visit>
+auto HASH_TABLE_TYPE::Probe(page_id_t header_page_id, const KeyType &key, size_t first_slot, Visit visit) -> size_t {
+  Page *header_page = FetchPage(header_page_id);
+  const size_t num_slots = reinterpret_cast<HashTableHeaderPage *>(header_page->GetData())->GetSize();
+  size_t free_slot = num_slots;
+  Page *block_page = nullptr;
+  size_t block_index = 0;
+  size_t slot = std::max<size_t>(hash_fn_.GetHash(key) % num_slots, first_slot);
+  for (size_t probed = first_slot; probed < num_slots; probed++, slot++) {
+    if (slot == num_slots) {
+      slot = first_slot;
+    }
+    if (block_page == nullptr || slot / BLOCK_ARRAY_SIZE != block_index) {
+      if (block_page != nullptr) {
+        block_page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(block_page->GetPageId(), false);
+      }
+      block_index = slot / BLOCK_ARRAY_SIZE;
+      block_page = FetchBlock(header_page, slot, false);
+      if (block_page == nullptr) {
+        // a block that was never written holds no entries, the chain ends at its first slot
+        if (free_slot == num_slots) {
+          free_slot = slot;
+        }
+        break;
+      }
+      block_page->RLatch();
+    }
+    auto *block = reinterpret_cast<HASH_TABLE_BLOCK_TYPE *>(block_page->GetData());
+    auto offset = static_cast<slot_offset_t>(slot % BLOCK_ARRAY_SIZE);
+    if (!block->IsReadable(offset)) {
+      if (free_slot == num_slots) {
+        free_slot = slot;
+      }
+      if (!block->IsOccupied(offset)) {
+        break;
+      }
+      continue;
+    }
+    if (comparator_(key, block->KeyAt(offset)) == 0 && visit(slot, block->ValueAt(offset))) {
+      break;
+    }
+  }
+  if (block_page != nullptr) {
+    block_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(block_page->GetPageId(), false);
+  }
+  buffer_pool_manager_->UnpinPage(header_page_id, false);
+  return free_slot;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::InsertAt(page_id_t header_page_id, size_t slot, const KeyType &key, const ValueType &value) {
+  Page *header_page = FetchPage(header_page_id);
+  Page *block_page = FetchBlock(header_page, slot, true);
+  block_page->WLatch();
+  reinterpret_cast<HASH_TABLE_BLOCK_TYPE *>(block_page->GetData())
+      ->Insert(static_cast<slot_offset_t>(slot % BLOCK_ARRAY_SIZE), key, value);
+  block_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(block_page->GetPageId(), true);
+  buffer_pool_manager_->UnpinPage(header_page_id, true);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::RemoveAt(page_id_t header_page_id, size_t slot) {
+  Page *header_page = FetchPage(header_page_id);
+  Page *block_page = FetchBlock(header_page, slot, false);
+  block_page->WLatch();
+  reinterpret_cast<HASH_TABLE_BLOCK_TYPE *>(block_page->GetData())
+      ->Remove(static_cast<slot_offset_t>(slot % BLOCK_ARRAY_SIZE));
+  block_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(block_page->GetPageId(), true);
+  buffer_pool_manager_->UnpinPage(header_page_id, false);
+}
 
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool {
-  return false;
+  bool found = false;
+  auto collect = [&](size_t /* slot */, const ValueType &value) {
+    result->push_back(value);
+    found = true;
+    return false;
+  };
+  table_latch_.RLock();
+  // the slots of the old table that have not been moved yet, then the new table
+  if (old_header_page_id_ != INVALID_PAGE_ID) {
+    Probe(old_header_page_id_, key, migrated_, collect);
+  }
+  Probe(header_page_id_, key, 0, collect);
+  table_latch_.RUnlock();
+  return found;
 }
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  return false;
+  std::scoped_lock write_lock(write_latch_);
+  MigrateSlots(LINEAR_PROBE_MIGRATE_SLOTS);
+  bool duplicate = false;
+  auto find = [&](size_t /* slot */, const ValueType &stored) {
+    duplicate = stored == value;
+    return duplicate;
+  };
+  while (true) {
+    table_latch_.RLock();
+    if (old_header_page_id_ != INVALID_PAGE_ID) {
+      Probe(old_header_page_id_, key, migrated_, find);
+    }
+    size_t slot = duplicate ? size_ : Probe(header_page_id_, key, 0, find);
+    if (!duplicate && slot < size_) {
+      InsertAt(header_page_id_, slot, key, value);
+      num_entries_++;
+    }
+    table_latch_.RUnlock();
+    if (duplicate) {
+      return false;
+    }
+    if (slot < size_) {
+      break;
+    }
+    // the table is full, finish the resize in progress or grow right away
+    if (old_header_page_id_ == INVALID_PAGE_ID && !StartResize(size_ * 2)) {
+      return false;
+    }
+    MigrateSlots(std::numeric_limits<size_t>::max());
+  }
+  if (old_header_page_id_ == INVALID_PAGE_ID && static_cast<double>(num_entries_) > LINEAR_PROBE_MAX_LOAD * size_) {
+    StartResize(size_ * 2);
+  }
+  return true;
 }
 
 /*****************************************************************************
@@ -48,21 +247,110 @@ auto HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  return false;
+  std::scoped_lock write_lock(write_latch_);
+  MigrateSlots(LINEAR_PROBE_MIGRATE_SLOTS);
+  std::optional<size_t> found;
+  auto find = [&](size_t slot, const ValueType &stored) {
+    if (stored == value) {
+      found = slot;
+    }
+    return found.has_value();
+  };
+  table_latch_.RLock();
+  page_id_t table = old_header_page_id_;
+  if (table != INVALID_PAGE_ID) {
+    Probe(table, key, migrated_, find);
+  }
+  if (!found.has_value()) {
+    table = header_page_id_;
+    Probe(table, key, 0, find);
+  }
+  if (found.has_value()) {
+    RemoveAt(table, *found);
+    num_entries_--;
+  }
+  table_latch_.RUnlock();
+  return found.has_value();
 }
 
 /*****************************************************************************
  * RESIZE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-void HASH_TABLE_TYPE::Resize(size_t initial_size) {}
+void HASH_TABLE_TYPE::Resize(size_t initial_size) {
+  std::scoped_lock write_lock(write_latch_);
+  MigrateSlots(std::numeric_limits<size_t>::max());
+  StartResize(initial_size * 2);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::StartResize(size_t num_slots) -> bool {
+  num_slots = std::min(num_slots, HashTableHeaderPage::MaxBlocks() * BLOCK_ARRAY_SIZE);
+  if (num_slots <= size_) {
+    return false;
+  }
+  page_id_t header_page_id = CreateTable(num_slots);
+  table_latch_.WLock();
+  old_header_page_id_ = header_page_id_;
+  header_page_id_ = header_page_id;
+  size_ = num_slots;
+  migrated_ = 0;
+  table_latch_.WUnlock();
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::MigrateSlots(size_t count) {
+  if (old_header_page_id_ == INVALID_PAGE_ID) {
+    return;
+  }
+  table_latch_.WLock();
+  Page *old_header_page = FetchPage(old_header_page_id_);
+  const size_t old_size = reinterpret_cast<HashTableHeaderPage *>(old_header_page->GetData())->GetSize();
+  const size_t end = migrated_ + std::min(count, old_size - migrated_);
+  while (migrated_ < end) {
+    Page *block_page = FetchBlock(old_header_page, migrated_, false);
+    const size_t block_end = std::min(end, (migrated_ / BLOCK_ARRAY_SIZE + 1) * BLOCK_ARRAY_SIZE);
+    if (block_page == nullptr) {
+      migrated_ = block_end;
+      continue;
+    }
+    // no latches on the block pages, readers and writers wait for the table latch
+    auto *block = reinterpret_cast<HASH_TABLE_BLOCK_TYPE *>(block_page->GetData());
+    bool dirty = false;
+    for (; migrated_ < block_end; migrated_++) {
+      auto offset = static_cast<slot_offset_t>(migrated_ % BLOCK_ARRAY_SIZE);
+      if (!block->IsReadable(offset)) {
+        continue;
+      }
+      KeyType key = block->KeyAt(offset);
+      auto no_visit = [](size_t /* slot */, const ValueType & /* value */) { return false; };
+      size_t slot = Probe(header_page_id_, key, 0, no_visit);
+      BUSTUB_ASSERT(slot < size_, "the new table has room for every entry of the old one");
+      InsertAt(header_page_id_, slot, key, block->ValueAt(offset));
+      block->Remove(offset);
+      dirty = true;
+    }
+    buffer_pool_manager_->UnpinPage(block_page->GetPageId(), dirty);
+  }
+  buffer_pool_manager_->UnpinPage(old_header_page_id_, false);
+  if (migrated_ == old_size) {
+    DeleteTable(old_header_page_id_);
+    old_header_page_id_ = INVALID_PAGE_ID;
+    migrated_ = 0;
+  }
+  table_latch_.WUnlock();
+}
 
 /*****************************************************************************
  * GETSIZE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::GetSize() -> size_t {
-  return 0;
+  table_latch_.RLock();
+  size_t size = size_;
+  table_latch_.RUnlock();
+  return size;
 }
 
 template class LinearProbeHashTable<int, int, IntComparator>;
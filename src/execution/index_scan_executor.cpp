@@ -11,12 +11,135 @@
 //===----------------------------------------------------------------------===//
 #include "execution/executors/index_scan_executor.h"
 
+#include <memory>
+#include <utility>
+
+#include "storage/index/b_plus_tree_index.h"
+#include "type/value_factory.h"
+
 namespace bustub {
+
+using BatchScan = std::function<void(std::vector<RID> *, std::vector<Tuple> *)>;
+
+/** Scan from begin to the end of the tree, INDEX_SCAN_BATCH_SIZE entries at a time, decoding them into entries */
+template <typename KeyType, typename ValueType, typename KeyComparator, typename Iterator>
+static auto BatchScanFrom(BPlusTreeIndex<KeyType, ValueType, KeyComparator> *tree, Iterator begin) -> BatchScan {
+  // std::function needs a copyable callable, the iterator itself can only be moved
+  auto iterator = std::make_shared<Iterator>(std::move(begin));
+  auto batch = std::make_shared<std::vector<std::pair<KeyType, ValueType>>>();
+  return [tree, iterator, batch](std::vector<RID> *rids, std::vector<Tuple> *entries) {
+    batch->clear();
+    iterator->NextBatch(INDEX_SCAN_BATCH_SIZE, batch.get());
+    for (const auto &[key, rid] : *batch) {
+      rids->push_back(rid);
+      if (entries != nullptr) {
+        entries->push_back(tree->EntryOf(key));
+      }
+    }
+  };
+}
+
+/** Scan the whole tree from its first key, or from its last key down if descending */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+static auto BatchScanOf(BPlusTreeIndex<KeyType, ValueType, KeyComparator> *tree, bool descending) -> BatchScan {
+  if (descending) {
+    return BatchScanFrom(tree, tree->GetReverseBeginIterator());
+  }
+  return BatchScanFrom(tree, tree->GetBeginIterator());
+}
+
+/** BatchScanOf the index if it is a B+ tree with normalized keys of KeyWidth bytes, nullptr otherwise */
+template <size_t KeyWidth>
+static auto TryBatchScanOf(Index *index, bool descending) -> BatchScan {
+  using Tree = BPlusTreeIndex<NormalizedKey<KeyWidth>, RID, NormalizedComparator<KeyWidth>>;
+  if (auto *tree = dynamic_cast<Tree *>(index); tree != nullptr) {
+    return BatchScanOf(tree, descending);
+  }
+  return nullptr;
+}
+
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan) {}
 
-void IndexScanExecutor::Init() { throw NotImplementedException("IndexScanExecutor is not implemented"); }
+void IndexScanExecutor::Init() {
+  auto *catalog = exec_ctx_->GetCatalog();
+  const auto *index_info = catalog->GetIndex(plan_->GetIndexOid());
+  table_info_ = catalog->GetTable(index_info->table_name_);
+  auto *index = index_info->index_.get();
+  entry_schema_ = index->GetEntrySchema();
+  entry_attrs_ = index->GetEntryAttrs();
+  next_batch_ = nullptr;
+  if (!plan_->GetLookupKey().empty()) {
+    // a point lookup takes all the matching RIDs, or entries, in a single batch
+    next_batch_ = [index, txn = exec_ctx_->GetTransaction(), key = plan_->GetLookupKey(), done = false](
+                      std::vector<RID> *rids, std::vector<Tuple> *entries) mutable {
+      if (done) {
+        return;
+      }
+      done = true;
+      if (entries == nullptr) {
+        index->ScanKey(Tuple(key, index->GetKeySchema()), rids, txn);
+        return;
+      }
+      std::vector<std::pair<Tuple, RID>> matches;
+      index->ScanKeyPrefixEntries(key, &matches, txn);
+      for (auto &[entry, rid] : matches) {
+        rids->push_back(rid);
+        entries->push_back(std::move(entry));
+      }
+    };
+  } else {
+    // the key width of an index is picked at runtime, try each one CreateBPlusTreeIndex may pick
+    for (auto try_batch_scan_of : {TryBatchScanOf<4>, TryBatchScanOf<8>, TryBatchScanOf<16>, TryBatchScanOf<32>,
+                                   TryBatchScanOf<64>}) {
+      if ((next_batch_ = try_batch_scan_of(index, plan_->IsDescending())) != nullptr) {
+        break;
+      }
+    }
+  }
+  if (next_batch_ == nullptr) {
+    throw NotImplementedException("index scan only supports B+ tree indexes with normalized keys");
+  }
+  if (plan_->IsIndexOnly() && !index->IsCovering()) {
+    throw NotImplementedException("index-only scan on an index that does not store its entries");
+  }
+  rids_.clear();
+  entries_.clear();
+  cursor_ = 0;
+}
 
-auto IndexScanExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+auto IndexScanExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  while (true) {
+    if (cursor_ == rids_.size()) {
+      rids_.clear();
+      entries_.clear();
+      cursor_ = 0;
+      next_batch_(&rids_, plan_->IsIndexOnly() ? &entries_ : nullptr);
+      if (rids_.empty()) {
+        return false;
+      }
+    }
+    *rid = rids_[cursor_++];
+    if (plan_->IsIndexOnly()) {
+      // the entry holds the key and included columns, the plan does not read the others
+      const auto &schema = GetOutputSchema();
+      std::vector<Value> values;
+      values.reserve(schema.GetColumnCount());
+      for (const auto &column : schema.GetColumns()) {
+        values.push_back(ValueFactory::GetNullValueByType(column.GetType()));
+      }
+      const auto &entry = entries_[cursor_ - 1];
+      for (uint32_t i = 0; i < entry_attrs_.size(); i++) {
+        values[entry_attrs_[i]] = entry.GetValue(entry_schema_, i);
+      }
+      *tuple = Tuple(values, &schema);
+      return true;
+    }
+    // skip entries whose row was deleted after the batch was taken
+    if (table_info_->table_->GetTuple(*rid, tuple, exec_ctx_->GetTransaction())) {
+      return true;
+    }
+  }
+}
 
 }  // namespace bustub
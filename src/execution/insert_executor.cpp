@@ -11,17 +11,70 @@
 //===----------------------------------------------------------------------===//
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "execution/executors/insert_executor.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
 InsertExecutor::InsertExecutor(ExecutorContext *exec_ctx, const InsertPlanNode *plan,
                                std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {}
 
-void InsertExecutor::Init() { throw NotImplementedException("InsertExecutor is not implemented"); }
+void InsertExecutor::Init() {
+  child_executor_->Init();
+  table_info_ = exec_ctx_->GetCatalog()->GetTable(plan_->TableOid());
+  inserted_ = 0;
+  done_ = false;
+}
 
-auto InsertExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool { return false; }
+auto InsertExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  if (done_) {
+    return false;
+  }
+  std::vector<Tuple> batch;
+  batch.reserve(INSERT_BATCH_SIZE);
+  Tuple child_tuple;
+  RID child_rid;
+  while (child_executor_->Next(&child_tuple, &child_rid)) {
+    batch.push_back(child_tuple);
+    if (batch.size() == INSERT_BATCH_SIZE) {
+      InsertBatch(batch);
+      batch.clear();
+    }
+  }
+  if (!batch.empty()) {
+    InsertBatch(batch);
+  }
+  *tuple = Tuple{std::vector<Value>{ValueFactory::GetIntegerValue(inserted_)}, &GetOutputSchema()};
+  done_ = true;
+  return true;
+}
+
+void InsertExecutor::InsertBatch(const std::vector<Tuple> &batch) {
+  auto *txn = exec_ctx_->GetTransaction();
+  auto *catalog = exec_ctx_->GetCatalog();
+  std::vector<RID> rids;
+  if (!table_info_->table_->InsertTuples(batch, &rids, txn)) {
+    throw ExecutionException("insert into " + table_info_->name_ + " failed");
+  }
+  inserted_ += static_cast<int32_t>(rids.size());
+
+  // The indexes are looked up after the heap write, so an index being built either scans the rows or logs them.
+  for (auto *index_info : catalog->GetTableIndexes(table_info_->name_)) {
+    auto *index = index_info->index_.get();
+    std::vector<std::pair<Tuple, RID>> entries;
+    entries.reserve(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+      Tuple key = batch[i].KeyFromTuple(table_info_->schema_, *index->GetEntrySchema(), index->GetEntryAttrs());
+      entries.emplace_back(std::move(key), rids[i]);
+      txn->GetIndexWriteSet()->emplace_back(rids[i], table_info_->oid_, WType::INSERT, batch[i],
+                                            index_info->index_oid_, catalog);
+    }
+    index_info->InsertEntries(entries, txn);
+  }
+}
 
 }  // namespace bustub
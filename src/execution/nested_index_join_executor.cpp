@@ -12,19 +12,145 @@
 
 #include "execution/executors/nested_index_join_executor.h"
 
+#include "type/value_factory.h"
+
 namespace bustub {
 
 NestIndexJoinExecutor::NestIndexJoinExecutor(ExecutorContext *exec_ctx, const NestedIndexJoinPlanNode *plan,
                                              std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {
+    : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {
   if (!(plan->GetJoinType() == JoinType::LEFT || plan->GetJoinType() == JoinType::INNER)) {
     // Note for 2022 Fall: You ONLY need to implement left join and inner join.
     throw bustub::NotImplementedException(fmt::format("join type {} not supported", plan->GetJoinType()));
   }
 }
 
-void NestIndexJoinExecutor::Init() { throw NotImplementedException("NestIndexJoinExecutor is not implemented"); }
+void NestIndexJoinExecutor::Init() {
+  child_executor_->Init();
+  auto *catalog = exec_ctx_->GetCatalog();
+  inner_table_info_ = catalog->GetTable(plan_->GetInnerTableOid());
+  index_info_ = catalog->GetIndex(plan_->GetIndexOid());
+  if (plan_->IsIndexOnly() && !index_info_->index_->IsCovering()) {
+    throw NotImplementedException("index-only join on an index that does not store its entries");
+  }
+  results_.clear();
+  cursor_ = 0;
+  outer_done_ = false;
+}
+
+auto NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  while (cursor_ == results_.size()) {
+    results_.clear();
+    cursor_ = 0;
+    // probe the index for a batch of outer tuples at once
+    std::vector<Tuple> outers;
+    Tuple outer;
+    RID outer_rid;
+    while (!outer_done_ && outers.size() < INDEX_SCAN_BATCH_SIZE) {
+      if (!child_executor_->Next(&outer, &outer_rid)) {
+        outer_done_ = true;
+        break;
+      }
+      outers.push_back(outer);
+    }
+    if (outers.empty()) {
+      return false;
+    }
+    JoinBatch(outers);
+  }
+  *tuple = results_[cursor_++];
+  *rid = tuple->GetRid();
+  return true;
+}
+
+void NestIndexJoinExecutor::JoinBatch(const std::vector<Tuple> &outers) {
+  const auto &outer_schema = child_executor_->GetOutputSchema();
+  auto *index = index_info_->index_.get();
+  auto *txn = exec_ctx_->GetTransaction();
 
-auto NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+  // NULL joins nothing; the index keys are encoded from the key column type, so the probe has to match it
+  TypeId key_type = index->GetKeySchema()->GetColumn(0).GetType();
+  std::vector<Value> keys;
+  std::vector<Tuple> key_tuples;
+  for (const auto &outer : outers) {
+    Value key = plan_->KeyPredicate()->Evaluate(&outer, outer_schema);
+    if (!key.IsNull() && key.GetTypeId() != key_type) {
+      key = key.CastAs(key_type);
+    }
+    if (!key.IsNull()) {
+      key_tuples.emplace_back(std::vector<Value>{key}, index->GetKeySchema());
+    }
+    keys.push_back(key);
+  }
+
+  // a whole key is looked up for the batch at once, a key prefix or index entries one outer tuple at a time
+  std::vector<std::vector<RID>> batch_rids;
+  bool batched = !plan_->IsIndexOnly() && index->GetIndexColumnCount() == 1;
+  if (batched) {
+    index->ScanKeys(key_tuples, &batch_rids, txn);
+  }
+  size_t next_rids = 0;
+  for (size_t i = 0; i < outers.size(); i++) {
+    std::vector<std::pair<Tuple, RID>> entries;
+    std::vector<RID> rids;
+    if (!keys[i].IsNull()) {
+      if (batched) {
+        rids = std::move(batch_rids[next_rids++]);
+      } else if (plan_->IsIndexOnly()) {
+        index->ScanKeyPrefixEntries({keys[i]}, &entries, txn);
+      } else {
+        index->ScanKeyPrefix({keys[i]}, &rids, txn);
+      }
+    }
+    Join(outers[i], keys[i], entries, rids);
+  }
+}
+
+void NestIndexJoinExecutor::Join(const Tuple &outer, const Value &key,
+                                 const std::vector<std::pair<Tuple, RID>> &entries, const std::vector<RID> &rids) {
+  const auto &outer_schema = child_executor_->GetOutputSchema();
+  const auto &inner_schema = plan_->InnerTableSchema();
+  auto *index = index_info_->index_.get();
+  uint32_t key_column = index->GetKeyAttrs()[0];
+  std::vector<Value> outer_values;
+  for (uint32_t i = 0; i < outer_schema.GetColumnCount(); i++) {
+    outer_values.push_back(outer.GetValue(&outer_schema, i));
+  }
+
+  // the inner rows come from the table, or straight from the index entries for an index-only join
+  bool joined = false;
+  for (const auto &entry : entries) {
+    std::vector<Value> values = outer_values;
+    size_t inner_begin = values.size();
+    for (const auto &column : inner_schema.GetColumns()) {
+      values.push_back(ValueFactory::GetNullValueByType(column.GetType()));
+    }
+    const auto &entry_attrs = index->GetEntryAttrs();
+    for (uint32_t i = 0; i < entry_attrs.size(); i++) {
+      values[inner_begin + entry_attrs[i]] = entry.first.GetValue(index->GetEntrySchema(), i);
+    }
+    results_.emplace_back(values, &GetOutputSchema());
+    joined = true;
+  }
+  for (const auto &inner_rid : rids) {
+    Tuple inner;
+    if (!inner_table_info_->table_->GetTuple(inner_rid, &inner, exec_ctx_->GetTransaction()) ||
+        inner.GetValue(&inner_table_info_->schema_, key_column).CompareEquals(key) != CmpBool::CmpTrue) {
+      continue;
+    }
+    std::vector<Value> values = outer_values;
+    for (uint32_t i = 0; i < inner_schema.GetColumnCount(); i++) {
+      values.push_back(inner.GetValue(&inner_schema, i));
+    }
+    results_.emplace_back(values, &GetOutputSchema());
+    joined = true;
+  }
+  if (!joined && plan_->GetJoinType() == JoinType::LEFT) {
+    for (uint32_t i = 0; i < inner_schema.GetColumnCount(); i++) {
+      outer_values.push_back(ValueFactory::GetNullValueByType(inner_schema.GetColumn(i).GetType()));
+    }
+    results_.emplace_back(outer_values, &GetOutputSchema());
+  }
+}
 
 }  // namespace bustub
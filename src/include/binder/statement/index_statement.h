@@ -14,6 +14,7 @@
 #include "binder/bound_statement.h"
 #include "binder/expressions/bound_column_ref.h"
 #include "binder/table_ref/bound_base_table_ref.h"
+#include "catalog/catalog.h"
 #include "catalog/column.h"
 
 namespace bustub {
@@ -21,7 +22,9 @@ namespace bustub {
 class IndexStatement : public BoundStatement {
  public:
   explicit IndexStatement(std::string index_name, std::unique_ptr<BoundBaseTableRef> table,
-                          std::vector<std::unique_ptr<BoundColumnRef>> cols);
+                          std::vector<std::unique_ptr<BoundColumnRef>> cols, bool is_unique,
+                          std::vector<std::unique_ptr<BoundColumnRef>> include_cols = {},
+                          IndexType index_type = IndexType::BPlusTreeIndex, bool concurrently = false);
 
   /** Name of the index */
   std::string index_name_;
@@ -32,6 +35,18 @@ class IndexStatement : public BoundStatement {
   /** Name of the columns */
   std::vector<std::unique_ptr<BoundColumnRef>> cols_;
 
+  /** CREATE UNIQUE INDEX */
+  bool is_unique_;
+
+  /** Columns stored in the index next to the key, `WITH (include = 'col, ...')` */
+  std::vector<std::unique_ptr<BoundColumnRef>> include_cols_;
+
+  /** `USING btree` or `USING lsm`, a B+ tree if not given */
+  IndexType index_type_;
+
+  /** CREATE INDEX CONCURRENTLY, built without blocking the planning of other statements */
+  bool concurrently_;
+
   auto ToString() const -> std::string override;
 };
 
@@ -12,19 +12,33 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <exception>
 #include <memory>
+#include <mutex>  // NOLINT
+#include <optional>
+#include <sstream>
 #include <string>
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/schema.h"
+#include "common/exception.h"
+#include "concurrency/transaction.h"
 #include "container/hash/hash_function.h"
 #include "storage/index/b_plus_tree_index.h"
 #include "storage/index/extendible_hash_table_index.h"
 #include "storage/index/index.h"
+#include "storage/index/lsm_tree_index.h"
+#include "storage/page/header_page.h"
 #include "storage/table/table_heap.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -35,6 +49,9 @@ using table_oid_t = uint32_t;
 using column_oid_t = uint32_t;
 using index_oid_t = uint32_t;
 
+/** The data structures an index can be built on */
+enum class IndexType { BPlusTreeIndex = 0, LSMTreeIndex, HashIndex };
+
 /**
  * The TableInfo class maintains metadata about a table.
  */
@@ -70,15 +87,17 @@ struct IndexInfo {
    * @param index_oid The unique OID for the index
    * @param table_name The name of the table on which the index is created
    * @param key_size The size of the index key, in bytes
+   * @param index_type The data structure of the index
    */
   IndexInfo(Schema key_schema, std::string name, std::unique_ptr<Index> &&index, index_oid_t index_oid,
-            std::string table_name, size_t key_size)
+            std::string table_name, size_t key_size, IndexType index_type = IndexType::BPlusTreeIndex)
       : key_schema_{std::move(key_schema)},
         name_{std::move(name)},
         index_{std::move(index)},
         index_oid_{index_oid},
         table_name_{std::move(table_name)},
-        key_size_{key_size} {}
+        key_size_{key_size},
+        index_type_{index_type} {}
   /** The schema for the index key */
   Schema key_schema_;
   /** The name of the index */
@@ -91,12 +110,122 @@ struct IndexInfo {
   std::string table_name_;
   /** The size of the index key, in bytes */
   const size_t key_size_;
+  /** The data structure of the index, only a B+ tree index can be scanned in key order */
+  const IndexType index_type_;
+  /** Whether the index holds every row of its table; the optimizer does not pick it while it is being built */
+  std::atomic<bool> valid_{true};
+
+  /**
+   * Add the entry of a row to the index. Writers to the table go through here, not through index_, so that their
+   * writes are kept in the side log while the index is being built.
+   */
+  void InsertEntry(const Tuple &key, RID rid, Transaction *txn) {
+    if (!LogWrite(true, key, rid)) {
+      index_->InsertEntry(key, rid, txn);
+    }
+  }
+
+  /** Add the entries of a batch of rows to the index, like InsertEntry; the index may insert them in key order. */
+  void InsertEntries(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *txn) {
+    if (!valid_) {
+      std::scoped_lock latch(side_log_latch_);
+      if (!valid_) {
+        for (const auto &[key, rid] : entries) {
+          if (!abandoned_) {
+            side_log_.push_back({true, key, rid});
+          }
+        }
+        return;
+      }
+    }
+    index_->InsertEntries(entries, txn);
+  }
+
+  /** Remove the entry of a row from the index, like InsertEntry. */
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *txn) {
+    if (!LogWrite(false, key, rid)) {
+      index_->DeleteEntry(key, rid, txn);
+    }
+  }
+
+  /**
+   * Once the index holds the rows of a scan of its table, apply the writes made meanwhile in order and mark it
+   * valid. Each batch of the side log is applied without holding its latch, so writers only wait for the last
+   * check that the log is empty.
+   */
+  void FinishBuild(Transaction *txn) {
+    while (true) {
+      std::vector<SideLogEntry> batch;
+      {
+        std::scoped_lock latch(side_log_latch_);
+        if (side_log_.empty()) {
+          valid_ = true;
+          return;
+        }
+        batch.swap(side_log_);
+      }
+      for (const auto &entry : batch) {
+        if (entry.insert_) {
+          index_->InsertEntry(entry.key_, entry.rid_, txn);
+        } else {
+          index_->DeleteEntry(entry.key_, entry.rid_, txn);
+        }
+      }
+    }
+  }
+
+  /**
+   * Give up on an index whose build failed: the side log is dropped and the writes of whoever still holds this
+   * IndexInfo are ignored from now on, as the index never becomes valid.
+   */
+  void Abandon() {
+    std::scoped_lock latch(side_log_latch_);
+    abandoned_ = true;
+    side_log_.clear();
+  }
+
+ private:
+  /** A write to the table made while the index was being built */
+  struct SideLogEntry {
+    bool insert_;
+    Tuple key_;
+    RID rid_;
+  };
+
+  /** @return Whether the write went to the side log, as the index is still being built */
+  auto LogWrite(bool insert, const Tuple &key, RID rid) -> bool {
+    if (valid_) {
+      return false;
+    }
+    std::scoped_lock latch(side_log_latch_);
+    if (valid_) {
+      return false;
+    }
+    if (!abandoned_) {
+      side_log_.push_back({insert, key, rid});
+    }
+    return true;
+  }
+
+  std::mutex side_log_latch_;
+  std::vector<SideLogEntry> side_log_;
+  /** Set under side_log_latch_ once the build failed, see Abandon */
+  bool abandoned_{false};
 };
 
 /**
- * The Catalog is a non-persistent catalog that is designed for
- * use by executors within the DBMS execution engine. It handles
- * table creation, table lookup, index creation, and index lookup.
+ * The Catalog is designed for use by executors within the DBMS execution
+ * engine. It handles table creation, table lookup, index creation, and index
+ * lookup.
+ *
+ * A persistent catalog additionally records its metadata in three system
+ * tables, `__tables`, `__columns` and `__indexes`, whose first pages are kept
+ * in the header page next to the B+ tree roots and the next OID counters.
+ * Opening it only opens the system tables. A table and its indexes are built
+ * the first time they are referenced by name or OID, from the rows the system
+ * tables hold for them, so opening a database does not depend on the number
+ * of tables in it. Indexes are rebuilt from their table heap when they are
+ * loaded, without holding the catalog latch.
  */
 class Catalog {
  public:
@@ -106,14 +235,42 @@ class Catalog {
   /** Indicates that an operation returning a `IndexInfo*` failed */
   static constexpr IndexInfo *NULL_INDEX_INFO{nullptr};
 
+  /** The system table RefreshIndexStats fills */
+  static constexpr const char *INDEX_STATS_TABLE = "__index_stats";
+
+  /**
+   * __index_stats(index_oid, table_name, index_name, height, level_pages, pages, entries, leaf_fill_avg,
+   * leaf_fill_p10, leaf_fill_p50, leaf_fill_p90, internal_fill_avg, leaf_contiguity, wasted_bytes), the fields of
+   * BPlusTreeStats with level_pages listing the pages per level from the root down
+   */
+  inline static const Schema INDEX_STATS_SCHEMA{std::vector<Column>{{"index_oid", TypeId::INTEGER},
+                                                                    {"table_name", TypeId::VARCHAR, 128},
+                                                                    {"index_name", TypeId::VARCHAR, 128},
+                                                                    {"height", TypeId::INTEGER},
+                                                                    {"level_pages", TypeId::VARCHAR, 128},
+                                                                    {"pages", TypeId::BIGINT},
+                                                                    {"entries", TypeId::BIGINT},
+                                                                    {"leaf_fill_avg", TypeId::DECIMAL},
+                                                                    {"leaf_fill_p10", TypeId::DECIMAL},
+                                                                    {"leaf_fill_p50", TypeId::DECIMAL},
+                                                                    {"leaf_fill_p90", TypeId::DECIMAL},
+                                                                    {"internal_fill_avg", TypeId::DECIMAL},
+                                                                    {"leaf_contiguity", TypeId::DECIMAL},
+                                                                    {"wasted_bytes", TypeId::BIGINT}}};
+
   /**
    * Construct a new Catalog instance.
    * @param bpm The buffer pool manager backing tables created by this catalog
    * @param lock_manager The lock manager in use by the system
    * @param log_manager The log manager in use by the system
+   * @param persistent Whether to keep metadata in system tables, the header page must already exist
    */
-  Catalog(BufferPoolManager *bpm, LockManager *lock_manager, LogManager *log_manager)
-      : bpm_{bpm}, lock_manager_{lock_manager}, log_manager_{log_manager} {}
+  Catalog(BufferPoolManager *bpm, LockManager *lock_manager, LogManager *log_manager, bool persistent = false)
+      : bpm_{bpm}, lock_manager_{lock_manager}, log_manager_{log_manager} {
+    if (persistent) {
+      OpenSystemTables();
+    }
+  }
 
   /**
    * Create a new table and return its metadata.
@@ -125,7 +282,8 @@ class Catalog {
    */
   auto CreateTable(Transaction *txn, const std::string &table_name, const Schema &schema, bool create_table_heap = true)
       -> TableInfo * {
-    if (table_names_.count(table_name) != 0) {
+    std::scoped_lock latch(catalog_latch_);
+    if (table_names_.count(table_name) != 0 || FindPersistedTable(table_name).has_value()) {
       return NULL_TABLE_INFO;
     }
 
@@ -142,6 +300,14 @@ class Catalog {
     // Fetch the table OID for the new table
     const auto table_oid = next_table_oid_.fetch_add(1);
 
+    // Tables without a heap only exist for the lifetime of this instance
+    if (tables_heap_ != nullptr) {
+      StoreCounter(NEXT_TABLE_OID_RECORD, next_table_oid_);
+      if (table != nullptr) {
+        StoreTable(txn, table_oid, table_name, schema, table->GetFirstPageId());
+      }
+    }
+
     // Construct the table information
     auto meta = std::make_unique<TableInfo>(schema, table_name, std::move(table), table_oid);
     auto *tmp = meta.get();
@@ -160,10 +326,15 @@ class Catalog {
    * @return A (non-owning) pointer to the metadata for the table
    */
   auto GetTable(const std::string &table_name) const -> TableInfo * {
+    std::unique_lock latch(catalog_latch_);
     auto table_oid = table_names_.find(table_name);
     if (table_oid == table_names_.end()) {
-      // Table not found
-      return NULL_TABLE_INFO;
+      // Table not found, unless it has not been loaded yet
+      auto persisted = FindPersistedTable(table_name);
+      if (!persisted.has_value()) {
+        return NULL_TABLE_INFO;
+      }
+      return LoadTable(*persisted, &latch);
     }
 
     auto meta = tables_.find(table_oid->second);
@@ -178,16 +349,19 @@ class Catalog {
    * @return A (non-owning) pointer to the metadata for the table
    */
   auto GetTable(table_oid_t table_oid) const -> TableInfo * {
+    std::unique_lock latch(catalog_latch_);
     auto meta = tables_.find(table_oid);
     if (meta == tables_.end()) {
-      return NULL_TABLE_INFO;
+      return LoadTable(table_oid, &latch);
     }
 
     return (meta->second).get();
   }
 
   /**
-   * Create a new index, populate existing data of the table and return its metadata.
+   * Create a new index, populate existing data of the table and return its metadata. The catalog latch is not held
+   * while the table is scanned, writes to the table made meanwhile are applied from the index's side log. If the
+   * build throws, the index is removed again and the exception is passed on.
    * @param txn The transaction in which the table is being created
    * @param index_name The name of the new index
    * @param table_name The name of the table
@@ -196,16 +370,24 @@ class Catalog {
    * @param key_attrs Key attributes
    * @param keysize Size of the key
    * @param hash_function The hash function for the index
+   * @param fill_factor How full (0, 1] to pack the pages built from the existing rows
+   * @param is_unique Whether a key maps to at most one row, the keys of a non-unique index need 8 more bytes
+   * @param include_attrs Table columns stored in the index entries after the key, they need room in the keys as well
+   * @param index_type The data structure to build the index on
    * @return A (non-owning) pointer to the metadata of the new table
    */
   template <class KeyType, class ValueType, class KeyComparator>
   auto CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name, const Schema &schema,
                    const Schema &key_schema, const std::vector<uint32_t> &key_attrs, std::size_t keysize,
-                   HashFunction<KeyType> hash_function) -> IndexInfo * {
+                   HashFunction<KeyType> hash_function, double fill_factor = INDEX_FILL_FACTOR, bool is_unique = true,
+                   const std::vector<uint32_t> &include_attrs = {},
+                   IndexType index_type = IndexType::BPlusTreeIndex) -> IndexInfo * {
     // Reject the creation request for nonexistent table
-    if (table_names_.find(table_name) == table_names_.end()) {
+    auto *table_meta = GetTable(table_name);
+    if (table_meta == NULL_TABLE_INFO) {
       return NULL_INDEX_INFO;
     }
+    std::unique_lock latch(catalog_latch_);
 
     // If the table exists, an entry for the table should already be present in index_names_
     BUSTUB_ASSERT((index_names_.find(table_name) != index_names_.end()), "Broken Invariant");
@@ -217,39 +399,151 @@ class Catalog {
       return NULL_INDEX_INFO;
     }
 
+    // Get the next OID for the new index
+    const auto index_oid = next_index_oid_.fetch_add(1);
+
     // Construct index metdata
-    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs);
+    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs, is_unique, include_attrs,
+                                                index_oid);
 
     // Construct the index, take ownership of metadata
-    // TODO(Kyle): We should update the API for CreateIndex
-    // to allow specification of the index type itself, not
-    // just the key, value, and comparator types
-
-    // TODO(chi): support both hash index and btree index
-    auto index = std::make_unique<BPlusTreeIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_);
+    auto index = MakeIndex<KeyType, ValueType, KeyComparator>(std::move(meta), index_type, hash_function);
 
-    // Populate the index with all tuples in table heap
-    auto *table_meta = GetTable(table_name);
-    auto *heap = table_meta->table_.get();
-    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
-      index->InsertEntry(tuple->KeyFromTuple(schema, key_schema, key_attrs), tuple->GetRid(), txn);
-    }
-
-    // Get the next OID for the new index
-    const auto index_oid = next_index_oid_.fetch_add(1);
-
-    // Construct index information; IndexInfo takes ownership of the Index itself
-    auto index_info =
-        std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name, keysize);
+    // Construct index information; IndexInfo takes ownership of the Index itself. It is registered before the table
+    // is scanned, from then on writers to the table keep their writes in its side log
+    auto index_info = std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name,
+                                                  keysize, index_type);
     auto *tmp = index_info.get();
+    tmp->valid_ = false;
 
     // Update internal tracking
     indexes_.emplace(index_oid, std::move(index_info));
     table_indexes.emplace(index_name, index_oid);
+    latch.unlock();
+
+    // Populate the index with all tuples in table heap without holding the catalog latch: collect the keys in one
+    // scan and let the index sort them and build its pages bottom-up, instead of descending from the root once per
+    // tuple. Then catch up with the writes made during the scan.
+    auto *heap = table_meta->table_.get();
+    try {
+      if (heap != nullptr) {
+        auto *new_index = tmp->index_.get();
+        std::vector<std::pair<Tuple, RID>> entries;
+        for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
+          entries.emplace_back(tuple->KeyFromTuple(schema, *new_index->GetEntrySchema(), new_index->GetEntryAttrs()),
+                               tuple->GetRid());
+        }
+        if (!entries.empty()) {
+          new_index->BulkLoad(entries, txn, fill_factor);
+        }
+      }
+      tmp->FinishBuild(txn);
+    } catch (...) {
+      // Unregister the index so that its name can be used again. Writers may still hold its IndexInfo, which is
+      // kept alive and ignores their writes from now on
+      tmp->Abandon();
+      latch.lock();
+      index_names_.find(table_name)->second.erase(index_name);
+      auto index_entry = indexes_.find(index_oid);
+      abandoned_indexes_.push_back(std::move(index_entry->second));
+      indexes_.erase(index_entry);
+      latch.unlock();
+      tmp->index_->Drop();
+      throw;
+    }
+
+    latch.lock();
+    if (tables_heap_ != nullptr && heap != nullptr) {
+      StoreCounter(NEXT_INDEX_OID_RECORD, next_index_oid_);
+      StoreIndex(txn, index_oid, table_meta->oid_, index_name, key_attrs, include_attrs, keysize, sizeof(KeyType),
+                 IS_NORMALIZED_KEY<KeyType>, is_unique, index_type);
+    }
 
     return tmp;
   }
 
+  /**
+   * Create a B+ tree index on any key columns. The key size is picked at runtime from the key schema, see
+   * BPlusTreeKeySizeFor; keys with long VARCHARs keep an inline prefix of them. Included columns are stored after the
+   * key, an index that holds them in full can answer queries on its columns without reading the table.
+   * @param txn The transaction in which the index is being created
+   * @param index_name The name of the new index
+   * @param table_name The name of the table
+   * @param schema The schema of the table
+   * @param key_schema The schema of the key
+   * @param key_attrs Key attributes
+   * @param fill_factor How full (0, 1] to pack the pages built from the existing rows
+   * @param is_unique Whether a key maps to at most one row
+   * @param include_attrs Table columns stored next to the key
+   * @return A (non-owning) pointer to the metadata of the new index
+   */
+  auto CreateBPlusTreeIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
+                            const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
+                            double fill_factor = INDEX_FILL_FACTOR, bool is_unique = true,
+                            const std::vector<uint32_t> &include_attrs = {}) -> IndexInfo * {
+    std::vector<uint32_t> entry_attrs = key_attrs;
+    entry_attrs.insert(entry_attrs.end(), include_attrs.begin(), include_attrs.end());
+    switch (BPlusTreeKeySizeFor(Schema::CopySchema(&schema, entry_attrs), is_unique)) {
+      case 4:
+        return CreateNormalizedIndex<4>(txn, index_name, table_name, schema, key_schema, key_attrs, fill_factor,
+                                        is_unique, include_attrs);
+      case 8:
+        return CreateNormalizedIndex<8>(txn, index_name, table_name, schema, key_schema, key_attrs, fill_factor,
+                                        is_unique, include_attrs);
+      case 16:
+        return CreateNormalizedIndex<16>(txn, index_name, table_name, schema, key_schema, key_attrs, fill_factor,
+                                         is_unique, include_attrs);
+      case 32:
+        return CreateNormalizedIndex<32>(txn, index_name, table_name, schema, key_schema, key_attrs, fill_factor,
+                                         is_unique, include_attrs);
+      case 64:
+        return CreateNormalizedIndex<64>(txn, index_name, table_name, schema, key_schema, key_attrs, fill_factor,
+                                         is_unique, include_attrs);
+      default:
+        throw NotImplementedException("index key columns are wider than 64 bytes");
+    }
+  }
+
+  /**
+   * Create an LSM tree index, which takes writes at the cost of slower lookups. The key size is the smallest of 4,
+   * 8, 16, 32 and 64 bytes that holds the key columns in full. The index is rebuilt from its table when the catalog
+   * is reopened.
+   * @param txn The transaction in which the index is being created
+   * @param index_name The name of the new index
+   * @param table_name The name of the table
+   * @param schema The schema of the table
+   * @param key_schema The schema of the key
+   * @param key_attrs Key attributes
+   * @param is_unique Whether a key maps to at most one row
+   * @return A (non-owning) pointer to the metadata of the new index
+   */
+  auto CreateLSMTreeIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
+                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
+                          bool is_unique = true) -> IndexInfo * {
+    return CreateFullKeyIndex(txn, index_name, table_name, schema, key_schema, key_attrs, is_unique,
+                              IndexType::LSMTreeIndex);
+  }
+
+  /**
+   * Create an extendible hash index, which only answers lookups of the whole key but reads a single bucket page for
+   * them. The key size is picked like for CreateLSMTreeIndex, and the index is rebuilt from its table when the
+   * catalog is reopened as well.
+   * @param txn The transaction in which the index is being created
+   * @param index_name The name of the new index
+   * @param table_name The name of the table
+   * @param schema The schema of the table
+   * @param key_schema The schema of the key
+   * @param key_attrs Key attributes
+   * @param is_unique Whether a key maps to at most one row
+   * @return A (non-owning) pointer to the metadata of the new index
+   */
+  auto CreateHashIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
+                       const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
+                       bool is_unique = true) -> IndexInfo * {
+    return CreateFullKeyIndex(txn, index_name, table_name, schema, key_schema, key_attrs, is_unique,
+                              IndexType::HashIndex);
+  }
+
   /**
    * Get the index `index_name` for table `table_name`.
    * @param index_name The name of the index for which to query
@@ -257,6 +551,8 @@ class Catalog {
    * @return A (non-owning) pointer to the metadata for the index
    */
   auto GetIndex(const std::string &index_name, const std::string &table_name) -> IndexInfo * {
+    GetTable(table_name);
+    std::scoped_lock latch(catalog_latch_);
     auto table = index_names_.find(table_name);
     if (table == index_names_.end()) {
       BUSTUB_ASSERT((table_names_.find(table_name) == table_names_.end()), "Broken Invariant");
@@ -284,13 +580,13 @@ class Catalog {
    */
   auto GetIndex(const std::string &index_name, const table_oid_t table_oid) -> IndexInfo * {
     // Locate the table metadata for the specified table OID
-    auto table_meta = tables_.find(table_oid);
-    if (table_meta == tables_.end()) {
+    auto *table_meta = GetTable(table_oid);
+    if (table_meta == NULL_TABLE_INFO) {
       // Table not found
       return NULL_INDEX_INFO;
     }
 
-    return GetIndex(index_name, table_meta->second->name_);
+    return GetIndex(index_name, table_meta->name_);
   }
 
   /**
@@ -298,10 +594,17 @@ class Catalog {
    * @param index_oid The OID of the index for which to query
    * @return A (non-owning) pointer to the metadata for the index
    */
-  auto GetIndex(index_oid_t index_oid) -> IndexInfo * {
+  auto GetIndex(index_oid_t index_oid) const -> IndexInfo * {
+    std::unique_lock latch(catalog_latch_);
     auto index = indexes_.find(index_oid);
     if (index == indexes_.end()) {
-      return NULL_INDEX_INFO;
+      // Loading the table of a persisted index loads the index as well
+      auto table_oid = FindPersistedIndex(index_oid);
+      if (!table_oid.has_value() || LoadTable(*table_oid, &latch) == NULL_TABLE_INFO) {
+        return NULL_INDEX_INFO;
+      }
+      index = indexes_.find(index_oid);
+      BUSTUB_ASSERT((index != indexes_.end()), "Broken Invariant");
     }
 
     return index->second.get();
@@ -315,9 +618,10 @@ class Catalog {
    */
   auto GetTableIndexes(const std::string &table_name) const -> std::vector<IndexInfo *> {
     // Ensure the table exists
-    if (table_names_.find(table_name) == table_names_.end()) {
+    if (GetTable(table_name) == NULL_TABLE_INFO) {
       return std::vector<IndexInfo *>{};
     }
+    std::scoped_lock latch(catalog_latch_);
 
     auto table_indexes = index_names_.find(table_name);
     BUSTUB_ASSERT((table_indexes != index_names_.end()), "Broken Invariant");
@@ -333,28 +637,620 @@ class Catalog {
     return indexes;
   }
 
+  /**
+   * Rebuild all indexes of `table_name` from its table heap. Index pages are not covered by the log,
+   * so this is how indexes are brought back after recovery; loading a table does the same.
+   * @param txn The transaction in which the indexes are rebuilt
+   * @param table_name The name of the table
+   * @return The number of rows that were indexed
+   */
+  auto RebuildIndexes(Transaction *txn, const std::string &table_name) -> size_t {
+    auto *table_info = GetTable(table_name);
+    auto index_infos = GetTableIndexes(table_name);
+    if (table_info == NULL_TABLE_INFO || table_info->table_ == nullptr) {
+      return 0;
+    }
+    std::vector<Index *> indexes;
+    indexes.reserve(index_infos.size());
+    for (auto *index_info : index_infos) {
+      indexes.push_back(index_info->index_.get());
+    }
+    return LoadIndexesFromHeap(txn, table_info, indexes);
+  }
+
+  /**
+   * Refill the `__index_stats` system table with the current statistics of every B+ tree index, one row per index
+   * laid out as INDEX_STATS_SCHEMA. The table is not listed in `__tables` and is created by the first refresh, a
+   * persistent catalog reuses the heap of earlier instances through a header page record.
+   * @param txn The transaction in which `__index_stats` is created by the first refresh
+   * @return A (non-owning) pointer to the metadata of `__index_stats`, NULL_TABLE_INFO without a buffer pool
+   */
+  auto RefreshIndexStats(Transaction *txn) -> TableInfo * {
+    if (bpm_ == nullptr) {
+      return NULL_TABLE_INFO;
+    }
+    // Walking the trees does not need the catalog latch
+    std::vector<std::vector<Value>> rows;
+    for (const auto &table_name : GetTableNames()) {
+      for (auto *index_info : GetTableIndexes(table_name)) {
+        auto stats = index_info->index_->GetTreeStats();
+        if (!stats.has_value()) {
+          continue;
+        }
+        std::string level_pages;
+        for (auto pages : stats->level_pages_) {
+          level_pages += (level_pages.empty() ? "" : ",") + std::to_string(pages);
+        }
+        rows.push_back({ValueFactory::GetIntegerValue(index_info->index_oid_),
+                        ValueFactory::GetVarcharValue(table_name), ValueFactory::GetVarcharValue(index_info->name_),
+                        ValueFactory::GetIntegerValue(stats->height_), ValueFactory::GetVarcharValue(level_pages),
+                        ValueFactory::GetBigIntValue(stats->PageCount()),
+                        ValueFactory::GetBigIntValue(stats->entries_),
+                        ValueFactory::GetDecimalValue(stats->leaf_fill_avg_),
+                        ValueFactory::GetDecimalValue(stats->leaf_fill_p10_),
+                        ValueFactory::GetDecimalValue(stats->leaf_fill_p50_),
+                        ValueFactory::GetDecimalValue(stats->leaf_fill_p90_),
+                        ValueFactory::GetDecimalValue(stats->internal_fill_avg_),
+                        ValueFactory::GetDecimalValue(stats->leaf_contiguity_),
+                        ValueFactory::GetBigIntValue(stats->wasted_bytes_)});
+      }
+    }
+
+    std::scoped_lock latch(catalog_latch_);
+    auto stats_oid = table_names_.find(INDEX_STATS_TABLE);
+    auto *table_info = stats_oid == table_names_.end() ? NULL_TABLE_INFO : tables_.at(stats_oid->second).get();
+    if (table_info == NULL_TABLE_INFO) {
+      // Not recorded in __tables, the statistics are recomputed instead of persisted. A persistent catalog keeps the
+      // heap in a header page record though, so that every start refills the same pages instead of allocating more.
+      const auto table_oid = next_table_oid_.fetch_add(1);
+      std::unique_ptr<TableHeap> heap;
+      if (tables_heap_ != nullptr) {
+        auto *header_page = static_cast<HeaderPage *>(bpm_->FetchPage(HEADER_PAGE_ID));
+        header_page->WLatch();
+        heap = OpenRecordedHeap(header_page, INDEX_STATS_TABLE);
+        header_page->WUnlatch();
+        bpm_->UnpinPage(HEADER_PAGE_ID, true);
+        bpm_->FlushPage(HEADER_PAGE_ID);
+      } else {
+        heap = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn);
+      }
+      auto meta = std::make_unique<TableInfo>(INDEX_STATS_SCHEMA, INDEX_STATS_TABLE, std::move(heap), table_oid);
+      table_info = meta.get();
+      tables_.emplace(table_oid, std::move(meta));
+      table_names_.emplace(INDEX_STATS_TABLE, table_oid);
+      index_names_.emplace(INDEX_STATS_TABLE, std::unordered_map<std::string, index_oid_t>{});
+    }
+    // The rows are replaced outside of txn, aborting it does not bring back older statistics
+    auto *heap = table_info->table_.get();
+    Transaction system_txn(INVALID_TXN_ID);
+    std::vector<RID> old_rows;
+    for (auto row = heap->Begin(&system_txn); row != heap->End(); ++row) {
+      old_rows.push_back(row->GetRid());
+    }
+    for (const auto &rid : old_rows) {
+      heap->ApplyDelete(rid, &system_txn);
+    }
+    for (auto &row : rows) {
+      StoreRow(heap, INDEX_STATS_SCHEMA, std::move(row), &system_txn);
+    }
+    return table_info;
+  }
+
   auto GetTableNames() -> std::vector<std::string> {
+    std::scoped_lock latch(catalog_latch_);
     std::vector<std::string> result;
     for (const auto &x : table_names_) {
       result.push_back(x.first);
     }
+    // Persisted tables that have not been referenced yet are listed without loading them
+    if (tables_heap_ != nullptr) {
+      Transaction system_txn(INVALID_TXN_ID);
+      for (auto row = tables_heap_->Begin(&system_txn); row != tables_heap_->End(); ++row) {
+        auto name = row->GetValue(&TABLES_SCHEMA, 1).ToString();
+        if (table_names_.count(name) == 0) {
+          result.push_back(std::move(name));
+        }
+      }
+    }
     return result;
   }
 
  private:
+  /** Header page records locating the system tables and holding the next OID counters */
+  static constexpr const char *TABLES_RECORD = "__tables";
+  static constexpr const char *COLUMNS_RECORD = "__columns";
+  static constexpr const char *INDEXES_RECORD = "__indexes";
+  static constexpr const char *NEXT_TABLE_OID_RECORD = "__next_table_oid";
+  static constexpr const char *NEXT_INDEX_OID_RECORD = "__next_index_oid";
+
+  /** __tables(oid, name, first_page_id) */
+  inline static const Schema TABLES_SCHEMA{std::vector<Column>{
+      {"oid", TypeId::INTEGER}, {"name", TypeId::VARCHAR, 128}, {"first_page_id", TypeId::INTEGER}}};
+  /** __columns(table_oid, ordinal, name, type, length) */
+  inline static const Schema COLUMNS_SCHEMA{std::vector<Column>{{"table_oid", TypeId::INTEGER},
+                                                                {"ordinal", TypeId::INTEGER},
+                                                                {"name", TypeId::VARCHAR, 128},
+                                                                {"type", TypeId::INTEGER},
+                                                                {"length", TypeId::INTEGER}}};
+  /**
+   * __indexes(oid, table_oid, name, key_attrs, key_size, key_width, normalized, is_unique, index_type), key_width
+   * picks the key size N and normalized whether the keys are NormalizedKey<N> or GenericKey<N>. key_attrs lists the
+   * key columns, followed by the included columns after a ';' if there are any. index_type is an IndexType.
+   */
+  inline static const Schema INDEXES_SCHEMA{std::vector<Column>{{"oid", TypeId::INTEGER},
+                                                                {"table_oid", TypeId::INTEGER},
+                                                                {"name", TypeId::VARCHAR, 128},
+                                                                {"key_attrs", TypeId::VARCHAR, 128},
+                                                                {"key_size", TypeId::INTEGER},
+                                                                {"key_width", TypeId::INTEGER},
+                                                                {"normalized", TypeId::BOOLEAN},
+                                                                {"is_unique", TypeId::BOOLEAN},
+                                                                {"index_type", TypeId::INTEGER}}};
+
+  /** The rows in the system tables that describe one persisted table */
+  struct PersistedTable {
+    RID table_row_;
+    std::vector<RID> column_rows_;
+    std::vector<RID> index_rows_;
+  };
+
+  /** A table and its indexes built by MaterializeTable, not yet known to the catalog */
+  struct LoadedTable {
+    std::unique_ptr<TableInfo> table_;
+    std::vector<std::unique_ptr<IndexInfo>> indexes_;
+  };
+
+  /** Open the heap the record of the write latched header page locates, creating and recording it if there is none. */
+  auto OpenRecordedHeap(HeaderPage *header_page, const std::string &record) -> std::unique_ptr<TableHeap> {
+    page_id_t first_page_id;
+    if (header_page->GetRootId(record, &first_page_id)) {
+      return std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, first_page_id);
+    }
+    auto heap = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, nullptr);
+    header_page->InsertRecord(record, heap->GetFirstPageId());
+    bpm_->FlushPage(heap->GetFirstPageId());
+    return heap;
+  }
+
+  /** Open the system tables recorded in the header page, creating them for a new database. */
+  void OpenSystemTables() {
+    auto *header_page = static_cast<HeaderPage *>(bpm_->FetchPage(HEADER_PAGE_ID));
+    header_page->WLatch();
+    auto open_counter = [&](const std::string &record) {
+      page_id_t value = 0;
+      if (!header_page->GetRootId(record, &value)) {
+        header_page->InsertRecord(record, value);
+      }
+      return static_cast<uint32_t>(value);
+    };
+    tables_heap_ = OpenRecordedHeap(header_page, TABLES_RECORD);
+    columns_heap_ = OpenRecordedHeap(header_page, COLUMNS_RECORD);
+    indexes_heap_ = OpenRecordedHeap(header_page, INDEXES_RECORD);
+    next_table_oid_ = open_counter(NEXT_TABLE_OID_RECORD);
+    next_index_oid_ = open_counter(NEXT_INDEX_OID_RECORD);
+    header_page->WUnlatch();
+    bpm_->UnpinPage(HEADER_PAGE_ID, true);
+    bpm_->FlushPage(HEADER_PAGE_ID);
+  }
+
+  /** @return The OID of the table `table_name` in `__tables`, std::nullopt if it is not there or not persistent */
+  auto FindPersistedTable(const std::string &table_name) const -> std::optional<table_oid_t> {
+    if (tables_heap_ == nullptr) {
+      return std::nullopt;
+    }
+    Transaction system_txn(INVALID_TXN_ID);
+    for (auto row = tables_heap_->Begin(&system_txn); row != tables_heap_->End(); ++row) {
+      if (row->GetValue(&TABLES_SCHEMA, 1).ToString() == table_name) {
+        return static_cast<table_oid_t>(row->GetValue(&TABLES_SCHEMA, 0).GetAs<int32_t>());
+      }
+    }
+    return std::nullopt;
+  }
+
+  /** @return The OID of the table of the index `index_oid` in `__indexes`, std::nullopt if it is not there */
+  auto FindPersistedIndex(index_oid_t index_oid) const -> std::optional<table_oid_t> {
+    if (indexes_heap_ == nullptr) {
+      return std::nullopt;
+    }
+    Transaction system_txn(INVALID_TXN_ID);
+    for (auto row = indexes_heap_->Begin(&system_txn); row != indexes_heap_->End(); ++row) {
+      if (static_cast<index_oid_t>(row->GetValue(&INDEXES_SCHEMA, 0).GetAs<int32_t>()) == index_oid) {
+        return static_cast<table_oid_t>(row->GetValue(&INDEXES_SCHEMA, 1).GetAs<int32_t>());
+      }
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Collect the rows that describe the persisted table `table_oid`, one pass over each system table. std::nullopt
+   * if the table is not in `__tables`.
+   */
+  auto CollectPersistedRows(table_oid_t table_oid) const -> std::optional<PersistedTable> {
+    if (tables_heap_ == nullptr) {
+      return std::nullopt;
+    }
+    Transaction system_txn(INVALID_TXN_ID);
+    PersistedTable rows;
+    bool found = false;
+    for (auto row = tables_heap_->Begin(&system_txn); row != tables_heap_->End(); ++row) {
+      if (static_cast<table_oid_t>(row->GetValue(&TABLES_SCHEMA, 0).GetAs<int32_t>()) == table_oid) {
+        rows.table_row_ = row->GetRid();
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      return std::nullopt;
+    }
+    for (auto row = columns_heap_->Begin(&system_txn); row != columns_heap_->End(); ++row) {
+      if (static_cast<table_oid_t>(row->GetValue(&COLUMNS_SCHEMA, 0).GetAs<int32_t>()) == table_oid) {
+        rows.column_rows_.push_back(row->GetRid());
+      }
+    }
+    for (auto row = indexes_heap_->Begin(&system_txn); row != indexes_heap_->End(); ++row) {
+      if (static_cast<table_oid_t>(row->GetValue(&INDEXES_SCHEMA, 1).GetAs<int32_t>()) == table_oid) {
+        rows.index_rows_.push_back(row->GetRid());
+      }
+    }
+    return rows;
+  }
+
+  void StoreCounter(const std::string &record, uint32_t value) {
+    auto *header_page = static_cast<HeaderPage *>(bpm_->FetchPage(HEADER_PAGE_ID));
+    header_page->WLatch();
+    header_page->UpdateRecord(record, static_cast<page_id_t>(value));
+    header_page->WUnlatch();
+    bpm_->UnpinPage(HEADER_PAGE_ID, true);
+  }
+
+  /** Append a row to a system table as part of `txn`, DDL issued without a transaction gets a private one. */
+  static void StoreRow(TableHeap *heap, const Schema &schema, std::vector<Value> values, Transaction *txn) {
+    Tuple row{std::move(values), &schema};
+    RID rid;
+    if (txn != nullptr) {
+      heap->InsertTuple(row, &rid, txn);
+      return;
+    }
+    Transaction system_txn(INVALID_TXN_ID);
+    heap->InsertTuple(row, &rid, &system_txn);
+  }
+
+  void StoreTable(Transaction *txn, table_oid_t oid, const std::string &name, const Schema &schema,
+                  page_id_t first_page_id) {
+    StoreRow(tables_heap_.get(), TABLES_SCHEMA,
+             {ValueFactory::GetIntegerValue(oid), ValueFactory::GetVarcharValue(name),
+              ValueFactory::GetIntegerValue(first_page_id)},
+             txn);
+    for (uint32_t i = 0; i < schema.GetColumnCount(); i++) {
+      const auto &column = schema.GetColumn(i);
+      StoreRow(columns_heap_.get(), COLUMNS_SCHEMA,
+               {ValueFactory::GetIntegerValue(oid), ValueFactory::GetIntegerValue(i),
+                ValueFactory::GetVarcharValue(column.GetName()),
+                ValueFactory::GetIntegerValue(static_cast<int32_t>(column.GetType())),
+                ValueFactory::GetIntegerValue(column.GetLength())},
+               txn);
+    }
+  }
+
+  void StoreIndex(Transaction *txn, index_oid_t oid, table_oid_t table_oid, const std::string &name,
+                  const std::vector<uint32_t> &key_attrs, const std::vector<uint32_t> &include_attrs, size_t key_size,
+                  size_t key_width, bool normalized, bool is_unique, IndexType index_type) {
+    std::string attrs;
+    for (auto attr : key_attrs) {
+      attrs += (attrs.empty() ? "" : ",") + std::to_string(attr);
+    }
+    for (size_t i = 0; i < include_attrs.size(); i++) {
+      attrs += (i == 0 ? ";" : ",") + std::to_string(include_attrs[i]);
+    }
+    StoreRow(indexes_heap_.get(), INDEXES_SCHEMA,
+             {ValueFactory::GetIntegerValue(oid), ValueFactory::GetIntegerValue(table_oid),
+              ValueFactory::GetVarcharValue(name), ValueFactory::GetVarcharValue(attrs),
+              ValueFactory::GetIntegerValue(key_size), ValueFactory::GetIntegerValue(key_width),
+              ValueFactory::GetBooleanValue(normalized), ValueFactory::GetBooleanValue(is_unique),
+              ValueFactory::GetIntegerValue(static_cast<int32_t>(index_type))},
+             txn);
+  }
+
+  /**
+   * Load a persisted table and its indexes by OID, NULL_TABLE_INFO if there is none. `latch` holds the catalog latch
+   * and is released while the rows are read and the indexes rebuilt, lookups of the same table wait for the load.
+   */
+  auto LoadTable(table_oid_t table_oid, std::unique_lock<std::mutex> *latch) const -> TableInfo * {
+    table_loaded_.wait(*latch, [&] { return loading_tables_.count(table_oid) == 0; });
+    auto meta = tables_.find(table_oid);
+    if (meta != tables_.end()) {
+      return meta->second.get();
+    }
+    if (tables_heap_ == nullptr) {
+      return NULL_TABLE_INFO;
+    }
+    loading_tables_.insert(table_oid);
+    latch->unlock();
+
+    LoadedTable loaded;
+    try {
+      auto rows = CollectPersistedRows(table_oid);
+      if (rows.has_value()) {
+        loaded = MaterializeTable(*rows);
+      }
+    } catch (...) {
+      latch->lock();
+      loading_tables_.erase(table_oid);
+      table_loaded_.notify_all();
+      throw;
+    }
+
+    latch->lock();
+    if (loaded.table_ == nullptr) {
+      loading_tables_.erase(table_oid);
+      table_loaded_.notify_all();
+      return NULL_TABLE_INFO;
+    }
+    auto *table_info = loaded.table_.get();
+    const auto &table_name = table_info->name_;
+    tables_.emplace(table_oid, std::move(loaded.table_));
+    table_names_.emplace(table_name, table_oid);
+    auto &table_indexes = index_names_.emplace(table_name, std::unordered_map<std::string, index_oid_t>{}).first->second;
+    for (auto &index_info : loaded.indexes_) {
+      table_indexes.emplace(index_info->name_, index_info->index_oid_);
+      const auto index_oid = index_info->index_oid_;
+      indexes_.emplace(index_oid, std::move(index_info));
+    }
+    loading_tables_.erase(table_oid);
+    table_loaded_.notify_all();
+    return table_info;
+  }
+
+  /**
+   * Load `indexes` of a table from its table heap. The heap is scanned once; every index then extracts and sorts
+   * its keys on its own thread and is loaded bottom-up, replacing whatever it held.
+   * @return The number of rows that were indexed, 0 if there are no indexes
+   */
+  static auto LoadIndexesFromHeap(Transaction *txn, const TableInfo *table_info, const std::vector<Index *> &indexes)
+      -> size_t {
+    if (indexes.empty()) {
+      return 0;
+    }
+    // One shared scan of the heap feeds every index
+    std::vector<Tuple> tuples;
+    auto *heap = table_info->table_.get();
+    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
+      tuples.push_back(*tuple);
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(indexes.size());
+    // an exception must not leave its thread, the first one is rethrown once every load is done
+    std::vector<std::exception_ptr> errors(indexes.size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+      threads.emplace_back([&, i] {
+        try {
+          auto *index = indexes[i];
+          std::vector<std::pair<Tuple, RID>> entries;
+          entries.reserve(tuples.size());
+          const auto &entry_schema = *index->GetEntrySchema();
+          for (auto &tuple : tuples) {
+            entries.emplace_back(tuple.KeyFromTuple(table_info->schema_, entry_schema, index->GetEntryAttrs()),
+                                 tuple.GetRid());
+          }
+          index->BulkLoad(entries, txn, INDEX_FILL_FACTOR);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    for (const auto &error : errors) {
+      if (error != nullptr) {
+        std::rethrow_exception(error);
+      }
+    }
+    return tuples.size();
+  }
+
+  /**
+   * Build the TableInfo of a persisted table together with the IndexInfo of all its indexes. Tables are loaded on
+   * first reference, which comes after recovery replayed the heap, so the indexes are rebuilt from the heap here.
+   */
+  auto MaterializeTable(const PersistedTable &rows) const -> LoadedTable {
+    Transaction system_txn(INVALID_TXN_ID);
+    Tuple table_row;
+    tables_heap_->GetTuple(rows.table_row_, &table_row, &system_txn);
+    const auto table_oid = static_cast<table_oid_t>(table_row.GetValue(&TABLES_SCHEMA, 0).GetAs<int32_t>());
+    const auto table_name = table_row.GetValue(&TABLES_SCHEMA, 1).ToString();
+    const auto first_page_id = table_row.GetValue(&TABLES_SCHEMA, 2).GetAs<page_id_t>();
+
+    // The heap may place a row in an earlier page with free space, so columns are ordered by ordinal
+    std::vector<std::pair<int32_t, Column>> ordered_columns;
+    for (const auto &rid : rows.column_rows_) {
+      Tuple row;
+      columns_heap_->GetTuple(rid, &row, &system_txn);
+      auto name = row.GetValue(&COLUMNS_SCHEMA, 2).ToString();
+      auto type = static_cast<TypeId>(row.GetValue(&COLUMNS_SCHEMA, 3).GetAs<int32_t>());
+      auto length = static_cast<uint32_t>(row.GetValue(&COLUMNS_SCHEMA, 4).GetAs<int32_t>());
+      ordered_columns.emplace_back(row.GetValue(&COLUMNS_SCHEMA, 1).GetAs<int32_t>(),
+                                   type == TypeId::VARCHAR ? Column(name, type, length) : Column(name, type));
+    }
+    std::sort(ordered_columns.begin(), ordered_columns.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    std::vector<Column> columns;
+    for (auto &[ordinal, column] : ordered_columns) {
+      columns.push_back(column);
+    }
+
+    LoadedTable loaded;
+    auto heap = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, first_page_id);
+    loaded.table_ = std::make_unique<TableInfo>(Schema(columns), table_name, std::move(heap), table_oid);
+    auto *table_info = loaded.table_.get();
+    std::vector<Index *> indexes;
+
+    for (const auto &rid : rows.index_rows_) {
+      Tuple row;
+      indexes_heap_->GetTuple(rid, &row, &system_txn);
+      const auto index_oid = static_cast<index_oid_t>(row.GetValue(&INDEXES_SCHEMA, 0).GetAs<int32_t>());
+      const auto index_name = row.GetValue(&INDEXES_SCHEMA, 2).ToString();
+      std::vector<uint32_t> key_attrs;
+      std::vector<uint32_t> include_attrs;
+      std::stringstream attr_lists(row.GetValue(&INDEXES_SCHEMA, 3).ToString());
+      for (auto *attr_list : {&key_attrs, &include_attrs}) {
+        std::string list;
+        std::getline(attr_lists, list, ';');
+        std::stringstream attrs(list);
+        for (std::string attr; std::getline(attrs, attr, ',');) {
+          attr_list->push_back(std::stoul(attr));
+        }
+      }
+      const auto key_size = static_cast<size_t>(row.GetValue(&INDEXES_SCHEMA, 4).GetAs<int32_t>());
+      const auto key_width = row.GetValue(&INDEXES_SCHEMA, 5).GetAs<int32_t>();
+      const auto normalized = row.GetValue(&INDEXES_SCHEMA, 6).GetAs<int8_t>() != 0;
+      const auto is_unique = row.GetValue(&INDEXES_SCHEMA, 7).GetAs<int8_t>() != 0;
+      const auto index_type = static_cast<IndexType>(row.GetValue(&INDEXES_SCHEMA, 8).GetAs<int32_t>());
+
+      auto index_meta = std::make_unique<IndexMetadata>(index_name, table_name, &table_info->schema_, key_attrs,
+                                                        is_unique, include_attrs, index_oid);
+      std::unique_ptr<Index> index;
+      switch (key_width) {
+        case 4:
+          index = OpenIndex<4>(std::move(index_meta), normalized, index_type);
+          break;
+        case 8:
+          index = OpenIndex<8>(std::move(index_meta), normalized, index_type);
+          break;
+        case 16:
+          index = OpenIndex<16>(std::move(index_meta), normalized, index_type);
+          break;
+        case 32:
+          index = OpenIndex<32>(std::move(index_meta), normalized, index_type);
+          break;
+        case 64:
+          index = OpenIndex<64>(std::move(index_meta), normalized, index_type);
+          break;
+        default:
+          throw Exception(ExceptionType::INVALID, "unsupported index key width in catalog");
+      }
+      indexes.push_back(index.get());
+      loaded.indexes_.push_back(std::make_unique<IndexInfo>(Schema::CopySchema(&table_info->schema_, key_attrs),
+                                                            index_name, std::move(index), index_oid, table_name,
+                                                            key_size, index_type));
+    }
+    LoadIndexesFromHeap(nullptr, table_info, indexes);
+    return loaded;
+  }
+
+  /** Create an index whose normalized keys hold the key columns in full, with the smallest key size that fits */
+  auto CreateFullKeyIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
+                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
+                          bool is_unique, IndexType index_type) -> IndexInfo * {
+    size_t width = NormalizedKeyWidth(Schema::CopySchema(&schema, key_attrs));
+    size_t key_size = 0;
+    for (size_t size : {4, 8, 16, 32, 64}) {
+      if (width <= size) {
+        key_size = size;
+        break;
+      }
+    }
+    switch (key_size) {
+      case 4:
+        return CreateNormalizedIndex<4>(txn, index_name, table_name, schema, key_schema, key_attrs, INDEX_FILL_FACTOR,
+                                        is_unique, {}, index_type);
+      case 8:
+        return CreateNormalizedIndex<8>(txn, index_name, table_name, schema, key_schema, key_attrs, INDEX_FILL_FACTOR,
+                                        is_unique, {}, index_type);
+      case 16:
+        return CreateNormalizedIndex<16>(txn, index_name, table_name, schema, key_schema, key_attrs, INDEX_FILL_FACTOR,
+                                         is_unique, {}, index_type);
+      case 32:
+        return CreateNormalizedIndex<32>(txn, index_name, table_name, schema, key_schema, key_attrs, INDEX_FILL_FACTOR,
+                                         is_unique, {}, index_type);
+      case 64:
+        return CreateNormalizedIndex<64>(txn, index_name, table_name, schema, key_schema, key_attrs, INDEX_FILL_FACTOR,
+                                         is_unique, {}, index_type);
+      default:
+        throw NotImplementedException("index key columns are wider than 64 bytes");
+    }
+  }
+
+  template <size_t KeyWidth>
+  auto CreateNormalizedIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
+                             const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
+                             double fill_factor, bool is_unique, const std::vector<uint32_t> &include_attrs,
+                             IndexType index_type = IndexType::BPlusTreeIndex) -> IndexInfo * {
+    return CreateIndex<NormalizedKey<KeyWidth>, RID, NormalizedComparator<KeyWidth>>(
+        txn, index_name, table_name, schema, key_schema, key_attrs, KeyWidth, HashFunction<NormalizedKey<KeyWidth>>{},
+        fill_factor, is_unique, include_attrs, index_type);
+  }
+
+  template <class KeyType, class ValueType, class KeyComparator>
+  auto MakeIndex(std::unique_ptr<IndexMetadata> &&index_meta, IndexType index_type,
+                 const HashFunction<KeyType> &hash_function = {}) const -> std::unique_ptr<Index> {
+    switch (index_type) {
+      case IndexType::BPlusTreeIndex:
+        return std::make_unique<BPlusTreeIndex<KeyType, ValueType, KeyComparator>>(std::move(index_meta), bpm_);
+      case IndexType::LSMTreeIndex:
+        return std::make_unique<LSMTreeIndex<KeyType, ValueType, KeyComparator>>(std::move(index_meta), bpm_);
+      case IndexType::HashIndex:
+        return std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(index_meta),
+                                                                                            bpm_, hash_function);
+    }
+    throw Exception(ExceptionType::INVALID, "unknown index type");
+  }
+
+  /**
+   * Reopen an index of the catalog empty, its table loads it from the heap. The pages of a B+ tree are not covered
+   * by the log and may disagree with the recovered heap, so the tree whose root an earlier instance recorded in the
+   * header page is freed instead of read
+   */
+  template <size_t KeyWidth>
+  auto OpenIndex(std::unique_ptr<IndexMetadata> &&index_meta, bool normalized, IndexType index_type) const
+      -> std::unique_ptr<Index> {
+    if (index_type != IndexType::BPlusTreeIndex) {
+      if (normalized) {
+        return MakeIndex<NormalizedKey<KeyWidth>, RID, NormalizedComparator<KeyWidth>>(std::move(index_meta),
+                                                                                        index_type);
+      }
+      return MakeIndex<GenericKey<KeyWidth>, RID, GenericComparator<KeyWidth>>(std::move(index_meta), index_type);
+    }
+    if (normalized) {
+      auto index = std::make_unique<BPlusTreeIndex<NormalizedKey<KeyWidth>, RID, NormalizedComparator<KeyWidth>>>(
+          std::move(index_meta), bpm_);
+      index->DropPersistedTree();
+      return index;
+    }
+    auto index = std::make_unique<BPlusTreeIndex<GenericKey<KeyWidth>, RID, GenericComparator<KeyWidth>>>(
+        std::move(index_meta), bpm_);
+    index->DropPersistedTree();
+    return index;
+  }
+
   [[maybe_unused]] BufferPoolManager *bpm_;
   [[maybe_unused]] LockManager *lock_manager_;
   [[maybe_unused]] LogManager *log_manager_;
 
+  /** Guards the maps below, which lookups fill in lazily for a persistent catalog */
+  mutable std::mutex catalog_latch_;
+
+  /** Signalled whenever a table leaves `loading_tables_` */
+  mutable std::condition_variable table_loaded_;
+
+  /** The persisted tables being loaded with the catalog latch released */
+  mutable std::unordered_set<table_oid_t> loading_tables_;
+
+  /** The system tables of a persistent catalog, all nullptr otherwise */
+  std::unique_ptr<TableHeap> tables_heap_;
+  std::unique_ptr<TableHeap> columns_heap_;
+  std::unique_ptr<TableHeap> indexes_heap_;
+
   /**
    * Map table identifier -> table metadata.
    *
    * NOTE: `tables_` owns all table metadata.
    */
-  std::unordered_map<table_oid_t, std::unique_ptr<TableInfo>> tables_;
+  mutable std::unordered_map<table_oid_t, std::unique_ptr<TableInfo>> tables_;
 
   /** Map table name -> table identifiers. */
-  std::unordered_map<std::string, table_oid_t> table_names_;
+  mutable std::unordered_map<std::string, table_oid_t> table_names_;
 
   /** The next table identifier to be used. */
   std::atomic<table_oid_t> next_table_oid_{0};
@@ -364,13 +1260,16 @@ class Catalog {
    *
    * NOTE: that `indexes_` owns all index metadata.
    */
-  std::unordered_map<index_oid_t, std::unique_ptr<IndexInfo>> indexes_;
+  mutable std::unordered_map<index_oid_t, std::unique_ptr<IndexInfo>> indexes_;
 
   /** Map table name -> index names -> index identifiers. */
-  std::unordered_map<std::string, std::unordered_map<std::string, index_oid_t>> index_names_;
+  mutable std::unordered_map<std::string, std::unordered_map<std::string, index_oid_t>> index_names_;
 
   /** The next index identifier to be used. */
   std::atomic<index_oid_t> next_index_oid_{0};
+
+  /** Indexes whose build failed, unregistered but not freed while writers may still hold them */
+  std::vector<std::unique_ptr<IndexInfo>> abandoned_indexes_;
 };
 
 }  // namespace bustub
@@ -241,6 +241,12 @@ class BustubInstance {
    */
   void GenerateMockTable();
 
+  /**
+   * FOR TEST ONLY. Make the destructor leave the dirty pages unwritten, like a crash would, so that a restarted
+   * instance has to recover the session's writes from the log.
+   */
+  void SimulateCrash() { crashed_ = true; }
+
   // TODO(chi): change to unique_ptr. Currently they're directly referenced by recovery test, so
   // we cannot do anything on them until someone decides to refactor the recovery test.
 
@@ -266,12 +272,22 @@ class BustubInstance {
     return variable == "1" || variable == "true" || variable == "yes";
   }
 
+  auto IsSynchronousCommit() -> bool {
+    auto variable = StringUtil::Lower(GetSessionVariable("synchronous_commit"));
+    return !(variable == "0" || variable == "off" || variable == "false" || variable == "no");
+  }
+
  private:
+  /** Allocate and initialize the header page (HEADER_PAGE_ID) unless the database file already has it. */
+  void ReserveHeaderPage();
   void CmdDisplayTables(ResultWriter &writer);
   void CmdDisplayIndices(ResultWriter &writer);
+  void CmdDisplayIndexStats(ResultWriter &writer, Transaction *txn);
+  void CmdReindex(const std::string &table_name, ResultWriter &writer, Transaction *txn);
   void CmdDisplayHelp(ResultWriter &writer);
   void WriteOneCell(const std::string &cell, ResultWriter &writer);
   std::unordered_map<std::string, std::string> session_variables_;
+  bool crashed_{false};
 };
 
 }  // namespace bustub
@@ -24,6 +24,9 @@ extern std::chrono::milliseconds cycle_detection_interval;
 /** True if logging should be enabled, false otherwise. */
 extern std::atomic<bool> enable_logging;
 
+/** True if a BustubInstance opened on a database file should start the log flush thread (and so logging). */
+extern std::atomic<bool> enable_logging_on_startup;
+
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
@@ -34,7 +37,21 @@ static constexpr int HEADER_PAGE_ID = 0;
 static constexpr int BUSTUB_PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                          // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * BUSTUB_PAGE_SIZE);  // size of a log buffer in byte
+static constexpr int LOG_SEGMENT_SIZE = 16 * LOG_BUFFER_SIZE;                        // size of a log segment file
+static constexpr int LOG_SEGMENT_RECYCLE_LIMIT = 4;                                  // spare log segments kept
 static constexpr int BUCKET_SIZE = 50;                                               // size of extendible hash bucket
+static constexpr double INDEX_FILL_FACTOR = 1.0;                                     // page fill of bulk loaded indexes
+static constexpr size_t INDEX_SCAN_BATCH_SIZE = 128;                                 // entries per index scan batch
+static constexpr size_t INSERT_BATCH_SIZE = 1024;                                    // rows per insert batch
+static constexpr size_t LSM_MEMTABLE_SIZE = 4096;                                    // entries of a full lsm memtable
+static constexpr size_t LSM_LEVEL0_RUNS = 4;                                         // level 0 runs that get compacted
+static constexpr size_t LSM_LEVEL0_STOP = 12;                                        // level 0 runs that stall writes
+static constexpr size_t LSM_LEVEL_FANOUT = 10;                                       // size ratio of lsm levels
+static constexpr size_t BLOOM_FILTER_BITS_PER_KEY = 10;                              // about 1% false positives
+static constexpr double LINEAR_PROBE_MAX_LOAD = 0.5;                                 // load that starts a resize
+static constexpr size_t LINEAR_PROBE_MIGRATE_SLOTS = 32;                             // slots moved per write in a resize
+static constexpr size_t ADAPTIVE_HASH_INDEX_SIZE = 1024;                             // hot keys cached per B+ tree
+static constexpr uint8_t ADAPTIVE_HASH_THRESHOLD = 8;                                // lookups that make a key hot
 static constexpr int LRUK_REPLACER_K = 10;  // lookback window for lru-k replacer
 
 using frame_id_t = int32_t;    // frame id type
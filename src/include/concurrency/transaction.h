@@ -323,6 +323,16 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return true if commit waits until the commit record is on disk */
+  inline auto IsSynchronousCommit() const -> bool { return synchronous_commit_; }
+
+  /**
+   * Set whether commit waits for the commit record to reach the disk. Without waiting, a crash may lose the
+   * transaction, but never more than log_timeout worth of commits.
+   * @param synchronous_commit true to wait for the log flush on commit
+   */
+  inline void SetSynchronousCommit(bool synchronous_commit) { synchronous_commit_ = synchronous_commit; }
+
  private:
   /** The current transaction state. */
   TransactionState state_{TransactionState::GROWING};
@@ -339,6 +349,8 @@ class Transaction {
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
   /** The LSN of the last record written by the transaction. */
   lsn_t prev_lsn_;
+  /** Whether commit waits for the commit record to be persisted. */
+  bool synchronous_commit_{true};
 
   std::mutex latch_;
 
@@ -77,6 +77,13 @@ class TransactionManager {
     return res;
   }
 
+  /**
+   * Sets whether transactions begun from now on wait for their commit record to be flushed, the session's
+   * synchronous_commit setting.
+   * @param synchronous_commit true to wait for the log flush on commit
+   */
+  void SetSynchronousCommit(bool synchronous_commit) { synchronous_commit_ = synchronous_commit; }
+
   /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
@@ -135,6 +142,8 @@ class TransactionManager {
   }
 
   std::atomic<txn_id_t> next_txn_id_{0};
+  /** Initial synchronous commit flag of new transactions. */
+  std::atomic<bool> synchronous_commit_{true};
   LockManager *lock_manager_ __attribute__((__unused__));
   LogManager *log_manager_ __attribute__((__unused__));
 
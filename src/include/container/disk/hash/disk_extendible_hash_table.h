@@ -30,6 +30,18 @@ namespace bustub {
  * Implementation of extendible hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table grows/shrinks dynamically as buckets become full/empty.
+ *
+ * Lookups, inserts and removes share table_latch_ and latch only the bucket
+ * page they touch, so operations on different buckets run in parallel. An
+ * insert into a full bucket retries with table_latch_ held exclusively and
+ * splits the bucket, doubling the directory if the bucket's local depth has
+ * reached the global depth. A remove that empties a bucket merges it with
+ * its split image the same way, halving the directory while no bucket needs
+ * its full global depth. The directory fits a single page, so the table has
+ * at most DIRECTORY_ARRAY_SIZE buckets; an insert fails once the bucket it
+ * needs cannot be split any further. There are no overflow buckets, so a key
+ * (or hash) holds at most BUCKET_ARRAY_SIZE values, and a bucket full of one
+ * hash is not split at all.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class DiskExtendibleHashTable {
@@ -74,6 +86,18 @@ class DiskExtendibleHashTable {
    */
   auto GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool;
 
+  /**
+   * Removes every key, shrinking the directory back to global depth 0 with a
+   * single empty bucket. The other bucket pages are deleted.
+   */
+  void Clear();
+
+  /**
+   * Deletes the directory and every bucket page. Nothing may use the table
+   * afterwards.
+   */
+  void Drop();
+
   /**
    * Returns the global depth
    */
@@ -121,6 +145,14 @@ class DiskExtendibleHashTable {
    */
   auto KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> page_id_t;
 
+  /**
+   * Fetches a page of the table from the buffer pool manager, throws if there is no frame for it.
+   *
+   * @param page_id the page_id to fetch
+   * @return a pointer to the pinned page
+   */
+  auto FetchPage(page_id_t page_id) -> Page *;
+
   /**
    * Fetches the directory page from the buffer pool manager.
    *
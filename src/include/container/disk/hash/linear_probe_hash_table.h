@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
 #include <vector>
@@ -30,6 +31,18 @@ namespace bustub {
  * Implementation of linear probing hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table dynamically grows once full.
+ *
+ * Growing is incremental: once the load passes LINEAR_PROBE_MAX_LOAD a table of
+ * twice the slots is created and every following insert or remove first moves
+ * the next LINEAR_PROBE_MIGRATE_SLOTS slots of the old table into it. Until the
+ * old table is drained, lookups probe its slots that have not been moved yet
+ * and then the new table, and inserts only go to the new table. Block pages are
+ * allocated when a slot in them is first written, so starting a resize costs a
+ * single header page and no write stalls for rehashing the whole table.
+ *
+ * Writers are serialized by write_latch_. A write moves slots under the table
+ * latch in write mode; lookups and the write itself hold it in read mode and
+ * latch the block pages they touch.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class LinearProbeHashTable {
@@ -73,7 +86,9 @@ class LinearProbeHashTable {
   auto GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool;
 
   /**
-   * Resizes the table to at least twice the initial size provided.
+   * Resizes the table to at least twice the initial size provided. A resize in
+   * progress is finished first, the slots of the new resize move over with the
+   * following writes.
    * @param initial_size the initial size of the hash table
    */
   void Resize(size_t initial_size);
@@ -85,20 +100,46 @@ class LinearProbeHashTable {
   auto GetSize() -> size_t;
 
  private:
-  auto GetHeaderPage() -> HashTableHeaderPage *;
-  auto GetBlockPage(page_id_t block_page_id) -> HASH_TABLE_BLOCK_TYPE *;
-  void ResizeInsert(HashTableHeaderPage *header_page, const KeyType &key, const ValueType &value);
-  void DeleteBlockPages(HashTableHeaderPage *old_header_page);
-  void CreateNewBlockPages(HashTableHeaderPage *header_page, size_t num_blocks);
-  auto GetValueLatchFree(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool;
+  auto FetchPage(page_id_t page_id) -> Page *;
+  // allocate the header page of a table of num_slots slots, its block pages are allocated on first write
+  auto CreateTable(size_t num_slots) -> page_id_t;
+  void DeleteTable(page_id_t header_page_id);
+  // the block page holding a slot, allocated if create is set, nullptr if it does not exist yet
+  auto FetchBlock(Page *header_page, size_t slot, bool create) -> Page *;
+  /*
+   * Walk the probe chain of key from its home slot, but not below first_slot, until the first never occupied slot.
+   * visit(slot, value) is called for every value stored with key and stops the walk by returning true. Slots below
+   * first_slot have been moved to the new table, a walk that wraps around past the end continues at first_slot.
+   * Returns the first free slot seen, or the number of slots if there is none.
+   */
+  template <typename Visit>
+  auto Probe(page_id_t header_page_id, const KeyType &key, size_t first_slot, Visit visit) -> size_t;
+  void InsertAt(page_id_t header_page_id, size_t slot, const KeyType &key, const ValueType &value);
+  void RemoveAt(page_id_t header_page_id, size_t slot);
+  // make the current table the old one and create a new one of num_slots slots, called with write_latch_ held and
+  // no resize in progress; false if the table cannot grow anymore
+  auto StartResize(size_t num_slots) -> bool;
+  // move up to count slots of the old table to the new one, called with write_latch_ held
+  void MigrateSlots(size_t count);
 
   // member variable
   page_id_t header_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
 
-  // Readers includes inserts and removes, writer is only resize
+  // Readers includes lookups, inserts and removes, writer is moving slots during a resize
   ReaderWriterLatch table_latch_;
+  // serializes inserts, removes and resizes
+  std::mutex write_latch_;
+
+  // number of slots of the current table
+  size_t size_;
+  // number of key-value pairs stored in both tables
+  size_t num_entries_{0};
+  // the table being resized away from, INVALID_PAGE_ID if there is no resize in progress
+  page_id_t old_header_page_id_{INVALID_PAGE_ID};
+  // slots of the old table below this one have been moved to the current table
+  size_t migrated_{0};
 
   // Hash function
   HashFunction<KeyType> hash_fn_;
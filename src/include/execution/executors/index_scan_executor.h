@@ -12,8 +12,10 @@
 
 #pragma once
 
+#include <functional>
 #include <vector>
 
+#include "catalog/catalog.h"
 #include "common/rid.h"
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
@@ -23,7 +25,11 @@
 namespace bustub {
 
 /**
- * IndexScanExecutor executes an index scan over a table.
+ * IndexScanExecutor executes an index scan over a table. It emits the rows of
+ * the table in index key order, or in reverse for a descending scan, taking
+ * the RIDs from the index in batches. An index-only scan builds the rows from
+ * the index entries and does not touch the table heap. A point lookup takes
+ * the RIDs of its key from the index in one go.
  */
 
 class IndexScanExecutor : public AbstractExecutor {
@@ -44,5 +50,16 @@ class IndexScanExecutor : public AbstractExecutor {
  private:
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
+  /** The table the index is built on */
+  const TableInfo *table_info_{nullptr};
+  /** The layout of the index entries and the table columns they hold, for an index-only scan */
+  const Schema *entry_schema_{nullptr};
+  std::vector<uint32_t> entry_attrs_;
+  /** Appends the RIDs of the next batch of index entries, and the entries themselves if asked to */
+  std::function<void(std::vector<RID> *, std::vector<Tuple> *)> next_batch_;
+  /** The current batch and the position of the next RID to emit */
+  std::vector<RID> rids_;
+  std::vector<Tuple> entries_;
+  size_t cursor_{0};
 };
 }  // namespace bustub
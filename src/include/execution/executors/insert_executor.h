@@ -14,6 +14,7 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
@@ -24,7 +25,9 @@ namespace bustub {
 
 /**
  * InsertExecutor executes an insert on a table.
- * Inserted values are always pulled from a child executor.
+ * Inserted values are always pulled from a child executor, INSERT_BATCH_SIZE
+ * at a time. Each batch is written to the table heap a page at a time and
+ * then to every index of the table in key order.
  */
 class InsertExecutor : public AbstractExecutor {
  public:
@@ -55,8 +58,19 @@ class InsertExecutor : public AbstractExecutor {
   auto GetOutputSchema() const -> const Schema & override { return plan_->OutputSchema(); };
 
  private:
+  /** Insert a batch of rows into the table and its indexes */
+  void InsertBatch(const std::vector<Tuple> &batch);
+
   /** The insert plan node to be executed*/
   const InsertPlanNode *plan_;
+  /** The child executor from which inserted tuples are pulled */
+  std::unique_ptr<AbstractExecutor> child_executor_;
+  /** The table the rows are inserted into */
+  TableInfo *table_info_{nullptr};
+  /** The rows inserted so far */
+  int32_t inserted_{0};
+  /** Whether the number of inserted rows has been produced */
+  bool done_{false};
 };
 
 }  // namespace bustub
@@ -28,7 +28,12 @@
 namespace bustub {
 
 /**
- * IndexJoinExecutor executes index join operations.
+ * IndexJoinExecutor executes index join operations. For each outer tuple it looks the join key up in the
+ * index of the inner table, by key prefix if the key has more columns, and checks the key of every inner
+ * tuple it fetches, as a prefix or lossy index may return rows with a different key. An index-only join
+ * builds the inner tuples from the index entries instead of fetching them. Whole keys are looked up
+ * INDEX_SCAN_BATCH_SIZE outer tuples at a time with Index::ScanKeys, which a B+ tree answers in key order
+ * with a single descent.
  */
 class NestIndexJoinExecutor : public AbstractExecutor {
  public:
@@ -48,7 +53,23 @@ class NestIndexJoinExecutor : public AbstractExecutor {
   auto Next(Tuple *tuple, RID *rid) -> bool override;
 
  private:
+  /** Look up the join keys of a batch of outer tuples and add their joined tuples to results_ */
+  void JoinBatch(const std::vector<Tuple> &outers);
+  /** Add the tuples joining outer with the inner rows or index entries found for its key */
+  void Join(const Tuple &outer, const Value &key, const std::vector<std::pair<Tuple, RID>> &entries,
+            const std::vector<RID> &rids);
+
   /** The nested index join plan node. */
   const NestedIndexJoinPlanNode *plan_;
+  /** The outer table */
+  std::unique_ptr<AbstractExecutor> child_executor_;
+  /** The inner table and the index looked up in it */
+  const TableInfo *inner_table_info_{nullptr};
+  const IndexInfo *index_info_{nullptr};
+  /** The joined tuples of the current outer tuple and the position of the next one to emit */
+  std::vector<Tuple> results_;
+  size_t cursor_{0};
+  /** Whether the outer table has no tuples left */
+  bool outer_done_{false};
 };
 }  // namespace bustub
@@ -14,6 +14,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "catalog/catalog.h"
 #include "execution/expressions/abstract_expression.h"
@@ -21,7 +22,10 @@
 
 namespace bustub {
 /**
- * IndexScanPlanNode identifies a table that should be scanned with an optional predicate.
+ * IndexScanPlanNode identifies a table that should be scanned with an optional predicate. The rows come out in
+ * index key order, or in reverse key order for a descending scan. An index-only scan reads the columns from the
+ * index entries and never fetches the rows, the columns the index does not store come out as NULL. With a lookup key
+ * the scan is a point lookup that only emits the rows whose key equals it, which any index type can answer.
  */
 class IndexScanPlanNode : public AbstractPlanNode {
  public:
@@ -29,25 +33,58 @@ class IndexScanPlanNode : public AbstractPlanNode {
    * Creates a new index scan plan node.
    * @param output the output format of this scan plan node
    * @param table_oid the identifier of table to be scanned
+   * @param descending whether to scan from the largest key down
+   * @param index_only whether to take the columns from the index entries instead of the table
+   * @param lookup_key the values of the key columns to look up, empty to scan the whole index
    */
-  IndexScanPlanNode(SchemaRef output, index_oid_t index_oid)
-      : AbstractPlanNode(std::move(output), {}), index_oid_(index_oid) {}
+  IndexScanPlanNode(SchemaRef output, index_oid_t index_oid, bool descending = false, bool index_only = false,
+                    std::vector<Value> lookup_key = {})
+      : AbstractPlanNode(std::move(output), {}),
+        index_oid_(index_oid),
+        descending_(descending),
+        index_only_(index_only),
+        lookup_key_(std::move(lookup_key)) {}
 
   auto GetType() const -> PlanType override { return PlanType::IndexScan; }
 
   /** @return the identifier of the table that should be scanned */
   auto GetIndexOid() const -> index_oid_t { return index_oid_; }
 
+  /** @return whether the scan goes from the largest key down */
+  auto IsDescending() const -> bool { return descending_; }
+
+  /** @return whether the rows are read from the index entries alone */
+  auto IsIndexOnly() const -> bool { return index_only_; }
+
+  /** @return the key values of a point lookup, empty for a scan of the whole index */
+  auto GetLookupKey() const -> const std::vector<Value> & { return lookup_key_; }
+
   BUSTUB_PLAN_NODE_CLONE_WITH_CHILDREN(IndexScanPlanNode);
 
   /** The table whose tuples should be scanned. */
   index_oid_t index_oid_;
 
-  // Add anything you want here for index lookup
+  /** Scan in reverse key order */
+  bool descending_;
+
+  /** Do not fetch the rows from the table */
+  bool index_only_;
+
+  /** Only emit the rows with this key */
+  std::vector<Value> lookup_key_;
 
  protected:
   auto PlanNodeToString() const -> std::string override {
-    return fmt::format("IndexScan {{ index_oid={} }}", index_oid_);
+    std::string lookup;
+    for (const auto &value : lookup_key_) {
+      lookup += lookup.empty() ? ", key=[" : ", ";
+      lookup += value.ToString();
+    }
+    if (!lookup.empty()) {
+      lookup += "]";
+    }
+    return fmt::format("IndexScan {{ index_oid={}{}{}{} }}", index_oid_, descending_ ? ", descending=true" : "",
+                       index_only_ ? ", index_only=true" : "", lookup);
   }
 };
 
@@ -29,13 +29,15 @@ namespace bustub {
 /**
  * NestedIndexJoinPlanNode is used to represent performing a nested index join between two tables
  * The outer table tuples are propogated using a child executor, but the inner table tuples should be
- * obtained using the outer table tuples as well as the index from the catalog.
+ * obtained using the outer table tuples as well as the index from the catalog. An index-only join takes the
+ * inner columns from the index entries and leaves the ones the index does not store NULL.
  */
 class NestedIndexJoinPlanNode : public AbstractPlanNode {
  public:
   NestedIndexJoinPlanNode(SchemaRef output, AbstractPlanNodeRef child, AbstractExpressionRef key_predicate,
                           table_oid_t inner_table_oid, index_oid_t index_oid, std::string index_name,
-                          std::string index_table_name, SchemaRef inner_table_schema, JoinType join_type)
+                          std::string index_table_name, SchemaRef inner_table_schema, JoinType join_type,
+                          bool index_only = false)
       : AbstractPlanNode(std::move(output), {std::move(child)}),
         key_predicate_(std::move(key_predicate)),
         inner_table_oid_(inner_table_oid),
@@ -43,7 +45,8 @@ class NestedIndexJoinPlanNode : public AbstractPlanNode {
         index_name_(std::move(index_name)),
         index_table_name_(std::move(index_table_name)),
         inner_table_schema_(std::move(inner_table_schema)),
-        join_type_(join_type) {}
+        join_type_(join_type),
+        index_only_(index_only) {}
 
   auto GetType() const -> PlanType override { return PlanType::NestedIndexJoin; }
 
@@ -68,6 +71,9 @@ class NestedIndexJoinPlanNode : public AbstractPlanNode {
   /** @return Schema with needed columns in from the inner table */
   auto InnerTableSchema() const -> const Schema & { return *inner_table_schema_; }
 
+  /** @return whether the inner rows are read from the index entries alone */
+  auto IsIndexOnly() const -> bool { return index_only_; }
+
   BUSTUB_PLAN_NODE_CLONE_WITH_CHILDREN(NestedIndexJoinPlanNode);
 
   /** The nested index join predicate. */
@@ -81,10 +87,13 @@ class NestedIndexJoinPlanNode : public AbstractPlanNode {
   /** The join type */
   JoinType join_type_;
 
+  /** Do not fetch the inner rows from the table */
+  bool index_only_;
+
  protected:
   auto PlanNodeToString() const -> std::string override {
-    return fmt::format("NestedIndexJoin {{ type={}, key_predicate={}, index={}, index_table={} }}", join_type_,
-                       key_predicate_, index_name_, index_table_name_);
+    return fmt::format("NestedIndexJoin {{ type={}, key_predicate={}, index={}, index_table={}{} }}", join_type_,
+                       key_predicate_, index_name_, index_table_name_, index_only_ ? ", index_only=true" : "");
   }
 };
 }  // namespace bustub
@@ -1,12 +1,14 @@
 #pragma once
 
 #include <memory>
+#include <set>
 #include <string>
 #include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "binder/bound_order_by.h"
 #include "catalog/catalog.h"
 #include "concurrency/transaction.h"
 #include "execution/expressions/abstract_expression.h"
@@ -85,10 +87,35 @@ class Optimizer {
    */
   auto OptimizeOrderByAsIndexScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
 
+  /**
+   * @brief find an index whose key starts with the single order by column of a scan, sets descending if it has to be
+   * scanned backwards
+   */
+  auto MatchOrderByIndex(const std::vector<std::pair<OrderByType, AbstractExpressionRef>> &order_bys,
+                         const AbstractPlanNodeRef &child_plan, bool *descending) -> const IndexInfo *;
+
+  /**
+   * @brief turn a filter on a sequential scan whose predicate requires `column = constant` into a point lookup on an
+   * index of the column, which can be a hash index
+   */
+  auto OptimizeEqualityAsIndexScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
+
+  /** @brief find an index whose key is just the column, preferring a hash index */
+  auto MatchEqualityIndex(const std::string &table_name, uint32_t column_idx) -> const IndexInfo *;
+
   /** @brief check if the index can be matched */
   auto MatchIndex(const std::string &table_name, uint32_t index_key_idx)
       -> std::optional<std::tuple<index_oid_t, std::string>>;
 
+  /**
+   * @brief read the rows of index scans and index joins from the index entries if the plan above them only uses
+   * columns the index stores, the table heap is then not touched at all
+   */
+  auto OptimizeIndexOnlyScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
+
+  /** @brief make the index scans and index joins under plan index-only where their index covers the columns read */
+  auto MakeIndexOnly(const AbstractPlanNodeRef &plan, std::set<uint32_t> columns) -> AbstractPlanNodeRef;
+
   /**
    * @brief optimize sort + limit as top N
    */
@@ -46,13 +46,42 @@ class LogManager {
 
   auto AppendLogRecord(LogRecord *log_record) -> lsn_t;
 
+  /** Write everything in the log buffer to disk before returning. */
+  void Flush();
+
+  /**
+   * Block until the log record with the given lsn is on disk, asking the flush thread for an early flush.
+   * @param lsn the lsn that must be persisted
+   */
+  void WaitForPersistent(lsn_t lsn);
+
+  /**
+   * Make the current end of the log the redo point for recovery and recycle the log segments before it.
+   * The log must be flushed and all dirty pages written out first, with no transaction running.
+   */
+  void CheckpointLog();
+
   inline auto GetNextLSN() -> lsn_t { return next_lsn_; }
   inline auto GetPersistentLSN() -> lsn_t { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
   inline auto GetLogBuffer() -> char * { return log_buffer_; }
 
  private:
-  // TODO(students): you may add your own member variables
+  /** Serialize the type specific body of a log record into the log buffer at pos. */
+  static void SerializeLogRecordBody(LogRecord *log_record, char *pos);
+
+  /**
+   * Swap the log buffer with the flush buffer and write it to disk. latch_ must be held. When lock is given, latch_
+   * is released during the disk write, only the flush thread may do so.
+   */
+  void FlushLogBuffer(std::unique_lock<std::mutex> *lock);
+
+  /** Number of bytes used in log_buffer_. */
+  int32_t log_buffer_offset_{0};
+  /** Set when someone waits for the log buffer to be flushed before the timeout. */
+  bool flush_requested_{false};
+  /** Notified whenever the flush thread swapped the buffers or persisted the log. */
+  std::condition_variable persistent_cv_;
 
   /** The atomic counter which records the next log sequence number. */
   std::atomic<lsn_t> next_lsn_;
@@ -64,11 +93,11 @@ class LogManager {
 
   std::mutex latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::thread *flush_thread_{nullptr};
 
   std::condition_variable cv_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
@@ -14,6 +14,8 @@
 
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "storage/table/tuple.h"
@@ -32,6 +34,17 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** Updating a tuple in place, only the changed byte ranges are logged. */
+  DELTAUPDATE,
+  /** Inserting a batch of tuples into one page. */
+  BATCHINSERT,
+};
+
+/** A contiguous byte range of a tuple that was changed by an update, with its before and after image. */
+struct DeltaRange {
+  uint32_t offset_;
+  std::string old_bytes_;
+  std::string new_bytes_;
 };
 
 /**
@@ -53,14 +66,23 @@ enum class LogRecordType {
  *-----------------------------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
  *-----------------------------------------------------------------------------------
+ * For delta update type log record (old and new tuple have the same size)
+ *--------------------------------------------------------------------------------------------------
+ * | HEADER | tuple_rid | tuple_size | range_count | offset | length | old_bytes | new_bytes | ... |
+ *--------------------------------------------------------------------------------------------------
  * For new page type log record
  *--------------------------
  * | HEADER | prev_page_id |
  *--------------------------
+ * For batch insert type log record (all tuples on the same page)
+ *-----------------------------------------------------------------------------
+ * | HEADER | tuple_count | tuple_rid | tuple_size | tuple_data | ... |
+ *-----------------------------------------------------------------------------
  */
 class LogRecord {
   friend class LogManager;
   friend class LogRecovery;
+  friend class DiskManager;
 
  public:
   LogRecord() = default;
@@ -85,7 +107,9 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
   }
 
-  // constructor for UPDATE type
+  // constructor for UPDATE/DELTAUPDATE type
+  // A DELTAUPDATE record falls back to a full UPDATE record when the tuple size changes or when the encoded
+  // ranges would not be smaller than the two full images.
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const RID &update_rid,
             const Tuple &old_tuple, const Tuple &new_tuple)
       : txn_id_(txn_id),
@@ -96,6 +120,28 @@ class LogRecord {
         new_tuple_(new_tuple) {
     // calculate log record size
     size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() + new_tuple.GetLength() + 2 * sizeof(int32_t);
+    if (log_record_type != LogRecordType::DELTAUPDATE) {
+      assert(log_record_type == LogRecordType::UPDATE);
+      return;
+    }
+    log_record_type_ = LogRecordType::UPDATE;
+    if (old_tuple.GetLength() != new_tuple.GetLength()) {
+      return;
+    }
+    int32_t delta_size = HEADER_SIZE + sizeof(RID) + 2 * sizeof(int32_t);
+    std::vector<DeltaRange> ranges = ComputeDelta(old_tuple.GetData(), new_tuple.GetData(), old_tuple.GetLength());
+    for (const auto &range : ranges) {
+      delta_size += DELTA_RANGE_HEADER_SIZE + 2 * range.old_bytes_.size();
+    }
+    if (delta_size < size_) {
+      log_record_type_ = LogRecordType::DELTAUPDATE;
+      delta_tuple_size_ = old_tuple.GetLength();
+      delta_ranges_ = std::move(ranges);
+      size_ = delta_size;
+      // the full images are not needed once the ranges are extracted
+      old_tuple_ = Tuple();
+      new_tuple_ = Tuple();
+    }
   }
 
   // constructor for NEWPAGE type
@@ -110,6 +156,22 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for BATCHINSERT type
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, std::vector<RID> rids,
+            std::vector<Tuple> tuples)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        batch_rids_(std::move(rids)),
+        batch_tuples_(std::move(tuples)) {
+    assert(log_record_type == LogRecordType::BATCHINSERT && batch_rids_.size() == batch_tuples_.size());
+    // calculate log record size
+    size_ = HEADER_SIZE + sizeof(uint32_t);
+    for (const auto &tuple : batch_tuples_) {
+      size_ += sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
+    }
+  }
+
   ~LogRecord() = default;
 
   inline auto GetDeleteTuple() -> Tuple & { return delete_tuple_; }
@@ -126,8 +188,16 @@ class LogRecord {
 
   inline auto GetUpdateRID() -> RID & { return update_rid_; }
 
+  inline auto GetDeltaRanges() -> std::vector<DeltaRange> & { return delta_ranges_; }
+
+  inline auto GetDeltaTupleSize() -> uint32_t { return delta_tuple_size_; }
+
   inline auto GetNewPageRecord() -> page_id_t { return prev_page_id_; }
 
+  inline auto GetBatchInsertRIDs() -> std::vector<RID> & { return batch_rids_; }
+
+  inline auto GetBatchInsertTuples() -> std::vector<Tuple> & { return batch_tuples_; }
+
   inline auto GetSize() -> int32_t { return size_; }
 
   inline auto GetLSN() -> lsn_t { return lsn_; }
@@ -138,6 +208,32 @@ class LogRecord {
 
   inline auto GetLogRecordType() -> LogRecordType & { return log_record_type_; }
 
+  /**
+   * Compute the byte ranges in which two equally sized tuple images differ. Every unchanged byte inside a range is
+   * logged twice (old and new image), so two ranges are coalesced only when twice the gap between them is smaller
+   * than the range header that splitting them would cost.
+   */
+  static auto ComputeDelta(const char *old_data, const char *new_data, uint32_t size) -> std::vector<DeltaRange> {
+    std::vector<DeltaRange> ranges;
+    uint32_t i = 0;
+    while (i < size) {
+      if (old_data[i] == new_data[i]) {
+        i++;
+        continue;
+      }
+      uint32_t begin = i;
+      uint32_t end = i + 1;
+      for (uint32_t j = end; j < size && 2 * (j - end) < DELTA_RANGE_HEADER_SIZE; j++) {
+        if (old_data[j] != new_data[j]) {
+          end = j + 1;
+        }
+      }
+      ranges.push_back({begin, std::string(old_data + begin, end - begin), std::string(new_data + begin, end - begin)});
+      i = end;
+    }
+    return ranges;
+  }
+
   // For debug purpose
   inline auto ToString() const -> std::string {
     std::ostringstream os;
@@ -176,7 +272,18 @@ class LogRecord {
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
+
+  // case5: for delta update operation, update_rid_ is shared with case3
+  uint32_t delta_tuple_size_{0};
+  std::vector<DeltaRange> delta_ranges_;
+
+  // case6: for batch insert operation
+  std::vector<RID> batch_rids_;
+  std::vector<Tuple> batch_tuples_;
+
   static const int HEADER_SIZE = 20;
+  /** offset + length of every encoded delta range */
+  static const int DELTA_RANGE_HEADER_SIZE = 2 * sizeof(uint32_t);
 };  // namespace bustub
 
 }  // namespace bustub
@@ -25,6 +25,11 @@ namespace bustub {
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * The log is one logical byte stream split into LOG_SEGMENT_SIZE segment files named `<db>.log.<n>`, segment n holds
+ * the log offsets [n * LOG_SEGMENT_SIZE, (n + 1) * LOG_SEGMENT_SIZE). A small control file `<db>.log.ctl` remembers
+ * the redo point of the last checkpoint. Segments before the redo point are renamed to future segment numbers and
+ * overwritten later instead of being deleted, so a recycled segment may contain stale records past the log tail.
  */
 class DiskManager {
  public:
@@ -69,10 +74,39 @@ class DiskManager {
    * Read a log entry from the log file.
    * @param[out] log_data output buffer
    * @param size size of the log entry
-   * @param offset offset of the log entry in the file
+   * @param offset logical offset of the log entry in the log
    * @return true if the read was successful, false otherwise
    */
-  auto ReadLog(char *log_data, int size, int offset) -> bool;
+  auto ReadLog(char *log_data, int size, int64_t offset) -> bool;
+
+  /**
+   * Record a checkpoint at the current log tail and recycle the segments that are entirely before it. All log records
+   * must be flushed and all dirty pages written before calling this.
+   * @param next_lsn the lsn the next appended log record will get
+   */
+  void CheckpointLog(lsn_t next_lsn);
+
+  /**
+   * Reposition the log tail, used by recovery after it replayed up to the last valid log record.
+   * @param offset logical offset right after the last valid log record
+   * @param next_lsn the lsn following the last valid log record
+   */
+  void SetLogTail(int64_t offset, lsn_t next_lsn);
+
+  /** @return the logical offset recovery should start redo from */
+  inline auto GetLogRedoOffset() const -> int64_t { return log_redo_offset_; }
+
+  /** @return the lsn of the first log record at the redo offset, INVALID_LSN if there was no checkpoint */
+  inline auto GetLogRedoLSN() const -> lsn_t { return log_redo_lsn_; }
+
+  /** @return the lsn the next appended log record should get */
+  inline auto GetLogNextLSN() const -> lsn_t { return log_next_lsn_; }
+
+  /** @return the logical offset the next log write goes to */
+  inline auto GetLogTail() const -> int64_t { return log_tail_; }
+
+  /** @return the number of pages in the database file, page ids from here on have never been written */
+  auto GetNumPages() -> page_id_t;
 
   /** @return the number of disk flushes */
   auto GetNumFlushes() const -> int;
@@ -94,9 +128,24 @@ class DiskManager {
 
  protected:
   auto GetFileSize(const std::string &file_name) -> int;
-  // stream to write log file
+  /** @return the file name of log segment segment_no */
+  auto GetLogSegmentName(int64_t segment_no) const -> std::string;
+  /** Open log segment segment_no for writing, reusing a recycled file if there is one. */
+  void OpenLogSegment(int64_t segment_no);
+  /** Position the log tail and the next lsn right after the last valid log record following the redo point. */
+  void FindLogTail();
+  /** Persist the redo point and resume position into the control file. */
+  void WriteLogControl();
+  // stream to write the current log segment
   std::fstream log_io_;
+  // log segment files are named log_name_.<n>
   std::string log_name_;
+  int64_t log_segment_no_{-1};
+  int64_t log_tail_{0};
+  int64_t log_redo_offset_{0};
+  lsn_t log_redo_lsn_{INVALID_LSN};
+  lsn_t log_next_lsn_{0};
+  std::mutex log_io_latch_;
   // stream to write db file
   std::fstream db_io_;
   std::string file_name_;
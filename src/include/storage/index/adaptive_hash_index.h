@@ -0,0 +1,129 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_hash_index.h
+//
+// Identification: src/include/storage/index/adaptive_hash_index.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <optional>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * In-memory hash index over the hot keys of a B+ tree, after the adaptive hash
+ * index of InnoDB. Every point lookup the index cannot answer is counted per
+ * key hash; once a key has been searched ADAPTIVE_HASH_THRESHOLD times the
+ * tree caches the leaf page and slot it found the key at, and later lookups
+ * of the key go straight to that leaf instead of descending from the root.
+ * The counters are halved every few lookups per entry, so a key has to stay
+ * hot to get cached.
+ *
+ * The index is direct mapped: a hot key takes over the entry of the key that
+ * shares its slot. Entries are only hints, BPlusTree::GetValue checks every
+ * hit against the leaf. The entries are allocated when the first key turns
+ * hot, so an index that only sees cold lookups costs just its counters.
+ */
+template <typename KeyType, typename KeyComparator>
+class AdaptiveHashIndex {
+ public:
+  /** Where a key was found, and the structure version of the tree at that time */
+  struct Location {
+    page_id_t page_id_;
+    int slot_;
+    uint64_t version_;
+  };
+
+  explicit AdaptiveHashIndex(const KeyComparator &comparator, size_t size = ADAPTIVE_HASH_INDEX_SIZE)
+      : comparator_(comparator), size_(size), counters_(std::make_unique<std::atomic<uint8_t>[]>(size)) {}
+
+  /** @return The location cached for key, if any */
+  auto Lookup(const KeyType &key, uint64_t hash) -> std::optional<Location> {
+    if (!allocated_.load(std::memory_order_acquire)) {
+      return std::nullopt;
+    }
+    size_t index = hash % size_;
+    std::scoped_lock lock(stripes_[index % STRIPES]);
+    const Entry &entry = entries_[index];
+    if (!entry.valid_ || comparator_(entry.key_, key) != 0) {
+      return std::nullopt;
+    }
+    return entry.location_;
+  }
+
+  /**
+   * Count a search of the key with this hash that the index could not answer.
+   * @return Whether the key is hot, i.e. should be cached once it is found
+   */
+  auto RecordMiss(uint64_t hash) -> bool {
+    if (searches_.fetch_add(1, std::memory_order_relaxed) % (size_ * AGING_PERIOD) == 0) {
+      // racing with other misses only loses a few counts
+      for (size_t i = 0; i < size_; i++) {
+        counters_[i].store(counters_[i].load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+      }
+    }
+    auto &counter = counters_[hash % size_];
+    uint8_t count = counter.load(std::memory_order_relaxed);
+    if (count < ADAPTIVE_HASH_THRESHOLD) {
+      counter.store(++count, std::memory_order_relaxed);
+    }
+    return count >= ADAPTIVE_HASH_THRESHOLD;
+  }
+
+  /** Cache the location of key, replacing whichever key had its entry */
+  void Insert(const KeyType &key, uint64_t hash, const Location &location) {
+    std::call_once(allocate_once_, [this] {
+      entries_ = std::make_unique<Entry[]>(size_);
+      allocated_.store(true, std::memory_order_release);
+    });
+    size_t index = hash % size_;
+    std::scoped_lock lock(stripes_[index % STRIPES]);
+    entries_[index] = {true, key, location};
+  }
+
+  /** Drop the entry of key, after a hit turned out to be stale */
+  void Erase(const KeyType &key, uint64_t hash) {
+    if (!allocated_.load(std::memory_order_acquire)) {
+      return;
+    }
+    size_t index = hash % size_;
+    std::scoped_lock lock(stripes_[index % STRIPES]);
+    Entry &entry = entries_[index];
+    if (entry.valid_ && comparator_(entry.key_, key) == 0) {
+      entry.valid_ = false;
+    }
+  }
+
+ private:
+  struct Entry {
+    bool valid_;
+    KeyType key_;
+    Location location_;
+  };
+  /** Number of latches the entries are striped over */
+  static constexpr size_t STRIPES = 16;
+  /** The counters are halved every AGING_PERIOD misses per entry */
+  static constexpr size_t AGING_PERIOD = 8;
+
+  KeyComparator comparator_;
+  size_t size_;
+  std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+  std::atomic<uint64_t> searches_{0};
+  std::once_flag allocate_once_;
+  std::atomic<bool> allocated_{false};
+  std::unique_ptr<Entry[]> entries_;
+  std::array<std::mutex, STRIPES> stripes_;
+};
+
+}  // namespace bustub
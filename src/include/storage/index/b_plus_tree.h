@@ -10,12 +10,20 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <atomic>
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "common/rwlatch.h"
 #include "concurrency/transaction.h"
+#include "container/hash/hash_function.h"
+#include "storage/index/adaptive_hash_index.h"
+#include "storage/index/b_plus_tree_stats.h"
 #include "storage/index/index_iterator.h"
+#include "storage/index/reverse_index_iterator.h"
 #include "storage/page/b_plus_tree_internal_page.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
 
@@ -23,18 +31,47 @@ namespace bustub {
 
 #define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
 
+/**
+ * How FindLeafPage latches the pages on its way down.
+ * SEARCH: read latch crabbing, the leaf is returned read latched.
+ * OPTIMISTIC: read latch crabbing, the leaf is returned write latched.
+ * INSERT/DELETE: write latch every page, ancestors stay latched in the
+ * transaction's page set until a page is safe for the operation.
+ */
+enum class Operation { SEARCH, OPTIMISTIC, INSERT, DELETE };
+
 /**
  * Main class providing the API for the Interactive B+ Tree.
  *
  * Implementation of simple b+ tree data structure where internal pages direct
  * the search and leaf pages contain actual data.
- * (1) We only support unique key
+ * (1) We only support unique key, BPlusTreeIndex appends the RID to the keys
+ *     of a non-unique index
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
- * (4) Implement index iterator for range scan
+ * (4) Implement index iterator for range scan, leaves are linked both ways so
+ *     a range can also be scanned backwards
+ * (5) Bulk load from sorted input, used when rebuilding an index from its table
+ * (6) Thread safe: lookups crab down with read latches, writers first try with
+ *     read latches and a write latched leaf, and only restart with write latch
+ *     crabbing when the leaf would split or underflow. root_page_id_ is guarded
+ *     by root_latch_.
+ * (7) Point lookups of hot keys skip the descent through an adaptive hash
+ *     index that caches the leaf and slot of each hot key. A hit counts only
+ *     if the slot still holds the key and no page has been freed since the
+ *     entry was cached, which structure_version_ tracks.
+ * (8) Rebuild compacts the tree online into new, contiguous pages: writers
+ *     wait on rebuild_latch_ while the entries are copied, readers only wait
+ *     for the root swap. The old pages are deleted once the lookups still on
+ *     them are done; while iterators are open they are deleted again when
+ *     the last one closes, so Rebuild never waits for a scan.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
+  // iterators search the tree again for their last key when their leaf changed under them
+  friend class IndexIterator<KeyType, ValueType, KeyComparator>;
+  friend class ReverseIndexIterator<KeyType, ValueType, KeyComparator>;
+
   using InternalPage = BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>;
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
 
@@ -48,12 +85,34 @@ class BPlusTree {
   // Insert a key-value pair into this B+ tree.
   auto Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr) -> bool;
 
+  // Replace the contents of this B+ tree with sorted key/value pairs, building it bottom-up with nodes filled to
+  // fill_factor (0, 1] of their capacity.
+  void BulkLoad(const std::vector<MappingType> &entries, Transaction *transaction = nullptr, double fill_factor = 1.0);
+
+  // Rewrite the entries of this B+ tree into new, contiguous pages filled to fill_factor and swap the root over to
+  // them, lookups keep running on the old pages meanwhile.
+  void Rebuild(double fill_factor = 1.0);
+
+  // Free the pages of the tree an earlier instance of this index left in the header page, leaving this tree empty.
+  void DropPersistedTree();
+
+  // Free every page of this B+ tree and remove its record from the header page, for an index that is given up on.
+  void Drop();
+
   // Remove a key and its value from this B+ tree.
   void Remove(const KeyType &key, Transaction *transaction = nullptr);
 
   // return the value associated with a given key
   auto GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr) -> bool;
 
+  // return the values of a batch of keys in ascending order, results[i] for sorted_keys[i], in a single descent
+  void GetValues(const std::vector<KeyType> &sorted_keys, std::vector<std::vector<ValueType>> *results,
+                 Transaction *transaction = nullptr);
+
+  // like GetValues, results[i] are the values of the keys in [low, high] of sorted_ranges[i], sorted by low
+  void GetValueRanges(const std::vector<std::pair<KeyType, KeyType>> &sorted_ranges,
+                      std::vector<std::vector<ValueType>> *results, Transaction *transaction = nullptr);
+
   // return the page id of the root node
   auto GetRootPageId() -> page_id_t;
 
@@ -62,6 +121,14 @@ class BPlusTree {
   auto Begin(const KeyType &key) -> INDEXITERATOR_TYPE;
   auto End() -> INDEXITERATOR_TYPE;
 
+  // reverse index iterator, from the last key (or the last key not greater than key) down to the first
+  auto RBegin() -> REVERSE_INDEXITERATOR_TYPE;
+  auto RBegin(const KeyType &key) -> REVERSE_INDEXITERATOR_TYPE;
+  auto REnd() -> REVERSE_INDEXITERATOR_TYPE;
+
+  // walk the tree and report its height, fill factors, leaf contiguity and wasted space
+  auto GetStats() -> BPlusTreeStats;
+
   // print the B+ tree
   void Print(BufferPoolManager *bpm);
 
@@ -85,15 +152,46 @@ class BPlusTree {
   // member variable
   std::string index_name_;
   page_id_t root_page_id_;
+  ReaderWriterLatch root_latch_;
+  // held in read mode by Insert, Remove and BulkLoad, in write mode by Rebuild while it copies the tree
+  ReaderWriterLatch rebuild_latch_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
-  auto FindLeafPage(const KeyType &key) -> Page *;
+  HashFunction<KeyType> hash_fn_;
+  AdaptiveHashIndex<KeyType, KeyComparator> adaptive_hash_;
+  // bumped whenever a page leaves the tree, which invalidates every location cached in adaptive_hash_
+  std::atomic<uint64_t> structure_version_{0};
+  // bumped whenever entries moved from one leaf to another, once the leaf links are updated and before the leaves'
+  // write latches are released; iterators hopping to a sibling leaf search for their position again if it changed
+  std::atomic<uint64_t> leaf_move_version_{0};
+  // guards open_iterators_ and deferred_pages_, the pages that left the tree while iterators were open
+  std::mutex deferred_latch_;
+  int open_iterators_{0};
+  std::vector<page_id_t> deferred_pages_;
+  auto FindLeafPage(const KeyType &key, Operation op, Transaction *transaction = nullptr, bool leftmost = false,
+                    bool rightmost = false) -> Page *;
+  auto IsSafe(BPlusTreePage *node, Operation op) const -> bool;
+  auto InsertImp(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool;
+  void RemoveImp(const KeyType &key, Transaction *transaction);
+  auto BuildTree(const std::vector<const MappingType *> &unique_entries, double fill_factor) -> page_id_t;
+  auto CollectPages(page_id_t root_id) -> std::vector<page_id_t>;
+  void FreeOldPages(const std::vector<page_id_t> &old_pages);
+  void DeleteOrDefer(const std::vector<page_id_t> &page_ids);
+  void OpenIterator();
+  void CloseIterator();
+  void ReleaseLatchFromQueue(Transaction *transaction, bool is_dirty);
+  void DeletePages(Transaction *transaction);
+  void RetirePage(page_id_t page_id, Transaction *transaction);
+  auto GetCachedValue(const KeyType &key, const typename AdaptiveHashIndex<KeyType, KeyComparator>::Location &location,
+                      std::vector<ValueType> *result) -> bool;
+  void StartNewTree(const KeyType &key, const ValueType &value);
   void InsertInParent(Page *page_leaf, const KeyType &key, Page *page_bother);
-  void DeleteEntry(Page *&page, const KeyType &key);
-  void AdjustRootPage(BPlusTreePage *b_node);
-  void Coalesce(Page *page, Page *bother_page, const KeyType &parent_key);
+  void DeleteEntry(Page *page, const KeyType &key, Transaction *transaction);
+  void AdjustRootPage(BPlusTreePage *b_node, Transaction *transaction);
+  void RelinkPrevPage(page_id_t page_id, page_id_t prev_page_id);
+  void Coalesce(Page *page, Page *bother_page, const KeyType &parent_key, Transaction *transaction);
   void Redistribute(Page *page, Page *bother_page, Page *parent_page, const KeyType &parent_key, bool ispre);
   void Redistribute2(Page *page, Page *bother_page, Page *parent_page, const KeyType &parent_key);
   auto GetMaxsize(BPlusTreePage *page) const -> int;
@@ -13,7 +13,9 @@
 
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "container/hash/hash_function.h"
@@ -24,6 +26,29 @@ namespace bustub {
 
 #define BPLUSTREE_INDEX_TYPE BPlusTreeIndex<KeyType, ValueType, KeyComparator>
 
+/** Inline prefix of an index that stores its VARCHARs in full */
+static constexpr uint32_t NO_PREFIX_LIMIT = UINT32_MAX;
+
+/**
+ * Index on a BPlusTree, which only holds unique keys. A non-unique index makes
+ * its keys unique by appending the RID as a hidden BIGINT column: the entries
+ * of one key are adjacent and sorted by RID, i.e. in heap page order, and a
+ * prefix compressed leaf stores the key once with the RIDs as its suffixes.
+ * KeyType must leave room for the extra 8 bytes.
+ *
+ * With normalized keys, VARCHAR columns that do not fit into KeyType in full
+ * are stored as an inline prefix of the string. Such an index is lossy: the
+ * RID is appended to keep keys sharing a prefix apart, lookups return every
+ * row whose key matches the prefix, and the caller checks the row itself.
+ * Since it could not tell duplicates apart either, a unique index refuses key
+ * columns that do not fit in full.
+ *
+ * Included columns are stored in the keys after the key columns, in front of
+ * the RID. They do not take part in lookups, but an index that stores all of
+ * its columns in full can decode its entries and covers queries that read
+ * only them. A unique index with included columns still allows one entry
+ * per key.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
@@ -31,32 +56,117 @@ class BPlusTreeIndex : public Index {
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
+  /** Inserts the entries in key order, so that neighbouring entries go into leaves that are still in the pool. */
+  void InsertEntries(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction) override;
+
+  /** Converts and sorts the keys in parallel chunks, then builds the tree bottom-up. */
+  void BulkLoad(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction,
+                double fill_factor) override;
+
   void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  // Look the keys up in key order, with a single descent of the tree for the whole batch
+  void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                Transaction *transaction) override;
+
+  /** With normalized keys a range scan over the keys starting with the encoded prefix. */
+  void ScanKeyPrefix(const std::vector<Value> &prefix, std::vector<RID> *result, Transaction *transaction) override;
+
+  auto IsLossy() const -> bool override { return inline_prefix_ != NO_PREFIX_LIMIT; }
+
+  auto IsCovering() const -> bool override { return IS_NORMALIZED_KEY<KeyType> && !IsLossy(); }
+
+  void ScanKeyPrefixEntries(const std::vector<Value> &prefix, std::vector<std::pair<Tuple, RID>> *result,
+                            Transaction *transaction) override;
+
+  auto GetTreeStats() -> std::optional<BPlusTreeStats> override { return container_.GetStats(); }
+
+  /** Reopen an index persisted by an earlier instance: free the tree its header page record points to. */
+  void DropPersistedTree();
+
+  /** Frees every page of the tree together with its header page record. */
+  void Drop() override { container_.Drop(); }
+
+  /** Compacts the tree online, see BPlusTree::Rebuild. */
+  auto Rebuild(Transaction *transaction, double fill_factor) -> bool override;
+
+  /** The entry stored in key, laid out as GetEntrySchema. The index has to be covering. */
+  auto EntryOf(const KeyType &key) const -> Tuple;
+
   auto GetBeginIterator() -> INDEXITERATOR_TYPE;
 
   auto GetBeginIterator(const KeyType &key) -> INDEXITERATOR_TYPE;
 
   auto GetEndIterator() -> INDEXITERATOR_TYPE;
 
+  auto GetReverseBeginIterator() -> REVERSE_INDEXITERATOR_TYPE;
+
+  auto GetReverseBeginIterator(const KeyType &key) -> REVERSE_INDEXITERATOR_TYPE;
+
+  auto GetReverseEndIterator() -> REVERSE_INDEXITERATOR_TYPE;
+
  protected:
+  /** The key of an entry in the tree: the index key, followed by the RID if the index is not unique */
+  auto MakeKey(const Tuple &key, RID rid) const -> KeyType;
+  /** The value as stored in a key, VARCHARs cut to the inline prefix */
+  auto InlineValue(const Value &value) const -> Value;
+  /** Call on_entry with every entry whose leading key columns equal prefix, in key order */
+  template <typename Callback>
+  void ScanPrefix(const std::vector<Value> &prefix, Callback on_entry);
+
+  // longest VARCHAR prefix stored in a key, NO_PREFIX_LIMIT unless the index is lossy
+  uint32_t inline_prefix_;
+  // whether the keys end with the RID, for a non-unique or a lossy index
+  bool rid_in_key_;
+  // schema of the keys in the tree, the entry schema with the RID column if rid_in_key_
+  Schema tree_key_schema_;
   // comparator for key
   KeyComparator comparator_;
   // container
   BPlusTree<KeyType, ValueType, KeyComparator> container_;
 };
 
-/** We only support index table with one integer key for now in BusTub. Hardcode everything here. */
+/**
+ * Size of the normalized keys of a B+ tree index whose entries have entry_schema: the smallest of 4, 8, 16, 32 and
+ * 64 bytes that holds every key and included column, and the RID if the index is not unique. 64 if that only works
+ * with the VARCHARs cut to a prefix, 0 if not even that fits.
+ */
+inline auto BPlusTreeKeySizeFor(const Schema &entry_schema, bool is_unique) -> size_t {
+  size_t width = NormalizedKeyWidth(entry_schema) + (is_unique ? 0 : sizeof(int64_t));
+  for (size_t key_size : {4, 8, 16, 32, 64}) {
+    if (width <= key_size) {
+      return key_size;
+    }
+  }
+  // a lossy key stores the fixed size columns, the RID and at least the marker and terminator of each VARCHAR
+  size_t min_width = sizeof(int64_t);
+  bool has_varchar = false;
+  for (const auto &column : entry_schema.GetColumns()) {
+    has_varchar = has_varchar || column.GetType() == TypeId::VARCHAR;
+    min_width += column.GetType() == TypeId::VARCHAR ? 2 : column.GetFixedLength();
+  }
+  return has_varchar && min_width <= 64 ? 64 : 0;
+}
+
+/** The index on one integer column, as CreateBPlusTreeIndex picks it. Hardcoded for tests and tools. */
 
 constexpr static const auto INTEGER_SIZE = 4;
-using IntegerKeyType = GenericKey<INTEGER_SIZE>;
+using IntegerKeyType = NormalizedKey<INTEGER_SIZE>;
 using IntegerValueType = RID;
-using IntegerComparatorType = GenericComparator<INTEGER_SIZE>;
+using IntegerComparatorType = NormalizedComparator<INTEGER_SIZE>;
 using BPlusTreeIndexForOneIntegerColumn = BPlusTreeIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>;
 using BPlusTreeIndexIteratorForOneIntegerColumn =
     IndexIterator<IntegerKeyType, IntegerValueType, IntegerComparatorType>;
 using IntegerHashFunctionType = HashFunction<IntegerKeyType>;
 
+/** A non-unique index on one integer column, the keys hold the integer and the RID. */
+constexpr static const auto INTEGER_RID_SIZE = 16;
+using IntegerRidKeyType = NormalizedKey<INTEGER_RID_SIZE>;
+using IntegerRidComparatorType = NormalizedComparator<INTEGER_RID_SIZE>;
+using BPlusTreeIndexForOneIntegerColumnNonUnique =
+    BPlusTreeIndex<IntegerRidKeyType, IntegerValueType, IntegerRidComparatorType>;
+using IntegerRidHashFunctionType = HashFunction<IntegerRidKeyType>;
+
 }  // namespace bustub
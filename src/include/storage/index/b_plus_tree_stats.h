@@ -0,0 +1,76 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_stats.h
+//
+// Identification: src/include/storage/index/b_plus_tree_stats.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bustub {
+
+/**
+ * Shape and health of a B+ tree, as collected by BPlusTree::GetStats. An index
+ * that has seen many deletes shows up with a low leaf fill factor and many
+ * wasted bytes; one that has grown by splits with a low leaf contiguity, i.e.
+ * range scans that jump around the file instead of reading it sequentially.
+ */
+struct BPlusTreeStats {
+  /** Number of levels, 0 for an empty tree and 1 if the root is a leaf */
+  uint32_t height_{0};
+  /** Number of pages on each level, from the root down to the leaves */
+  std::vector<uint32_t> level_pages_;
+  /** Number of key/value pairs in the leaves */
+  uint64_t entries_{0};
+  /** Fill factor (size / max size) of the leaves: the mean and the 10th, 50th and 90th percentile */
+  double leaf_fill_avg_{0};
+  double leaf_fill_p10_{0};
+  double leaf_fill_p50_{0};
+  double leaf_fill_p90_{0};
+  /** Mean fill factor of the internal pages */
+  double internal_fill_avg_{0};
+  /** Fraction of the next page hops between leaves that go to the page with the following page id, 1 without hops */
+  double leaf_contiguity_{1};
+  /** Bytes of the tree pages taken by neither page headers nor entries, compressed leaves count their suffixes */
+  uint64_t wasted_bytes_{0};
+
+  /** @return The number of pages of the tree */
+  auto PageCount() const -> uint64_t {
+    uint64_t count = 0;
+    for (auto pages : level_pages_) {
+      count += pages;
+    }
+    return count;
+  }
+
+  /** @return The number of leaf pages */
+  auto LeafPageCount() const -> uint32_t { return level_pages_.empty() ? 0 : level_pages_.back(); }
+
+  /** @return A human readable report, one statistic per line */
+  auto ToString() const -> std::string {
+    std::stringstream os;
+    os << "height: " << height_ << "\n";
+    os << "pages per level:";
+    for (auto pages : level_pages_) {
+      os << " " << pages;
+    }
+    os << " (" << PageCount() << " in total)\n";
+    os << "entries: " << entries_ << "\n";
+    os << "leaf fill: avg " << leaf_fill_avg_ << ", p10 " << leaf_fill_p10_ << ", p50 " << leaf_fill_p50_ << ", p90 "
+       << leaf_fill_p90_ << "\n";
+    os << "internal fill: avg " << internal_fill_avg_ << "\n";
+    os << "leaf contiguity: " << leaf_contiguity_ << "\n";
+    os << "wasted bytes: " << wasted_bytes_ << "\n";
+    return os.str();
+  }
+};
+
+}  // namespace bustub
@@ -0,0 +1,63 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bloom_filter.h
+//
+// Identification: src/include/storage/index/bloom_filter.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * Bloom filter over 64 bit key hashes. MayContain never misses a hash that was
+ * inserted; with bits_per_key bits per expected key it wrongly reports about
+ * 0.6185^bits_per_key of the others, 1% at the default of 10. The k probes are
+ * derived from the two halves of the hash (double hashing), so a key is only
+ * hashed once.
+ */
+class BloomFilter {
+ public:
+  explicit BloomFilter(size_t expected_keys, size_t bits_per_key = BLOOM_FILTER_BITS_PER_KEY)
+      : num_bits_(std::max<size_t>(64, expected_keys * bits_per_key)),
+        // k = ln 2 * bits_per_key minimizes the false positive rate
+        num_probes_(std::clamp<size_t>(bits_per_key * 69 / 100, 1, 30)),
+        bits_((num_bits_ + 63) / 64, 0) {}
+
+  void Insert(uint64_t hash) {
+    uint64_t probe = hash;
+    const uint64_t delta = (hash >> 32) | 1;
+    for (size_t i = 0; i < num_probes_; i++, probe += delta) {
+      uint64_t bit = probe % num_bits_;
+      bits_[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+  }
+
+  auto MayContain(uint64_t hash) const -> bool {
+    uint64_t probe = hash;
+    const uint64_t delta = (hash >> 32) | 1;
+    for (size_t i = 0; i < num_probes_; i++, probe += delta) {
+      uint64_t bit = probe % num_bits_;
+      if ((bits_[bit / 64] & (uint64_t{1} << (bit % 64))) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  size_t num_bits_;
+  size_t num_probes_;
+  std::vector<uint64_t> bits_;
+};
+
+}  // namespace bustub
@@ -12,19 +12,32 @@
 
 #pragma once
 
+#include <algorithm>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "container/disk/hash/disk_extendible_hash_table.h"
 #include "container/hash/hash_function.h"
 #include "storage/index/index.h"
+#include "storage/index/normalized_key.h"
 
 namespace bustub {
 
 #define HASH_TABLE_INDEX_TYPE ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>
 
+/**
+ * Index on a DiskExtendibleHashTable. It only answers lookups of a whole key,
+ * a lookup reads one bucket page whatever the size of the index, but it can
+ * neither scan a range of keys nor a key prefix nor return the rows in order.
+ *
+ * The table keeps the RIDs of a key apart on its own, so the keys hold just
+ * the key columns. Like an LSM tree index it is rebuilt from its table when
+ * the catalog is reopened. Included columns are not supported.
+ */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTableIndex : public Index {
  public:
@@ -33,17 +46,30 @@ class ExtendibleHashTableIndex : public Index {
 
   ~ExtendibleHashTableIndex() override = default;
 
+  /** Does nothing for a unique index whose key already has a row, throws if the bucket of the key cannot split. */
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
+  /** Empties the table and inserts the entries, replacing the contents of the index. */
+  void BulkLoad(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction,
+                double fill_factor) override;
+
+  /** A unique index removes the row of the key whatever rid is, like a B+ tree does. */
   void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  /** Deletes the directory and bucket pages. */
+  void Drop() override { container_.Drop(); }
+
  protected:
+  auto MakeKey(const Tuple &key) const -> KeyType;
+
   // comparator for key
   KeyComparator comparator_;
   // container
   DiskExtendibleHashTable<KeyType, ValueType, KeyComparator> container_;
+  // held while a unique index checks for a key and adds or removes it
+  std::mutex unique_latch_;
 };
 
 }  // namespace bustub
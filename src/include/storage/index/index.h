@@ -13,11 +13,14 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "catalog/schema.h"
+#include "common/exception.h"
+#include "storage/index/b_plus_tree_stats.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
 
@@ -43,11 +46,23 @@ class IndexMetadata {
    * @param table_name The name of the table on which the index is created
    * @param tuple_schema The schema of the indexed key
    * @param key_attrs The mapping from indexed columns to base table columns
+   * @param is_unique Whether a key maps to at most one RID
+   * @param include_attrs The base table columns stored in the index entries next to the key, see GetEntrySchema
+   * @param index_oid The OID the catalog gave the index, none for an index outside of a catalog
    */
   IndexMetadata(std::string index_name, std::string table_name, const Schema *tuple_schema,
-                std::vector<uint32_t> key_attrs)
-      : name_(std::move(index_name)), table_name_(std::move(table_name)), key_attrs_(std::move(key_attrs)) {
+                std::vector<uint32_t> key_attrs, bool is_unique = true, std::vector<uint32_t> include_attrs = {},
+                std::optional<uint32_t> index_oid = std::nullopt)
+      : name_(std::move(index_name)),
+        table_name_(std::move(table_name)),
+        key_attrs_(std::move(key_attrs)),
+        include_attrs_(std::move(include_attrs)),
+        is_unique_(is_unique),
+        index_oid_(index_oid) {
     key_schema_ = std::make_shared<Schema>(Schema::CopySchema(tuple_schema, key_attrs_));
+    entry_attrs_ = key_attrs_;
+    entry_attrs_.insert(entry_attrs_.end(), include_attrs_.begin(), include_attrs_.end());
+    entry_schema_ = std::make_shared<Schema>(Schema::CopySchema(tuple_schema, entry_attrs_));
   }
 
   ~IndexMetadata() = default;
@@ -72,6 +87,21 @@ class IndexMetadata {
   /** @return The mapping relation between indexed columns and base table columns */
   inline auto GetKeyAttrs() const -> const std::vector<uint32_t> & { return key_attrs_; }
 
+  /** @return The base table columns stored next to the key, they are not part of the key */
+  inline auto GetIncludeAttrs() const -> const std::vector<uint32_t> & { return include_attrs_; }
+
+  /** @return The base table columns of an index entry: the key columns followed by the included columns */
+  inline auto GetEntryAttrs() const -> const std::vector<uint32_t> & { return entry_attrs_; }
+
+  /** @return The schema of an index entry, the key schema if there are no included columns */
+  inline auto GetEntrySchema() const -> Schema * { return entry_schema_.get(); }
+
+  /** @return Whether a key maps to at most one RID, a non-unique index keeps every (key, RID) entry */
+  inline auto IsUnique() const -> bool { return is_unique_; }
+
+  /** @return The OID the catalog gave the index, unlike the name it is unique across tables */
+  inline auto GetOid() const -> std::optional<uint32_t> { return index_oid_; }
+
   /** @return A string representation for debugging */
   auto ToString() const -> std::string {
     std::stringstream os;
@@ -79,21 +109,44 @@ class IndexMetadata {
     os << "IndexMetadata["
        << "Name = " << name_ << ", "
        << "Type = B+Tree, "
+       << "Unique = " << (is_unique_ ? "true" : "false") << ", "
        << "Table name = " << table_name_ << "] :: ";
     os << key_schema_->ToString();
+    if (!include_attrs_.empty()) {
+      os << " INCLUDE " << Schema::CopySchema(entry_schema_.get(), IncludePositions()).ToString();
+    }
 
     return os.str();
   }
 
  private:
+  /** The positions of the included columns in the entry schema */
+  auto IncludePositions() const -> std::vector<uint32_t> {
+    std::vector<uint32_t> positions;
+    for (size_t i = key_attrs_.size(); i < entry_attrs_.size(); i++) {
+      positions.push_back(static_cast<uint32_t>(i));
+    }
+    return positions;
+  }
+
   /** The name of the index */
   std::string name_;
   /** The name of the table on which the index is created */
   std::string table_name_;
   /** The mapping relation between key schema and tuple schema */
   const std::vector<uint32_t> key_attrs_;
+  /** The mapping relation between the included columns and tuple schema */
+  const std::vector<uint32_t> include_attrs_;
+  /** The key attributes followed by the included attributes */
+  std::vector<uint32_t> entry_attrs_;
   /** The schema of the indexed key */
   std::shared_ptr<Schema> key_schema_;
+  /** The schema of the key columns followed by the included columns */
+  std::shared_ptr<Schema> entry_schema_;
+  /** Whether a key maps to at most one RID */
+  bool is_unique_;
+  /** The OID of the index in its catalog */
+  std::optional<uint32_t> index_oid_;
 };
 
 /////////////////////////////////////////////////////////////////////
@@ -139,6 +192,12 @@ class Index {
   /** @return The index key attributes */
   auto GetKeyAttrs() const -> const std::vector<uint32_t> & { return metadata_->GetKeyAttrs(); }
 
+  /** @return The index entry schema, the key columns followed by the included columns */
+  auto GetEntrySchema() const -> Schema * { return metadata_->GetEntrySchema(); }
+
+  /** @return The table columns of an index entry, build entries with Tuple::KeyFromTuple on these */
+  auto GetEntryAttrs() const -> const std::vector<uint32_t> & { return metadata_->GetEntryAttrs(); }
+
   /** @return A string representation for debugging */
   auto ToString() const -> std::string {
     std::stringstream os;
@@ -153,16 +212,42 @@ class Index {
 
   /**
    * Insert an entry into the index.
-   * @param key The index key
+   * @param key The index entry, laid out as GetEntrySchema: the key followed by the included columns
    * @param rid The RID associated with the key
    * @param transaction The transaction context
    */
   virtual void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) = 0;
 
+  /**
+   * Insert the entries of a batch of rows, as InsertEntry does for each of them. An index may insert them together,
+   * e.g. in key order, to save page fetches.
+   * @param entries The index entries (see InsertEntry) and their RIDs, in any order
+   * @param transaction The transaction context
+   */
+  virtual void InsertEntries(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction) {
+    for (const auto &[key, rid] : entries) {
+      InsertEntry(key, rid, transaction);
+    }
+  }
+
+  /**
+   * Load a batch of entries into the index, e.g. when rebuilding it from its table.
+   * The default implementation inserts the entries one at a time.
+   * @param entries The index entries (see InsertEntry) and their RIDs, in any order
+   * @param transaction The transaction context
+   * @param fill_factor How full (0, 1] to pack the index pages, for indexes that build them bottom-up
+   */
+  virtual void BulkLoad(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction,
+                        double fill_factor) {
+    for (const auto &[key, rid] : entries) {
+      InsertEntry(key, rid, transaction);
+    }
+  }
+
   /**
    * Delete an index entry by key.
-   * @param key The index key
-   * @param rid The RID associated with the key (unused)
+   * @param key The index entry, laid out as GetEntrySchema like for InsertEntry
+   * @param rid The RID associated with the key, a non-unique index only deletes the entry of this RID
    * @param transaction The transaction context
    */
   virtual void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) = 0;
@@ -170,11 +255,86 @@ class Index {
   /**
    * Search the index for the provided key.
    * @param key The index key
-   * @param result The collection of RIDs that is populated with results of the search
+   * @param result The collection of RIDs that is populated with results of the search, in RID order if the
+   * index is not unique. A lossy index may also return rows whose key only shares the stored prefix.
    * @param transaction The transaction context
    */
   virtual void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) = 0;
 
+  /**
+   * Search the index for a batch of keys, as ScanKey does for each of them. An index may probe the keys together,
+   * e.g. in key order, to save page fetches.
+   * @param keys The index keys
+   * @param results The RIDs of every key, results[i] for keys[i]
+   * @param transaction The transaction context
+   */
+  virtual void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                        Transaction *transaction) {
+    results->assign(keys.size(), {});
+    for (size_t i = 0; i < keys.size(); i++) {
+      ScanKey(keys[i], &(*results)[i], transaction);
+    }
+  }
+
+  /**
+   * Search the index for the keys whose leading columns equal prefix.
+   * The default implementation only handles a prefix of all key columns, i.e. the whole key.
+   * @param prefix The values of the first prefix.size() key columns
+   * @param result The collection of RIDs that is populated with results of the search
+   * @param transaction The transaction context
+   */
+  virtual void ScanKeyPrefix(const std::vector<Value> &prefix, std::vector<RID> *result, Transaction *transaction) {
+    if (prefix.size() != GetIndexColumnCount()) {
+      throw NotImplementedException("index does not support prefix lookups");
+    }
+    ScanKey(Tuple(prefix, GetKeySchema()), result, transaction);
+  }
+
+  /**
+   * @return Whether the index may store only a prefix of long keys. Lookups on a lossy index have to be
+   * checked against the table, and its key order is not the order of the indexed columns.
+   */
+  virtual auto IsLossy() const -> bool { return false; }
+
+  /**
+   * @return Whether the index can hand out its entries, so that a query reading only the key and included columns
+   * never has to fetch the rows from the table
+   */
+  virtual auto IsCovering() const -> bool { return false; }
+
+  /**
+   * Like ScanKeyPrefix, but return the entries of the matching rows as stored in the index, only for an index that
+   * IsCovering.
+   * @param prefix The values of the first prefix.size() key columns
+   * @param result The entries, laid out as GetEntrySchema, and their RIDs
+   * @param transaction The transaction context
+   */
+  virtual void ScanKeyPrefixEntries(const std::vector<Value> &prefix, std::vector<std::pair<Tuple, RID>> *result,
+                                    Transaction *transaction) {
+    throw NotImplementedException("index does not store its entries");
+  }
+
+  /**
+   * Walk the index pages and report their shape and fill, to tell when the index should be rebuilt.
+   * @return The statistics of a tree index, std::nullopt for other kinds of index
+   */
+  virtual auto GetTreeStats() -> std::optional<BPlusTreeStats> { return std::nullopt; }
+
+  /**
+   * Rewrite the index into new, compact pages, e.g. once GetTreeStats shows it sparsely filled after heavy deletes.
+   * Lookups keep running while the index is rebuilt.
+   * @param transaction The transaction context
+   * @param fill_factor How full to pack the new pages, in (0, 1]
+   * @return Whether the index was rebuilt, false for kinds of index that cannot be
+   */
+  virtual auto Rebuild(Transaction *transaction, double fill_factor) -> bool { return false; }
+
+  /**
+   * Free the pages of the index once the catalog gave up on it, e.g. because building it failed. Nothing may use
+   * the index afterwards. The default implementation keeps the pages.
+   */
+  virtual void Drop() {}
+
  private:
   /** The Index structure owns its metadata */
   std::unique_ptr<IndexMetadata> metadata_;
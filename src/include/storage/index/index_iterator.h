@@ -13,26 +13,53 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include <vector>
+
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTree;
+
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
  public:
   // you may define your own constructor based on your member variables
   IndexIterator();
-  IndexIterator(page_id_t page_id, Page *page, int index, BufferPoolManager *buffer_pool_manager);
+  // page is pinned for the iterator and read latched until the constructor returns, start_key is the key
+  // the position at index was searched for, if any
+  IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, Page *page, int index,
+                const KeyType *start_key = nullptr);
   ~IndexIterator();  // NOLINT
 
+  // the iterator owns a pin on its leaf page, so it can be moved but not copied
+  IndexIterator(const IndexIterator &) = delete;
+  auto operator=(const IndexIterator &) -> IndexIterator & = delete;
+  IndexIterator(IndexIterator &&other) noexcept;
+  auto operator=(IndexIterator &&other) noexcept -> IndexIterator &;
+
   auto IsEnd() -> bool;
 
   auto operator*() -> const MappingType &;
 
   auto operator++() -> IndexIterator &;
 
+  /**
+   * Copy up to max_n entries from the current position on into out and move past them. The batch stops before
+   * the first key greater than end_key, or not less than end_key if inclusive is false. A leaf is latched once
+   * for all entries a batch takes from it, and a batch that uses up its leaf already moves on to the next one,
+   * so that leaf is pinned in the buffer pool before the next batch starts.
+   * @return the number of entries appended to out, 0 once the range is exhausted
+   */
+  auto NextBatch(const KeyType &end_key, bool inclusive, const KeyComparator &comparator, size_t max_n,
+                 std::vector<MappingType> *out) -> size_t;
+
+  /** NextBatch without an upper bound, up to the end of the index */
+  auto NextBatch(size_t max_n, std::vector<MappingType> *out) -> size_t;
+
   auto operator==(const IndexIterator &itr) const -> bool {
     return static_cast<bool>(page_id_ == itr.page_id_ && index_ == itr.index_);
   }
@@ -40,11 +67,35 @@ class IndexIterator {
   auto operator!=(const IndexIterator &itr) const -> bool { return !(*this == itr); }
 
  private:
+  // move past the leaves whose entries index_ is beyond
+  void SkipExhaustedLeaves();
+  // recompute index_ from key_ if the leaf changed since the iterator last saw it
+  void Reposition();
+  // recompute index_ from key_, searching the tree if the current leaf does not cover key_
+  void Relocate();
+  // record the entry at index_ as the one the iterator moves past
+  void PassEntry();
+  // NextBatch, end_key is nullptr for no upper bound
+  auto CopyBatch(const KeyType *end_key, bool inclusive, const KeyComparator *comparator, size_t max_n,
+                 std::vector<MappingType> *out) -> size_t;
+
   // add your own private member variables here
+  BPlusTree<KeyType, ValueType, KeyComparator> *tree_{nullptr};
   page_id_t page_id_{INVALID_PAGE_ID};
   Page *page_{nullptr};
   int index_{0};
   BufferPoolManager *buffer_pool_manager_{nullptr};
+  // copy of the current entry, taken under the leaf's read latch
+  MappingType item_;
+  // version of the leaf when index_ was last computed, see BPlusTreePage::GetVersion
+  lsn_t version_{INVALID_LSN};
+  // the position is the first entry after key_ once past_key_, the first one not before it until then; without
+  // has_key_ it is the first entry of the index
+  KeyType key_{};
+  bool has_key_{false};
+  bool past_key_{false};
+  // operator* returned key_, operator++ moves past it even if it was removed since
+  bool returned_key_{false};
 };
 
 }  // namespace bustub
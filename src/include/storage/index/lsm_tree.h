@@ -0,0 +1,201 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lsm_tree.h
+//
+// Identification: src/include/storage/index/lsm_tree.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <optional>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "container/hash/hash_function.h"
+#include "storage/index/bloom_filter.h"
+#include "storage/page/lsm_run_page.h"
+
+namespace bustub {
+
+#define LSMTREE_TYPE LSMTree<KeyType, ValueType, KeyComparator>
+
+/**
+ * Log-structured merge tree, an index for write heavy workloads.
+ *
+ * Writes only go to an in-memory sorted memtable. A full memtable is frozen
+ * and written out sequentially as an immutable sorted run of LSMRunPages.
+ * Level 0 holds the runs written from the memtable, newest first, and their
+ * keys overlap. Every deeper level holds at most one run of up to
+ * LSM_LEVEL_FANOUT times the entries of the level above. Once level 0 has
+ * LSM_LEVEL0_RUNS runs, or a level outgrows its size, a background thread
+ * merges it into the next level (leveled compaction). Writers wait for it if
+ * level 0 reaches LSM_LEVEL0_STOP runs.
+ *
+ * Entries are sorted by key and then by value, one key may map to many values.
+ * Removing an entry writes a tombstone, which hides older versions of the
+ * entry until a merge into the deepest level drops both. Every run keeps a
+ * Bloom filter of its keys and the first key of each page in memory, so a
+ * point lookup only reads the pages holding the key in the runs whose filter
+ * matches.
+ *
+ * Thread safe: latch_ guards the memtable and the list of runs. Readers copy
+ * a snapshot of the runs, which are immutable and reference counted, and read
+ * them without holding latch_. A run's pages are deleted with its last
+ * reference, once compaction has replaced it and no reader uses it anymore.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class LSMTree {
+  using RunPage = LSMRunPage<KeyType, ValueType, KeyComparator>;
+
+ public:
+  explicit LSMTree(BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+                   size_t memtable_size = LSM_MEMTABLE_SIZE);
+  ~LSMTree();
+
+  LSMTree(const LSMTree &) = delete;
+  auto operator=(const LSMTree &) -> LSMTree & = delete;
+
+  // Insert a key-value pair, unless unique is set and the key already has a value.
+  auto Insert(const KeyType &key, const ValueType &value, bool unique = false) -> bool;
+
+  // Remove a key-value pair.
+  void Remove(const KeyType &key, const ValueType &value);
+
+  // return the values associated with a given key, in value order
+  auto GetValue(const KeyType &key, std::vector<ValueType> *result) -> bool;
+
+  // call on_entry with every key-value pair whose key lies in [low, high], in order
+  void Scan(const KeyType &low, const KeyType &high,
+            const std::function<void(const KeyType &, const ValueType &)> &on_entry);
+
+  // Replace the contents of this LSM tree with sorted, distinct key-value pairs, written as a single run.
+  void BulkLoad(const std::vector<MappingType> &entries);
+
+  // write the memtable out as a level 0 run
+  void Flush();
+
+  // block until the background thread has no compaction left to do
+  void WaitForCompaction();
+
+  // the number of runs on each level, level 0 first
+  auto GetLevelRuns() -> std::vector<size_t>;
+
+ private:
+  /** An entry as stored in the memtable and the runs */
+  struct Entry {
+    KeyType key_;
+    ValueType value_;
+    bool tombstone_;
+  };
+
+  /** Orders the memtable by key, then by value */
+  struct EntryLess {
+    KeyComparator comparator_;
+    auto operator()(const std::pair<KeyType, ValueType> &lhs, const std::pair<KeyType, ValueType> &rhs) const
+        -> bool {
+      int cmp = comparator_(lhs.first, rhs.first);
+      return cmp < 0 || (cmp == 0 && lhs.second.Get() < rhs.second.Get());
+    }
+  };
+  /** Key-value pair to whether it is a tombstone */
+  using Memtable = std::map<std::pair<KeyType, ValueType>, bool, EntryLess>;
+
+  /** An immutable sorted run, its pages are deleted along with it */
+  struct Run {
+    Run(BufferPoolManager *buffer_pool_manager, size_t expected_entries)
+        : buffer_pool_manager_(buffer_pool_manager), bloom_(expected_entries) {}
+    ~Run();
+    BufferPoolManager *buffer_pool_manager_;
+    std::vector<page_id_t> pages_;
+    // first key of every page, and the last key of the run
+    std::vector<KeyType> fences_;
+    KeyType last_key_;
+    size_t size_{0};
+    BloomFilter bloom_;
+  };
+  using RunRef = std::shared_ptr<const Run>;
+
+  /** Walks the entries of a run, or of a copy of the memtable, in order */
+  class Cursor {
+   public:
+    explicit Cursor(std::vector<Entry> entries) : buffer_(std::move(entries)) {}
+    // position at the first entry whose key is not less than low
+    Cursor(RunRef run, const KeyType &low, const KeyComparator &comparator);
+    auto Valid() const -> bool { return pos_ < buffer_.size(); }
+    auto Get() const -> const Entry & { return buffer_[pos_]; }
+    void Next();
+
+   private:
+    void LoadPage(size_t page_index);
+
+    RunRef run_;
+    size_t page_index_{0};
+    std::vector<Entry> buffer_;
+    size_t pos_{0};
+  };
+
+  /** Writes entries, in order, into the pages of a new run */
+  class RunWriter {
+   public:
+    RunWriter(LSMTree *tree, size_t expected_entries);
+    ~RunWriter();
+    void Append(const Entry &entry);
+    // the run written, nullptr if it has no entries
+    auto Finish() -> RunRef;
+
+   private:
+    LSMTree *tree_;
+    std::shared_ptr<Run> run_;
+    Page *page_{nullptr};
+  };
+
+  auto CompareEntries(const Entry &lhs, const Entry &rhs) const -> int;
+  void Put(const KeyType &key, const ValueType &value, bool tombstone);
+  // freeze the memtable and write it out unless it has room left and force is not set, called with latch_ held
+  void FlushMemtable(std::unique_lock<std::mutex> *lock, bool force);
+  // copy of the memtable entries with keys in [low, high]
+  auto CopyRange(const Memtable &memtable, const KeyType &low, const KeyType &high) const -> std::vector<Entry>;
+  // cursors over the entries with keys in [low, high], newest first; a point lookup skips runs by their filters
+  auto OpenCursors(const KeyType &low, const KeyType &high, bool point) -> std::vector<Cursor>;
+  // call emit with the newest version of every entry of the cursors, in order, until a key exceeds high
+  template <typename Emit>
+  void Merge(std::vector<Cursor> *cursors, const KeyType *high, Emit emit);
+  // max entries of a level below level 0
+  auto LevelCapacity(size_t level) const -> size_t;
+  // the level to merge into the next one, called with latch_ held
+  auto CompactionLevel() const -> std::optional<size_t>;
+  void CompactionLoop();
+
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  HashFunction<KeyType> hash_fn_;
+  size_t memtable_size_;
+
+  std::mutex latch_;
+  // held while a unique insert checks for its key and adds it
+  std::mutex unique_latch_;
+  std::unique_ptr<Memtable> memtable_;
+  // the memtable being written out, nullptr if there is no flush in progress
+  std::shared_ptr<const Memtable> immutable_;
+  // runs of every level, level 0 newest first, one run or none on deeper levels
+  std::vector<std::vector<RunRef>> levels_;
+  bool compacting_{false};
+  bool stop_{false};
+  // signaled when compaction may have work to do
+  std::condition_variable compaction_cv_;
+  // signaled when a flush or a compaction finishes
+  std::condition_variable done_cv_;
+  std::thread compaction_thread_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,72 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lsm_tree_index.h
+//
+// Identification: src/include/storage/index/lsm_tree_index.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "storage/index/index.h"
+#include "storage/index/lsm_tree.h"
+
+namespace bustub {
+
+#define LSMTREE_INDEX_TYPE LSMTreeIndex<KeyType, ValueType, KeyComparator>
+
+/**
+ * Index on an LSMTree, for tables that see many more writes than reads.
+ *
+ * Inserts and deletes only touch the memtable, which is written out as a
+ * whole, so they do not read or rewrite index pages like a B+ tree does.
+ * Lookups merge the memtable with every run they cannot rule out, and cost
+ * more than on a B+ tree. The tree keeps the RIDs of a key apart on its own,
+ * so the keys hold just the key columns.
+ *
+ * The runs live in buffer pool pages but are not recorded anywhere: the
+ * catalog rebuilds an LSM index from its table when the database is reopened.
+ * Included columns are not supported.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class LSMTreeIndex : public Index {
+ public:
+  LSMTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager);
+
+  /** Does nothing for a unique index whose key already has a row. */
+  void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  /** Sorts the entries and writes them as a single run, replacing the contents of the index. */
+  void BulkLoad(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction,
+                double fill_factor) override;
+
+  /** Writes a tombstone; a unique index looks up the row of the key first, like a B+ tree it ignores rid. */
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
+
+  /** With normalized keys a range scan over the keys starting with the encoded prefix. */
+  void ScanKeyPrefix(const std::vector<Value> &prefix, std::vector<RID> *result, Transaction *transaction) override;
+
+  /** Write the memtable out and wait for the compactions it triggers, for tests and tools. */
+  void FlushAndCompact();
+
+  /** @return The number of runs on each level, level 0 first */
+  auto GetLevelRuns() -> std::vector<size_t> { return container_.GetLevelRuns(); }
+
+ private:
+  auto MakeKey(const Tuple &key) const -> KeyType;
+
+  // comparator for key
+  KeyComparator comparator_;
+  // container
+  LSMTree<KeyType, ValueType, KeyComparator> container_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,247 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// normalized_key.h
+//
+// Identification: src/include/storage/index/normalized_key.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "storage/table/tuple.h"
+#include "type/value.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+/**
+ * Normalized key is a fixed length index key whose bytes sort like the key
+ * itself, so two keys are compared with a single memcmp.
+ *
+ * Every column of the key schema is encoded in turn:
+ * - integers (BOOLEAN, TINYINT, SMALLINT, INTEGER, BIGINT) are stored
+ *   big-endian with the sign bit flipped. BusTub keeps their NULL in-band as
+ *   the type's minimum, which encodes as all zero bytes and sorts first.
+ * - DECIMAL flips the sign bit of positive numbers and all bits of negative
+ *   ones, TIMESTAMP is stored big-endian.
+ * - VARCHAR gets a marker byte, 0 for NULL and 1 otherwise, followed by the
+ *   characters and a 0 terminator, so a string sorts before its extensions.
+ * Columns that do not fit into KeySize are cut off; keys that only differ
+ * past KeySize bytes compare equal. A key that holds all of its columns in
+ * full can be decoded back into their values.
+ */
+template <size_t KeySize>
+class NormalizedKey {
+ public:
+  inline void SetFromKey(const Tuple &tuple, const Schema *key_schema) {
+    memset(data_, 0, KeySize);
+    EncodeKey(tuple, key_schema);
+  }
+
+  // set to the largest key whose leading columns are the columns of tuple, the smallest one is SetFromKey
+  inline void SetPrefixUpperBound(const Tuple &tuple, const Schema *prefix_schema) {
+    memset(data_, 0, KeySize);
+    size_t offset = EncodeKey(tuple, prefix_schema);
+    if (offset < KeySize) {
+      memset(data_ + offset, 0xFF, KeySize - offset);
+    }
+  }
+
+  // decode the columns of key_schema, the key must hold them in full (see NormalizedKeyWidth)
+  inline auto DecodeKey(const Schema *key_schema) const -> std::vector<Value> {
+    std::vector<Value> values;
+    values.reserve(key_schema->GetColumnCount());
+    size_t offset = 0;
+    for (const auto &column : key_schema->GetColumns()) {
+      values.push_back(DecodeValue(column.GetType(), &offset));
+    }
+    return values;
+  }
+
+  // NOTE: for test purpose only
+  // encode as a BIGINT, or as an INTEGER if the key is too short for one
+  inline void SetFromInteger(int64_t key) {
+    memset(data_, 0, KeySize);
+    if constexpr (KeySize >= sizeof(int64_t)) {
+      EncodeInteger(static_cast<uint64_t>(key), sizeof(int64_t), 0);
+    } else {
+      EncodeInteger(static_cast<uint64_t>(key), sizeof(int32_t), 0);
+    }
+  }
+
+  // NOTE: for test purpose only
+  // decode what SetFromInteger (or a leading BIGINT/INTEGER column) encoded
+  inline auto ToString() const -> int64_t {
+    constexpr size_t width = KeySize >= sizeof(int64_t) ? sizeof(int64_t) : sizeof(int32_t);
+    uint64_t bits = 0;
+    for (size_t i = 0; i < width; i++) {
+      bits = (bits << 8) | static_cast<uint8_t>(data_[i]);
+    }
+    bits ^= uint64_t{1} << (width * 8 - 1);
+    if constexpr (width == sizeof(int32_t)) {
+      return static_cast<int32_t>(static_cast<uint32_t>(bits));
+    }
+    return static_cast<int64_t>(bits);
+  }
+
+  // NOTE: for test purpose only
+  friend auto operator<<(std::ostream &os, const NormalizedKey &key) -> std::ostream & {
+    os << key.ToString();
+    return os;
+  }
+
+  // actual location of data
+  char data_[KeySize];
+
+ private:
+  inline auto EncodeKey(const Tuple &tuple, const Schema *key_schema) -> size_t {
+    size_t offset = 0;
+    for (uint32_t i = 0; i < key_schema->GetColumnCount() && offset < KeySize; i++) {
+      offset = EncodeValue(tuple.GetValue(key_schema, i), offset);
+    }
+    return std::min(offset, KeySize);
+  }
+
+  /** Write the big-endian low `width` bytes of bits with the top bit flipped, return the next offset. */
+  inline auto EncodeInteger(uint64_t bits, size_t width, size_t offset) -> size_t {
+    bits ^= uint64_t{1} << (width * 8 - 1);
+    return EncodeBigEndian(bits, width, offset);
+  }
+
+  inline auto EncodeBigEndian(uint64_t bits, size_t width, size_t offset) -> size_t {
+    for (size_t i = 0; i < width && offset < KeySize; i++, offset++) {
+      data_[offset] = static_cast<char>(bits >> ((width - 1 - i) * 8));
+    }
+    return offset;
+  }
+
+  inline auto EncodeValue(const Value &value, size_t offset) -> size_t {
+    switch (value.GetTypeId()) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        return EncodeInteger(static_cast<uint64_t>(value.GetAs<int8_t>()), sizeof(int8_t), offset);
+      case TypeId::SMALLINT:
+        return EncodeInteger(static_cast<uint64_t>(value.GetAs<int16_t>()), sizeof(int16_t), offset);
+      case TypeId::INTEGER:
+        return EncodeInteger(static_cast<uint64_t>(value.GetAs<int32_t>()), sizeof(int32_t), offset);
+      case TypeId::BIGINT:
+        return EncodeInteger(static_cast<uint64_t>(value.GetAs<int64_t>()), sizeof(int64_t), offset);
+      case TypeId::DECIMAL: {
+        double decimal = value.GetAs<double>();
+        uint64_t bits;
+        memcpy(&bits, &decimal, sizeof(bits));
+        bits = (bits >> 63) != 0 ? ~bits : bits ^ (uint64_t{1} << 63);
+        return EncodeBigEndian(bits, sizeof(bits), offset);
+      }
+      case TypeId::TIMESTAMP:
+        return EncodeBigEndian(value.GetAs<uint64_t>(), sizeof(uint64_t), offset);
+      case TypeId::VARCHAR: {
+        if (value.IsNull()) {
+          return offset + 1;  // the marker byte is already 0
+        }
+        data_[offset++] = 1;
+        const char *str = value.GetData();
+        size_t length = strnlen(str, value.GetLength());
+        size_t copy = std::min(length, KeySize - std::min(offset, KeySize));
+        memcpy(data_ + offset, str, copy);
+        return offset + copy + 1;  // skip the 0 terminator
+      }
+      default:
+        return offset;
+    }
+  }
+
+  inline auto DecodeBigEndian(size_t width, size_t *offset) const -> uint64_t {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < width; i++) {
+      bits = (bits << 8) | static_cast<uint8_t>(data_[(*offset)++]);
+    }
+    return bits;
+  }
+
+  /** The integer of `width` bytes EncodeInteger wrote, sign extended */
+  inline auto DecodeInteger(size_t width, size_t *offset) const -> int64_t {
+    uint64_t bits = DecodeBigEndian(width, offset) ^ (uint64_t{1} << (width * 8 - 1));
+    size_t shift = 64 - width * 8;
+    return static_cast<int64_t>(bits << shift) >> shift;
+  }
+
+  inline auto DecodeValue(TypeId type, size_t *offset) const -> Value {
+    switch (type) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        return {type, static_cast<int8_t>(DecodeInteger(sizeof(int8_t), offset))};
+      case TypeId::SMALLINT:
+        return {type, static_cast<int16_t>(DecodeInteger(sizeof(int16_t), offset))};
+      case TypeId::INTEGER:
+        return {type, static_cast<int32_t>(DecodeInteger(sizeof(int32_t), offset))};
+      case TypeId::BIGINT:
+        return {type, DecodeInteger(sizeof(int64_t), offset)};
+      case TypeId::DECIMAL: {
+        uint64_t bits = DecodeBigEndian(sizeof(uint64_t), offset);
+        bits = (bits >> 63) != 0 ? bits ^ (uint64_t{1} << 63) : ~bits;
+        double decimal;
+        memcpy(&decimal, &bits, sizeof(decimal));
+        return {type, decimal};
+      }
+      case TypeId::TIMESTAMP:
+        return {type, DecodeBigEndian(sizeof(uint64_t), offset)};
+      case TypeId::VARCHAR: {
+        if (data_[(*offset)++] == 0) {
+          return ValueFactory::GetNullValueByType(type);
+        }
+        size_t length = strnlen(data_ + *offset, KeySize - *offset);
+        std::string str(data_ + *offset, length);
+        *offset += length + 1;
+        return {type, str};
+      }
+      default:
+        return ValueFactory::GetNullValueByType(type);
+    }
+  }
+};
+
+/**
+ * Bytes a normalized key needs to hold every column of key_schema in full,
+ * VARCHAR columns at their declared length.
+ */
+inline auto NormalizedKeyWidth(const Schema &key_schema) -> size_t {
+  size_t width = 0;
+  for (const auto &column : key_schema.GetColumns()) {
+    width += column.GetType() == TypeId::VARCHAR ? column.GetLength() + 2 : column.GetFixedLength();
+  }
+  return width;
+}
+
+/**
+ * Function object comparing normalized keys bytewise. The key size is a
+ * template argument, so the memcmp is expanded inline by the compiler.
+ */
+template <size_t KeySize>
+class NormalizedComparator {
+ public:
+  inline auto operator()(const NormalizedKey<KeySize> &lhs, const NormalizedKey<KeySize> &rhs) const -> int {
+    return memcmp(lhs.data_, rhs.data_, KeySize);
+  }
+
+  NormalizedComparator(const NormalizedComparator &other) = default;
+
+  // constructor, the key schema is only needed while building keys
+  explicit NormalizedComparator(Schema *key_schema) {}
+};
+
+/** Whether KeyType is a NormalizedKey, the catalog records it to reopen an index with the same encoding. */
+template <class KeyType>
+inline constexpr bool IS_NORMALIZED_KEY = false;
+template <size_t KeySize>
+inline constexpr bool IS_NORMALIZED_KEY<NormalizedKey<KeySize>> = true;
+
+}  // namespace bustub
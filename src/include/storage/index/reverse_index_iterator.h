@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// reverse_index_iterator.h
+//
+// Identification: src/include/storage/index/reverse_index_iterator.h
+//
+//===----------------------------------------------------------------------===//
+/**
+ * reverse_index_iterator.h
+ * For descending range scan of b+ tree
+ */
+#pragma once
+#include <vector>
+
+#include "storage/page/b_plus_tree_leaf_page.h"
+
+namespace bustub {
+
+#define REVERSE_INDEXITERATOR_TYPE ReverseIndexIterator<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTree;
+
+/**
+ * Walks the leaf entries from the last key down to the first, following the
+ * prev links of the leaves. The end position is index -1 of the leftmost leaf.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class ReverseIndexIterator {
+ public:
+  ReverseIndexIterator();
+  // page is pinned for the iterator and read latched until the constructor returns, start_key is the key
+  // the position at index was searched for, if any
+  ReverseIndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, Page *page, int index,
+                       const KeyType *start_key = nullptr);
+  ~ReverseIndexIterator();  // NOLINT
+
+  // the iterator owns a pin on its leaf page, so it can be moved but not copied
+  ReverseIndexIterator(const ReverseIndexIterator &) = delete;
+  auto operator=(const ReverseIndexIterator &) -> ReverseIndexIterator & = delete;
+  ReverseIndexIterator(ReverseIndexIterator &&other) noexcept;
+  auto operator=(ReverseIndexIterator &&other) noexcept -> ReverseIndexIterator &;
+
+  auto IsEnd() -> bool;
+
+  auto operator*() -> const MappingType &;
+
+  auto operator++() -> ReverseIndexIterator &;
+
+  /**
+   * Copy up to max_n entries from the current position downwards into out and move past them, latching each
+   * leaf once per batch like IndexIterator::NextBatch.
+   * @return the number of entries appended to out, 0 once the first key has been passed
+   */
+  auto NextBatch(size_t max_n, std::vector<MappingType> *out) -> size_t;
+
+  auto operator==(const ReverseIndexIterator &itr) const -> bool {
+    return static_cast<bool>(page_id_ == itr.page_id_ && index_ == itr.index_);
+  }
+
+  auto operator!=(const ReverseIndexIterator &itr) const -> bool { return !(*this == itr); }
+
+ private:
+  // move in front of the leaves whose entries index_ is before
+  void SkipExhaustedLeaves();
+  // recompute index_ from key_ if the leaf changed since the iterator last saw it
+  void Reposition();
+  // recompute index_ from key_, searching the tree if the current leaf does not cover key_
+  void Relocate();
+  // record the entry at index_ as the one the iterator moves past
+  void PassEntry();
+
+  BPlusTree<KeyType, ValueType, KeyComparator> *tree_{nullptr};
+  page_id_t page_id_{INVALID_PAGE_ID};
+  Page *page_{nullptr};
+  int index_{-1};
+  BufferPoolManager *buffer_pool_manager_{nullptr};
+  // copy of the current entry, taken under the leaf's read latch
+  MappingType item_;
+  // version of the leaf when index_ was last computed, see BPlusTreePage::GetVersion
+  lsn_t version_{INVALID_LSN};
+  // the position is the last entry before key_ once past_key_, the last one not after it until then; without
+  // has_key_ it is the last entry of the index
+  KeyType key_{};
+  bool has_key_{false};
+  bool past_key_{false};
+  // operator* returned key_, operator++ moves past it even if it was removed since
+  bool returned_key_{false};
+};
+
+}  // namespace bustub
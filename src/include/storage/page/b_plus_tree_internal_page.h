@@ -12,6 +12,7 @@
 
 #include <queue>
 
+#include "storage/page/b_plus_tree_key_search.h"
 #include "storage/page/b_plus_tree_page.h"
 
 namespace bustub {
@@ -27,9 +28,10 @@ namespace bustub {
  * the first key always remains invalid. That is to say, any search/lookup
  * should ignore the first key.
  *
- * Internal page format (keys are stored in increasing order):
+ * Internal page format (keys are stored in increasing order). Keys and page
+ * ids live in two arrays of INTERNAL_PAGE_SIZE slots each:
  *  --------------------------------------------------------------------------
- * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
+ * | HEADER | KEY(1) | KEY(2) | ... | KEY(n) | ... | PAGE_ID(1) | ... | PAGE_ID(n) |
  *  --------------------------------------------------------------------------
  */
 INDEX_TEMPLATE_ARGUMENTS
@@ -45,6 +47,7 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   auto GetAt(int index) const -> MappingType;
   void SetAt(int index, const MappingType &value);
   auto Lookup(const KeyType &key, const KeyComparator &keyComparator) -> ValueType;
+  auto LookupIndex(const KeyType &key, const KeyComparator &keyComparator) -> int;
   void Insert(const MappingType &value, const KeyComparator &keyComparator);
   void Split(const KeyType &key, Page *page_bother, Page *page_parent_page, const KeyComparator &keyComparator,
              BufferPoolManager *buffer_pool_manager);
@@ -55,9 +58,18 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   void GetBotherPage(page_id_t child_page_id, Page *&bother_page, KeyType &key, bool &ispre,
                      BufferPoolManager *buffer_pool_manager);
   void Merge(const KeyType &key, Page *right_page, BufferPoolManager *buffer_pool_manager);
+  // bytes of the page that hold neither the header nor an entry
+  auto FreeBytes() const -> size_t;
 
  private:
-  // Flexible array member for page data.
-  MappingType array_[1];
+  // move count entries starting at src to dst, the ranges may overlap
+  void MoveEntries(int dst, int src, int count);
+  auto Values() -> ValueType * { return reinterpret_cast<ValueType *>(keys_ + INTERNAL_PAGE_SIZE); }
+  auto Values() const -> const ValueType * {
+    return reinterpret_cast<const ValueType *>(keys_ + INTERNAL_PAGE_SIZE);
+  }
+
+  // Flexible array member for page data, the values follow the INTERNAL_PAGE_SIZE key slots.
+  KeyType keys_[1];
 };
 }  // namespace bustub
@@ -0,0 +1,199 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_key_search.h
+//
+// Identification: src/include/storage/page/b_plus_tree_key_search.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "storage/index/generic_key.h"
+#include "storage/index/normalized_key.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BUSTUB_KEY_SEARCH_AVX2
+#include <immintrin.h>
+#endif
+
+namespace bustub {
+
+/**
+ * Search over the contiguous key array of a B+ tree page. Both bounds look
+ * at keys[l, r) only and return r if no key qualifies.
+ */
+template <typename KeyType, typename KeyComparator>
+class KeySearch {
+ public:
+  /** @return index of the first key not less than key */
+  static auto LowerBound(const KeyType *keys, int l, int r, const KeyType &key, const KeyComparator &comparator)
+      -> int {
+    while (l < r) {
+      int mid = (l + r) / 2;
+      if (comparator(keys[mid], key) < 0) {
+        l = mid + 1;
+      } else {
+        r = mid;
+      }
+    }
+    return l;
+  }
+
+  /** @return index of the first key greater than key */
+  static auto UpperBound(const KeyType *keys, int l, int r, const KeyType &key, const KeyComparator &comparator)
+      -> int {
+    while (l < r) {
+      int mid = (l + r) / 2;
+      if (comparator(keys[mid], key) <= 0) {
+        l = mid + 1;
+      } else {
+        r = mid;
+      }
+    }
+    return l;
+  }
+};
+
+/**
+ * Search specialized for the single INTEGER index. The binary search stops
+ * once the range fits into a few cache lines, the rest is counted with a
+ * linear scan: 8 keys per AVX2 compare when the CPU has it, a plain loop the
+ * compiler can vectorize otherwise.
+ */
+template <>
+class KeySearch<NormalizedKey<4>, NormalizedComparator<4>> {
+ public:
+  using KeyType = NormalizedKey<4>;
+  static_assert(sizeof(KeyType) == sizeof(int32_t), "the scan loads keys as packed 32 bit lanes");
+
+  /** Ranges up to this many keys (128 bytes) are scanned instead of bisected */
+  static constexpr int SCAN_WINDOW = 32;
+
+  static auto LowerBound(const KeyType *keys, int l, int r, const KeyType &key,
+                         const NormalizedComparator<4> &comparator) -> int {
+    int32_t target = Decode(key);
+    while (r - l > SCAN_WINDOW) {
+      int mid = (l + r) / 2;
+      if (Decode(keys[mid]) < target) {
+        l = mid + 1;
+      } else {
+        r = mid;
+      }
+    }
+    return l + Count<false>(keys + l, r - l, target);
+  }
+
+  static auto UpperBound(const KeyType *keys, int l, int r, const KeyType &key,
+                         const NormalizedComparator<4> &comparator) -> int {
+    int32_t target = Decode(key);
+    while (r - l > SCAN_WINDOW) {
+      int mid = (l + r) / 2;
+      if (Decode(keys[mid]) <= target) {
+        l = mid + 1;
+      } else {
+        r = mid;
+      }
+    }
+    return l + Count<true>(keys + l, r - l, target);
+  }
+
+ private:
+  /** Undo the big-endian, sign flipped encoding of NormalizedKey */
+  static inline auto Decode(const KeyType &key) -> int32_t {
+    const auto *bytes = reinterpret_cast<const uint8_t *>(key.data_);
+    uint32_t bits = (uint32_t{bytes[0]} << 24) | (uint32_t{bytes[1]} << 16) | (uint32_t{bytes[2]} << 8) | bytes[3];
+    return static_cast<int32_t>(bits ^ 0x80000000U);
+  }
+
+  /** Number of the n sorted keys less than target, or not greater than target if OrEqual */
+  template <bool OrEqual>
+  static inline auto Count(const KeyType *keys, int n, int32_t target) -> int {
+#ifdef BUSTUB_KEY_SEARCH_AVX2
+    if (HAS_AVX2) {
+      return CountAvx2<OrEqual>(keys, n, target);
+    }
+#endif
+    return CountScalar<OrEqual>(keys, n, target, 0);
+  }
+
+  template <bool OrEqual>
+  static inline auto CountScalar(const KeyType *keys, int n, int32_t target, int i) -> int {
+    int count = 0;
+    for (; i < n; i++) {
+      int32_t value = Decode(keys[i]);
+      count += static_cast<int>(OrEqual ? value <= target : value < target);
+    }
+    return count;
+  }
+
+#ifdef BUSTUB_KEY_SEARCH_AVX2
+  static inline const bool HAS_AVX2 = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+
+  template <bool OrEqual>
+  __attribute__((target("avx2"))) static auto CountAvx2(const KeyType *keys, int n, int32_t target) -> int {
+    // reverse the bytes of every 32 bit lane, then flip the sign bit back
+    const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5,
+                                           4, 11, 10, 9, 8, 15, 14, 13, 12);
+    const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+    const __m256i needle = _mm256_set1_epi32(target);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+      __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+      values = _mm256_xor_si256(_mm256_shuffle_epi8(values, bswap), sign);
+      // less: target > value, less or equal: !(value > target)
+      __m256i hits = OrEqual ? _mm256_cmpgt_epi32(values, needle) : _mm256_cmpgt_epi32(needle, values);
+      int mask = _mm256_movemask_ps(_mm256_castsi256_ps(hits));
+      count += OrEqual ? 8 - __builtin_popcount(mask) : __builtin_popcount(mask);
+    }
+    return count + CountScalar<OrEqual>(keys, n, target, i);
+  }
+#endif
+};
+
+/**
+ * Number of leading bytes two normalized keys share. Since they compare with
+ * memcmp, every key between the two shares these bytes as well.
+ */
+template <size_t KeySize>
+inline auto CommonPrefixSize(const NormalizedKey<KeySize> &lhs, const NormalizedKey<KeySize> &rhs) -> size_t {
+  size_t size = 0;
+  while (size < KeySize && lhs.data_[size] == rhs.data_[size]) {
+    size++;
+  }
+  return size;
+}
+
+/**
+ * Separator to push up when a leaf splits between left and right (left <
+ * right): a key s with left < s <= right. Without knowing the key encoding
+ * that is right itself.
+ */
+template <typename KeyType>
+inline auto ShortestSeparator(const KeyType &left, const KeyType &right) -> KeyType {
+  return right;
+}
+
+/**
+ * Normalized keys are cut after the first byte where right differs from left
+ * and zero padded, the shortest key that still separates the two.
+ */
+template <size_t KeySize>
+inline auto ShortestSeparator(const NormalizedKey<KeySize> &left, const NormalizedKey<KeySize> &right)
+    -> NormalizedKey<KeySize> {
+  NormalizedKey<KeySize> separator;
+  memset(separator.data_, 0, KeySize);
+  memcpy(separator.data_, right.data_, std::min(CommonPrefixSize(left, right) + 1, KeySize));
+  return separator;
+}
+
+}  // namespace bustub
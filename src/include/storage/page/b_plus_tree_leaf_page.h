@@ -13,31 +13,46 @@
 #include <utility>
 #include <vector>
 
+#include "storage/page/b_plus_tree_key_search.h"
 #include "storage/page/b_plus_tree_page.h"
 
 namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
-#define LEAF_PAGE_HEADER_SIZE 28
+#define LEAF_PAGE_HEADER_SIZE 32
 #define LEAF_PAGE_SIZE ((BUSTUB_PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
 
 /**
  * Store indexed key and record id(record id = page id combined with slot id,
  * see include/common/rid.h for detailed implementation) together within leaf
- * page. Only support unique key.
+ * page. Only support unique key, a non-unique index appends the RID to its
+ * keys.
  *
- * Leaf page format (keys are stored in order):
+ * Leaf page format (keys are stored in order). Keys and RIDs live in two
+ * arrays of LEAF_PAGE_SIZE slots each, so a search only touches the keys:
  *  ----------------------------------------------------------------------
- * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
+ * | HEADER | KEY(1) | KEY(2) | ... | KEY(n) | ... | RID(1) | ... | RID(n)
  *  ----------------------------------------------------------------------
  *
- *  Header format (size in byte, 28 bytes in total):
+ * Leaves of normalized keys of 16 bytes and more are prefix compressed. They
+ * keep the separators the parent routes by as fence keys: every key k of the
+ * page satisfies LOW <= k < HIGH, so all keys share the bytes the two fences
+ * share and the key slots only store the rest. The slot count grows with the
+ * prefix and the max size grows along with it:
+ *  ----------------------------------------------------------------------
+ * | HEADER | PREFIX SIZE (4) | BASE MAX SIZE (4) | LOW | HIGH | SUFFIX(1) |
+ *  ----------------------------------------------------------------------
+ *  --------------------------------------------------------
+ * | SUFFIX(2) | ... | SUFFIX(n) | ... | RID(1) | ... | RID(n)
+ *  --------------------------------------------------------
+ *
+ *  Header format (size in byte, 32 bytes in total):
  *  ---------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
- *  -----------------------------------------------
- * | ParentPageId (4) | PageId (4) | NextPageId (4)
- *  -----------------------------------------------
+ *  ----------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | PrevPageId (4)
+ *  ----------------------------------------------------------------
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeLeafPage : public BPlusTreePage {
@@ -48,25 +63,73 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   // helper methods
   auto GetNextPageId() const -> page_id_t;
   void SetNextPageId(page_id_t next_page_id);
+  auto GetPrevPageId() const -> page_id_t;
+  void SetPrevPageId(page_id_t prev_page_id);
   auto KeyAt(int index) const -> KeyType;
   auto SetKeyAt(int index, const KeyType &key) -> void;
   auto ValueAt(int index) const -> ValueType;
   auto SetValueAt(int index, const ValueType &value) -> void;
-  auto GetAt(int index) -> MappingType;
+  auto GetAt(int index) const -> MappingType;
   void SetAt(int index, const MappingType &value);
-  auto GetAtIter(int index) -> MappingType &;
   auto Remove(const KeyType &key, int index, const KeyComparator &keyComparator) -> bool;
   auto Delete(const KeyType &key, const KeyComparator &keyComparator) -> bool;
-  void Split(Page *bother_page);
+  auto Split(Page *bother_page) -> KeyType;
   auto KeyIndex(const KeyType &key, const KeyComparator &keyComparator) -> int;
   auto Insert(MappingType value, int index, const KeyComparator &keyComparator) -> bool;
   void InsertFirst(const KeyType &key, const ValueType &value);
   void InsertLast(const KeyType &key, const ValueType &value);
   void Merge(Page *right_page, BufferPoolManager *buffer_pool_manager);
 
+  /** Whether the leaf strips the prefix its fence keys share, see the page format above */
+  static constexpr bool PREFIX_COMPRESSED = IS_NORMALIZED_KEY<KeyType> && sizeof(KeyType) >= 16;
+  // fence keys of a leaf that has no left or right neighbour
+  static auto MinFence() -> KeyType;
+  static auto MaxFence() -> KeyType;
+  // max size of a leaf initialized with base_max_size once it has the given fences
+  static auto MaxSizeOf(int base_max_size, const KeyType &low_fence, const KeyType &high_fence) -> int;
+  auto GetLowFence() const -> KeyType;
+  auto GetHighFence() const -> KeyType;
+  auto MaxSizeFor(const KeyType &low_fence, const KeyType &high_fence) const -> int;
+  // move the fences and re-encode the entries, they must fit MaxSizeFor the new fences
+  void SetFences(const KeyType &low_fence, const KeyType &high_fence);
+  // bytes of the page that hold neither the header, the fences nor an entry
+  auto FreeBytes() const -> size_t;
+
  private:
+  /** Stored in front of the key slots of a prefix compressed leaf */
+  struct FenceHeader {
+    int32_t prefix_size_;
+    int32_t base_max_size_;
+    KeyType low_fence_;
+    KeyType high_fence_;
+  };
+  static constexpr size_t FENCE_HEADER_SIZE = PREFIX_COMPRESSED ? sizeof(FenceHeader) : 0;
+
+  static auto SlotCount(size_t slot_size) -> int;
+  auto Fences() -> FenceHeader * { return reinterpret_cast<FenceHeader *>(keys_); }
+  auto Fences() const -> const FenceHeader * { return reinterpret_cast<const FenceHeader *>(keys_); }
+  auto PrefixSize() const -> size_t;
+  auto SlotSize() const -> size_t { return sizeof(KeyType) - PrefixSize(); }
+  auto Slot(int index) -> char * {
+    return reinterpret_cast<char *>(keys_) + FENCE_HEADER_SIZE + index * SlotSize();
+  }
+  auto Slot(int index) const -> const char * {
+    return reinterpret_cast<const char *>(keys_) + FENCE_HEADER_SIZE + index * SlotSize();
+  }
+  auto Values() -> ValueType *;
+  auto Values() const -> const ValueType *;
+  // compare the key at index with key, which must lie within the fences
+  auto CompareAt(int index, const KeyType &key, const KeyComparator &keyComparator) const -> int;
+  // move count entries starting at src to dst, the ranges may overlap
+  void MoveEntries(int dst, int src, int count);
+  // copy count entries starting at src of another page to dst
+  void CopyEntries(int dst, const BPlusTreeLeafPage *other, int src, int count);
+  // replace the entries by count entries under new fences
+  void Rebuild(const MappingType *entries, int count, const KeyType &low_fence, const KeyType &high_fence);
+
   page_id_t next_page_id_;
-  // Flexible array member for page data.
-  MappingType array_[1];
+  page_id_t prev_page_id_;
+  // Flexible array member for page data: the fence header if any, the key slots, then the values.
+  KeyType keys_[1];
 };
 }  // namespace bustub
@@ -17,6 +17,7 @@
 
 #include "buffer/buffer_pool_manager.h"
 #include "storage/index/generic_key.h"
+#include "storage/index/normalized_key.h"
 
 namespace bustub {
 
@@ -39,6 +40,10 @@ enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
  * ----------------------------------------------------------------------------
  * | ParentPageId (4) | PageId(4) |
  * ----------------------------------------------------------------------------
+ *
+ * Index pages are not logged, so the LSN field serves as the page's version
+ * instead: every change of the size bumps it, and an iterator compares it to
+ * notice that entries were moved under its position.
  */
 class BPlusTreePage {
  public:
@@ -61,8 +66,11 @@ class BPlusTreePage {
   void SetPageId(page_id_t page_id);
 
   void SetLSN(lsn_t lsn = INVALID_LSN);
+  auto GetVersion() const -> lsn_t;
 
  private:
+  void BumpVersion();
+
   // member variable, attributes that both internal and leaf page share
   IndexPageType page_type_ __attribute__((__unused__));
   lsn_t lsn_ __attribute__((__unused__));
@@ -114,7 +114,8 @@ class HashTableDirectoryPage {
   auto GetGlobalDepth() -> uint32_t;
 
   /**
-   * Increment the global depth of the directory
+   * Increment the global depth of the directory, doubling it. Every new index
+   * points to the same bucket as the index it differs from in the new high bit.
    */
   void IncrGlobalDepth();
 
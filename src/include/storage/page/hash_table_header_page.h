@@ -84,11 +84,24 @@ class HashTableHeaderPage {
    */
   auto GetBlockPageId(size_t index) -> page_id_t;
 
+  /**
+   * Replaces the page_id of the index-th block
+   *
+   * @param index the index of the block
+   * @param page_id the new page_id of the block
+   */
+  void SetBlockPageId(size_t index, page_id_t page_id);
+
   /**
    * @return the number of blocks currently stored in the header page
    */
   auto NumBlocks() -> size_t;
 
+  /**
+   * @return the number of block page_ids that fit in a header page
+   */
+  static auto MaxBlocks() -> size_t;
+
  private:
   __attribute__((unused)) lsn_t lsn_;
   __attribute__((unused)) size_t size_;
@@ -0,0 +1,59 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lsm_run_page.h
+//
+// Identification: src/include/storage/page/lsm_run_page.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define LSM_RUN_PAGE_TYPE LSMRunPage<KeyType, ValueType, KeyComparator>
+#define LSM_RUN_PAGE_HEADER_SIZE 4
+
+/**
+ * Page of a sorted run of an LSMTree. A run is written once, from its first
+ * entry to its last, and never changes afterwards: removing an entry writes a
+ * tombstone for it into a newer run instead.
+ *
+ * Entries are sorted by key and then by value. Keys, values and tombstone
+ * flags live in three arrays of CAPACITY slots each:
+ *  ---------------------------------------------------------------------------
+ * | Size (4) | KEY(1) | ... | KEY(n) | ... | VALUE(1) | ... | FLAG(1) | ... |
+ *  ---------------------------------------------------------------------------
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class LSMRunPage {
+ public:
+  /** Number of entries that fit into a page */
+  static constexpr int CAPACITY =
+      (BUSTUB_PAGE_SIZE - LSM_RUN_PAGE_HEADER_SIZE) / (sizeof(KeyType) + sizeof(ValueType) + sizeof(bool));
+
+  // After creating a new run page from buffer pool, must call initialize method to set default values
+  void Init();
+  auto GetSize() const -> int;
+  auto IsFull() const -> bool;
+  auto KeyAt(int index) const -> const KeyType &;
+  auto ValueAt(int index) const -> const ValueType &;
+  auto IsTombstone(int index) const -> bool;
+  // add an entry after the last one, the page must not be full
+  void Append(const KeyType &key, const ValueType &value, bool tombstone);
+
+ private:
+  auto Values() -> ValueType * { return reinterpret_cast<ValueType *>(keys_ + CAPACITY); }
+  auto Values() const -> const ValueType * { return reinterpret_cast<const ValueType *>(keys_ + CAPACITY); }
+  auto Flags() -> bool * { return reinterpret_cast<bool *>(Values() + CAPACITY); }
+  auto Flags() const -> const bool * { return reinterpret_cast<const bool *>(Values() + CAPACITY); }
+
+  int32_t size_;
+  // Flexible array member for page data: the keys, then the values, then the flags.
+  KeyType keys_[1];
+};
+
+}  // namespace bustub
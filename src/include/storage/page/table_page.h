@@ -13,6 +13,7 @@
 #pragma once
 
 #include <cstring>
+#include <vector>
 
 #include "common/rid.h"
 #include "concurrency/lock_manager.h"
@@ -84,6 +85,19 @@ class TablePage : public Page {
   auto InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager)
       -> bool;
 
+  /**
+   * Insert the tuples of a batch into the table, in order, for as long as they fit, and write them ahead as a
+   * single BATCHINSERT log record.
+   * @param tuples the batch of tuples
+   * @param begin index of the first tuple of the batch to insert
+   * @param[out] rids the rids of the inserted tuples are appended here
+   * @param txn transaction performing the insert
+   * @param log_manager the log manager
+   * @return the number of tuples inserted, 0 if tuples[begin] does not fit
+   */
+  auto InsertTuples(const std::vector<Tuple> &tuples, size_t begin, std::vector<RID> *rids, Transaction *txn,
+                    LogManager *log_manager) -> size_t;
+
   /**
    * Mark a tuple as deleted. This does not actually delete the tuple.
    * @param rid rid of the tuple to mark as deleted
@@ -107,6 +121,14 @@ class TablePage : public Page {
   auto UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID &rid, Transaction *txn,
                    LockManager *lock_manager, LogManager *log_manager) -> bool;
 
+  /**
+   * Patch the changed byte ranges of an in-place update into a tuple, used by recovery for DELTAUPDATE records.
+   * @param rid rid of the tuple
+   * @param ranges the changed byte ranges
+   * @param undo true to write the before images, false to write the after images
+   */
+  void ApplyDelta(const RID &rid, const std::vector<DeltaRange> &ranges, bool undo);
+
   /** To be called on commit or abort. Actually perform the delete or rollback an insert. */
   void ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
 
@@ -138,7 +160,21 @@ class TablePage : public Page {
    */
   auto GetNextTupleRid(const RID &cur_rid, RID *next_rid) -> bool;
 
+  /** @return the bytes left on this page for new tuples and their slots */
+  auto GetFreeSpace() -> uint32_t { return GetFreeSpaceRemaining(); }
+
+  /** @return the bytes a tuple of tuple_size takes on a page, its slot included */
+  static auto SpaceFor(uint32_t tuple_size) -> uint32_t { return tuple_size + SIZE_TUPLE; }
+
  private:
+  /**
+   * Copy a tuple into the page, into the first empty slot at or after *slot, or into a new slot.
+   * @param tuple tuple to copy
+   * @param[in,out] slot where to start looking for an empty slot, set to the slot the tuple took
+   * @return true if there was enough space
+   */
+  auto PlaceTuple(const Tuple &tuple, uint32_t *slot) -> bool;
+
   static_assert(sizeof(page_id_t) == 4);
 
   static constexpr size_t SIZE_TABLE_PAGE_HEADER = 24;
@@ -0,0 +1,65 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map.h
+//
+// Identification: src/include/storage/table/free_space_map.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * FreeSpaceMap records the approximate free space of every page of a table
+ * heap, so that an insert goes straight to a page with room for its tuple
+ * instead of walking the page chain from the first page.
+ *
+ * Free space is kept in units of UNIT bytes, rounded down, so a page Find
+ * returns had room for the tuple when it was last recorded. It may have
+ * filled up since; the inserter then records its actual free space and asks
+ * again. Among the pages with room the one with the least free space is
+ * picked, lowest page id first, which leaves roomy pages to larger tuples.
+ *
+ * The map lives in memory only. A table heap that is opened again rebuilds it
+ * with one walk over its pages.
+ */
+class FreeSpaceMap {
+ public:
+  FreeSpaceMap();
+
+  /**
+   * Record the free space of a page, adding the page if it is new.
+   * @param page_id the page
+   * @param free_bytes the bytes free on the page
+   */
+  void Update(page_id_t page_id, uint32_t free_bytes);
+
+  /**
+   * @param bytes the bytes the tuple takes on a page, slot included
+   * @return a page that had at least bytes free when it was last recorded, INVALID_PAGE_ID if there is none
+   */
+  auto Find(uint32_t bytes) -> page_id_t;
+
+ private:
+  /** Free space is recorded in units of UNIT bytes */
+  static constexpr uint32_t UNIT = 32;
+  static constexpr uint32_t CATEGORIES = BUSTUB_PAGE_SIZE / UNIT + 1;
+
+  std::mutex latch_;
+  /** Page id to the units free on it */
+  std::unordered_map<page_id_t, uint32_t> categories_;
+  /** The pages with each number of units free */
+  std::vector<std::set<page_id_t>> pages_;
+};
+
+}  // namespace bustub
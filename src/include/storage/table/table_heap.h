@@ -12,9 +12,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>  // NOLINT
+
 #include "buffer/buffer_pool_manager.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
+#include "storage/table/free_space_map.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
 
@@ -22,7 +26,8 @@ namespace bustub {
 
 /**
  * TableHeap represents a physical table on disk.
- * This is just a doubly-linked list of pages.
+ * This is just a doubly-linked list of pages. A free space map tells inserts
+ * which page has room, so they don't walk the list.
  */
 class TableHeap {
   friend class TableIterator;
@@ -59,6 +64,17 @@ class TableHeap {
    */
   auto InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> bool;
 
+  /**
+   * Insert a batch of tuples into the table. Each page is filled with as many of the tuples as fit under a single
+   * latch and pin, and logged with a single record.
+   * @param tuples the tuples to insert, none may be too large (see InsertTuple)
+   * @param[out] rids the rids of the inserted tuples, rids[i] for tuples[i]
+   * @param txn the transaction performing the insert
+   * @return true iff all the tuples were inserted; otherwise the transaction is aborted, the tuples inserted so far
+   * are in rids and in its write set
+   */
+  auto InsertTuples(const std::vector<Tuple> &tuples, std::vector<RID> *rids, Transaction *txn) -> bool;
+
   /**
    * Mark the tuple as deleted. The actual delete will occur when ApplyDelete is called.
    * @param rid resource id of the tuple of delete
@@ -113,6 +129,23 @@ class TableHeap {
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+
+  /** Walk the pages once to record their free space and find the last one */
+  void LoadFreeSpaceMap();
+
+  /**
+   * Move on from a full page to the page after it, appending a new page if it is the last one.
+   * @param cur_page the full page, WLatched; it is unlatched and unpinned
+   * @param is_dirty whether cur_page was modified
+   * @param txn the transaction performing the insert
+   * @return the next page, WLatched, or nullptr if no page could be created
+   */
+  auto NextPage(TablePage *cur_page, bool is_dirty, Transaction *txn) -> TablePage *;
+
+  FreeSpaceMap free_space_map_;
+  std::once_flag free_space_map_loaded_;
+  /** A hint to the last page, new pages are linked after the page it leads to */
+  std::atomic<page_id_t> last_page_id_{INVALID_PAGE_ID};
 };
 
 }  // namespace bustub
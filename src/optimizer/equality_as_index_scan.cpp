@@ -0,0 +1,126 @@
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "catalog/catalog.h"
+#include "common/exception.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "execution/expressions/constant_value_expression.h"
+#include "execution/expressions/logic_expression.h"
+#include "execution/plans/filter_plan.h"
+#include "execution/plans/index_scan_plan.h"
+#include "execution/plans/seq_scan_plan.h"
+#include "optimizer/optimizer.h"
+
+namespace bustub {
+
+/** The column and the value of a `column = constant` or `constant = column` comparison */
+static auto MatchColumnEqualsConstant(const AbstractExpression &expr) -> std::optional<std::pair<uint32_t, Value>> {
+  const auto *comparison = dynamic_cast<const ComparisonExpression *>(&expr);
+  if (comparison == nullptr || comparison->comp_type_ != ComparisonType::Equal) {
+    return std::nullopt;
+  }
+  for (size_t column_side : {0, 1}) {
+    const auto *column = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(column_side).get());
+    const auto *constant = dynamic_cast<const ConstantValueExpression *>(comparison->GetChildAt(1 - column_side).get());
+    if (column != nullptr && constant != nullptr && column->GetTupleIdx() == 0) {
+      return std::make_pair(column->GetColIdx(), constant->val_);
+    }
+  }
+  return std::nullopt;
+}
+
+/** Add the `column = constant` comparisons among the conjuncts of expr to equalities */
+static void CollectEqualities(const AbstractExpression &expr, std::vector<std::pair<uint32_t, Value>> *equalities) {
+  if (const auto *logic = dynamic_cast<const LogicExpression *>(&expr);
+      logic != nullptr && logic->logic_type_ == LogicType::And) {
+    CollectEqualities(*logic->GetChildAt(0), equalities);
+    CollectEqualities(*logic->GetChildAt(1), equalities);
+    return;
+  }
+  if (auto equality = MatchColumnEqualsConstant(expr); equality.has_value()) {
+    equalities->push_back(std::move(*equality));
+  }
+}
+
+/** value as the type of the key column, nullopt if it is NULL or the cast would change it */
+static auto LookupValue(const Value &value, TypeId key_type) -> std::optional<Value> {
+  if (value.IsNull()) {
+    return std::nullopt;
+  }
+  if (value.GetTypeId() == key_type) {
+    return value;
+  }
+  try {
+    Value cast = value.CastAs(key_type);
+    if (cast.CompareEquals(value) == CmpBool::CmpTrue) {
+      return cast;
+    }
+  } catch (const Exception &e) {
+    // out of range for the key column, no row can match but leave that to the filter
+  }
+  return std::nullopt;
+}
+
+auto Optimizer::MatchEqualityIndex(const std::string &table_name, uint32_t column_idx) -> const IndexInfo * {
+  // a hash index is built for point lookups, any other index on just the column answers them as well
+  const IndexInfo *match = nullptr;
+  for (const auto *index_info : catalog_.GetTableIndexes(table_name)) {
+    const auto &key_attrs = index_info->index_->GetKeyAttrs();
+    if (!index_info->valid_ || key_attrs.size() != 1 || key_attrs[0] != column_idx) {
+      continue;
+    }
+    if (index_info->index_type_ == IndexType::HashIndex) {
+      return index_info;
+    }
+    if (match == nullptr) {
+      match = index_info;
+    }
+  }
+  return match;
+}
+
+auto Optimizer::OptimizeEqualityAsIndexScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
+  std::vector<AbstractPlanNodeRef> children;
+  for (const auto &child : plan->GetChildren()) {
+    children.emplace_back(OptimizeEqualityAsIndexScan(child));
+  }
+  auto optimized_plan = plan->CloneWithChildren(std::move(children));
+
+  if (optimized_plan->GetType() == PlanType::Filter) {
+    const auto &filter_plan = dynamic_cast<const FilterPlanNode &>(*optimized_plan);
+    BUSTUB_ENSURE(optimized_plan->children_.size() == 1, "Filter with multiple children?? Impossible!");
+    if (filter_plan.GetChildPlan()->GetType() != PlanType::SeqScan) {
+      return optimized_plan;
+    }
+    const auto &seq_scan = dynamic_cast<const SeqScanPlanNode &>(*filter_plan.GetChildPlan());
+    if (seq_scan.filter_predicate_ != nullptr) {
+      return optimized_plan;
+    }
+    std::vector<std::pair<uint32_t, Value>> equalities;
+    CollectEqualities(*filter_plan.GetPredicate(), &equalities);
+    for (const auto &[column_idx, value] : equalities) {
+      const auto *index_info = MatchEqualityIndex(seq_scan.table_name_, column_idx);
+      if (index_info == nullptr) {
+        continue;
+      }
+      auto key = LookupValue(value, index_info->key_schema_.GetColumn(0).GetType());
+      if (!key.has_value()) {
+        continue;
+      }
+      auto index_scan = std::make_shared<IndexScanPlanNode>(seq_scan.output_schema_, index_info->index_oid_, false,
+                                                            false, std::vector<Value>{*key});
+      // the lookup checks the whole predicate unless there are other conjuncts or the index keeps a key prefix
+      if (MatchColumnEqualsConstant(*filter_plan.GetPredicate()).has_value() && !index_info->index_->IsLossy()) {
+        return index_scan;
+      }
+      return filter_plan.CloneWithChildren({index_scan});
+    }
+  }
+
+  return optimized_plan;
+}
+
+}  // namespace bustub
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <memory>
+#include <set>
+
+#include "catalog/catalog.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/plans/abstract_plan.h"
+#include "execution/plans/filter_plan.h"
+#include "execution/plans/index_scan_plan.h"
+#include "execution/plans/limit_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
+#include "execution/plans/projection_plan.h"
+#include "execution/plans/sort_plan.h"
+#include "optimizer/optimizer.h"
+
+namespace bustub {
+
+/** Add the columns expr reads to columns */
+static void CollectColumns(const AbstractExpressionRef &expr, std::set<uint32_t> *columns) {
+  if (const auto *column_value_expr = dynamic_cast<const ColumnValueExpression *>(expr.get());
+      column_value_expr != nullptr) {
+    columns->insert(column_value_expr->GetColIdx());
+  }
+  for (const auto &child : expr->GetChildren()) {
+    CollectColumns(child, columns);
+  }
+}
+
+/** Every output column of plan */
+static auto AllColumns(const AbstractPlanNode &plan) -> std::set<uint32_t> {
+  std::set<uint32_t> columns;
+  for (uint32_t i = 0; i < plan.OutputSchema().GetColumnCount(); i++) {
+    columns.insert(i);
+  }
+  return columns;
+}
+
+/** Whether the index stores the table columns `column - offset` of every column in columns from offset on */
+static auto IndexCovers(const IndexInfo &index_info, const std::set<uint32_t> &columns, uint32_t offset) -> bool {
+  if (!index_info.index_->IsCovering()) {
+    return false;
+  }
+  const auto &entry_attrs = index_info.index_->GetEntryAttrs();
+  for (auto column : columns) {
+    if (column >= offset && std::find(entry_attrs.begin(), entry_attrs.end(), column - offset) == entry_attrs.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto Optimizer::MakeIndexOnly(const AbstractPlanNodeRef &plan, std::set<uint32_t> columns) -> AbstractPlanNodeRef {
+  switch (plan->GetType()) {
+    case PlanType::Projection: {
+      // the projection only reads the columns of its expressions, whatever its parent needs
+      std::set<uint32_t> child_columns;
+      for (const auto &expr : dynamic_cast<const ProjectionPlanNode &>(*plan).GetExpressions()) {
+        CollectColumns(expr, &child_columns);
+      }
+      return plan->CloneWithChildren({MakeIndexOnly(plan->GetChildAt(0), std::move(child_columns))});
+    }
+    case PlanType::Limit:
+      return plan->CloneWithChildren({MakeIndexOnly(plan->GetChildAt(0), std::move(columns))});
+    case PlanType::Filter: {
+      CollectColumns(dynamic_cast<const FilterPlanNode &>(*plan).GetPredicate(), &columns);
+      return plan->CloneWithChildren({MakeIndexOnly(plan->GetChildAt(0), std::move(columns))});
+    }
+    case PlanType::Sort: {
+      for (const auto &[order_type, expr] : dynamic_cast<const SortPlanNode &>(*plan).GetOrderBy()) {
+        CollectColumns(expr, &columns);
+      }
+      return plan->CloneWithChildren({MakeIndexOnly(plan->GetChildAt(0), std::move(columns))});
+    }
+    case PlanType::IndexScan: {
+      const auto &index_scan = dynamic_cast<const IndexScanPlanNode &>(*plan);
+      const auto *index_info = catalog_.GetIndex(index_scan.GetIndexOid());
+      if (!index_scan.IsIndexOnly() && index_info != nullptr && IndexCovers(*index_info, columns, 0)) {
+        return std::make_shared<IndexScanPlanNode>(index_scan.output_schema_, index_scan.GetIndexOid(),
+                                                   index_scan.IsDescending(), true, index_scan.GetLookupKey());
+      }
+      return plan;
+    }
+    case PlanType::NestedIndexJoin: {
+      // the output rows are the outer columns followed by the inner ones, only the inner ones come from the index
+      const auto &join = dynamic_cast<const NestedIndexJoinPlanNode &>(*plan);
+      auto outer_column_count = join.GetChildPlan()->OutputSchema().GetColumnCount();
+      std::set<uint32_t> outer_columns(columns.begin(), columns.lower_bound(outer_column_count));
+      CollectColumns(join.KeyPredicate(), &outer_columns);
+      auto outer = MakeIndexOnly(join.GetChildPlan(), std::move(outer_columns));
+      const auto *index_info = catalog_.GetIndex(join.GetIndexOid());
+      bool index_only =
+          join.IsIndexOnly() || (index_info != nullptr && IndexCovers(*index_info, columns, outer_column_count));
+      return std::make_shared<NestedIndexJoinPlanNode>(join.output_schema_, outer, join.KeyPredicate(),
+                                                       join.GetInnerTableOid(), join.GetIndexOid(), join.index_name_,
+                                                       join.index_table_name_, join.inner_table_schema_,
+                                                       join.GetJoinType(), index_only);
+    }
+    default: {
+      // anything else may read every column of its children
+      std::vector<AbstractPlanNodeRef> children;
+      for (const auto &child : plan->GetChildren()) {
+        children.emplace_back(MakeIndexOnly(child, AllColumns(*child)));
+      }
+      return plan->CloneWithChildren(std::move(children));
+    }
+  }
+}
+
+auto Optimizer::OptimizeIndexOnlyScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
+  // The columns each node needs are only known from its parents, so this rule works top-down
+  return MakeIndexOnly(plan, AllColumns(*plan));
+}
+
+}  // namespace bustub
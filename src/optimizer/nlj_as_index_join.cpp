@@ -23,13 +23,23 @@ namespace bustub {
 
 auto Optimizer::MatchIndex(const std::string &table_name, uint32_t index_key_idx)
     -> std::optional<std::tuple<index_oid_t, std::string>> {
-  const auto key_attrs = std::vector{index_key_idx};
+  // an index on exactly this column is best, else one whose key starts with it answers the join by key prefix,
+  // which a hash index cannot do
+  std::optional<std::tuple<index_oid_t, std::string>> prefix_match;
   for (const auto *index_info : catalog_.GetTableIndexes(table_name)) {
-    if (key_attrs == index_info->index_->GetKeyAttrs()) {
+    if (!index_info->valid_) {
+      continue;
+    }
+    const auto &key_attrs = index_info->index_->GetKeyAttrs();
+    if (key_attrs.size() == 1 && key_attrs[0] == index_key_idx) {
       return std::make_optional(std::make_tuple(index_info->index_oid_, index_info->name_));
     }
+    if (!prefix_match.has_value() && key_attrs[0] == index_key_idx &&
+        index_info->index_type_ != IndexType::HashIndex) {
+      prefix_match = std::make_tuple(index_info->index_oid_, index_info->name_);
+    }
   }
-  return std::nullopt;
+  return prefix_match;
 }
 
 auto Optimizer::OptimizeNLJAsIndexJoin(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
@@ -12,15 +12,57 @@
 #include "execution/plans/abstract_plan.h"
 #include "execution/plans/filter_plan.h"
 #include "execution/plans/index_scan_plan.h"
+#include "execution/plans/limit_plan.h"
 #include "execution/plans/nested_loop_join_plan.h"
 #include "execution/plans/projection_plan.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/sort_plan.h"
+#include "execution/plans/topn_plan.h"
 #include "optimizer/optimizer.h"
 #include "type/type_id.h"
 
 namespace bustub {
 
+auto Optimizer::MatchOrderByIndex(const std::vector<std::pair<OrderByType, AbstractExpressionRef>> &order_bys,
+                                  const AbstractPlanNodeRef &child_plan, bool *descending) -> const IndexInfo * {
+  // Has exactly one order by column
+  if (order_bys.size() != 1) {
+    return nullptr;
+  }
+
+  // Either direction works, a descending order scans the index backwards
+  const auto &[order_type, expr] = order_bys[0];
+  if (order_type == OrderByType::INVALID) {
+    return nullptr;
+  }
+  *descending = order_type == OrderByType::DESC;
+
+  // Order expression is a column value expression
+  const auto *column_value_expr = dynamic_cast<ColumnValueExpression *>(expr.get());
+  if (column_value_expr == nullptr) {
+    return nullptr;
+  }
+
+  auto order_by_column_id = column_value_expr->GetColIdx();
+
+  if (child_plan->GetType() == PlanType::SeqScan) {
+    const auto &seq_scan = dynamic_cast<const SeqScanPlanNode &>(*child_plan);
+    const auto *table_info = catalog_.GetTable(seq_scan.GetTableOid());
+    const auto indices = catalog_.GetTableIndexes(table_info->name_);
+
+    // a B+ tree index whose key starts with the column sorts by it, unless it only keeps a prefix of the values
+    for (const auto *index : indices) {
+      const auto &columns = index->key_schema_.GetColumns();
+      if (index->valid_ && index->index_type_ == IndexType::BPlusTreeIndex &&
+          columns[0].GetName() == table_info->schema_.GetColumn(order_by_column_id).GetName() &&
+          !(index->index_->IsLossy() && columns[0].GetType() == TypeId::VARCHAR)) {
+        return index;
+      }
+    }
+  }
+  return nullptr;
+}
+
 auto Optimizer::OptimizeOrderByAsIndexScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
   std::vector<AbstractPlanNodeRef> children;
   for (const auto &child : plan->GetChildren()) {
@@ -30,47 +72,45 @@ auto Optimizer::OptimizeOrderByAsIndexScan(const AbstractPlanNodeRef &plan) -> A
 
   if (optimized_plan->GetType() == PlanType::Sort) {
     const auto &sort_plan = dynamic_cast<const SortPlanNode &>(*optimized_plan);
-    const auto &order_bys = sort_plan.GetOrderBy();
-
-    // Has exactly one order by column
-    if (order_bys.size() != 1) {
-      return optimized_plan;
-    }
-
-    // Order type is asc or default
-    const auto &[order_type, expr] = order_bys[0];
-    if (!(order_type == OrderByType::ASC || order_type == OrderByType::DEFAULT)) {
-      return optimized_plan;
-    }
-
-    // Order expression is a column value expression
-    const auto *column_value_expr = dynamic_cast<ColumnValueExpression *>(expr.get());
-    if (column_value_expr == nullptr) {
-      return optimized_plan;
+    BUSTUB_ENSURE(optimized_plan->children_.size() == 1, "Sort with multiple children?? Impossible!");
+    bool descending;
+    const auto *index = MatchOrderByIndex(sort_plan.GetOrderBy(), optimized_plan->children_[0], &descending);
+    if (index != nullptr) {
+      // Index matched, return index scan instead
+      return std::make_shared<IndexScanPlanNode>(optimized_plan->output_schema_, index->index_oid_, descending);
     }
 
-    auto order_by_column_id = column_value_expr->GetColIdx();
-
-    // Has exactly one child
-    BUSTUB_ENSURE(optimized_plan->children_.size() == 1, "Sort with multiple children?? Impossible!");
+    // A projection between the sort and the scan keeps the order, sort by the scan column it projects instead
     const auto &child_plan = optimized_plan->children_[0];
-
-    if (child_plan->GetType() == PlanType::SeqScan) {
-      const auto &seq_scan = dynamic_cast<const SeqScanPlanNode &>(*child_plan);
-      const auto *table_info = catalog_.GetTable(seq_scan.GetTableOid());
-      const auto indices = catalog_.GetTableIndexes(table_info->name_);
-
-      for (const auto *index : indices) {
-        const auto &columns = index->key_schema_.GetColumns();
-        if (columns.size() == 1 &&
-            columns[0].GetName() == table_info->schema_.GetColumn(order_by_column_id).GetName()) {
-          // Index matched, return index scan instead
-          return std::make_shared<IndexScanPlanNode>(optimized_plan->output_schema_, index->index_oid_);
+    if (child_plan->GetType() == PlanType::Projection && sort_plan.GetOrderBy().size() == 1) {
+      const auto &projection_plan = dynamic_cast<const ProjectionPlanNode &>(*child_plan);
+      const auto &[order_type, expr] = sort_plan.GetOrderBy()[0];
+      const auto *column_value_expr = dynamic_cast<const ColumnValueExpression *>(expr.get());
+      if (column_value_expr != nullptr) {
+        const auto &projected = projection_plan.GetExpressions()[column_value_expr->GetColIdx()];
+        const auto *index =
+            MatchOrderByIndex({{order_type, projected}}, projection_plan.GetChildPlan(), &descending);
+        if (index != nullptr) {
+          auto index_scan = std::make_shared<IndexScanPlanNode>(projection_plan.GetChildPlan()->output_schema_,
+                                                                index->index_oid_, descending);
+          return projection_plan.CloneWithChildren({index_scan});
         }
       }
     }
   }
 
+  if (optimized_plan->GetType() == PlanType::TopN) {
+    const auto &topn_plan = dynamic_cast<const TopNPlanNode &>(*optimized_plan);
+    bool descending;
+    const auto *index = MatchOrderByIndex(topn_plan.GetOrderBy(), topn_plan.GetChildPlan(), &descending);
+    if (index != nullptr) {
+      // The first n rows of the index scan are the top n, no need to look at the rest of the table
+      auto index_scan =
+          std::make_shared<IndexScanPlanNode>(optimized_plan->output_schema_, index->index_oid_, descending);
+      return std::make_shared<LimitPlanNode>(optimized_plan->output_schema_, index_scan, topn_plan.GetN());
+    }
+  }
+
   return optimized_plan;
 }
 
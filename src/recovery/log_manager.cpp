@@ -22,12 +22,39 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  // continue the lsn sequence of the log on disk, recovery repositions it after the last valid record
+  next_lsn_ = disk_manager_->GetLogNextLSN();
+  persistent_lsn_ = next_lsn_ - 1;
+  enable_logging = true;
+  flush_thread_ = new std::thread([this] {
+    std::unique_lock<std::mutex> lock(latch_);
+    while (enable_logging) {
+      cv_.wait_for(lock, log_timeout, [this] { return flush_requested_ || !enable_logging; });
+      FlushLogBuffer(&lock);
+    }
+  });
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  {
+    std::scoped_lock lock(latch_);
+    enable_logging = false;
+    cv_.notify_one();
+  }
+  if (flush_thread_ != nullptr) {
+    flush_thread_->join();
+    delete flush_thread_;
+    flush_thread_ = nullptr;
+  }
+  Flush();
+}
 
 /*
  * append a log record into log buffer
@@ -49,6 +76,143 @@ void LogManager::StopFlushThread() {}
  *  }
  *
  */
-auto LogManager::AppendLogRecord(LogRecord *log_record) -> lsn_t { return INVALID_LSN; }
+auto LogManager::AppendLogRecord(LogRecord *log_record) -> lsn_t {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (log_buffer_offset_ + log_record->size_ > LOG_BUFFER_SIZE) {
+    if (flush_thread_ == nullptr) {
+      FlushLogBuffer(nullptr);
+      break;
+    }
+    // wake up the flush thread and wait until it swapped the buffers
+    flush_requested_ = true;
+    cv_.notify_one();
+    persistent_cv_.wait(lock);
+  }
+  log_record->lsn_ = next_lsn_++;
+  char *pos = log_buffer_ + log_buffer_offset_;
+  memcpy(pos, &log_record->size_, sizeof(int32_t));
+  memcpy(pos + 4, &log_record->lsn_, sizeof(lsn_t));
+  memcpy(pos + 8, &log_record->txn_id_, sizeof(txn_id_t));
+  memcpy(pos + 12, &log_record->prev_lsn_, sizeof(lsn_t));
+  memcpy(pos + 16, &log_record->log_record_type_, sizeof(LogRecordType));
+  SerializeLogRecordBody(log_record, pos + LogRecord::HEADER_SIZE);
+  log_buffer_offset_ += log_record->size_;
+  return log_record->lsn_;
+}
+
+void LogManager::Flush() {
+  lsn_t lsn;
+  {
+    std::scoped_lock lock(latch_);
+    lsn = next_lsn_ - 1;
+  }
+  WaitForPersistent(lsn);
+}
+
+void LogManager::WaitForPersistent(lsn_t lsn) {
+  std::unique_lock<std::mutex> lock(latch_);
+  if (flush_thread_ == nullptr) {
+    if (persistent_lsn_ < lsn) {
+      FlushLogBuffer(nullptr);
+    }
+    return;
+  }
+  // group commit: every waiter that arrives before the flush thread wakes up shares the same write
+  while (persistent_lsn_ < lsn) {
+    flush_requested_ = true;
+    cv_.notify_one();
+    persistent_cv_.wait(lock);
+  }
+}
+
+void LogManager::CheckpointLog() {
+  Flush();
+  std::scoped_lock lock(latch_);
+  disk_manager_->CheckpointLog(next_lsn_);
+}
+
+void LogManager::SerializeLogRecordBody(LogRecord *log_record, char *pos) {
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(pos, &log_record->insert_rid_, sizeof(RID));
+      log_record->insert_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(pos, &log_record->delete_rid_, sizeof(RID));
+      log_record->delete_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.SerializeTo(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.SerializeTo(pos);
+      break;
+    case LogRecordType::DELTAUPDATE: {
+      memcpy(pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      memcpy(pos, &log_record->delta_tuple_size_, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+      auto range_count = static_cast<uint32_t>(log_record->delta_ranges_.size());
+      memcpy(pos, &range_count, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+      for (const auto &range : log_record->delta_ranges_) {
+        auto length = static_cast<uint32_t>(range.old_bytes_.size());
+        memcpy(pos, &range.offset_, sizeof(uint32_t));
+        memcpy(pos + sizeof(uint32_t), &length, sizeof(uint32_t));
+        pos += LogRecord::DELTA_RANGE_HEADER_SIZE;
+        memcpy(pos, range.old_bytes_.data(), length);
+        memcpy(pos + length, range.new_bytes_.data(), length);
+        pos += 2 * length;
+      }
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      memcpy(pos, &log_record->prev_page_id_, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &log_record->page_id_, sizeof(page_id_t));
+      break;
+    case LogRecordType::BATCHINSERT: {
+      auto tuple_count = static_cast<uint32_t>(log_record->batch_tuples_.size());
+      memcpy(pos, &tuple_count, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+      for (uint32_t i = 0; i < tuple_count; i++) {
+        memcpy(pos, &log_record->batch_rids_[i], sizeof(RID));
+        pos += sizeof(RID);
+        log_record->batch_tuples_[i].SerializeTo(pos);
+        pos += sizeof(int32_t) + log_record->batch_tuples_[i].GetLength();
+      }
+      break;
+    }
+    default:
+      // BEGIN/COMMIT/ABORT only carry the header
+      break;
+  }
+}
+
+void LogManager::FlushLogBuffer(std::unique_lock<std::mutex> *lock) {
+  flush_requested_ = false;
+  if (log_buffer_offset_ == 0) {
+    persistent_lsn_ = next_lsn_ - 1;
+    persistent_cv_.notify_all();
+    return;
+  }
+  std::swap(log_buffer_, flush_buffer_);
+  int32_t flush_size = log_buffer_offset_;
+  lsn_t flush_lsn = next_lsn_ - 1;
+  log_buffer_offset_ = 0;
+  if (lock != nullptr) {
+    // appenders can fill the other buffer while this one is written, the flush thread is the only writer
+    persistent_cv_.notify_all();
+    lock->unlock();
+    disk_manager_->WriteLog(flush_buffer_, flush_size);
+    lock->lock();
+  } else {
+    disk_manager_->WriteLog(flush_buffer_, flush_size);
+  }
+  persistent_lsn_ = flush_lsn;
+  persistent_cv_.notify_all();
+}
 
 }  // namespace bustub
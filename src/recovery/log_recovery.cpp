@@ -20,21 +20,287 @@ namespace bustub {
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool { return false; }
+auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool {
+  *log_record = LogRecord();
+  memcpy(&log_record->size_, data, sizeof(int32_t));
+  memcpy(&log_record->lsn_, data + 4, sizeof(lsn_t));
+  memcpy(&log_record->txn_id_, data + 8, sizeof(txn_id_t));
+  memcpy(&log_record->prev_lsn_, data + 12, sizeof(lsn_t));
+  memcpy(&log_record->log_record_type_, data + 16, sizeof(LogRecordType));
+  if (log_record->size_ < LogRecord::HEADER_SIZE || log_record->log_record_type_ == LogRecordType::INVALID) {
+    return false;
+  }
+  const char *pos = data + LogRecord::HEADER_SIZE;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(&log_record->insert_rid_, pos, sizeof(RID));
+      log_record->insert_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(&log_record->delete_rid_, pos, sizeof(RID));
+      log_record->delete_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(&log_record->update_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.DeserializeFrom(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.DeserializeFrom(pos);
+      break;
+    case LogRecordType::DELTAUPDATE: {
+      memcpy(&log_record->update_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      memcpy(&log_record->delta_tuple_size_, pos, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+      uint32_t range_count;
+      memcpy(&range_count, pos, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+      for (uint32_t i = 0; i < range_count; i++) {
+        uint32_t offset;
+        uint32_t length;
+        memcpy(&offset, pos, sizeof(uint32_t));
+        memcpy(&length, pos + sizeof(uint32_t), sizeof(uint32_t));
+        pos += LogRecord::DELTA_RANGE_HEADER_SIZE;
+        log_record->delta_ranges_.push_back({offset, std::string(pos, length), std::string(pos + length, length)});
+        pos += 2 * length;
+      }
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      memcpy(&log_record->prev_page_id_, pos, sizeof(page_id_t));
+      memcpy(&log_record->page_id_, pos + sizeof(page_id_t), sizeof(page_id_t));
+      break;
+    case LogRecordType::BATCHINSERT: {
+      uint32_t tuple_count;
+      memcpy(&tuple_count, pos, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+      log_record->batch_rids_.resize(tuple_count);
+      log_record->batch_tuples_.resize(tuple_count);
+      for (uint32_t i = 0; i < tuple_count; i++) {
+        memcpy(&log_record->batch_rids_[i], pos, sizeof(RID));
+        pos += sizeof(RID);
+        log_record->batch_tuples_[i].DeserializeFrom(pos);
+        pos += sizeof(int32_t) + log_record->batch_tuples_[i].GetLength();
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return true;
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
- *read log file from the beginning to end (you must prefetch log records into
+ *read log file from the redo point of the last checkpoint to the end (you must prefetch log records into
  *log buffer to reduce unnecessary I/O operations), remember to compare page's
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
+ *lsns are consecutive in the log, the first record breaking the sequence is the end of the log (recycled segments
+ *still hold stale records past the tail)
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  offset_ = disk_manager_->GetLogRedoOffset();
+  active_txn_.clear();
+  lsn_mapping_.clear();
+  lsn_t expected_lsn = disk_manager_->GetLogRedoLSN();
+  LogRecord log_record;
+  bool end_of_log = false;
+  while (!end_of_log && disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset_)) {
+    int pos = 0;
+    while (pos + LogRecord::HEADER_SIZE <= LOG_BUFFER_SIZE) {
+      int32_t size = *reinterpret_cast<int32_t *>(log_buffer_ + pos);
+      if (pos + size > LOG_BUFFER_SIZE) {
+        // the record is cut off by the end of the buffer, read again starting from it
+        break;
+      }
+      if (!DeserializeLogRecord(log_buffer_ + pos, &log_record) ||
+          (expected_lsn != INVALID_LSN && log_record.lsn_ != expected_lsn)) {
+        end_of_log = true;
+        break;
+      }
+      expected_lsn = log_record.lsn_ + 1;
+      lsn_mapping_[log_record.lsn_] = offset_ + pos;
+      if (log_record.log_record_type_ == LogRecordType::COMMIT ||
+          log_record.log_record_type_ == LogRecordType::ABORT) {
+        active_txn_.erase(log_record.txn_id_);
+      } else {
+        active_txn_[log_record.txn_id_] = log_record.lsn_;
+      }
+      RedoLogRecord(&log_record);
+      pos += size;
+    }
+    if (pos == 0) {
+      break;
+    }
+    offset_ += pos;
+  }
+  // new log records continue right after the last valid one
+  disk_manager_->SetLogTail(offset_, expected_lsn == INVALID_LSN ? 0 : expected_lsn);
+}
+
+void LogRecovery::RedoLogRecord(LogRecord *log_record) {
+  page_id_t page_id;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page_id = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_id = log_record->delete_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+    case LogRecordType::DELTAUPDATE:
+      page_id = log_record->update_rid_.GetPageId();
+      break;
+    case LogRecordType::BATCHINSERT:
+      page_id = log_record->batch_rids_.front().GetPageId();
+      break;
+    case LogRecordType::NEWPAGE:
+      page_id = log_record->page_id_;
+      break;
+    default:
+      return;
+  }
+
+  auto *page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "Cannot fetch page during redo.");
+  bool redo = page->GetLSN() < log_record->lsn_;
+  if (redo) {
+    switch (log_record->log_record_type_) {
+      case LogRecordType::INSERT: {
+        RID rid;
+        page->InsertTuple(log_record->insert_tuple_, &rid, nullptr, nullptr, nullptr);
+        break;
+      }
+      case LogRecordType::MARKDELETE:
+        page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+        break;
+      case LogRecordType::APPLYDELETE:
+        page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::ROLLBACKDELETE:
+        page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::UPDATE: {
+        Tuple old_tuple;
+        page->UpdateTuple(log_record->new_tuple_, &old_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+        break;
+      }
+      case LogRecordType::DELTAUPDATE:
+        page->ApplyDelta(log_record->update_rid_, log_record->delta_ranges_, false);
+        break;
+      case LogRecordType::BATCHINSERT:
+        for (const auto &tuple : log_record->batch_tuples_) {
+          RID rid;
+          page->InsertTuple(tuple, &rid, nullptr, nullptr, nullptr);
+        }
+        break;
+      case LogRecordType::NEWPAGE:
+        page->Init(page_id, BUSTUB_PAGE_SIZE, log_record->prev_page_id_, nullptr, nullptr);
+        break;
+      default:
+        break;
+    }
+    page->SetLSN(log_record->lsn_);
+  }
+  buffer_pool_manager_->UnpinPage(page_id, redo);
+
+  // re-link the new page into the table heap
+  if (log_record->log_record_type_ == LogRecordType::NEWPAGE && log_record->prev_page_id_ != INVALID_PAGE_ID) {
+    auto *prev_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(log_record->prev_page_id_));
+    BUSTUB_ASSERT(prev_page != nullptr, "Cannot fetch page during redo.");
+    bool relink = prev_page->GetNextPageId() != page_id;
+    if (relink) {
+      prev_page->SetNextPageId(page_id);
+    }
+    buffer_pool_manager_->UnpinPage(log_record->prev_page_id_, relink);
+  }
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  LogRecord log_record;
+  for (const auto &[txn_id, last_lsn] : active_txn_) {
+    lsn_t lsn = last_lsn;
+    while (lsn != INVALID_LSN) {
+      auto it = lsn_mapping_.find(lsn);
+      BUSTUB_ASSERT(it != lsn_mapping_.end(), "Undo chain points to an unknown lsn.");
+      disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, it->second);
+      if (!DeserializeLogRecord(log_buffer_, &log_record)) {
+        break;
+      }
+      UndoLogRecord(&log_record);
+      lsn = log_record.prev_lsn_;
+    }
+  }
+  active_txn_.clear();
+  lsn_mapping_.clear();
+}
+
+void LogRecovery::UndoLogRecord(LogRecord *log_record) {
+  page_id_t page_id;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page_id = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_id = log_record->delete_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+    case LogRecordType::DELTAUPDATE:
+      page_id = log_record->update_rid_.GetPageId();
+      break;
+    case LogRecordType::BATCHINSERT:
+      page_id = log_record->batch_rids_.front().GetPageId();
+      break;
+    default:
+      // nothing to undo for BEGIN/NEWPAGE, an empty page left behind is harmless
+      return;
+  }
+
+  auto *page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "Cannot fetch page during undo.");
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page->ApplyDelete(log_record->insert_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::MARKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE: {
+      RID rid;
+      page->InsertTuple(log_record->delete_tuple_, &rid, nullptr, nullptr, nullptr);
+      break;
+    }
+    case LogRecordType::ROLLBACKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE: {
+      Tuple new_tuple;
+      page->UpdateTuple(log_record->old_tuple_, &new_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+      break;
+    }
+    case LogRecordType::DELTAUPDATE:
+      page->ApplyDelta(log_record->update_rid_, log_record->delta_ranges_, true);
+      break;
+    case LogRecordType::BATCHINSERT:
+      for (auto rid = log_record->batch_rids_.rbegin(); rid != log_record->batch_rids_.rend(); ++rid) {
+        page->ApplyDelete(*rid, nullptr, nullptr);
+      }
+      break;
+    default:
+      break;
+  }
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 }  // namespace bustub
@@ -11,15 +11,20 @@
 //===----------------------------------------------------------------------===//
 
 #include <sys/stat.h>
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
@@ -38,16 +43,16 @@ DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
   }
   log_name_ = file_name_.substr(0, n) + ".log";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::out | std::ios::in);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
+  // pick up the redo point of the last checkpoint, segment files are only created once the log is written
+  std::ifstream control(log_name_ + ".ctl", std::ios::binary);
+  if (control.is_open()) {
+    control.read(reinterpret_cast<char *>(&log_redo_offset_), sizeof(log_redo_offset_));
+    control.read(reinterpret_cast<char *>(&log_redo_lsn_), sizeof(log_redo_lsn_));
+    if (!control) {
+      throw Exception("can't read dblog control file");
     }
   }
+  FindLogTail();
 
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
   db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
@@ -71,6 +76,7 @@ void DiskManager::ShutDown() {
     std::scoped_lock scoped_db_io_latch(db_io_latch_);
     db_io_.close();
   }
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
   log_io_.close();
 }
 
@@ -143,14 +149,29 @@ void DiskManager::WriteLog(char *log_data, int size) {
   }
 
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
+  if (log_name_.empty()) {  // in-memory disk managers have no log file
     return;
   }
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  // sequence write, split at segment boundaries
+  int written = 0;
+  while (written < size) {
+    int64_t segment_no = log_tail_ / LOG_SEGMENT_SIZE;
+    if (segment_no != log_segment_no_) {
+      OpenLogSegment(segment_no);
+    }
+    int segment_offset = static_cast<int>(log_tail_ % LOG_SEGMENT_SIZE);
+    int chunk = std::min(size - written, LOG_SEGMENT_SIZE - segment_offset);
+    log_io_.seekp(segment_offset);
+    log_io_.write(log_data + written, chunk);
+    // check for I/O error
+    if (log_io_.bad()) {
+      LOG_DEBUG("I/O error while writing log");
+      return;
+    }
+    written += chunk;
+    log_tail_ += chunk;
+  }
   // needs to flush to keep disk file in sync
   log_io_.flush();
   flush_log_ = false;
@@ -161,27 +182,149 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * Always read from the beginning and perform sequence read
  * @return: false means already reach the end
  */
-auto DiskManager::ReadLog(char *log_data, int size, int offset) -> bool {
-  if (offset >= GetFileSize(log_name_)) {
+auto DiskManager::ReadLog(char *log_data, int size, int64_t offset) -> bool {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  int read = 0;
+  while (read < size) {
+    int64_t segment_no = (offset + read) / LOG_SEGMENT_SIZE;
+    std::ifstream segment(GetLogSegmentName(segment_no), std::ios::binary);
+    if (!segment.is_open()) {
+      break;
+    }
+    int segment_offset = static_cast<int>((offset + read) % LOG_SEGMENT_SIZE);
+    int chunk = std::min(size - read, LOG_SEGMENT_SIZE - segment_offset);
+    segment.seekg(segment_offset);
+    segment.read(log_data + read, chunk);
+    if (segment.bad()) {
+      LOG_DEBUG("I/O error while reading log");
+      return false;
+    }
+    int read_count = segment.gcount();
+    read += read_count;
+    // if the segment file ends before reading "chunk"
+    if (read_count < chunk) {
+      break;
+    }
+  }
+  if (read == 0) {
     // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  memset(log_data + read, 0, size - read);
+  return true;
+}
 
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while reading log");
-    return false;
+/**
+ * Remember the current log tail as the redo point, then recycle the segments entirely before it by renaming them past
+ * the last segment file, keeping at most LOG_SEGMENT_RECYCLE_LIMIT spares
+ */
+void DiskManager::CheckpointLog(lsn_t next_lsn) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  int64_t first_segment_no = log_redo_offset_ / LOG_SEGMENT_SIZE;
+  log_redo_offset_ = log_tail_;
+  log_redo_lsn_ = next_lsn;
+  log_next_lsn_ = next_lsn;
+  WriteLogControl();
+
+  int64_t redo_segment_no = log_redo_offset_ / LOG_SEGMENT_SIZE;
+  int64_t spare_segment_no = redo_segment_no + 1;
+  while (std::filesystem::exists(GetLogSegmentName(spare_segment_no))) {
+    spare_segment_no++;
+  }
+  for (int64_t segment_no = first_segment_no; segment_no < redo_segment_no; segment_no++) {
+    std::string segment_name = GetLogSegmentName(segment_no);
+    if (spare_segment_no - redo_segment_no - 1 < LOG_SEGMENT_RECYCLE_LIMIT) {
+      if (std::rename(segment_name.c_str(), GetLogSegmentName(spare_segment_no).c_str()) == 0) {
+        spare_segment_no++;
+      }
+    } else {
+      std::remove(segment_name.c_str());
+    }
   }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
+}
+
+/**
+ * Walk the log record headers from the redo point so that new log records are appended after the last valid one,
+ * even when the log is written before recovery ran. lsns are consecutive in the log, the first record breaking the
+ * sequence is the end of the log (recycled segments still hold stale records past the tail)
+ */
+void DiskManager::FindLogTail() {
+  std::vector<char> buffer(LOG_BUFFER_SIZE);
+  int64_t offset = log_redo_offset_;
+  lsn_t expected_lsn = log_redo_lsn_;
+  bool end_of_log = false;
+  while (!end_of_log && ReadLog(buffer.data(), LOG_BUFFER_SIZE, offset)) {
+    int pos = 0;
+    while (pos + LogRecord::HEADER_SIZE <= LOG_BUFFER_SIZE) {
+      int32_t size;
+      lsn_t lsn;
+      LogRecordType type;
+      memcpy(&size, buffer.data() + pos, sizeof(int32_t));
+      memcpy(&lsn, buffer.data() + pos + 4, sizeof(lsn_t));
+      memcpy(&type, buffer.data() + pos + 16, sizeof(LogRecordType));
+      if (size < LogRecord::HEADER_SIZE || type == LogRecordType::INVALID ||
+          (expected_lsn != INVALID_LSN && lsn != expected_lsn)) {
+        end_of_log = true;
+        break;
+      }
+      if (pos + size > LOG_BUFFER_SIZE) {
+        // the record is cut off by the end of the buffer, read again starting from it
+        break;
+      }
+      expected_lsn = lsn + 1;
+      pos += size;
+    }
+    if (pos == 0) {
+      break;
+    }
+    offset += pos;
+  }
+  log_tail_ = offset;
+  log_next_lsn_ = expected_lsn == INVALID_LSN ? 0 : expected_lsn;
+}
+
+void DiskManager::SetLogTail(int64_t offset, lsn_t next_lsn) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  log_tail_ = offset;
+  log_next_lsn_ = next_lsn;
+}
+
+auto DiskManager::GetLogSegmentName(int64_t segment_no) const -> std::string {
+  return log_name_ + "." + std::to_string(segment_no);
+}
+
+void DiskManager::OpenLogSegment(int64_t segment_no) {
+  log_io_.close();
+  std::string segment_name = GetLogSegmentName(segment_no);
+  // a recycled segment is already allocated, we simply overwrite it
+  log_io_.open(segment_name, std::ios::binary | std::ios::in | std::ios::out);
+  if (!log_io_.is_open()) {
     log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
+    // create a new file and allocate the whole segment up front
+    log_io_.open(segment_name, std::ios::binary | std::ios::trunc | std::ios::out | std::ios::in);
+    if (!log_io_.is_open()) {
+      throw Exception("can't open dblog file");
+    }
+    std::filesystem::resize_file(segment_name, LOG_SEGMENT_SIZE);
   }
+  log_segment_no_ = segment_no;
+}
 
-  return true;
+void DiskManager::WriteLogControl() {
+  std::string control_name = log_name_ + ".ctl";
+  std::string tmp_name = control_name + ".tmp";
+  {
+    std::ofstream control(tmp_name, std::ios::binary | std::ios::trunc);
+    control.write(reinterpret_cast<const char *>(&log_redo_offset_), sizeof(log_redo_offset_));
+    control.write(reinterpret_cast<const char *>(&log_redo_lsn_), sizeof(log_redo_lsn_));
+    control.flush();
+    if (!control) {
+      LOG_DEBUG("I/O error while writing log control file");
+      return;
+    }
+  }
+  // replace atomically so a crash never leaves a torn control file behind
+  std::rename(tmp_name.c_str(), control_name.c_str());
 }
 
 /**
@@ -199,6 +342,17 @@ auto DiskManager::GetNumWrites() const -> int { return num_writes_; }
  */
 auto DiskManager::GetFlushState() const -> bool { return flush_log_; }
 
+/**
+ * Number of pages in the database file, rounded up for a partially written last page
+ */
+auto DiskManager::GetNumPages() -> page_id_t {
+  int file_size = file_name_.empty() ? -1 : GetFileSize(file_name_);
+  if (file_size <= 0) {
+    return 0;
+  }
+  return static_cast<page_id_t>((file_size + BUSTUB_PAGE_SIZE - 1) / BUSTUB_PAGE_SIZE);
+}
+
 /**
  * Private helper function to get disk file size
  */
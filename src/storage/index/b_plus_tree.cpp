@@ -1,4 +1,10 @@
+#include <algorithm>
+#include <memory>
+#include <optional>
 #include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/exception.h"
 #include "common/logger.h"
@@ -15,7 +21,8 @@ BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manag
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {}
+      internal_max_size_(internal_max_size),
+      adaptive_hash_(comparator) {}
 
 /*
  * Helper function to decide whether current b+tree is empty
@@ -32,40 +39,341 @@ auto BPLUSTREE_TYPE::IsEmpty() const -> bool { return root_page_id_ == INVALID_P
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) -> bool {
-  if (IsEmpty()) {  // 如果为空
-    return false;   // 返回false
+  // 热点key先查自适应哈希索引，命中时不用从根节点往下找
+  uint64_t hash = hash_fn_.GetHash(key);
+  if (auto location = adaptive_hash_.Lookup(key, hash); location.has_value()) {
+    if (GetCachedValue(key, *location, result)) {
+      return true;
+    }
+    adaptive_hash_.Erase(key, hash);  // 条目已失效
   }
-  auto page = FindLeafPage(key);  // 查找叶子节点
-  if (page == nullptr) {          // 如果为空
-    return false;                 // 返回false
+  bool hot = adaptive_hash_.RecordMiss(hash);
+
+  auto page = FindLeafPage(key, Operation::SEARCH, transaction);  // 查找叶子节点，叶子节点已加读锁
+  if (page == nullptr) {                                          // 如果为空
+    return false;                                                 // 返回false
   }
-  auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());                        // 转换为叶子节点
-  int index = leaf_page->KeyIndex(key, comparator_);                                     // 获取索引
-  if (index < leaf_page->GetSize() && comparator_(leaf_page->KeyAt(index), key) == 0) {  // 如果索引小于大小且key相等
-    result->emplace_back(leaf_page->ValueAt(index));                                     // 插入数据
-    buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), false);                      // 释放
-    return true;                                                                         // 返回true
+  auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());  // 转换为叶子节点
+  int index = leaf_page->KeyIndex(key, comparator_);               // 获取索引
+  bool found = index < leaf_page->GetSize() && comparator_(leaf_page->KeyAt(index), key) == 0;
+  if (found) {                                        // 如果索引小于大小且key相等
+    result->emplace_back(leaf_page->ValueAt(index));  // 插入数据
+    if (hot) {
+      adaptive_hash_.Insert(key, hash, {page->GetPageId(), index, structure_version_.load()});  // 缓存热点key的位置
+    }
   }
-  buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), false);  // 释放
-  return false;
+  page->RUnlatch();                                           // 解锁
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);  // 释放
+  return found;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key) -> Page * {
-  if (IsEmpty()) {  // 如果为空
-    return nullptr;
+void BPLUSTREE_TYPE::GetValues(const std::vector<KeyType> &sorted_keys, std::vector<std::vector<ValueType>> *results,
+                               Transaction *transaction) {
+  std::vector<std::pair<KeyType, KeyType>> ranges;
+  ranges.reserve(sorted_keys.size());
+  for (const auto &key : sorted_keys) {
+    ranges.emplace_back(key, key);
   }
-  Page *page = buffer_pool_manager_->FetchPage(root_page_id_);                           // 获取根节点
-  auto internal_page = reinterpret_cast<InternalPage *>(page->GetData());                // 转换为内部节点
-  while (!internal_page->IsLeafPage()) {                                                 // 如果不是叶子节点
-    page_id_t child_page_id = internal_page->Lookup(key, comparator_);                   // 查找key
-    Page *child_page = buffer_pool_manager_->FetchPage(child_page_id);                   // 获取子节点
-    auto child_internal_page = reinterpret_cast<InternalPage *>(child_page->GetData());  // 转换为内部节点
-    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);                           // 释放
-    page = child_page;                                                                   // 设置为子节点
-    internal_page = child_internal_page;                                                 // 设置为子节点
+  GetValueRanges(ranges, results, transaction);
+}
+
+/*
+ * Look up a batch of key ranges sorted by their low key. Only the leaf being
+ * read is latched, the descent crabs down from page to page. The path to the
+ * leaf is remembered unlatched and unpinned, each page with the key range it
+ * covers and the version it had: the next range drops the pages that do not
+ * cover its low key or changed since, and descends again from the lowest one
+ * left. A range that goes on past the end of a leaf continues at the leaf's
+ * upper bound the same way, so no leaf is ever latched through its sibling
+ * pointer. Once a page has left the tree the path may point at a freed page,
+ * and the next descent starts over from the root.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::GetValueRanges(const std::vector<std::pair<KeyType, KeyType>> &sorted_ranges,
+                                    std::vector<std::vector<ValueType>> *results, Transaction *transaction) {
+  results->assign(sorted_ranges.size(), {});
+  struct Frame {
+    page_id_t page_id_;
+    lsn_t version_;               // 读取时节点的版本
+    std::optional<KeyType> low_;  // 子树覆盖的范围 [low_, high_)，nullopt 表示无界
+    std::optional<KeyType> high_;
+  };
+  auto covers = [this](const Frame &frame, const KeyType &key) {
+    return (!frame.low_ || comparator_(key, *frame.low_) >= 0) && (!frame.high_ || comparator_(key, *frame.high_) < 0);
+  };
+  std::vector<Frame> path;    // 上一次下降经过的节点，不持有锁和pin
+  uint64_t path_version = 0;  // 从根节点下降时的structure_version_
+
+  // 返回读锁住的叶子节点，path以它结束
+  auto find_leaf = [&](const KeyType &key) -> Page * {
+    if (path_version != structure_version_.load()) {
+      path.clear();  // 有页面离开了树，记下的节点可能已被删除
+    }
+    Page *page = nullptr;
+    while (!path.empty()) {  // 回退到覆盖key且没有变化的祖先节点
+      if (covers(path.back(), key)) {
+        page = buffer_pool_manager_->FetchPage(path.back().page_id_);
+        page->RLatch();
+        if (reinterpret_cast<BPlusTreePage *>(page->GetData())->GetVersion() == path.back().version_) {
+          break;
+        }
+        page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(path.back().page_id_, false);
+        page = nullptr;
+      }
+      path.pop_back();
+    }
+    if (page == nullptr) {
+      root_latch_.RLock();
+      if (IsEmpty()) {
+        root_latch_.RUnlock();
+        return nullptr;
+      }
+      path_version = structure_version_.load();
+      page = buffer_pool_manager_->FetchPage(root_page_id_);
+      page->RLatch();
+      root_latch_.RUnlock();
+      auto root_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      path.push_back({page->GetPageId(), root_node->GetVersion(), std::nullopt, std::nullopt});
+    }
+    auto b_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    while (!b_node->IsLeafPage()) {  // 下降到叶子节点
+      auto internal_page = reinterpret_cast<InternalPage *>(b_node);
+      int index = internal_page->LookupIndex(key, comparator_);
+      Frame child{internal_page->ValueAt(index), 0, path.back().low_, path.back().high_};
+      if (index > 0) {
+        child.low_ = internal_page->KeyAt(index);
+      }
+      if (index + 1 < internal_page->GetSize()) {
+        child.high_ = internal_page->KeyAt(index + 1);
+      }
+      Page *child_page = buffer_pool_manager_->FetchPage(child.page_id_);
+      child_page->RLatch();
+      page->RUnlatch();  // 释放父节点
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      page = child_page;
+      b_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      child.version_ = b_node->GetVersion();
+      path.push_back(child);
+    }
+    return page;
+  };
+
+  for (size_t i = 0; i < sorted_ranges.size(); i++) {
+    KeyType low = sorted_ranges[i].first;
+    const KeyType &high = sorted_ranges[i].second;
+    while (true) {
+      Page *page = find_leaf(low);
+      if (page == nullptr) {
+        return;
+      }
+      auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+      int index = leaf_page->KeyIndex(low, comparator_);
+      for (; index < leaf_page->GetSize() && comparator_(leaf_page->KeyAt(index), high) <= 0; index++) {
+        (*results)[i].push_back(leaf_page->ValueAt(index));
+      }
+      // 叶子节点读完而范围还没结束，从叶子的上界继续
+      std::optional<KeyType> leaf_high = path.back().high_;
+      bool done = index < leaf_page->GetSize() || !leaf_high || comparator_(*leaf_high, high) > 0;
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      if (done) {
+        break;
+      }
+      low = *leaf_high;
+    }
   }
-  return page;  // 返回
+}
+
+/*
+ * Answer a lookup from the leaf and slot the adaptive hash index cached for
+ * the key. Inserts, deletes and splits move keys between slots, which the key
+ * check catches; a page freed by a merge may be read back from disk with its
+ * old contents, so any freed page since the entry was cached voids it. The
+ * version is checked again once the leaf is latched, as the page may have been
+ * freed while it was fetched.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::GetCachedValue(const KeyType &key,
+                                    const typename AdaptiveHashIndex<KeyType, KeyComparator>::Location &location,
+                                    std::vector<ValueType> *result) -> bool {
+  if (location.version_ != structure_version_.load()) {
+    return false;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(location.page_id_);
+  if (page == nullptr) {
+    return false;
+  }
+  page->RLatch();
+  auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+  bool valid = location.version_ == structure_version_.load() && leaf_page->IsLeafPage() &&
+               location.slot_ < leaf_page->GetSize() && comparator_(leaf_page->KeyAt(location.slot_), key) == 0;
+  if (valid) {
+    result->emplace_back(leaf_page->ValueAt(location.slot_));
+  }
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  return valid;
+}
+
+/*
+ * Descend from the root to the leaf page covering key (or the leftmost /
+ * rightmost leaf). For SEARCH and OPTIMISTIC root_latch_ is taken here and
+ * nullptr is returned for an empty tree; a parent is released as soon as its
+ * child is latched. For INSERT and DELETE the caller already holds root_latch_
+ * in write mode and has pushed nullptr for it into the page set; every page is
+ * write latched and added to the page set, and everything above a safe page is
+ * released.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, Operation op, Transaction *transaction, bool leftmost,
+                                  bool rightmost) -> Page * {
+  bool pessimistic = op == Operation::INSERT || op == Operation::DELETE;  // 是否为悲观加锁
+  if (!pessimistic) {
+    root_latch_.RLock();  // 根节点读锁
+    if (IsEmpty()) {      // 如果为空
+      root_latch_.RUnlock();
+      return nullptr;
+    }
+  }
+  Page *parent_page = nullptr;        // 父节点
+  page_id_t page_id = root_page_id_;  // 从根节点开始
+  while (true) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);             // 获取节点
+    auto b_node = reinterpret_cast<BPlusTreePage *>(page->GetData());  // 节点类型不会改变
+    if (pessimistic) {
+      page->WLatch();                               // 写锁
+      if (IsSafe(b_node, op)) {                     // 如果当前节点安全
+        ReleaseLatchFromQueue(transaction, false);  // 释放所有祖先节点
+      }
+      transaction->AddIntoPageSet(page);  // 加入page set
+    } else {
+      if (op == Operation::OPTIMISTIC && b_node->IsLeafPage()) {
+        page->WLatch();  // 叶子节点写锁
+      } else {
+        page->RLatch();  // 读锁
+      }
+      if (parent_page == nullptr) {
+        root_latch_.RUnlock();  // 释放根节点读锁
+      } else {
+        parent_page->RUnlatch();                                           // 释放父节点读锁
+        buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), false);  // 释放
+      }
+    }
+    if (b_node->IsLeafPage()) {  // 如果是叶子节点
+      return page;               // 返回
+    }
+    auto internal_page = reinterpret_cast<InternalPage *>(page->GetData());  // 转换为内部节点
+    if (leftmost) {
+      page_id = internal_page->ValueAt(0);  // 最左子节点
+    } else if (rightmost) {
+      page_id = internal_page->ValueAt(internal_page->GetSize() - 1);  // 最右子节点
+    } else {
+      page_id = internal_page->Lookup(key, comparator_);  // 查找key
+    }
+    parent_page = page;  // 设置为父节点
+  }
+}
+
+/*
+ * A page is safe when the operation cannot split or merge it, so nothing
+ * above it can change
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op) const -> bool {
+  if (op == Operation::INSERT) {
+    if (node->IsLeafPage()) {
+      return node->GetSize() + 1 < node->GetMaxSize();  // 插入后不会分裂
+    }
+    return node->GetSize() < node->GetMaxSize();  // 还能再插入一个子节点
+  }
+  if (op == Operation::DELETE) {
+    return node->GetSize() > node->GetMinSize();  // 删除后不会合并
+  }
+  return true;
+}
+
+/*
+ * Unlatch and unpin every page in the transaction's page set; nullptr stands
+ * for root_latch_
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseLatchFromQueue(Transaction *transaction, bool is_dirty) {
+  auto page_set = transaction->GetPageSet();
+  while (!page_set->empty()) {
+    Page *page = page_set->front();  // 从上往下释放
+    page_set->pop_front();
+    if (page == nullptr) {
+      root_latch_.WUnlock();  // 释放根节点写锁
+    } else {
+      page->WUnlatch();                                              // 解锁
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), is_dirty);  // 释放
+    }
+  }
+}
+
+/*
+ * Take a page out of the tree, it is deleted by DeletePages once its latch is
+ * released. Called with the page write latched, so a lookup through the
+ * adaptive hash index either latched it before or sees the new version.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RetirePage(page_id_t page_id, Transaction *transaction) {
+  structure_version_++;
+  transaction->AddIntoDeletedPageSet(page_id);
+}
+
+/*
+ * Delete the pages emptied by merges, once no latch or pin of ours is left
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeletePages(Transaction *transaction) {
+  auto deleted_page_set = transaction->GetDeletedPageSet();
+  DeleteOrDefer(std::vector<page_id_t>(deleted_page_set->begin(), deleted_page_set->end()));
+  deleted_page_set->clear();
+}
+
+/*
+ * Delete pages that left the tree. An open iterator may still be on one of
+ * them, or step onto one through a leaf link and read it back from disk, so
+ * while any iterator is open the pages are also kept in deferred_pages_ and
+ * deleted again by the last iterator to close.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeleteOrDefer(const std::vector<page_id_t> &page_ids) {
+  std::scoped_lock guard(deferred_latch_);
+  for (page_id_t page_id : page_ids) {
+    buffer_pool_manager_->DeletePage(page_id);  // 被迭代器pin住的页面删除失败
+  }
+  if (open_iterators_ > 0) {
+    deferred_pages_.insert(deferred_pages_.end(), page_ids.begin(), page_ids.end());  // 等迭代器都关闭后再删除
+  }
+}
+
+/*
+ * Called by an iterator once it has pinned its first leaf, which is still
+ * latched then, so a tree swap that latches the old pages afterwards sees it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::OpenIterator() {
+  std::scoped_lock guard(deferred_latch_);
+  open_iterators_++;
+}
+
+/*
+ * Called by an iterator after it unpinned its leaf for the last time
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::CloseIterator() {
+  std::scoped_lock guard(deferred_latch_);
+  if (--open_iterators_ > 0) {
+    return;
+  }
+  for (page_id_t page_id : deferred_pages_) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  deferred_pages_.clear();
 }
 
 /*****************************************************************************
@@ -80,44 +388,85 @@ auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key) -> Page * {
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool {
-  Page *page = FindLeafPage(key);                                          // 获取叶子节点
-  while (page == nullptr) {                                                // 如果为空
-    if (IsEmpty()) {                                                       // 如果为空
-      page_id_t page_id;                                                   // 页id
-      Page *new_page = buffer_pool_manager_->NewPage(&page_id);            // 创建新页
-      auto leaf_page = reinterpret_cast<LeafPage *>(new_page->GetData());  // 转换为叶子节点
-      leaf_page->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);           // 初始化
-      root_page_id_ = page_id;                                             // 设置根节点
-      UpdateRootPageId(1);                                                 // 更新根节点
-      buffer_pool_manager_->UnpinPage(page_id, true);                      // 释放
-    }
-    page = FindLeafPage(key);  // 查找叶子节点
+  rebuild_latch_.RLock();  // 重建期间等待
+  bool is_insert = InsertImp(key, value, transaction);
+  rebuild_latch_.RUnlock();
+  return is_insert;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::InsertImp(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool {
+  // 乐观插入：读锁下降，只对叶子节点加写锁
+  Page *page = FindLeafPage(key, Operation::OPTIMISTIC, transaction);  // 获取叶子节点
+  if (page != nullptr) {
+    auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());                        // 转换为叶子节点
+    if (leaf_page->GetSize() + 1 < leaf_page->GetMaxSize()) {                              // 插入后不会分裂
+      int index = leaf_page->KeyIndex(key, comparator_);                                   // 获取索引
+      bool is_insert = leaf_page->Insert(std::make_pair(key, value), index, comparator_);  // 插入数据
+      page->WUnlatch();                                                                    // 解锁
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), is_insert);                       // 释放
+      return is_insert;
+    }
+    page->WUnlatch();                                           // 解锁
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);  // 释放，需要分裂，重新加写锁下降
   }
+
+  // 悲观插入：从根节点开始加写锁
+  std::unique_ptr<Transaction> local_transaction;  // 没有传入事务时用于记录page set
+  if (transaction == nullptr) {
+    local_transaction = std::make_unique<Transaction>(INVALID_TXN_ID);
+    transaction = local_transaction.get();
+  }
+  root_latch_.WLock();                   // 根节点写锁
+  transaction->AddIntoPageSet(nullptr);  // nullptr代表根节点锁
+  if (IsEmpty()) {                       // 如果为空
+    StartNewTree(key, value);            // 创建新树
+    ReleaseLatchFromQueue(transaction, true);
+    return true;
+  }
+  page = FindLeafPage(key, Operation::INSERT, transaction);                            // 获取叶子节点
   auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());                      // 转换为叶子节点
   int index = leaf_page->KeyIndex(key, comparator_);                                   // 获取索引
   bool is_insert = leaf_page->Insert(std::make_pair(key, value), index, comparator_);  // 插入数据
   if (!is_insert) {                                                                    // 如果插入失败
-    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);                         // 释放
+    ReleaseLatchFromQueue(transaction, false);                                         // 释放
     return false;                                                                      // 返回false
   }
   // 如果插入成功
-  if (leaf_page->GetSize() == leaf_max_size_) {                                    // 如果大小等于最大大小
+  if (leaf_page->GetSize() >= leaf_page->GetMaxSize()) {                           // 如果大小达到最大大小
     page_id_t page_bother_id;                                                      // 兄弟节点id
     Page *page_bother = buffer_pool_manager_->NewPage(&page_bother_id);            // 创建新页
     auto leaf_bother_page = reinterpret_cast<LeafPage *>(page_bother->GetData());  // 转换为叶子节点
     leaf_bother_page->Init(page_bother_id, INVALID_PAGE_ID, leaf_max_size_);       // 初始化
-    leaf_page->Split(page_bother);                                                 // 分裂
-    InsertInParent(page, leaf_bother_page->KeyAt(0), page_bother);                 // 插入父节点
+    KeyType separator = leaf_page->Split(page_bother);                             // 分裂，返回分隔key
+    RelinkPrevPage(leaf_bother_page->GetNextPageId(), page_bother_id);             // 原下一个节点指回新节点
+    leaf_move_version_++;                                                          // 数据移动到新叶子
+    InsertInParent(page, separator, page_bother);                                  // 插入父节点
     buffer_pool_manager_->UnpinPage(page_bother->GetPageId(), true);               // 释放
   }
-  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);  // 释放
-  return true;                                               // 返回true
+  ReleaseLatchFromQueue(transaction, true);  // 释放
+  return true;                               // 返回true
+}
+
+/*
+ * Create a root leaf holding the first entry, called with root_latch_ held
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
+  page_id_t page_id;                                                   // 页id
+  Page *new_page = buffer_pool_manager_->NewPage(&page_id);            // 创建新页
+  auto leaf_page = reinterpret_cast<LeafPage *>(new_page->GetData());  // 转换为叶子节点
+  leaf_page->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);           // 初始化
+  leaf_page->InsertLast(key, value);                                   // 插入数据
+  root_page_id_ = page_id;                                             // 设置根节点
+  UpdateRootPageId(1);                                                 // 更新根节点
+  buffer_pool_manager_->UnpinPage(page_id, true);                      // 释放
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::InsertInParent(Page *page_leaf, const KeyType &key, Page *page_bother) -> void {
   auto tree_page = reinterpret_cast<BPlusTreePage *>(page_leaf->GetData());             // 转换为b+树节点
-  if (tree_page->GetPageId() == root_page_id_) {                                        // 如果是根节点
+  if (tree_page->IsRootPage()) {                                                        // 如果是根节点
     page_id_t new_page_id;                                                              // 页id
     Page *new_page = buffer_pool_manager_->NewPage(&new_page_id);                       // 创建新页
     auto new_root = reinterpret_cast<InternalPage *>(new_page->GetData());              // 转换为内部节点
@@ -155,6 +504,330 @@ auto BPLUSTREE_TYPE::InsertInParent(Page *page_leaf, const KeyType &key, Page *p
   buffer_pool_manager_->UnpinPage(parent_id, true);                                             // 释放
 }
 
+/*
+ * Replace whatever the tree held before with entries sorted by key. Entries
+ * with a key equal to their predecessor are skipped since we only support
+ * unique key. The pages of the replaced tree are deleted after the swap, the
+ * same way Rebuild deletes them.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkLoad(const std::vector<MappingType> &entries, Transaction *transaction, double fill_factor) {
+  std::vector<const MappingType *> unique_entries;  // 去重后的数据
+  unique_entries.reserve(entries.size());
+  for (const auto &entry : entries) {
+    if (unique_entries.empty() || comparator_(unique_entries.back()->first, entry.first) != 0) {
+      unique_entries.push_back(&entry);  // 只保留第一个
+    }
+  }
+  rebuild_latch_.RLock();      // 重建期间等待
+  root_latch_.WLock();         // 根节点写锁，构建期间阻塞其他操作
+  bool had_root = !IsEmpty();  // 是否已有根节点
+  std::vector<page_id_t> old_pages = had_root ? CollectPages(root_page_id_) : std::vector<page_id_t>{};
+  structure_version_++;  // 旧的页面不再属于这棵树
+  if (unique_entries.empty()) {
+    root_page_id_ = INVALID_PAGE_ID;  // 空树
+    if (had_root) {
+      UpdateRootPageId(0);  // 更新根节点
+    }
+  } else {
+    root_page_id_ = BuildTree(unique_entries, fill_factor);  // 设置根节点
+    UpdateRootPageId(had_root ? 0 : 1);                      // 更新根节点
+  }
+  root_latch_.WUnlock();
+  rebuild_latch_.RUnlock();
+  FreeOldPages(old_pages);  // 删除旧树的页面
+}
+
+/*
+ * Collect the page ids of the tree under root_id level by level, each page is
+ * read latched while its children are read.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::CollectPages(page_id_t root_id) -> std::vector<page_id_t> {
+  std::vector<page_id_t> pages{root_id};
+  for (size_t i = 0; i < pages.size(); ++i) {
+    Page *page = buffer_pool_manager_->FetchPage(pages[i]);
+    page->RLatch();
+    auto b_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (!b_node->IsLeafPage()) {
+      auto internal_page = reinterpret_cast<InternalPage *>(b_node);
+      for (int index = 0; index < internal_page->GetSize(); ++index) {
+        pages.push_back(internal_page->ValueAt(index));
+      }
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(pages[i], false);
+  }
+  return pages;
+}
+
+/*
+ * Free the tree an earlier instance of this index recorded in the header page
+ * and reset the record to an empty tree, before the tree is rebuilt. Index
+ * pages are not covered by the log, so a page of the old tree is only trusted
+ * if it carries its own page id and its parent's: a page never written back
+ * or since handed out for other data is not followed. Nothing reads the tree
+ * yet, so the pages are deleted right away.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DropPersistedTree() {
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  header_page->RLatch();
+  page_id_t old_root_id;
+  bool found = header_page->GetRootId(index_name_, &old_root_id);
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  if (!found || old_root_id == INVALID_PAGE_ID) {
+    return;
+  }
+
+  std::vector<std::pair<page_id_t, page_id_t>> pending{{old_root_id, INVALID_PAGE_ID}};  // 页面及其父节点
+  std::unordered_set<page_id_t> old_pages;
+  while (!pending.empty()) {
+    auto [page_id, parent_id] = pending.back();
+    pending.pop_back();
+    Page *page = old_pages.count(page_id) == 0 ? buffer_pool_manager_->FetchPage(page_id) : nullptr;
+    if (page == nullptr) {
+      continue;
+    }
+    auto b_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (b_node->GetPageId() == page_id && b_node->GetParentPageId() == parent_id) {
+      old_pages.insert(page_id);
+      auto internal_page = reinterpret_cast<InternalPage *>(b_node);
+      for (int index = 0; !b_node->IsLeafPage() && index < std::min(b_node->GetSize(), internal_max_size_ + 1); ++index) {
+        pending.emplace_back(internal_page->ValueAt(index), page_id);
+      }
+    }
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+  for (page_id_t page_id : old_pages) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+
+  root_latch_.WLock();
+  root_page_id_ = INVALID_PAGE_ID;
+  UpdateRootPageId(0);
+  root_latch_.WUnlock();
+}
+
+/*
+ * Free the whole tree of an index the catalog gave up on. The pages are
+ * deleted the way BulkLoad deletes the tree it replaces, and the record of
+ * the tree is removed from the header page rather than reset.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Drop() {
+  rebuild_latch_.RLock();  // 重建期间等待
+  root_latch_.WLock();
+  std::vector<page_id_t> old_pages = IsEmpty() ? std::vector<page_id_t>{} : CollectPages(root_page_id_);
+  structure_version_++;  // 旧的页面不再属于这棵树
+  root_page_id_ = INVALID_PAGE_ID;
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  header_page->WLatch();
+  page_id_t recorded_root_id;
+  bool found = header_page->GetRootId(index_name_, &recorded_root_id);
+  if (found) {
+    header_page->DeleteRecord(index_name_);
+  }
+  header_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, found);
+  root_latch_.WUnlock();
+  rebuild_latch_.RUnlock();
+  FreeOldPages(old_pages);  // 删除旧树的页面
+}
+
+/*
+ * Delete the pages of a tree that was swapped out. Lookups still descending
+ * through them are waited for by latching the pages top-down, as a lookup
+ * latches a child before it releases the parent. Open iterators keep their
+ * leaf pinned without a latch instead, so the pages they may still reach are
+ * left to DeleteOrDefer rather than waited for, and this returns even if the
+ * caller holds an iterator itself.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::FreeOldPages(const std::vector<page_id_t> &old_pages) {
+  for (page_id_t page_id : old_pages) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    page->WLatch();
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+  DeleteOrDefer(old_pages);
+}
+
+/*
+ * Build a tree bottom-up from distinct entries sorted by key and return its
+ * root page id. Pages are allocated leaves first, in key order. Nodes are
+ * filled to fill_factor of what Insert lets them hold (leaving room for later
+ * inserts without splits), and every level is filled evenly so that each node
+ * stays above its min size, which keeps later Insert/Remove valid.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::BuildTree(const std::vector<const MappingType *> &unique_entries, double fill_factor)
+    -> page_id_t {
+  // 每层的节点数量：按填充因子装入，但平均分配后每个节点不能小于最小大小
+  auto node_count_of = [fill_factor](int total, int max_entries, int min_entries) {
+    min_entries = std::max(min_entries, 1);
+    int capacity = std::clamp(static_cast<int>(max_entries * fill_factor), min_entries, max_entries);
+    int count = (total + capacity - 1) / capacity;
+    return std::max(std::min(count, total / min_entries), 1);
+  };
+
+  // 叶子之间的分隔key，也是叶子的fence
+  int total = static_cast<int>(unique_entries.size());
+  auto fence_at = [&unique_entries, total](int boundary) -> KeyType {
+    if (boundary == 0) {
+      return LeafPage::MinFence();
+    }
+    if (boundary == total) {
+      return LeafPage::MaxFence();
+    }
+    return ShortestSeparator(unique_entries[boundary - 1]->first, unique_entries[boundary]->first);
+  };
+  std::vector<int> boundaries{0};  // 每个叶子的起始位置，最后是total
+  if constexpr (LeafPage::PREFIX_COMPRESSED) {
+    // 前缀压缩的叶子能放多少数据取决于fence，贪心地装入；叶子越大前缀越短，容量只会变小
+    auto capacity_of = [&](int begin, int end) {
+      int max_size = LeafPage::MaxSizeOf(leaf_max_size_, fence_at(begin), fence_at(end));
+      return std::clamp(static_cast<int>((max_size - 1) * fill_factor), std::max(max_size / 2, 1), max_size - 1);
+    };
+    for (int begin = 0; begin < total;) {
+      int end = begin + 1;
+      while (end < total && end + 1 - begin <= capacity_of(begin, end + 1)) {
+        ++end;
+      }
+      boundaries.push_back(end);
+      begin = end;
+    }
+    // 最后一个叶子太小时和前一个叶子平分
+    int leaf_count = static_cast<int>(boundaries.size()) - 1;
+    if (leaf_count > 1) {
+      int begin = boundaries[leaf_count - 1];
+      int max_size = LeafPage::MaxSizeOf(leaf_max_size_, fence_at(begin), fence_at(total));
+      int prev_begin = boundaries[leaf_count - 2];
+      int mid = (prev_begin + total) / 2;
+      if (total - begin < max_size / 2 && mid - prev_begin <= capacity_of(prev_begin, mid) &&
+          total - mid <= capacity_of(mid, total)) {
+        boundaries[leaf_count - 1] = mid;
+      }
+    }
+  } else {
+    // 每个叶子最多leaf_max_size_ - 1个数据，与Insert分裂前的上限一致
+    int leaf_count = node_count_of(total, std::max(leaf_max_size_ - 1, 1), leaf_max_size_ / 2);  // 叶子数量
+    for (int i = 0; i < leaf_count; ++i) {
+      boundaries.push_back(boundaries.back() + total / leaf_count + (i < total % leaf_count ? 1 : 0));  // 平均分配
+    }
+  }
+
+  // 叶子层
+  std::vector<std::pair<KeyType, page_id_t>> level;  // 当前层<分隔key, 页id>
+  LeafPage *prev_leaf = nullptr;                     // 前一个叶子
+  for (size_t i = 0; i + 1 < boundaries.size(); ++i) {
+    page_id_t page_id;
+    Page *page = buffer_pool_manager_->NewPage(&page_id);                   // 创建新页
+    auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());              // 转换为叶子节点
+    leaf_page->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);                   // 初始化
+    leaf_page->SetFences(fence_at(boundaries[i]), fence_at(boundaries[i + 1]));  // 设置fence
+    for (int pos = boundaries[i]; pos < boundaries[i + 1]; ++pos) {
+      leaf_page->InsertLast(unique_entries[pos]->first, unique_entries[pos]->second);  // 插入数据
+    }
+    if (prev_leaf != nullptr) {
+      prev_leaf->SetNextPageId(page_id);                              // 设置下一个节点
+      leaf_page->SetPrevPageId(prev_leaf->GetPageId());               // 设置上一个节点
+      buffer_pool_manager_->UnpinPage(prev_leaf->GetPageId(), true);  // 释放
+    }
+    prev_leaf = leaf_page;
+    level.emplace_back(fence_at(boundaries[i]), page_id);
+  }
+  buffer_pool_manager_->UnpinPage(prev_leaf->GetPageId(), true);  // 释放
+
+  // 内部层：逐层向上构建，直到只剩一个节点
+  while (level.size() > 1) {
+    std::vector<std::pair<KeyType, page_id_t>> parent_level;
+    int child_total = static_cast<int>(level.size());
+    int node_count = node_count_of(child_total, internal_max_size_, (internal_max_size_ + 1) / 2);  // 节点数量
+    for (int i = 0, pos = 0; i < node_count; ++i) {
+      int count = child_total / node_count + (i < child_total % node_count ? 1 : 0);  // 平均分配
+      page_id_t page_id;
+      Page *page = buffer_pool_manager_->NewPage(&page_id);                    // 创建新页
+      auto internal_page = reinterpret_cast<InternalPage *>(page->GetData());  // 转换为内部节点
+      internal_page->Init(page_id, INVALID_PAGE_ID, internal_max_size_);       // 初始化
+      for (int j = 0; j < count; ++j, ++pos) {
+        internal_page->SetKeyAt(j, level[pos].first);                                // 设置key，第一个key无效
+        internal_page->SetValueAt(j, level[pos].second);                             // 设置值
+        Page *child_page = buffer_pool_manager_->FetchPage(level[pos].second);       // 获取子节点
+        auto child_node = reinterpret_cast<BPlusTreePage *>(child_page->GetData());  // 转换为b+树节点
+        child_node->SetParentPageId(page_id);                                        // 设置父节点
+        buffer_pool_manager_->UnpinPage(level[pos].second, true);                    // 释放
+      }
+      internal_page->SetSize(count);                                 // 设置大小
+      parent_level.emplace_back(level[pos - count].first, page_id);  // 记录第一个key
+      buffer_pool_manager_->UnpinPage(page_id, true);                // 释放
+    }
+    level = std::move(parent_level);
+  }
+
+  return level[0].second;
+}
+
+/*
+ * Compact the tree online. With writers held off by rebuild_latch_, the
+ * entries are copied out of the leaves in key order and built bottom-up into
+ * freshly allocated pages, so that a range scan reads the new leaves one
+ * after another; lookups keep reading the old pages meanwhile. The root is
+ * then swapped under root_latch_ and recorded in the header page, and the old
+ * pages are deleted by FreeOldPages.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Rebuild(double fill_factor) {
+  rebuild_latch_.WLock();  // 阻塞写操作，读操作继续在旧树上进行
+  root_latch_.RLock();
+  page_id_t old_root_id = root_page_id_;
+  root_latch_.RUnlock();
+  if (old_root_id == INVALID_PAGE_ID) {
+    rebuild_latch_.WUnlock();
+    return;
+  }
+
+  // 逐层遍历旧树，记录所有页面，并按key的顺序取出叶子节点的数据
+  std::vector<page_id_t> old_pages{old_root_id};
+  std::vector<MappingType> entries;
+  for (size_t i = 0; i < old_pages.size(); ++i) {
+    Page *page = buffer_pool_manager_->FetchPage(old_pages[i]);
+    page->RLatch();
+    auto b_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (b_node->IsLeafPage()) {
+      auto leaf_page = reinterpret_cast<LeafPage *>(b_node);
+      for (int index = 0; index < leaf_page->GetSize(); ++index) {
+        entries.emplace_back(leaf_page->KeyAt(index), leaf_page->ValueAt(index));
+      }
+    } else {
+      auto internal_page = reinterpret_cast<InternalPage *>(b_node);
+      for (int index = 0; index < internal_page->GetSize(); ++index) {
+        old_pages.push_back(internal_page->ValueAt(index));
+      }
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(old_pages[i], false);
+  }
+
+  std::vector<const MappingType *> sorted_entries;
+  sorted_entries.reserve(entries.size());
+  for (const auto &entry : entries) {
+    sorted_entries.push_back(&entry);
+  }
+  page_id_t new_root_id = entries.empty() ? INVALID_PAGE_ID : BuildTree(sorted_entries, fill_factor);
+  root_latch_.WLock();  // 只在切换根节点时阻塞读操作
+  root_page_id_ = new_root_id;
+  UpdateRootPageId(0);
+  structure_version_++;  // 旧的页面不再属于这棵树
+  root_latch_.WUnlock();
+  rebuild_latch_.WUnlock();
+
+  // 等还在旧树上的读操作离开后删除旧页面
+  FreeOldPages(old_pages);
+}
+
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
@@ -167,75 +840,120 @@ auto BPLUSTREE_TYPE::InsertInParent(Page *page_leaf, const KeyType &key, Page *p
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
-  if (IsEmpty()) {  // 如果为空
-    return;         // 返回
+  rebuild_latch_.RLock();  // 重建期间等待
+  RemoveImp(key, transaction);
+  rebuild_latch_.RUnlock();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RemoveImp(const KeyType &key, Transaction *transaction) {
+  // 乐观删除：读锁下降，只对叶子节点加写锁
+  Page *page = FindLeafPage(key, Operation::OPTIMISTIC, transaction);  // 查找叶子节点
+  if (page == nullptr) {                                               // 如果为空
+    return;                                                            // 返回
   }
-  auto leaf_page = FindLeafPage(key);  // 查找叶子节点
-  if (leaf_page == nullptr) {
+  auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());   // 转换为叶子节点
+  if (leaf_page->GetSize() > leaf_page->GetMinSize()) {             // 删除后不会合并
+    bool is_delete = leaf_page->Delete(key, comparator_);           // 删除数据
+    page->WUnlatch();                                               // 解锁
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), is_delete);  // 释放
     return;
   }
-  DeleteEntry(leaf_page, key);  // 删除数据
+  page->WUnlatch();                                           // 解锁
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);  // 释放，可能需要合并，重新加写锁下降
+
+  // 悲观删除：从根节点开始加写锁
+  std::unique_ptr<Transaction> local_transaction;  // 没有传入事务时用于记录page set
+  if (transaction == nullptr) {
+    local_transaction = std::make_unique<Transaction>(INVALID_TXN_ID);
+    transaction = local_transaction.get();
+  }
+  root_latch_.WLock();                   // 根节点写锁
+  transaction->AddIntoPageSet(nullptr);  // nullptr代表根节点锁
+  if (IsEmpty()) {                       // 如果为空
+    ReleaseLatchFromQueue(transaction, false);
+    return;
+  }
+  page = FindLeafPage(key, Operation::DELETE, transaction);  // 查找叶子节点
+  DeleteEntry(page, key, transaction);                       // 删除数据
+  ReleaseLatchFromQueue(transaction, true);                  // 释放
+  DeletePages(transaction);                                  // 删除合并后的空节点
 }
 
+/*
+ * Remove key from page and fix an underflow by merging with or borrowing from
+ * a sibling. page and, while it may change, its parent are write latched in
+ * the page set; the sibling is latched here.
+ */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::DeleteEntry(Page *&page, const KeyType &key) -> void {
+auto BPLUSTREE_TYPE::DeleteEntry(Page *page, const KeyType &key, Transaction *transaction) -> void {
   auto b_node = reinterpret_cast<BPlusTreePage *>(page->GetData());  // 转换为b+树节点
   if (b_node->IsLeafPage()) {                                        // 如果是叶子节点
     auto leaf_node = reinterpret_cast<LeafPage *>(page->GetData());  // 转换为叶子节点
     if (!leaf_node->Delete(key, comparator_)) {                      // 删除失败，说明没有这个key
-      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);     // 释放
       return;
     }
   } else {                                                                   // 如果不是叶子节点
     auto internal_node = reinterpret_cast<InternalPage *>(page->GetData());  // 转换为内部节点
     if (!internal_node->Delete(key, comparator_)) {                          // 删除失败
-      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);             // 释放
       return;
     }
   }
-  if (b_node->GetPageId() == root_page_id_) {  // 如果是根节点
-    AdjustRootPage(b_node);                    // 调整根节点
+  if (b_node->IsRootPage()) {             // 如果是根节点
+    AdjustRootPage(b_node, transaction);  // 调整根节点
     return;
   }
-  if (b_node->GetSize() < b_node->GetMinSize()) {  // 如果大小小于最小大小
-    Page *bother_page;
-    KeyType parent_key{};
-    bool is_pre;
-    auto inter_node = reinterpret_cast<InternalPage *>(page->GetData());          // 转换为内部节点
-    auto parent_page_id = inter_node->GetParentPageId();                          // 获取父节点id
-    auto parent_page = buffer_pool_manager_->FetchPage(parent_page_id);           // 获取父节点
-    auto parent_node = reinterpret_cast<InternalPage *>(parent_page->GetData());  // 转换为内部节点
-    parent_node->GetBotherPage(page->GetPageId(), bother_page, parent_key, is_pre,
-                               buffer_pool_manager_);                              // 获取兄弟节点
-    auto bother_node = reinterpret_cast<BPlusTreePage *>(bother_page->GetData());  // 转换为b+树节点
-    if (b_node->GetSize() + bother_node->GetSize() <= b_node->GetMaxSize()) {  // 如果大小小于等于最大大小
-      if (!is_pre) {
-        std::swap(page, bother_page);
-      }
-      Coalesce(page, bother_page, parent_key);                           // 合并
-      DeleteEntry(parent_page, parent_key);                              // 删除数据
-    } else {                                                             // 如果大小大于最大大小
-      Redistribute(page, bother_page, parent_page, parent_key, is_pre);  // 重分配
-    }
+  if (b_node->GetSize() >= b_node->GetMinSize()) {  // 如果大小不小于最小大小
+    return;
   }
-  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);  // 释放
+  Page *bother_page;
+  KeyType parent_key{};
+  bool is_pre;
+  auto parent_page_id = b_node->GetParentPageId();                              // 获取父节点id
+  auto parent_page = buffer_pool_manager_->FetchPage(parent_page_id);           // 获取父节点，已加锁
+  auto parent_node = reinterpret_cast<InternalPage *>(parent_page->GetData());  // 转换为内部节点
+  parent_node->GetBotherPage(page->GetPageId(), bother_page, parent_key, is_pre,
+                             buffer_pool_manager_);                              // 获取兄弟节点
+  bother_page->WLatch();                                                         // 兄弟节点写锁
+  auto bother_node = reinterpret_cast<BPlusTreePage *>(bother_page->GetData());  // 转换为b+树节点
+  int merged_size = b_node->GetSize() + bother_node->GetSize();                  // 合并后的大小
+  Page *left_page = is_pre ? bother_page : page;         // 左节点
+  Page *right_page = is_pre ? page : bother_page;        // 右节点，合并后删除
+  bool can_merge = merged_size <= b_node->GetMaxSize();  // 内部节点能否合并
+  if (b_node->IsLeafPage()) {
+    // 合并后的叶子节点必须小于最大大小，否则下一次插入无法分裂；压缩的叶子合并后前缀可能变短
+    auto left_leaf = reinterpret_cast<LeafPage *>(left_page->GetData());
+    auto right_leaf = reinterpret_cast<LeafPage *>(right_page->GetData());
+    can_merge = merged_size < left_leaf->MaxSizeFor(left_leaf->GetLowFence(), right_leaf->GetHighFence());
+  }
+  if (can_merge) {
+    Coalesce(right_page, left_page, parent_key, transaction);          // 合并
+    DeleteEntry(parent_page, parent_key, transaction);                 // 删除数据
+  } else {                                                             // 如果大小大于最大大小
+    Redistribute(page, bother_page, parent_page, parent_key, is_pre);  // 重分配
+  }
+  bother_page->WUnlatch();                                          // 解锁
+  buffer_pool_manager_->UnpinPage(bother_page->GetPageId(), true);  // 释放
+  buffer_pool_manager_->UnpinPage(parent_page_id, true);            // 释放
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::AdjustRootPage(BPlusTreePage *b_node) {
-  if (b_node->IsLeafPage() && b_node->GetSize() == 0) {          // 如果是叶子节点且大小为0
-    root_page_id_ = INVALID_PAGE_ID;                             // 设置根节点
-    UpdateRootPageId(0);                                         // 更新根节点
-    buffer_pool_manager_->UnpinPage(b_node->GetPageId(), true);  // 释放
-    buffer_pool_manager_->DeletePage(b_node->GetPageId());       // 删除
+void BPLUSTREE_TYPE::AdjustRootPage(BPlusTreePage *b_node, Transaction *transaction) {
+  if (b_node->IsLeafPage() && b_node->GetSize() == 0) {  // 如果是叶子节点且大小为0
+    root_page_id_ = INVALID_PAGE_ID;                     // 设置根节点
+    UpdateRootPageId(0);                                 // 更新根节点
+    RetirePage(b_node->GetPageId(), transaction);        // 释放锁后删除
     return;
   }
   if (!b_node->IsLeafPage() && b_node->GetSize() == 1) {
-    auto inter_node = reinterpret_cast<InternalPage *>(b_node);  // 转换为内部节点
-    root_page_id_ = inter_node->ValueAt(0);                      // 设置根节点
-    UpdateRootPageId(0);                                         // 更新根节点
-    buffer_pool_manager_->UnpinPage(b_node->GetPageId(), true);  // 释放
-    buffer_pool_manager_->DeletePage(b_node->GetPageId());       // 删除
+    auto inter_node = reinterpret_cast<InternalPage *>(b_node);                  // 转换为内部节点
+    root_page_id_ = inter_node->ValueAt(0);                                      // 设置根节点
+    UpdateRootPageId(0);                                                         // 更新根节点
+    Page *child_page = buffer_pool_manager_->FetchPage(root_page_id_);           // 获取新的根节点
+    auto child_node = reinterpret_cast<BPlusTreePage *>(child_page->GetData());  // 转换为b+树节点
+    child_node->SetParentPageId(INVALID_PAGE_ID);                                // 新的根节点没有父节点
+    buffer_pool_manager_->UnpinPage(root_page_id_, true);                        // 释放
+    RetirePage(b_node->GetPageId(), transaction);                                // 释放锁后删除
     return;
   }
 }
@@ -244,7 +962,7 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Redistribute(Page *page, Page *bother_page, Page *parent_page, const KeyType &parent_key,
                                   bool ispre) {
   auto bother_node = reinterpret_cast<BPlusTreePage *>(bother_page->GetData());             // 转换为b+树节点
-  if (bother_node->IsRootPage()) {                                                          // 如果是根节点
+  if (!bother_node->IsLeafPage()) {                                                         // 如果是内部节点
     auto inter_bother_node = reinterpret_cast<InternalPage *>(bother_page->GetData());      // 转换为内部节点
     auto inter_b_node = reinterpret_cast<InternalPage *>(page->GetData());                  // 转换为内部节点
     Page *child_page;                                                                       // 子节点
@@ -276,50 +994,76 @@ void BPLUSTREE_TYPE::Redistribute(Page *page, Page *bother_page, Page *parent_pa
     auto inter_parent_node = reinterpret_cast<InternalPage *>(parent_page->GetData());    // 转换为内部节点
     int index = inter_parent_node->KeyIndex(parent_key, comparator_);                     // 获取索引
     inter_parent_node->SetKeyAt(index, key);                                              // 设置key
-    buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);                      // 释放
-    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);                             // 释放
-    buffer_pool_manager_->UnpinPage(bother_page->GetPageId(), true);                      // 释放
   } else {                                                                                // 如果是叶子节点
-    auto leaf_bother_node = reinterpret_cast<LeafPage *>(bother_page->GetData());         // 转换为叶子节点
-    auto leaf_b_node = reinterpret_cast<LeafPage *>(page->GetData());                     // 转换为叶子节点
-    KeyType key;                                                                          // key
-    if (ispre) {                                                                          // 如果是前一个
-      ValueType last_value = leaf_bother_node->ValueAt(leaf_bother_node->GetSize() - 1);  // 获取最后一个值
-      KeyType last_key = leaf_bother_node->KeyAt(leaf_bother_node->GetSize() - 1);        // 获取最后一个key
-      leaf_bother_node->Delete(last_key, comparator_);                                    // 删除数据
-      leaf_b_node->InsertFirst(last_key, last_value);                                     // 插入数据
-      key = last_key;                                                                     // 设置key
-    } else {                                                                              // 如果是后一个
-      ValueType first_value = leaf_bother_node->ValueAt(0);                               // 获取第一个值
-      KeyType first_key = leaf_bother_node->KeyAt(0);                                     // 获取第一个key
-      leaf_bother_node->Delete(first_key, comparator_);                                   // 删除数据
-      leaf_b_node->InsertLast(first_key, first_value);                                    // 插入数据
-      key = leaf_bother_node->KeyAt(0);                                                   // 设置key
+    auto leaf_bother_node = reinterpret_cast<LeafPage *>(bother_page->GetData());  // 转换为叶子节点
+    auto leaf_b_node = reinterpret_cast<LeafPage *>(page->GetData());              // 转换为叶子节点
+    if (leaf_bother_node->GetSize() < 2) {                                         // 兄弟节点借出后不能为空
+      return;
     }
+    // 新的分隔key是两个叶子新的fence，压缩的叶子借入后前缀可能变短，放不下时不重分配
+    KeyType key;  // 新的分隔key
+    if (ispre) {  // 如果是前一个
+      int last = leaf_bother_node->GetSize() - 1;
+      MappingType moved = leaf_bother_node->GetAt(last);                        // 借最后一个
+      key = ShortestSeparator(leaf_bother_node->KeyAt(last - 1), moved.first);  // 设置key
+      if (leaf_b_node->GetSize() + 1 >= leaf_b_node->MaxSizeFor(key, leaf_b_node->GetHighFence())) {
+        return;
+      }
+      leaf_bother_node->Delete(moved.first, comparator_);                 // 删除数据
+      leaf_bother_node->SetFences(leaf_bother_node->GetLowFence(), key);  // 设置fence
+      leaf_b_node->SetFences(key, leaf_b_node->GetHighFence());           // 设置fence
+      leaf_b_node->InsertFirst(moved.first, moved.second);                // 插入数据
+    } else {  // 如果是后一个
+      MappingType moved = leaf_bother_node->GetAt(0);                    // 借第一个
+      key = ShortestSeparator(moved.first, leaf_bother_node->KeyAt(1));  // 设置key
+      if (leaf_b_node->GetSize() + 1 >= leaf_b_node->MaxSizeFor(leaf_b_node->GetLowFence(), key)) {
+        return;
+      }
+      leaf_bother_node->Delete(moved.first, comparator_);                  // 删除数据
+      leaf_bother_node->SetFences(key, leaf_bother_node->GetHighFence());  // 设置fence
+      leaf_b_node->SetFences(leaf_b_node->GetLowFence(), key);             // 设置fence
+      leaf_b_node->InsertLast(moved.first, moved.second);                  // 插入数据
+    }
+    leaf_move_version_++;                                                               // 数据在叶子之间移动
     auto inter_parent_node = reinterpret_cast<InternalPage *>(parent_page->GetData());  // 转换为内部节点
     int index = inter_parent_node->KeyIndex(parent_key, comparator_);                   // 获取索引
     inter_parent_node->SetKeyAt(index, key);                                            // 设置key
-    buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);                    // 释放
-    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);                           // 释放
-    buffer_pool_manager_->UnpinPage(bother_page->GetPageId(), true);                    // 释放
   }
 }
 
+/*
+ * Point the prev link of leaf page_id to prev_page_id after its left
+ * neighbour changed. The caller holds the write latches of that neighbour and
+ * of its parent; a leaf is only latched while holding its right neighbour by
+ * a writer that holds their common parent, so this cannot deadlock.
+ */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::Coalesce(Page *page, Page *bother_page, const KeyType &parent_key) {
+void BPLUSTREE_TYPE::RelinkPrevPage(page_id_t page_id, page_id_t prev_page_id) {
+  if (page_id == INVALID_PAGE_ID) {  // 最右的叶子
+    return;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(page_id);                       // 获取节点
+  page->WLatch();                                                              // 写锁
+  reinterpret_cast<LeafPage *>(page->GetData())->SetPrevPageId(prev_page_id);  // 设置上一个节点
+  page->WUnlatch();                                                            // 解锁
+  buffer_pool_manager_->UnpinPage(page_id, true);                              // 释放
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Coalesce(Page *page, Page *bother_page, const KeyType &parent_key, Transaction *transaction) {
   auto b_node = reinterpret_cast<BPlusTreePage *>(page->GetData());                     // 转换为b+树节点
   if (b_node->IsLeafPage()) {                                                           // 如果是叶子节点
     auto leaf_bother_node = reinterpret_cast<LeafPage *>(bother_page->GetData());       // 转换为叶子节点
     auto leaf_b_node = reinterpret_cast<LeafPage *>(page->GetData());                   // 转换为叶子节点
     leaf_bother_node->Merge(page, buffer_pool_manager_);                                // 合并
     leaf_bother_node->SetNextPageId(leaf_b_node->GetNextPageId());                      // 设置下一个节点
+    RelinkPrevPage(leaf_b_node->GetNextPageId(), leaf_bother_node->GetPageId());        // 下一个节点指回左节点
+    leaf_move_version_++;                                                               // 数据在叶子之间移动
   } else {                                                                              // 如果内部节点
     auto inter_bother_node = reinterpret_cast<InternalPage *>(bother_page->GetData());  // 转换为内部节点
     inter_bother_node->Merge(parent_key, page, buffer_pool_manager_);                   // 合并
   }
-  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);         // 释放
-  buffer_pool_manager_->DeletePage(page->GetPageId());              // 删除
-  buffer_pool_manager_->UnpinPage(bother_page->GetPageId(), true);  // 释放
+  RetirePage(page->GetPageId(), transaction);  // 释放锁后删除
 }
 /*****************************************************************************
  * INDEX ITERATOR
@@ -331,44 +1075,27 @@ void BPLUSTREE_TYPE::Coalesce(Page *page, Page *bother_page, const KeyType &pare
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE {
-  if (IsEmpty()) {
+  Page *leaf_page = FindLeafPage(KeyType{}, Operation::SEARCH, nullptr, true);  // 最左叶子节点
+  if (leaf_page == nullptr) {
     return INDEXITERATOR_TYPE();
   }
-  Page *curr_page = buffer_pool_manager_->FetchPage(root_page_id_);
-  auto curr_page_inter = reinterpret_cast<InternalPage *>(curr_page->GetData());
-  while (!curr_page_inter->IsLeafPage()) {
-    Page *next_page = buffer_pool_manager_->FetchPage(curr_page_inter->ValueAt(0));
-    auto next_page_inter = reinterpret_cast<InternalPage *>(next_page->GetData());
-    buffer_pool_manager_->UnpinPage(curr_page->GetPageId(), false);
-    curr_page = next_page;
-    curr_page_inter = next_page_inter;
-  }
-  return INDEXITERATOR_TYPE(curr_page->GetPageId(), curr_page, 0, buffer_pool_manager_);
+  return INDEXITERATOR_TYPE(this, leaf_page, 0);  // 迭代器只保留pin，每次访问时再加读锁
 }
 
 /*
  * Input parameter is low key, find the leaf page that contains the input key
- * first, then construct index iterator
+ * first, then construct index iterator at the first key not less than it
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
-  if (IsEmpty()) {
+  auto leaf_page = FindLeafPage(key, Operation::SEARCH);
+  if (leaf_page == nullptr) {
     return INDEXITERATOR_TYPE();
   }
-  auto leaf_page = FindLeafPage(key);
   auto leaf_node = reinterpret_cast<LeafPage *>(leaf_page->GetData());
-  int index;
-  for (index = 0; index < leaf_node->GetSize(); index++) {
-    if (comparator_(leaf_node->KeyAt(index), key) == 0) {
-      break;
-    }
-  }
-  if (index == leaf_node->GetSize()) {
-    buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), false);
-    return End();
-  }
-  return INDEXITERATOR_TYPE(leaf_page->GetPageId(), leaf_page, index, buffer_pool_manager_);
+  int index = leaf_node->KeyIndex(key, comparator_);  // 第一个不小于key的位置，可能在下一个叶子
+  return INDEXITERATOR_TYPE(this, leaf_page, index, &key);
 }
 
 /*
@@ -378,29 +1105,147 @@ auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::End() -> INDEXITERATOR_TYPE {
-  if (IsEmpty()) {
+  Page *leaf_page = FindLeafPage(KeyType{}, Operation::SEARCH, nullptr, false, true);  // 最右叶子节点
+  if (leaf_page == nullptr) {
     return INDEXITERATOR_TYPE();
   }
-  Page *curr_page = buffer_pool_manager_->FetchPage(root_page_id_);
-  auto curr_page_inter = reinterpret_cast<InternalPage *>(curr_page->GetData());
-  while (!curr_page_inter->IsLeafPage()) {
-    Page *next_page = buffer_pool_manager_->FetchPage(curr_page_inter->ValueAt(curr_page_inter->GetSize() - 1));
-    auto next_page_inter = reinterpret_cast<InternalPage *>(next_page->GetData());
-    buffer_pool_manager_->UnpinPage(curr_page->GetPageId(), false);
-    curr_page = next_page;
-    curr_page_inter = next_page_inter;
+  auto leaf_node = reinterpret_cast<LeafPage *>(leaf_page->GetData());
+  return INDEXITERATOR_TYPE(this, leaf_page, leaf_node->GetSize());
+}
+
+/*
+ * Input parameter is void, find the rightmost leaf page first, then construct
+ * reverse index iterator at its last key
+ * @return : reverse index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RBegin() -> REVERSE_INDEXITERATOR_TYPE {
+  Page *leaf_page = FindLeafPage(KeyType{}, Operation::SEARCH, nullptr, false, true);  // 最右叶子节点
+  if (leaf_page == nullptr) {
+    return REVERSE_INDEXITERATOR_TYPE();
+  }
+  auto leaf_node = reinterpret_cast<LeafPage *>(leaf_page->GetData());
+  return REVERSE_INDEXITERATOR_TYPE(this, leaf_page, leaf_node->GetSize() - 1);  // 最后一个key
+}
+
+/*
+ * Input parameter is high key, find the leaf page that contains the input key
+ * first, then construct reverse index iterator at the last key not greater
+ * than it
+ * @return : reverse index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RBegin(const KeyType &key) -> REVERSE_INDEXITERATOR_TYPE {
+  auto leaf_page = FindLeafPage(key, Operation::SEARCH);
+  if (leaf_page == nullptr) {
+    return REVERSE_INDEXITERATOR_TYPE();
+  }
+  auto leaf_node = reinterpret_cast<LeafPage *>(leaf_page->GetData());
+  int index = leaf_node->KeyIndex(key, comparator_);  // 第一个不小于key的位置
+  if (index == leaf_node->GetSize() || comparator_(leaf_node->KeyAt(index), key) != 0) {
+    --index;  // 没有等于key的，取前一个，可能在上一个叶子
   }
-  auto curr_node = reinterpret_cast<LeafPage *>(curr_page->GetData());
-  page_id_t page_id = curr_page->GetPageId();
-  buffer_pool_manager_->UnpinPage(curr_page->GetPageId(), false);
-  return INDEXITERATOR_TYPE(page_id, curr_page, curr_node->GetSize(), buffer_pool_manager_);
+  return REVERSE_INDEXITERATOR_TYPE(this, leaf_page, index, &key);
+}
+
+/*
+ * Input parameter is void, construct a reverse index iterator representing
+ * the position before the first key/value pair in the leaf node
+ * @return : reverse index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::REnd() -> REVERSE_INDEXITERATOR_TYPE {
+  Page *leaf_page = FindLeafPage(KeyType{}, Operation::SEARCH, nullptr, true);  // 最左叶子节点
+  if (leaf_page == nullptr) {
+    return REVERSE_INDEXITERATOR_TYPE();
+  }
+  return REVERSE_INDEXITERATOR_TYPE(this, leaf_page, -1);
 }
 
 /**
  * @return Page id of the root of this tree
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::GetRootPageId() -> page_id_t { return root_page_id_; }
+auto BPLUSTREE_TYPE::GetRootPageId() -> page_id_t {
+  root_latch_.RLock();
+  page_id_t root_page_id = root_page_id_;
+  root_latch_.RUnlock();
+  return root_page_id;
+}
+
+/*
+ * Walk the tree level by level and collect its statistics. root_latch_ is
+ * held in read mode throughout: splits and merges take it in write mode, so
+ * the structure stays put while lookups and in-place leaf updates go on. Each
+ * page is read latched only while it is being looked at.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::GetStats() -> BPlusTreeStats {
+  BPlusTreeStats stats;
+  std::vector<double> leaf_fills;
+  double internal_fill_sum = 0;
+  uint64_t internal_pages = 0;
+  uint64_t leaf_hops = 0;
+  uint64_t contiguous_hops = 0;
+  root_latch_.RLock();
+  std::vector<page_id_t> level;
+  if (root_page_id_ != INVALID_PAGE_ID) {
+    level.push_back(root_page_id_);
+  }
+  while (!level.empty()) {
+    std::vector<page_id_t> next_level;  // 下一层的节点，从左到右
+    for (page_id_t page_id : level) {
+      Page *page = buffer_pool_manager_->FetchPage(page_id);
+      page->RLatch();
+      auto b_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      double fill = static_cast<double>(b_node->GetSize()) / b_node->GetMaxSize();
+      if (b_node->IsLeafPage()) {
+        auto leaf_node = reinterpret_cast<LeafPage *>(b_node);
+        stats.entries_ += leaf_node->GetSize();
+        leaf_fills.push_back(fill);
+        stats.wasted_bytes_ += leaf_node->FreeBytes();  // 压缩的叶子按实际占用计算
+        if (leaf_node->GetNextPageId() != INVALID_PAGE_ID) {
+          leaf_hops++;
+          contiguous_hops += static_cast<uint64_t>(leaf_node->GetNextPageId() == page_id + 1);  // 物理上相邻
+        }
+      } else {
+        auto internal_node = reinterpret_cast<InternalPage *>(b_node);
+        for (int i = 0; i < internal_node->GetSize(); i++) {
+          next_level.push_back(internal_node->ValueAt(i));
+        }
+        internal_fill_sum += fill;
+        internal_pages++;
+        stats.wasted_bytes_ += internal_node->FreeBytes();
+      }
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+    }
+    stats.level_pages_.push_back(static_cast<uint32_t>(level.size()));
+    level = std::move(next_level);
+  }
+  root_latch_.RUnlock();
+
+  stats.height_ = static_cast<uint32_t>(stats.level_pages_.size());
+  if (!leaf_fills.empty()) {
+    std::sort(leaf_fills.begin(), leaf_fills.end());
+    auto percentile = [&](size_t p) { return leaf_fills[(leaf_fills.size() - 1) * p / 100]; };
+    double leaf_fill_sum = 0;
+    for (double fill : leaf_fills) {
+      leaf_fill_sum += fill;
+    }
+    stats.leaf_fill_avg_ = leaf_fill_sum / leaf_fills.size();
+    stats.leaf_fill_p10_ = percentile(10);
+    stats.leaf_fill_p50_ = percentile(50);
+    stats.leaf_fill_p90_ = percentile(90);
+  }
+  if (internal_pages > 0) {
+    stats.internal_fill_avg_ = internal_fill_sum / internal_pages;
+  }
+  if (leaf_hops > 0) {
+    stats.leaf_contiguity_ = static_cast<double>(contiguous_hops) / leaf_hops;
+  }
+  return stats;
+}
 
 /*****************************************************************************
  * UTILITIES AND DEBUG
@@ -416,13 +1261,18 @@ auto BPLUSTREE_TYPE::GetRootPageId() -> page_id_t { return root_page_id_; }
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  header_page->WLatch();  // 多个索引可能同时更新header page
   if (insert_record != 0) {
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
+    // create a new record<index_name + root_page_id> in header_page, a record
+    // left behind by an earlier instance of this index is updated instead
+    if (!header_page->InsertRecord(index_name_, root_page_id_)) {
+      header_page->UpdateRecord(index_name_, root_page_id_);
+    }
   } else {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
+  header_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
@@ -619,5 +1469,10 @@ template class BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTree<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTree<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTree<GenericKey<64>, RID, GenericComparator<64>>;
+template class BPlusTree<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class BPlusTree<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class BPlusTree<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class BPlusTree<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class BPlusTree<NormalizedKey<64>, RID, NormalizedComparator<64>>;
 
 }  // namespace bustub
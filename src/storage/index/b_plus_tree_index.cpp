@@ -9,43 +9,346 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <numeric>
+#include <set>
+#include <thread>  // NOLINT
+
+#include "common/exception.h"
+#include "fmt/format.h"
 #include "storage/index/b_plus_tree_index.h"
+#include "type/value_factory.h"
 
 namespace bustub {
+
+/**
+ * Longest VARCHAR prefix a normalized key of KeySize bytes can store inline, NO_PREFIX_LIMIT if every column
+ * fits in full. Once strings are cut the RID is appended as well, so that keys sharing a prefix stay apart.
+ */
+static auto InlinePrefixOf(const IndexMetadata &metadata, size_t key_size) -> uint32_t {
+  const Schema &entry_schema = *metadata.GetEntrySchema();
+  size_t rid_size = metadata.IsUnique() ? 0 : sizeof(int64_t);
+  if (NormalizedKeyWidth(entry_schema) + rid_size <= key_size) {
+    return NO_PREFIX_LIMIT;
+  }
+  size_t fixed_size = sizeof(int64_t);  // the RID
+  size_t varchar_count = 0;
+  for (const auto &column : entry_schema.GetColumns()) {
+    if (column.GetType() == TypeId::VARCHAR) {
+      fixed_size += 2;  // marker and terminator
+      varchar_count++;
+    } else {
+      fixed_size += column.GetFixedLength();
+    }
+  }
+  BUSTUB_ASSERT(varchar_count > 0 && fixed_size <= key_size, "key type too short for the key columns and RID");
+  return static_cast<uint32_t>((key_size - fixed_size) / varchar_count);
+}
+
+/**
+ * The name the tree records its root under in the header page. Index names are only unique within a table, so an
+ * index of a catalog is recorded by its OID.
+ */
+static auto HeaderRecordOf(const IndexMetadata &metadata) -> std::string {
+  return metadata.GetOid().has_value() ? fmt::format("__index_{}", *metadata.GetOid()) : metadata.GetName();
+}
+
+/** The entry schema, with the RID column a non-unique or lossy index appends */
+static auto TreeKeySchema(const IndexMetadata &metadata, bool rid_in_key) -> Schema {
+  std::vector<Column> columns = metadata.GetEntrySchema()->GetColumns();
+  if (rid_in_key) {
+    columns.emplace_back("__rid", TypeId::BIGINT);
+  }
+  return Schema(columns);
+}
+
 /*
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager)
     : Index(std::move(metadata)),
-      comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_) {}
+      inline_prefix_(IS_NORMALIZED_KEY<KeyType> ? InlinePrefixOf(*GetMetadata(), sizeof(KeyType)) : NO_PREFIX_LIMIT),
+      rid_in_key_(!GetMetadata()->IsUnique() || inline_prefix_ != NO_PREFIX_LIMIT),
+      tree_key_schema_(TreeKeySchema(*GetMetadata(), rid_in_key_)),
+      comparator_(&tree_key_schema_),
+      container_(HeaderRecordOf(*GetMetadata()), buffer_pool_manager, comparator_) {
+  // normalized keys are checked by InlinePrefixOf
+  BUSTUB_ASSERT(IS_NORMALIZED_KEY<KeyType> || GetMetadata()->IsUnique() ||
+                    tree_key_schema_.GetLength() <= sizeof(KeyType),
+                "key type too short for the key and RID");
+  if (GetMetadata()->IsUnique() && IsLossy()) {
+    // distinct keys sharing the stored prefix are kept apart by the RID, so duplicates would not be noticed either.
+    // Only included columns may be cut, uniqueness is checked on the key columns
+    for (uint32_t i = 0; i < GetIndexColumnCount(); i++) {
+      const Column &column = GetEntrySchema()->GetColumn(i);
+      if (column.GetType() == TypeId::VARCHAR && column.GetLength() > inline_prefix_) {
+        throw NotImplementedException(fmt::format("UNIQUE index {} cannot enforce uniqueness, only {} characters of "
+                                                  "key column {} fit into a {} byte key",
+                                                  GetMetadata()->GetName(), inline_prefix_, column.GetName(),
+                                                  sizeof(KeyType)));
+      }
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::MakeKey(const Tuple &key, RID rid) const -> KeyType {
+  KeyType index_key;
+  if (!rid_in_key_) {
+    index_key.SetFromKey(key, GetEntrySchema());
+    return index_key;
+  }
+  // RID::Get() is page id then slot, so the entries of a key sort in heap page order
+  std::vector<Value> values;
+  values.reserve(tree_key_schema_.GetColumnCount());
+  for (uint32_t i = 0; i + 1 < tree_key_schema_.GetColumnCount(); i++) {
+    values.push_back(InlineValue(key.GetValue(GetEntrySchema(), i)));
+  }
+  values.push_back(ValueFactory::GetBigIntValue(rid.Get()));
+  index_key.SetFromKey(Tuple{values, &tree_key_schema_}, &tree_key_schema_);
+  return index_key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::InlineValue(const Value &value) const -> Value {
+  if (value.GetTypeId() != TypeId::VARCHAR || value.IsNull() || value.GetLength() <= inline_prefix_ + 1) {
+    return value;  // the length of a VARCHAR value counts its terminator
+  }
+  return ValueFactory::GetVarcharValue(value.ToString().substr(0, inline_prefix_));
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  if (GetMetadata()->IsUnique() && !GetMetadata()->GetIncludeAttrs().empty()) {
+    // the tree only rejects equal entries, a unique key with other included values has to be looked up
+    std::vector<Value> key_values;
+    for (uint32_t i = 0; i < GetIndexColumnCount(); i++) {
+      key_values.push_back(key.GetValue(GetEntrySchema(), i));
+    }
+    bool exists = false;
+    ScanPrefix(key_values, [&exists](const MappingType &entry) { exists = true; });
+    if (exists) {
+      return;
+    }
+  }
+
   // construct insert index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  KeyType index_key = MakeKey(key, rid);
 
   container_.Insert(index_key, rid, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::InsertEntries(const std::vector<std::pair<Tuple, RID>> &entries,
+                                         Transaction *transaction) {
+  if (GetMetadata()->IsUnique() && !GetMetadata()->GetIncludeAttrs().empty()) {
+    // every entry has to be looked up first, see InsertEntry
+    Index::InsertEntries(entries, transaction);
+    return;
+  }
+  std::vector<MappingType> sorted;
+  sorted.reserve(entries.size());
+  for (const auto &[key, rid] : entries) {
+    sorted.emplace_back(MakeKey(key, rid), rid);
+  }
+  // stable, so that of equal keys in a unique index the first one is kept, as when inserting one by one
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [this](const MappingType &a, const MappingType &b) { return comparator_(a.first, b.first) < 0; });
+  for (const auto &[key, rid] : sorted) {
+    container_.Insert(key, rid, transaction);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::BulkLoad(const std::vector<std::pair<Tuple, RID>> &all_entries, Transaction *transaction,
+                                    double fill_factor) {
+  // a unique index with included columns keeps the first entry of each key, which the tree cannot tell apart
+  const std::vector<std::pair<Tuple, RID>> *load = &all_entries;
+  std::vector<std::pair<Tuple, RID>> unique_entries;
+  if (GetMetadata()->IsUnique() && !GetMetadata()->GetIncludeAttrs().empty()) {
+    auto key_less = [this](const KeyType &a, const KeyType &b) { return comparator_(a, b) < 0; };
+    std::set<KeyType, decltype(key_less)> keys(key_less);
+    for (const auto &entry : all_entries) {
+      KeyType key;
+      key.SetFromKey(entry.first, GetKeySchema());
+      if (keys.insert(key).second) {
+        unique_entries.push_back(entry);
+      }
+    }
+    load = &unique_entries;
+  }
+  const auto &entries = *load;
+
+  // below this many entries per worker a thread costs more than it saves
+  constexpr size_t min_chunk_size = 16384;
+  size_t hardware_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  size_t workers = std::clamp<size_t>(entries.size() / min_chunk_size, 1, hardware_threads);
+
+  // each worker converts and sorts a contiguous chunk; stable sorts keep the first of equal keys in scan order
+  std::vector<MappingType> sorted(entries.size());
+  std::vector<size_t> bounds(workers + 1);
+  for (size_t i = 0; i <= workers; i++) {
+    bounds[i] = entries.size() * i / workers;
+  }
+  auto less = [this](const MappingType &a, const MappingType &b) { return comparator_(a.first, b.first) < 0; };
+  std::vector<std::thread> threads;
+  for (size_t w = 0; w < workers; w++) {
+    threads.emplace_back([&, w] {
+      for (size_t i = bounds[w]; i < bounds[w + 1]; i++) {
+        sorted[i].first = MakeKey(entries[i].first, entries[i].second);
+        sorted[i].second = entries[i].second;
+      }
+      std::stable_sort(sorted.begin() + bounds[w], sorted.begin() + bounds[w + 1], less);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // merge the sorted runs pairwise
+  for (size_t width = 1; width < workers; width *= 2) {
+    for (size_t w = 0; w + width < workers; w += 2 * width) {
+      std::inplace_merge(sorted.begin() + bounds[w], sorted.begin() + bounds[w + width],
+                         sorted.begin() + bounds[std::min(w + 2 * width, workers)], less);
+    }
+  }
+
+  container_.BulkLoad(sorted, transaction, fill_factor);
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct delete index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  KeyType index_key = MakeKey(key, rid);
 
   container_.Remove(index_key, transaction);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
-  // construct scan index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  if (!GetMetadata()->GetIncludeAttrs().empty()) {
+    // the entries of the key start with it, whatever included values follow
+    std::vector<Value> values;
+    for (uint32_t i = 0; i < GetIndexColumnCount(); i++) {
+      values.push_back(key.GetValue(GetKeySchema(), i));
+    }
+    ScanPrefix(values, [result](const MappingType &entry) { result->push_back(entry.second); });
+    return;
+  }
+  if (!rid_in_key_) {
+    // construct scan index key
+    KeyType index_key = MakeKey(key, RID());
+
+    container_.GetValue(index_key, result, transaction);
+    return;
+  }
+  // the entries of the key lie between the key with the smallest and the largest RID
+  KeyType low_key = MakeKey(key, RID(0, 0));
+  KeyType high_key = MakeKey(key, RID(INT64_MAX));
+  auto end = container_.End();
+  for (auto it = container_.Begin(low_key); it != end && comparator_((*it).first, high_key) <= 0; ++it) {
+    result->push_back((*it).second);
+  }
+}
 
-  container_.GetValue(index_key, result, transaction);
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                                    Transaction *transaction) {
+  if (!GetMetadata()->GetIncludeAttrs().empty()) {
+    Index::ScanKeys(keys, results, transaction);
+    return;
+  }
+  // the tree keys of every lookup key, as ScanKey searches them
+  std::vector<std::pair<KeyType, KeyType>> ranges;
+  ranges.reserve(keys.size());
+  for (const auto &key : keys) {
+    if (rid_in_key_) {
+      ranges.emplace_back(MakeKey(key, RID(0, 0)), MakeKey(key, RID(INT64_MAX)));
+    } else {
+      KeyType index_key = MakeKey(key, RID());
+      ranges.emplace_back(index_key, index_key);
+    }
+  }
+  std::vector<size_t> order(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](size_t lhs, size_t rhs) { return comparator_(ranges[lhs].first, ranges[rhs].first) < 0; });
+  std::vector<std::pair<KeyType, KeyType>> sorted_ranges;
+  sorted_ranges.reserve(keys.size());
+  for (size_t i : order) {
+    sorted_ranges.push_back(ranges[i]);
+  }
+  std::vector<std::vector<RID>> sorted_results;
+  container_.GetValueRanges(sorted_ranges, &sorted_results, transaction);
+  results->assign(keys.size(), {});
+  for (size_t i = 0; i < order.size(); i++) {
+    (*results)[order[i]] = std::move(sorted_results[i]);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanKeyPrefix(const std::vector<Value> &prefix, std::vector<RID> *result,
+                                         Transaction *transaction) {
+  if constexpr (!IS_NORMALIZED_KEY<KeyType>) {
+    Index::ScanKeyPrefix(prefix, result, transaction);
+  } else {
+    ScanPrefix(prefix, [result](const MappingType &entry) { result->push_back(entry.second); });
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanKeyPrefixEntries(const std::vector<Value> &prefix,
+                                                std::vector<std::pair<Tuple, RID>> *result, Transaction *transaction) {
+  if (!IsCovering()) {
+    Index::ScanKeyPrefixEntries(prefix, result, transaction);
+    return;
+  }
+  ScanPrefix(prefix,
+             [this, result](const MappingType &entry) { result->emplace_back(EntryOf(entry.first), entry.second); });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::EntryOf(const KeyType &key) const -> Tuple {
+  if constexpr (!IS_NORMALIZED_KEY<KeyType>) {
+    throw NotImplementedException("only normalized keys can be decoded");
+  } else {
+    BUSTUB_ASSERT(!IsLossy(), "a lossy index does not store its entries in full");
+    std::vector<Value> values = key.DecodeKey(&tree_key_schema_);
+    values.resize(GetEntrySchema()->GetColumnCount());  // drop the RID
+    return {values, GetEntrySchema()};
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+template <typename Callback>
+void BPLUSTREE_INDEX_TYPE::ScanPrefix(const std::vector<Value> &prefix, Callback on_entry) {
+  if constexpr (!IS_NORMALIZED_KEY<KeyType>) {
+    throw NotImplementedException("index does not support prefix lookups");
+  } else {
+    if (prefix.size() > GetIndexColumnCount()) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, "prefix is longer than the index key");
+    }
+    // the encoded prefix is a byte prefix of every key it leads, they lie between the prefix padded with 0x00
+    // and the prefix padded with 0xFF
+    std::vector<uint32_t> prefix_attrs(prefix.size());
+    std::iota(prefix_attrs.begin(), prefix_attrs.end(), 0);
+    Schema prefix_schema = Schema::CopySchema(&tree_key_schema_, prefix_attrs);
+    std::vector<Value> values;
+    values.reserve(prefix.size());
+    for (const auto &value : prefix) {
+      values.push_back(InlineValue(value));
+    }
+    Tuple prefix_tuple(values, &prefix_schema);
+    KeyType low_key;
+    KeyType high_key;
+    low_key.SetFromKey(prefix_tuple, &prefix_schema);
+    high_key.SetPrefixUpperBound(prefix_tuple, &prefix_schema);
+    auto end = container_.End();
+    for (auto it = container_.Begin(low_key); it != end && comparator_((*it).first, high_key) <= 0; ++it) {
+      on_entry(*it);
+    }
+  }
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -57,10 +360,35 @@ auto BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &key) -> INDEXITERATOR
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_INDEX_TYPE::GetEndIterator() -> INDEXITERATOR_TYPE { return container_.End(); }
 
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetReverseBeginIterator() -> REVERSE_INDEXITERATOR_TYPE { return container_.RBegin(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetReverseBeginIterator(const KeyType &key) -> REVERSE_INDEXITERATOR_TYPE {
+  return container_.RBegin(key);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetReverseEndIterator() -> REVERSE_INDEXITERATOR_TYPE { return container_.REnd(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::DropPersistedTree() { container_.DropPersistedTree(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::Rebuild(Transaction *transaction, double fill_factor) -> bool {
+  container_.Rebuild(fill_factor);
+  return true;
+}
+
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTreeIndex<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>;
+template class BPlusTreeIndex<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class BPlusTreeIndex<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class BPlusTreeIndex<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class BPlusTreeIndex<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class BPlusTreeIndex<NormalizedKey<64>, RID, NormalizedComparator<64>>;
 
 }  // namespace bustub
@@ -1,5 +1,6 @@
 #include <vector>
 
+#include "fmt/format.h"
 #include "storage/index/extendible_hash_table_index.h"
 
 namespace bustub {
@@ -12,38 +13,83 @@ HASH_TABLE_INDEX_TYPE::ExtendibleHashTableIndex(std::unique_ptr<IndexMetadata> &
                                                 const HashFunction<KeyType> &hash_fn)
     : Index(std::move(metadata)),
       comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, hash_fn) {}
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, hash_fn) {
+  if (!GetMetadata()->GetIncludeAttrs().empty()) {
+    throw NotImplementedException("a hash index cannot include columns");
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_INDEX_TYPE::MakeKey(const Tuple &key) const -> KeyType {
+  KeyType index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+  return index_key;
+}
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct insert index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  KeyType index_key = MakeKey(key);
 
-  container_.Insert(transaction, index_key, rid);
+  std::unique_lock<std::mutex> unique_lock(unique_latch_, std::defer_lock);
+  if (GetMetadata()->IsUnique()) {
+    unique_lock.lock();
+    std::vector<RID> rids;
+    if (container_.GetValue(transaction, index_key, &rids)) {
+      return;
+    }
+  }
+  if (!container_.Insert(transaction, index_key, rid)) {
+    std::vector<RID> rids;
+    container_.GetValue(transaction, index_key, &rids);
+    if (std::find(rids.begin(), rids.end(), rid) == rids.end()) {
+      throw Exception(ExceptionType::OUT_OF_RANGE,
+                      fmt::format("hash index {} is full, a bucket page holds at most {} rows of one key, use a "
+                                  "B+ tree index for keys with more duplicates",
+                                  GetMetadata()->GetName(), BUCKET_ARRAY_SIZE));
+    }
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_INDEX_TYPE::BulkLoad(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction,
+                                     double fill_factor) {
+  // the table is not ordered, so there is nothing to build bottom-up, but rows left over from before must go
+  container_.Clear();
+  Index::BulkLoad(entries, transaction, fill_factor);
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct delete index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  KeyType index_key = MakeKey(key);
 
-  container_.Remove(transaction, index_key, rid);
+  if (!GetMetadata()->IsUnique()) {
+    container_.Remove(transaction, index_key, rid);
+    return;
+  }
+  std::scoped_lock unique_lock(unique_latch_);
+  std::vector<RID> rids;
+  container_.GetValue(transaction, index_key, &rids);
+  for (const auto &stored_rid : rids) {
+    container_.Remove(transaction, index_key, stored_rid);
+  }
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
-  // construct scan index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
-
-  container_.GetValue(transaction, index_key, result);
+  container_.GetValue(transaction, MakeKey(key), result);
 }
+
 template class ExtendibleHashTableIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class ExtendibleHashTableIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class ExtendibleHashTableIndex<GenericKey<16>, RID, GenericComparator<16>>;
 template class ExtendibleHashTableIndex<GenericKey<32>, RID, GenericComparator<32>>;
 template class ExtendibleHashTableIndex<GenericKey<64>, RID, GenericComparator<64>>;
+template class ExtendibleHashTableIndex<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class ExtendibleHashTableIndex<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class ExtendibleHashTableIndex<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class ExtendibleHashTableIndex<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class ExtendibleHashTableIndex<NormalizedKey<64>, RID, NormalizedComparator<64>>;
 
 }  // namespace bustub
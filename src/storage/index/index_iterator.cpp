@@ -1,8 +1,10 @@
 /**
  * index_iterator.cpp
  */
+#include <algorithm>
 #include <cassert>
 
+#include "storage/index/b_plus_tree.h"
 #include "storage/index/index_iterator.h"
 
 namespace bustub {
@@ -10,44 +12,282 @@ namespace bustub {
 /*
  * NOTE: you can change the destructor/constructor method here
  * set your own input parameters
+ *
+ * The iterator keeps its leaf pinned but not latched, each access takes the
+ * leaf's read latch only for as long as it needs it. Moving to the next leaf
+ * pins it while the current leaf is still latched, so that a merge cannot
+ * delete it in between, then drops the current latch before taking the next
+ * one, so a scan never holds two leaf latches and cannot deadlock with a
+ * writer merging siblings.
+ *
+ * Between two accesses writers may insert into the leaf, remove from it,
+ * split it or merge it away, which moves the entries under index_. The
+ * iterator therefore remembers the last key it moved past and the leaf's
+ * version, and searches for that key again once the version changed. The
+ * same goes for the hop to the next leaf, taken without a latch: if entries
+ * moved between leaves meanwhile, a merge may have moved the rest of the scan
+ * into the leaf just left, or a redistribution entries already returned into
+ * the next one, so the position is searched for again.
+ *
+ * The tree counts its open iterators: pages that leave the tree while one is
+ * open may still be reached through its leaf links, so the tree deletes them
+ * again when the last iterator closes.
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator() = default;
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator(page_id_t page_id, Page *page, int index, BufferPoolManager *buffer_pool_manager)
-    : page_id_(page_id), page_(page), index_(index), buffer_pool_manager_(buffer_pool_manager) {}
+INDEXITERATOR_TYPE::IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, Page *page, int index,
+                                  const KeyType *start_key)
+    : tree_(tree),
+      page_id_(page->GetPageId()),
+      page_(page),
+      index_(index),
+      buffer_pool_manager_(tree->buffer_pool_manager_) {
+  if (start_key != nullptr) {
+    key_ = *start_key;
+    has_key_ = true;
+  }
+  tree_->OpenIterator();  // 在叶子节点仍被锁住时登记，旧页面不会在此之后被删除
+  SkipExhaustedLeaves();  // a position past the end of a leaf means the first entry of the next one
+  page_->RUnlatch();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::~IndexIterator() {  // NOLINT
+  if (page_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(page_id_, false);
+    tree_->CloseIterator();
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() = default;  // NOLINT
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other) noexcept
+    : tree_(other.tree_),
+      page_id_(other.page_id_),
+      page_(other.page_),
+      index_(other.index_),
+      buffer_pool_manager_(other.buffer_pool_manager_),
+      item_(other.item_),
+      version_(other.version_),
+      key_(other.key_),
+      has_key_(other.has_key_),
+      past_key_(other.past_key_),
+      returned_key_(other.returned_key_) {
+  other.page_ = nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::operator=(IndexIterator &&other) noexcept -> INDEXITERATOR_TYPE & {
+  if (this != &other) {
+    if (page_ != nullptr) {
+      buffer_pool_manager_->UnpinPage(page_id_, false);
+      tree_->CloseIterator();
+    }
+    tree_ = other.tree_;
+    page_id_ = other.page_id_;
+    page_ = other.page_;
+    index_ = other.index_;
+    buffer_pool_manager_ = other.buffer_pool_manager_;
+    item_ = other.item_;
+    version_ = other.version_;
+    key_ = other.key_;
+    has_key_ = other.has_key_;
+    past_key_ = other.past_key_;
+    returned_key_ = other.returned_key_;
+    other.page_ = nullptr;
+  }
+  return *this;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 auto INDEXITERATOR_TYPE::IsEnd() -> bool {
+  if (page_ == nullptr) {
+    return true;
+  }
+  page_->RLatch();
+  Reposition();
   auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
-  return static_cast<bool>(index_ == tree_page->GetSize() && tree_page->GetNextPageId() == INVALID_PAGE_ID);
+  bool is_end = index_ >= tree_page->GetSize() && tree_page->GetNextPageId() == INVALID_PAGE_ID;
+  page_->RUnlatch();
+  return is_end;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto INDEXITERATOR_TYPE::operator*() -> const MappingType & {
+  page_->RLatch();
+  Reposition();
   auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
-  return tree_page->GetAtIter(index_);
+  item_ = tree_page->GetAt(index_);
+  key_ = item_.first;
+  has_key_ = true;
+  past_key_ = false;
+  returned_key_ = true;
+  page_->RUnlatch();
+  return item_;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto INDEXITERATOR_TYPE::operator++() -> INDEXITERATOR_TYPE & {
-  ++index_;
+  page_->RLatch();
+  Reposition();
+  PassEntry();
+  SkipExhaustedLeaves();
+  page_->RUnlatch();
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::NextBatch(const KeyType &end_key, bool inclusive, const KeyComparator &comparator,
+                                   size_t max_n, std::vector<MappingType> *out) -> size_t {
+  return CopyBatch(&end_key, inclusive, &comparator, max_n, out);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::NextBatch(size_t max_n, std::vector<MappingType> *out) -> size_t {
+  return CopyBatch(nullptr, false, nullptr, max_n, out);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::CopyBatch(const KeyType *end_key, bool inclusive, const KeyComparator *comparator,
+                                   size_t max_n, std::vector<MappingType> *out) -> size_t {
+  if (page_ == nullptr) {
+    return 0;
+  }
+  auto in_range = [&](const KeyType &key) {
+    int cmp = (*comparator)(key, *end_key);
+    return inclusive ? cmp <= 0 : cmp < 0;
+  };
+  size_t copied = 0;
+  page_->RLatch();
+  Reposition();
   auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
-  if (index_ == tree_page->GetSize() && tree_page->GetNextPageId() != INVALID_PAGE_ID) {
-    auto next_page = buffer_pool_manager_->FetchPage(tree_page->GetNextPageId());
-    buffer_pool_manager_->UnpinPage(tree_page->GetPageId(), false);
+  while (copied < max_n && index_ < tree_page->GetSize()) {
+    int end = std::min<int>(tree_page->GetSize(), index_ + static_cast<int>(max_n - copied));
+    // the keys are sorted, if the last one taken from this leaf is in range all of them are
+    bool check = end_key != nullptr && !in_range(tree_page->KeyAt(end - 1));
+    for (; index_ < end; ++index_) {
+      MappingType item = tree_page->GetAt(index_);
+      if (check && !in_range(item.first)) {
+        page_->RUnlatch();
+        return copied;
+      }
+      out->push_back(item);
+      ++copied;
+      key_ = item.first;
+      has_key_ = true;
+      past_key_ = true;
+      returned_key_ = false;
+    }
+    SkipExhaustedLeaves();
+    tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  }
+  page_->RUnlatch();
+  return copied;
+}
+
+/*
+ * Called with the current leaf read latched, returns with the leaf it moved to
+ * read latched
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SkipExhaustedLeaves() {
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  // skip to the next leaf that still has entries, leaves emptied by a merge keep their next pointer
+  while (index_ >= tree_page->GetSize() && tree_page->GetNextPageId() != INVALID_PAGE_ID) {
+    page_id_t next_page_id = tree_page->GetNextPageId();
+    auto next_page = buffer_pool_manager_->FetchPage(next_page_id);
+    uint64_t move_version = tree_->leaf_move_version_.load();  // 持有当前叶子的读锁时读取
+    page_->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id_, false);
     page_ = next_page;
-    page_id_ = page_->GetPageId();
+    page_id_ = next_page_id;
     index_ = 0;
+    page_->RLatch();
+    if (tree_->leaf_move_version_.load() != move_version) {
+      Relocate();  // 跳转期间数据在叶子之间移动过
+    }
+    tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
   }
-  if (index_ == tree_page->GetSize() && tree_page->GetNextPageId() == INVALID_PAGE_ID) {
-    buffer_pool_manager_->UnpinPage(tree_page->GetPageId(), false);
+  version_ = tree_page->GetVersion();
+}
+
+/*
+ * Called with the current leaf read latched, returns with the leaf the
+ * position is in read latched. Every change that moves entries changes the
+ * size of the leaf and with it its version.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Reposition() {
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  if (tree_page->GetVersion() == version_) {
+    return;
   }
-  return *this;
+  Relocate();
+  SkipExhaustedLeaves();
+}
+
+/*
+ * Called with the current leaf read latched, returns with the leaf that holds
+ * the position read latched, index_ may be past its end. If key_ still lies
+ * between the first and the last key of the leaf a search within the leaf is
+ * enough; otherwise key_ moved to a sibling by a split or redistribution, or
+ * the leaf was merged away, and the tree is searched for the leaf now holding
+ * it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Relocate() {
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  const KeyComparator &comparator = tree_->comparator_;
+  int size = tree_page->GetSize();
+  bool in_leaf = has_key_ ? size > 0 && comparator(tree_page->KeyAt(0), key_) <= 0 &&
+                                comparator(key_, tree_page->KeyAt(size - 1)) <= 0
+                          : tree_page->GetPrevPageId() == INVALID_PAGE_ID;  // 最左叶子节点之前不会有数据
+  if (!in_leaf) {
+    page_->RUnlatch();  // 从根节点往下查找，不能持有叶子节点的锁
+    Page *leaf_page = has_key_ ? tree_->FindLeafPage(key_, Operation::SEARCH)
+                               : tree_->FindLeafPage(KeyType{}, Operation::SEARCH, nullptr, true);
+    if (leaf_page == nullptr) {  // 树已经为空
+      page_->RLatch();
+      index_ = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData())->GetSize();
+      return;
+    }
+    buffer_pool_manager_->UnpinPage(page_id_, false);
+    page_ = leaf_page;
+    page_id_ = leaf_page->GetPageId();
+    tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  }
+  if (!has_key_) {
+    index_ = 0;
+  } else {
+    index_ = tree_page->KeyIndex(key_, comparator);  // 第一个不小于key的位置
+    if (past_key_ && index_ < tree_page->GetSize() && comparator(tree_page->KeyAt(index_), key_) == 0) {
+      ++index_;
+    }
+  }
+}
+
+/*
+ * Called with the leaf read latched after Reposition, moves index_ past the
+ * current entry and remembers its key
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::PassEntry() {
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  if (returned_key_) {
+    // the position is key_ itself, or the entry after it if key_ was removed since operator* returned it
+    if (index_ < tree_page->GetSize() && tree_->comparator_(tree_page->KeyAt(index_), key_) == 0) {
+      ++index_;
+    }
+  } else if (index_ < tree_page->GetSize()) {
+    key_ = tree_page->KeyAt(index_);
+    ++index_;
+  } else {
+    return;  // 已经到达末尾
+  }
+  has_key_ = true;
+  past_key_ = true;
+  returned_key_ = false;
 }
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
@@ -60,4 +300,14 @@ template class IndexIterator<GenericKey<32>, RID, GenericComparator<32>>;
 
 template class IndexIterator<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class IndexIterator<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+
+template class IndexIterator<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+
+template class IndexIterator<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+
+template class IndexIterator<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+
+template class IndexIterator<NormalizedKey<64>, RID, NormalizedComparator<64>>;
+
 }  // namespace bustub
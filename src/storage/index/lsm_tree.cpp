@@ -0,0 +1,458 @@
+/**
+ * lsm_tree.cpp
+ */
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "storage/index/lsm_tree.h"
+
+namespace bustub {
+
+INDEX_TEMPLATE_ARGUMENTS
+LSMTREE_TYPE::LSMTree(BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator, size_t memtable_size)
+    : buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      memtable_size_(std::max<size_t>(memtable_size, 1)),
+      memtable_(std::make_unique<Memtable>(EntryLess{comparator})),
+      levels_(1) {
+  compaction_thread_ = std::thread([this] { CompactionLoop(); });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+LSMTREE_TYPE::~LSMTree() {
+  {
+    std::scoped_lock lock(latch_);
+    stop_ = true;
+  }
+  compaction_cv_.notify_all();
+  compaction_thread_.join();
+}
+
+/*****************************************************************************
+ * RUNS
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+LSMTREE_TYPE::Run::~Run() {
+  for (page_id_t page_id : pages_) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+LSMTREE_TYPE::Cursor::Cursor(RunRef run, const KeyType &low, const KeyComparator &comparator) : run_(std::move(run)) {
+  // entries equal to low may start on the page before the first fence that is not less than low
+  auto fence = std::lower_bound(run_->fences_.begin(), run_->fences_.end(), low,
+                                [&](const KeyType &lhs, const KeyType &rhs) { return comparator(lhs, rhs) < 0; });
+  page_index_ = fence == run_->fences_.begin() ? 0 : fence - run_->fences_.begin() - 1;
+  LoadPage(page_index_);
+  while (Valid() && comparator(Get().key_, low) < 0) {
+    Next();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::Cursor::Next() {
+  ++pos_;
+  if (pos_ == buffer_.size() && run_ != nullptr && page_index_ + 1 < run_->pages_.size()) {
+    LoadPage(++page_index_);
+  }
+}
+
+/*
+ * Copy out the entries of a page, so the page is only pinned while it is read.
+ * Run pages never change, there is nothing to latch.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::Cursor::LoadPage(size_t page_index) {
+  page_id_t page_id = run_->pages_[page_index];
+  Page *page = run_->buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch a page of an lsm run");
+  }
+  auto run_page = reinterpret_cast<const RunPage *>(page->GetData());
+  buffer_.clear();
+  buffer_.reserve(run_page->GetSize());
+  for (int i = 0; i < run_page->GetSize(); i++) {
+    buffer_.push_back({run_page->KeyAt(i), run_page->ValueAt(i), run_page->IsTombstone(i)});
+  }
+  pos_ = 0;
+  run_->buffer_pool_manager_->UnpinPage(page_id, false);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+LSMTREE_TYPE::RunWriter::RunWriter(LSMTree *tree, size_t expected_entries)
+    : tree_(tree), run_(std::make_shared<Run>(tree->buffer_pool_manager_, expected_entries)) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+LSMTREE_TYPE::RunWriter::~RunWriter() {
+  if (page_ != nullptr) {
+    tree_->buffer_pool_manager_->UnpinPage(page_->GetPageId(), true);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::RunWriter::Append(const Entry &entry) {
+  if (page_ == nullptr || reinterpret_cast<RunPage *>(page_->GetData())->IsFull()) {
+    if (page_ != nullptr) {
+      tree_->buffer_pool_manager_->UnpinPage(page_->GetPageId(), true);
+      page_ = nullptr;
+    }
+    page_id_t page_id;
+    page_ = tree_->buffer_pool_manager_->NewPage(&page_id);
+    if (page_ == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate a page for an lsm run");
+    }
+    reinterpret_cast<RunPage *>(page_->GetData())->Init();
+    run_->pages_.push_back(page_id);
+    run_->fences_.push_back(entry.key_);
+  }
+  reinterpret_cast<RunPage *>(page_->GetData())->Append(entry.key_, entry.value_, entry.tombstone_);
+  run_->bloom_.Insert(tree_->hash_fn_.GetHash(entry.key_));
+  run_->last_key_ = entry.key_;
+  run_->size_++;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSMTREE_TYPE::RunWriter::Finish() -> RunRef {
+  if (page_ != nullptr) {
+    tree_->buffer_pool_manager_->UnpinPage(page_->GetPageId(), true);
+    page_ = nullptr;
+  }
+  if (run_->size_ == 0) {
+    return nullptr;
+  }
+  return std::move(run_);
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto LSMTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result) -> bool {
+  bool found = false;
+  auto cursors = OpenCursors(key, key, true);
+  Merge(&cursors, &key, [&](const Entry &entry) {
+    if (!entry.tombstone_) {
+      result->push_back(entry.value_);
+      found = true;
+    }
+  });
+  return found;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::Scan(const KeyType &low, const KeyType &high,
+                        const std::function<void(const KeyType &, const ValueType &)> &on_entry) {
+  if (comparator_(low, high) > 0) {
+    return;
+  }
+  auto cursors = OpenCursors(low, high, false);
+  Merge(&cursors, &high, [&](const Entry &entry) {
+    if (!entry.tombstone_) {
+      on_entry(entry.key_, entry.value_);
+    }
+  });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSMTREE_TYPE::CompareEntries(const Entry &lhs, const Entry &rhs) const -> int {
+  int cmp = comparator_(lhs.key_, rhs.key_);
+  if (cmp != 0) {
+    return cmp;
+  }
+  if (lhs.value_.Get() != rhs.value_.Get()) {
+    return lhs.value_.Get() < rhs.value_.Get() ? -1 : 1;
+  }
+  return 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSMTREE_TYPE::CopyRange(const Memtable &memtable, const KeyType &low, const KeyType &high) const
+    -> std::vector<Entry> {
+  std::vector<Entry> entries;
+  // a default constructed RID has an invalid page id and sorts before every real one
+  for (auto it = memtable.lower_bound({low, ValueType{}}); it != memtable.end(); ++it) {
+    if (comparator_(it->first.first, high) > 0) {
+      break;
+    }
+    entries.push_back({it->first.first, it->first.second, it->second});
+  }
+  return entries;
+}
+
+/*
+ * Take a snapshot of the memtables and the runs under latch_, then open the
+ * runs without it. The cursors are ordered newest first, which Merge relies on.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto LSMTREE_TYPE::OpenCursors(const KeyType &low, const KeyType &high, bool point) -> std::vector<Cursor> {
+  std::vector<Cursor> cursors;
+  std::shared_ptr<const Memtable> immutable;
+  std::vector<RunRef> runs;
+  {
+    std::scoped_lock lock(latch_);
+    cursors.emplace_back(CopyRange(*memtable_, low, high));
+    immutable = immutable_;
+    for (const auto &level : levels_) {
+      runs.insert(runs.end(), level.begin(), level.end());
+    }
+  }
+  if (immutable != nullptr) {
+    cursors.emplace_back(CopyRange(*immutable, low, high));
+  }
+  uint64_t hash = point ? hash_fn_.GetHash(low) : 0;
+  for (auto &run : runs) {
+    if (comparator_(run->last_key_, low) < 0 || comparator_(high, run->fences_.front()) < 0) {
+      continue;
+    }
+    if (point && !run->bloom_.MayContain(hash)) {
+      continue;
+    }
+    cursors.emplace_back(std::move(run), low, comparator_);
+  }
+  return cursors;
+}
+
+/*
+ * K-way merge of the cursors. Of equal entries only the one of the first, i.e.
+ * newest, cursor is emitted, the others are older versions it shadows.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename Emit>
+void LSMTREE_TYPE::Merge(std::vector<Cursor> *cursors, const KeyType *high, Emit emit) {
+  while (true) {
+    const Entry *newest = nullptr;
+    for (const auto &cursor : *cursors) {
+      if (cursor.Valid() && (newest == nullptr || CompareEntries(cursor.Get(), *newest) < 0)) {
+        newest = &cursor.Get();
+      }
+    }
+    if (newest == nullptr || (high != nullptr && comparator_(newest->key_, *high) > 0)) {
+      return;
+    }
+    Entry entry = *newest;
+    for (auto &cursor : *cursors) {
+      if (cursor.Valid() && CompareEntries(cursor.Get(), entry) == 0) {
+        cursor.Next();
+      }
+    }
+    emit(entry);
+  }
+}
+
+/*****************************************************************************
+ * INSERTION / REMOVE
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto LSMTREE_TYPE::Insert(const KeyType &key, const ValueType &value, bool unique) -> bool {
+  if (!unique) {
+    Put(key, value, false);
+    return true;
+  }
+  std::scoped_lock lock(unique_latch_);
+  std::vector<ValueType> values;
+  if (GetValue(key, &values)) {
+    return false;
+  }
+  Put(key, value, false);
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::Remove(const KeyType &key, const ValueType &value) { Put(key, value, true); }
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::Put(const KeyType &key, const ValueType &value, bool tombstone) {
+  std::unique_lock lock(latch_);
+  (*memtable_)[{key, value}] = tombstone;
+  if (memtable_->size() >= memtable_size_) {
+    FlushMemtable(&lock, false);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::Flush() {
+  std::unique_lock lock(latch_);
+  FlushMemtable(&lock, true);
+}
+
+/*
+ * Writers keep going while the frozen memtable is written out, only a second
+ * flush waits for the first one, and for compaction once level 0 is full.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::FlushMemtable(std::unique_lock<std::mutex> *lock, bool force) {
+  done_cv_.wait(*lock, [&] { return immutable_ == nullptr && levels_[0].size() < LSM_LEVEL0_STOP; });
+  // another writer may have flushed it meanwhile
+  if (memtable_->empty() || (!force && memtable_->size() < memtable_size_)) {
+    return;
+  }
+  immutable_ = std::move(memtable_);
+  memtable_ = std::make_unique<Memtable>(EntryLess{comparator_});
+  auto frozen = immutable_;
+  lock->unlock();
+
+  RunWriter writer(this, frozen->size());
+  for (const auto &[entry, tombstone] : *frozen) {
+    writer.Append({entry.first, entry.second, tombstone});
+  }
+  RunRef run = writer.Finish();
+
+  lock->lock();
+  levels_[0].insert(levels_[0].begin(), std::move(run));
+  immutable_ = nullptr;
+  done_cv_.notify_all();
+  if (levels_[0].size() >= LSM_LEVEL0_RUNS) {
+    compaction_cv_.notify_one();
+  }
+}
+
+/*
+ * Write the entries as one run on the shallowest level that holds it, so no
+ * compaction has to rewrite it soon, and drop everything else.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::BulkLoad(const std::vector<MappingType> &entries) {
+  RunWriter writer(this, entries.size());
+  for (const auto &[key, value] : entries) {
+    writer.Append({key, value, false});
+  }
+  RunRef run = writer.Finish();
+
+  std::vector<std::vector<RunRef>> old_levels;
+  {
+    std::unique_lock lock(latch_);
+    done_cv_.wait(lock, [&] { return immutable_ == nullptr && !compacting_; });
+    size_t level = 1;
+    while (run != nullptr && run->size_ > LevelCapacity(level)) {
+      level++;
+    }
+    memtable_ = std::make_unique<Memtable>(EntryLess{comparator_});
+    old_levels = std::move(levels_);
+    levels_.assign(level + 1, {});
+    if (run != nullptr) {
+      levels_[level].push_back(std::move(run));
+    }
+  }
+  // the old runs delete their pages here, outside of latch_, unless a reader still uses them
+}
+
+/*****************************************************************************
+ * COMPACTION
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto LSMTREE_TYPE::LevelCapacity(size_t level) const -> size_t {
+  size_t capacity = memtable_size_ * LSM_LEVEL0_RUNS;
+  for (size_t i = 1; i < level; i++) {
+    capacity *= LSM_LEVEL_FANOUT;
+  }
+  return capacity;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSMTREE_TYPE::CompactionLevel() const -> std::optional<size_t> {
+  if (levels_[0].size() >= LSM_LEVEL0_RUNS) {
+    return 0;
+  }
+  for (size_t level = 1; level < levels_.size(); level++) {
+    if (!levels_[level].empty() && levels_[level].front()->size_ > LevelCapacity(level)) {
+      return level;
+    }
+  }
+  return std::nullopt;
+}
+
+/*
+ * Merge a level into the next one without holding latch_. Flushes only add
+ * runs to the front of level 0 meanwhile, so the input runs are still the
+ * oldest of their level when the merged run replaces them.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::CompactionLoop() {
+  std::unique_lock lock(latch_);
+  while (true) {
+    std::optional<size_t> level;
+    compaction_cv_.wait(lock, [&] { return stop_ || (level = CompactionLevel()).has_value(); });
+    if (stop_) {
+      return;
+    }
+    size_t target = *level + 1;
+    if (levels_.size() <= target) {
+      levels_.resize(target + 1);
+    }
+    // newest first: the runs of the level, then the run of the level below
+    std::vector<RunRef> inputs = levels_[*level];
+    size_t source_runs = inputs.size();
+    inputs.insert(inputs.end(), levels_[target].begin(), levels_[target].end());
+    // a tombstone has nothing left to hide once it reaches the deepest level
+    bool bottom = std::all_of(levels_.begin() + target + 1, levels_.end(),
+                              [](const std::vector<RunRef> &runs) { return runs.empty(); });
+    compacting_ = true;
+    lock.unlock();
+
+    std::vector<Cursor> cursors;
+    size_t expected_entries = 0;
+    for (const auto &run : inputs) {
+      expected_entries += run->size_;
+      cursors.emplace_back(run, run->fences_.front(), comparator_);
+    }
+    RunWriter writer(this, expected_entries);
+    Merge(&cursors, nullptr, [&](const Entry &entry) {
+      if (!bottom || !entry.tombstone_) {
+        writer.Append(entry);
+      }
+    });
+    RunRef merged = writer.Finish();
+    cursors.clear();
+    inputs.clear();
+
+    lock.lock();
+    auto &source = levels_[*level];
+    source.erase(source.end() - source_runs, source.end());
+    levels_[target].clear();
+    if (merged != nullptr) {
+      levels_[target].push_back(std::move(merged));
+    }
+    compacting_ = false;
+    done_cv_.notify_all();
+  }
+}
+
+/*****************************************************************************
+ * UTILITIES AND DEBUG
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_TYPE::WaitForCompaction() {
+  std::unique_lock lock(latch_);
+  compaction_cv_.notify_one();
+  done_cv_.wait(lock, [&] { return immutable_ == nullptr && !compacting_ && !CompactionLevel().has_value(); });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSMTREE_TYPE::GetLevelRuns() -> std::vector<size_t> {
+  std::scoped_lock lock(latch_);
+  std::vector<size_t> runs;
+  runs.reserve(levels_.size());
+  for (const auto &level : levels_) {
+    runs.push_back(level.size());
+  }
+  return runs;
+}
+
+template class LSMTree<GenericKey<4>, RID, GenericComparator<4>>;
+template class LSMTree<GenericKey<8>, RID, GenericComparator<8>>;
+template class LSMTree<GenericKey<16>, RID, GenericComparator<16>>;
+template class LSMTree<GenericKey<32>, RID, GenericComparator<32>>;
+template class LSMTree<GenericKey<64>, RID, GenericComparator<64>>;
+
+template class LSMTree<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class LSMTree<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class LSMTree<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class LSMTree<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class LSMTree<NormalizedKey<64>, RID, NormalizedComparator<64>>;
+
+}  // namespace bustub
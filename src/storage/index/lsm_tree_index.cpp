@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lsm_tree_index.cpp
+//
+// Identification: src/storage/index/lsm_tree_index.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <numeric>
+
+#include "storage/index/lsm_tree_index.h"
+
+namespace bustub {
+
+INDEX_TEMPLATE_ARGUMENTS
+LSMTREE_INDEX_TYPE::LSMTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager)
+    : Index(std::move(metadata)),
+      comparator_(GetMetadata()->GetKeySchema()),
+      container_(buffer_pool_manager, comparator_) {
+  if (!GetMetadata()->GetIncludeAttrs().empty()) {
+    throw NotImplementedException("an LSM tree index cannot include columns");
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSMTREE_INDEX_TYPE::MakeKey(const Tuple &key) const -> KeyType {
+  KeyType index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+  return index_key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  container_.Insert(MakeKey(key), rid, GetMetadata()->IsUnique());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_INDEX_TYPE::BulkLoad(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction,
+                                  double fill_factor) {
+  std::vector<MappingType> sorted;
+  sorted.reserve(entries.size());
+  for (const auto &[key, rid] : entries) {
+    sorted.emplace_back(MakeKey(key), rid);
+  }
+  // by key, then by RID as the tree orders entries; a stable sort keeps the first row of a unique key in front
+  std::stable_sort(sorted.begin(), sorted.end(), [this](const MappingType &a, const MappingType &b) {
+    int cmp = comparator_(a.first, b.first);
+    return cmp < 0 || (cmp == 0 && !GetMetadata()->IsUnique() && a.second.Get() < b.second.Get());
+  });
+  auto same = [this](const MappingType &a, const MappingType &b) {
+    return comparator_(a.first, b.first) == 0 && (GetMetadata()->IsUnique() || a.second == b.second);
+  };
+  sorted.erase(std::unique(sorted.begin(), sorted.end(), same), sorted.end());
+  container_.BulkLoad(sorted);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  KeyType index_key = MakeKey(key);
+  if (!GetMetadata()->IsUnique()) {
+    container_.Remove(index_key, rid);
+    return;
+  }
+  std::vector<RID> rids;
+  container_.GetValue(index_key, &rids);
+  for (const auto &stored_rid : rids) {
+    container_.Remove(index_key, stored_rid);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
+  container_.GetValue(MakeKey(key), result);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_INDEX_TYPE::ScanKeyPrefix(const std::vector<Value> &prefix, std::vector<RID> *result,
+                                       Transaction *transaction) {
+  if constexpr (!IS_NORMALIZED_KEY<KeyType>) {
+    Index::ScanKeyPrefix(prefix, result, transaction);
+  } else {
+    if (prefix.size() > GetIndexColumnCount()) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, "prefix is longer than the index key");
+    }
+    // the keys with the prefix lie between the prefix padded with 0x00 and the prefix padded with 0xFF
+    std::vector<uint32_t> prefix_attrs(prefix.size());
+    std::iota(prefix_attrs.begin(), prefix_attrs.end(), 0);
+    Schema prefix_schema = Schema::CopySchema(GetKeySchema(), prefix_attrs);
+    Tuple prefix_tuple(prefix, &prefix_schema);
+    KeyType low_key;
+    KeyType high_key;
+    low_key.SetFromKey(prefix_tuple, &prefix_schema);
+    high_key.SetPrefixUpperBound(prefix_tuple, &prefix_schema);
+    container_.Scan(low_key, high_key, [result](const KeyType &key, const RID &rid) { result->push_back(rid); });
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSMTREE_INDEX_TYPE::FlushAndCompact() {
+  container_.Flush();
+  container_.WaitForCompaction();
+}
+
+template class LSMTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
+template class LSMTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
+template class LSMTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
+template class LSMTreeIndex<GenericKey<32>, RID, GenericComparator<32>>;
+template class LSMTreeIndex<GenericKey<64>, RID, GenericComparator<64>>;
+template class LSMTreeIndex<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class LSMTreeIndex<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class LSMTreeIndex<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class LSMTreeIndex<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class LSMTreeIndex<NormalizedKey<64>, RID, NormalizedComparator<64>>;
+
+}  // namespace bustub
@@ -0,0 +1,272 @@
+/**
+ * reverse_index_iterator.cpp
+ */
+#include <algorithm>
+
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/reverse_index_iterator.h"
+
+namespace bustub {
+
+/*
+ * Latches like IndexIterator: the leaf stays pinned, and each access read
+ * latches it only for as long as it needs. Moving to the previous leaf pins it
+ * while the current leaf is still latched, then drops the current latch before
+ * taking the next one, so walking right to left never holds two leaf latches
+ * and cannot deadlock with writers. Like IndexIterator it remembers the last
+ * key it moved past and searches for it again once the leaf's version changed,
+ * or once entries moved between leaves while it hopped to the previous leaf.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+REVERSE_INDEXITERATOR_TYPE::ReverseIndexIterator() = default;
+
+INDEX_TEMPLATE_ARGUMENTS
+REVERSE_INDEXITERATOR_TYPE::ReverseIndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, Page *page,
+                                                 int index, const KeyType *start_key)
+    : tree_(tree),
+      page_id_(page->GetPageId()),
+      page_(page),
+      index_(index),
+      buffer_pool_manager_(tree->buffer_pool_manager_) {
+  if (start_key != nullptr) {
+    key_ = *start_key;
+    has_key_ = true;
+  }
+  tree_->OpenIterator();  // 在叶子节点仍被锁住时登记，旧页面不会在此之后被删除
+  SkipExhaustedLeaves();  // a position before the start of a leaf means the last entry of the previous one
+  page_->RUnlatch();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+REVERSE_INDEXITERATOR_TYPE::~ReverseIndexIterator() {  // NOLINT
+  if (page_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(page_id_, false);
+    tree_->CloseIterator();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+REVERSE_INDEXITERATOR_TYPE::ReverseIndexIterator(ReverseIndexIterator &&other) noexcept
+    : tree_(other.tree_),
+      page_id_(other.page_id_),
+      page_(other.page_),
+      index_(other.index_),
+      buffer_pool_manager_(other.buffer_pool_manager_),
+      item_(other.item_),
+      version_(other.version_),
+      key_(other.key_),
+      has_key_(other.has_key_),
+      past_key_(other.past_key_),
+      returned_key_(other.returned_key_) {
+  other.page_ = nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto REVERSE_INDEXITERATOR_TYPE::operator=(ReverseIndexIterator &&other) noexcept -> REVERSE_INDEXITERATOR_TYPE & {
+  if (this != &other) {
+    if (page_ != nullptr) {
+      buffer_pool_manager_->UnpinPage(page_id_, false);
+      tree_->CloseIterator();
+    }
+    tree_ = other.tree_;
+    page_id_ = other.page_id_;
+    page_ = other.page_;
+    index_ = other.index_;
+    buffer_pool_manager_ = other.buffer_pool_manager_;
+    item_ = other.item_;
+    version_ = other.version_;
+    key_ = other.key_;
+    has_key_ = other.has_key_;
+    past_key_ = other.past_key_;
+    returned_key_ = other.returned_key_;
+    other.page_ = nullptr;
+  }
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto REVERSE_INDEXITERATOR_TYPE::IsEnd() -> bool {
+  if (page_ == nullptr) {
+    return true;
+  }
+  page_->RLatch();
+  Reposition();
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  bool is_end = index_ < 0 && tree_page->GetPrevPageId() == INVALID_PAGE_ID;
+  page_->RUnlatch();
+  return is_end;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto REVERSE_INDEXITERATOR_TYPE::operator*() -> const MappingType & {
+  page_->RLatch();
+  Reposition();
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  item_ = tree_page->GetAt(index_);
+  key_ = item_.first;
+  has_key_ = true;
+  past_key_ = false;
+  returned_key_ = true;
+  page_->RUnlatch();
+  return item_;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto REVERSE_INDEXITERATOR_TYPE::operator++() -> REVERSE_INDEXITERATOR_TYPE & {
+  page_->RLatch();
+  Reposition();
+  PassEntry();
+  SkipExhaustedLeaves();
+  page_->RUnlatch();
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto REVERSE_INDEXITERATOR_TYPE::NextBatch(size_t max_n, std::vector<MappingType> *out) -> size_t {
+  if (page_ == nullptr) {
+    return 0;
+  }
+  size_t copied = 0;
+  page_->RLatch();
+  Reposition();
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  while (copied < max_n && index_ >= 0) {
+    int end = std::max(-1, index_ - static_cast<int>(max_n - copied));
+    for (; index_ > end; --index_) {
+      out->push_back(tree_page->GetAt(index_));
+      ++copied;
+    }
+    key_ = out->back().first;
+    has_key_ = true;
+    past_key_ = true;
+    returned_key_ = false;
+    SkipExhaustedLeaves();
+    tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  }
+  page_->RUnlatch();
+  return copied;
+}
+
+/*
+ * Called with the current leaf read latched, returns with the leaf it moved to
+ * read latched
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void REVERSE_INDEXITERATOR_TYPE::SkipExhaustedLeaves() {
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  // skip to the previous leaf that still has entries
+  while (index_ < 0 && tree_page->GetPrevPageId() != INVALID_PAGE_ID) {
+    page_id_t prev_page_id = tree_page->GetPrevPageId();
+    auto prev_page = buffer_pool_manager_->FetchPage(prev_page_id);
+    uint64_t move_version = tree_->leaf_move_version_.load();  // 持有当前叶子的读锁时读取
+    page_->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id_, false);
+    page_ = prev_page;
+    page_id_ = prev_page_id;
+    page_->RLatch();
+    tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+    index_ = tree_page->GetSize() - 1;
+    if (tree_->leaf_move_version_.load() != move_version) {
+      Relocate();  // 跳转期间数据在叶子之间移动过
+      tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+    }
+  }
+  version_ = tree_page->GetVersion();
+}
+
+/*
+ * Called with the current leaf read latched, returns with the leaf the
+ * position is in read latched. Mirrors IndexIterator::Reposition.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void REVERSE_INDEXITERATOR_TYPE::Reposition() {
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  if (tree_page->GetVersion() == version_) {
+    return;
+  }
+  Relocate();
+  SkipExhaustedLeaves();
+}
+
+/*
+ * Called with the current leaf read latched, returns with the leaf that holds
+ * the position read latched, index_ may be before its start. Mirrors
+ * IndexIterator::Relocate: the leaf is searched for key_ if key_ still lies
+ * between its first and its last key, otherwise the tree is.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void REVERSE_INDEXITERATOR_TYPE::Relocate() {
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  const KeyComparator &comparator = tree_->comparator_;
+  int size = tree_page->GetSize();
+  bool in_leaf = has_key_ ? size > 0 && comparator(tree_page->KeyAt(0), key_) <= 0 &&
+                                comparator(key_, tree_page->KeyAt(size - 1)) <= 0
+                          : tree_page->GetNextPageId() == INVALID_PAGE_ID;  // 最右叶子节点之后不会有数据
+  if (!in_leaf) {
+    page_->RUnlatch();  // 从根节点往下查找，不能持有叶子节点的锁
+    Page *leaf_page = has_key_ ? tree_->FindLeafPage(key_, Operation::SEARCH)
+                               : tree_->FindLeafPage(KeyType{}, Operation::SEARCH, nullptr, false, true);
+    if (leaf_page == nullptr) {  // 树已经为空
+      page_->RLatch();
+      index_ = -1;
+      return;
+    }
+    buffer_pool_manager_->UnpinPage(page_id_, false);
+    page_ = leaf_page;
+    page_id_ = leaf_page->GetPageId();
+    tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  }
+  if (!has_key_) {
+    index_ = tree_page->GetSize() - 1;
+  } else {
+    index_ = tree_page->KeyIndex(key_, comparator);  // 第一个不小于key的位置
+    if (past_key_ || index_ == tree_page->GetSize() || comparator(tree_page->KeyAt(index_), key_) != 0) {
+      --index_;  // 前一个才小于key，可能在上一个叶子
+    }
+  }
+}
+
+/*
+ * Called with the leaf read latched after Reposition, moves index_ in front
+ * of the current entry and remembers its key
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void REVERSE_INDEXITERATOR_TYPE::PassEntry() {
+  auto tree_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_->GetData());
+  if (returned_key_) {
+    // the position is key_ itself, or the entry before it if key_ was removed since operator* returned it
+    if (index_ >= 0 && tree_->comparator_(tree_page->KeyAt(index_), key_) == 0) {
+      --index_;
+    }
+  } else if (index_ >= 0) {
+    key_ = tree_page->KeyAt(index_);
+    --index_;
+  } else {
+    return;  // 已经到达末尾
+  }
+  has_key_ = true;
+  past_key_ = true;
+  returned_key_ = false;
+}
+
+template class ReverseIndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
+
+template class ReverseIndexIterator<GenericKey<8>, RID, GenericComparator<8>>;
+
+template class ReverseIndexIterator<GenericKey<16>, RID, GenericComparator<16>>;
+
+template class ReverseIndexIterator<GenericKey<32>, RID, GenericComparator<32>>;
+
+template class ReverseIndexIterator<GenericKey<64>, RID, GenericComparator<64>>;
+
+template class ReverseIndexIterator<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+
+template class ReverseIndexIterator<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+
+template class ReverseIndexIterator<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+
+template class ReverseIndexIterator<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+
+template class ReverseIndexIterator<NormalizedKey<64>, RID, NormalizedComparator<64>>;
+
+}  // namespace bustub
@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -39,55 +40,56 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const -> KeyType {
   // replace with your own code
-  return array_[index].first;
+  return keys_[index];
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) { array_[index].first = key; }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) { keys_[index] = key; }
 
 /*
  * Helper method to get the value associated with input "index"(a.k.a array
  * offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const -> ValueType { return array_[index].second; }
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const -> ValueType { return Values()[index]; }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index, const ValueType &value) { array_[index].second = value; }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index, const ValueType &value) { Values()[index] = value; }
 
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetAt(int index) const -> MappingType { return array_[index]; }
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetAt(int index) const -> MappingType { return {keys_[index], Values()[index]}; }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetAt(int index, const MappingType &value) { array_[index] = value; }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetAt(int index, const MappingType &value) {
+  keys_[index] = value.first;
+  Values()[index] = value.second;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &keyComparator) -> ValueType {
-  int l = 1;
-  int r = GetSize();
-  while (l < r) {
-    int mid = (l + r) / 2;
-    if (keyComparator(array_[mid].first, key) <= 0) {
-      l = mid + 1;
-    } else {
-      r = mid;
-    }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveEntries(int dst, int src, int count) {
+  if (count <= 0) {
+    return;
   }
-  return array_[r - 1].second;
+  memmove(static_cast<void *>(keys_ + dst), keys_ + src, count * sizeof(KeyType));
+  memmove(static_cast<void *>(Values() + dst), Values() + src, count * sizeof(ValueType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &keyComparator) -> ValueType {
+  return Values()[LookupIndex(key, keyComparator)];
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::LookupIndex(const KeyType &key, const KeyComparator &keyComparator) -> int {
+  // 第一个大于key的位置，它左边的指针指向包含key的子树
+  return KeySearch<KeyType, KeyComparator>::UpperBound(keys_, 1, GetSize(), key, keyComparator) - 1;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Insert(const MappingType &value, const KeyComparator &keyComparator) -> void {
-  for (int i = GetSize() - 1; i > 0; --i) {
-    if (keyComparator(array_[i].first, value.first) > 0) {
-      array_[i + 1] = array_[i];
-    } else {
-      array_[i + 1] = value;
-      IncreaseSize(1);
-      return;
-    }
-  }
-  SetAt(1, value);
+  int index = KeySearch<KeyType, KeyComparator>::UpperBound(keys_, 1, GetSize(), value.first, keyComparator);
+  MoveEntries(index + 1, index, GetSize() - index);
+  SetAt(index, value);
   IncreaseSize(1);
 }
 
@@ -95,17 +97,17 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Split(const KeyType &key, Page *page_bother, Page *page_parent_page,
                                            const KeyComparator &keyComparator, BufferPoolManager *buffer_pool_manager) {
   auto *tmp = static_cast<MappingType *>(malloc(sizeof(MappingType) * (GetMaxSize() + 1)));
-  bool flag = true;    // 是否已经插入
-  tmp[0] = array_[0];  // 0 是无效的
+  bool flag = true;   // 是否已经插入
+  tmp[0] = GetAt(0);  // 0 是无效的
   for (int i = 1; i < GetMaxSize(); ++i) {
-    if (keyComparator(array_[i].first, key) < 0) {  // 如果key小于分裂key
-      tmp[i] = array_[i];
-    } else if (flag && keyComparator(array_[i].first, key) > 0) {  // 如果key大于分裂key
-      flag = false;                                                // 重置flag
+    if (keyComparator(keys_[i], key) < 0) {  // 如果key小于分裂key
+      tmp[i] = GetAt(i);
+    } else if (flag && keyComparator(keys_[i], key) > 0) {  // 如果key大于分裂key
+      flag = false;                                         // 重置flag
       tmp[i] = std::make_pair(key, page_bother->GetPageId());
-      tmp[i + 1] = array_[i];
+      tmp[i + 1] = GetAt(i);
     } else {  // 如果key等于分裂key
-      tmp[i + 1] = array_[i];
+      tmp[i + 1] = GetAt(i);
     }
   }
   if (flag) {                                                           // 没有插入
@@ -118,14 +120,14 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Split(const KeyType &key, Page *page_bother
   auto page_parent_node =
       reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE_TYPE *>(page_parent_page->GetData());  // 转换为内部节点
   for (int i = 0; i < mid; ++i) {
-    array_[i] = tmp[i];  // 复制数据
+    SetAt(i, tmp[i]);  // 复制数据
   }
   int i = 0;  // 重置i
   while (mid <= GetMaxSize()) {
     Page *child = buffer_pool_manager->FetchPage(tmp[mid].second);                           // 获取子节点
     auto child_node = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE_TYPE *>(child->GetData());  // 转换为内部节点
     child_node->SetParentPageId(page_parent_node->GetPageId());                              // 设置父节点
-    page_parent_node->array_[i++] = tmp[mid++];                                              // 复制数据
+    page_parent_node->SetAt(i++, tmp[mid++]);                                                // 复制数据
     page_parent_node->IncreaseSize(1);                                                       // 增加大小
     IncreaseSize(-1);                                                                        // 减少大小
     buffer_pool_manager->UnpinPage(child->GetPageId(), true);                                // 释放
@@ -136,29 +138,17 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Split(const KeyType &key, Page *page_bother
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Delete(const KeyType &key, const KeyComparator &keyComparator) -> bool {
   int index = KeyIndex(key, keyComparator);                                  // 获取索引
-  if (index >= GetSize() || keyComparator(array_[index].first, key) != 0) {  // 如果索引大于等于大小或者key不相等
+  if (index >= GetSize() || keyComparator(keys_[index], key) != 0) {  // 如果索引大于等于大小或者key不相等
     return false;
   }
-  for (int i = index + 1; i < GetSize(); ++i) {  // 删除数据
-    array_[i - 1] = array_[i];
-  }
-  IncreaseSize(-1);  // 减少大小
+  MoveEntries(index, index + 1, GetSize() - index - 1);  // 删除数据
+  IncreaseSize(-1);                                      // 减少大小
   return true;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &keyComparator) -> int {
-  int l = 1;
-  int r = GetSize();
-  while (l < r) {
-    int mid = (l + r) / 2;
-    if (keyComparator(array_[mid].first, key) < 0) {
-      l = mid + 1;
-    } else {
-      r = mid;
-    }
-  }
-  return r;
+  return KeySearch<KeyType, KeyComparator>::LowerBound(keys_, 1, GetSize(), key, keyComparator);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -166,19 +156,19 @@ auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetBotherPage(page_id_t child_page_id, Page
                                                    bool &ispre, BufferPoolManager *buffer_pool_manager) -> void {
   int i = 0;
   for (i = 0; i < GetSize(); ++i) {
-    if (array_[i].second == child_page_id) {  // 如果子节点id等于child_page_id
-      break;                                  // 说明找到了
+    if (Values()[i] == child_page_id) {  // 如果子节点id等于child_page_id
+      break;                             // 说明找到了
     }
   }
-  if (i >= 1) {                                                          // 如果大于等于1
-    bother_page = buffer_pool_manager->FetchPage(array_[i - 1].second);  // 获取左兄弟节点
-    key = array_[i - 1].first;                                           // 设置key
-    ispre = true;                                                        // 设置为true
+  if (i >= 1) {                                                     // 如果大于等于1
+    bother_page = buffer_pool_manager->FetchPage(Values()[i - 1]);  // 获取左兄弟节点
+    key = keys_[i];                                                 // 设置key，分隔左兄弟和当前节点
+    ispre = true;                                                   // 设置为true
     return;
   }
-  bother_page = buffer_pool_manager->FetchPage(array_[i + 1].second);  // 获取右兄弟节点
-  key = array_[i + 1].first;                                           // 设置key
-  ispre = false;                                                       // 设置为false
+  bother_page = buffer_pool_manager->FetchPage(Values()[i + 1]);  // 获取右兄弟节点
+  key = keys_[i + 1];                                             // 设置key
+  ispre = false;                                                  // 设置为false
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -186,16 +176,15 @@ auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Merge(const KeyType &key, Page *right_page,
     -> void {
   auto right = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE_TYPE *>(right_page->GetData());  // 转换为内部节点
   int size = GetSize();                                                                    // 获取大小
-  array_[GetSize()] = std::make_pair(key, right->array_[0].second);                        // 插入数据
+  SetAt(GetSize(), std::make_pair(key, right->ValueAt(0)));                                // 插入数据
   IncreaseSize(1);                                                                         // 增加大小
   for (int i = GetSize(), j = 1; j < right->GetSize(); ++i, ++j) {
-    array_[i] = std::make_pair(right->array_[j].first, right->array_[j].second);  // 插入数据
-    IncreaseSize(1);                                                              // 增加大小
+    SetAt(i, right->GetAt(j));  // 插入数据
+    IncreaseSize(1);            // 增加大小
   }
-  buffer_pool_manager->UnpinPage(right->GetPageId(), true);  // 释放
-  buffer_pool_manager->DeletePage(right->GetPageId());       // 删除页
+  right->SetSize(0);  // 右节点由调用者释放并删除
   for (int i = size; i < GetSize(); ++i) {
-    page_id_t child_page_id = array_[i].second;                                                   // 获取子节点id
+    page_id_t child_page_id = ValueAt(i);                                                         // 获取子节点id
     auto child_page = buffer_pool_manager->FetchPage(child_page_id);                              // 获取子节点
     auto child_node = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE_TYPE *>(child_page->GetData());  // 转换为内部节点
     child_node->SetParentPageId(GetPageId());                                                     // 设置父节点
@@ -205,9 +194,7 @@ auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Merge(const KeyType &key, Page *right_page,
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertFirst(const KeyType &key, const ValueType &value) -> void {
-  for (int i = GetSize(); i > 0; --i) {
-    array_[i] = array_[i - 1];
-  }
+  MoveEntries(1, 0, GetSize());
   SetValueAt(0, value);  // 插入数据
   SetKeyAt(1, key);      // 插入数据
   IncreaseSize(1);
@@ -215,16 +202,24 @@ auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertFirst(const KeyType &key, const Value
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::DeleteFirst() -> void {
-  for (int i = 1; i < GetSize(); ++i) {
-    array_[i - 1] = array_[i];
-  }
+  MoveEntries(0, 1, GetSize() - 1);
   IncreaseSize(-1);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::FreeBytes() const -> size_t {
+  return BUSTUB_PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE - GetSize() * (sizeof(KeyType) + sizeof(ValueType));
+}
+
 // valuetype for internalNode should be page id_t
 template class BPlusTreeInternalPage<GenericKey<4>, page_id_t, GenericComparator<4>>;
 template class BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>>;
 template class BPlusTreeInternalPage<GenericKey<16>, page_id_t, GenericComparator<16>>;
 template class BPlusTreeInternalPage<GenericKey<32>, page_id_t, GenericComparator<32>>;
 template class BPlusTreeInternalPage<GenericKey<64>, page_id_t, GenericComparator<64>>;
+template class BPlusTreeInternalPage<NormalizedKey<4>, page_id_t, NormalizedComparator<4>>;
+template class BPlusTreeInternalPage<NormalizedKey<8>, page_id_t, NormalizedComparator<8>>;
+template class BPlusTreeInternalPage<NormalizedKey<16>, page_id_t, NormalizedComparator<16>>;
+template class BPlusTreeInternalPage<NormalizedKey<32>, page_id_t, NormalizedComparator<32>>;
+template class BPlusTreeInternalPage<NormalizedKey<64>, page_id_t, NormalizedComparator<64>>;
 }  // namespace bustub
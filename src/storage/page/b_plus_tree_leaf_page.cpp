@@ -9,7 +9,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
+#include <vector>
 
 #include "common/exception.h"
 #include "common/rid.h"
@@ -24,7 +27,7 @@ namespace bustub {
 /**
  * Init method after creating a new leaf page
  * Including set page type, set current size to zero, set page id/parent id, set
- * next page id and set max size
+ * next/prev page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
@@ -34,6 +37,11 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, in
   SetPageType(IndexPageType::LEAF_PAGE);
   SetSize(0);
   SetNextPageId(INVALID_PAGE_ID);
+  SetPrevPageId(INVALID_PAGE_ID);
+  if constexpr (PREFIX_COMPRESSED) {
+    Fences()->base_max_size_ = max_size;
+    Rebuild(nullptr, 0, MinFence(), MaxFence());  // 没有兄弟节点时的fence
+  }
 }
 
 /**
@@ -45,6 +53,15 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetNextPageId() const -> page_id_t { return nex
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
 
+/**
+ * Helper methods to set/get prev page id
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetPrevPageId() const -> page_id_t { return prev_page_id_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetPrevPageId(page_id_t prev_page_id) { prev_page_id_ = prev_page_id; }
+
 /*
  * Helper method to find and return the key associated with input "index"(a.k.a
  * array offset)
@@ -52,127 +69,307 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_pa
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const -> KeyType {
   // replace with your own code
-  return array_[index].first;
+  if constexpr (PREFIX_COMPRESSED) {
+    KeyType key;
+    memcpy(key.data_, Fences()->low_fence_.data_, PrefixSize());  // 前缀来自fence
+    memcpy(key.data_ + PrefixSize(), Slot(index), SlotSize());    // 后缀
+    return key;
+  }
+  return keys_[index];
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) -> void {
   // replace with your own code
-  array_[index].first = key;
+  if constexpr (PREFIX_COMPRESSED) {
+    memcpy(Slot(index), key.data_ + PrefixSize(), SlotSize());  // 只保存后缀
+    return;
+  }
+  keys_[index] = key;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const -> ValueType {
   // replace with your own code
-  return array_[index].second;
+  return Values()[index];
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::SetValueAt(int index, const ValueType &value) -> void {
   // replace with your own code
-  array_[index].second = value;
+  Values()[index] = value;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetAt(int index) const -> MappingType { return {KeyAt(index), Values()[index]}; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetAt(int index, const MappingType &value) {
+  SetKeyAt(index, value.first);
+  Values()[index] = value.second;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::SlotCount(size_t slot_size) -> int {
+  if constexpr (PREFIX_COMPRESSED) {
+    size_t space = BUSTUB_PAGE_SIZE - LEAF_PAGE_HEADER_SIZE - FENCE_HEADER_SIZE - (alignof(ValueType) - 1);
+    return static_cast<int>(space / (slot_size + sizeof(ValueType)));
+  }
+  return LEAF_PAGE_SIZE;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::PrefixSize() const -> size_t {
+  if constexpr (PREFIX_COMPRESSED) {
+    return Fences()->prefix_size_;
+  }
+  return 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::Values() -> ValueType * {
+  return const_cast<ValueType *>(static_cast<const BPlusTreeLeafPage *>(this)->Values());
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetAt(int index) -> MappingType { return array_[index]; }
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::Values() const -> const ValueType * {
+  if constexpr (PREFIX_COMPRESSED) {
+    size_t offset = FENCE_HEADER_SIZE + SlotCount(SlotSize()) * SlotSize();                // 值在所有key槽之后
+    offset = (offset + alignof(ValueType) - 1) / alignof(ValueType) * alignof(ValueType);  // 对齐
+    return reinterpret_cast<const ValueType *>(reinterpret_cast<const char *>(keys_) + offset);
+  }
+  return reinterpret_cast<const ValueType *>(keys_ + LEAF_PAGE_SIZE);
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::SetAt(int index, const MappingType &value) { array_[index] = value; }
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::MinFence() -> KeyType {
+  KeyType key{};
+  return key;  // 全0，不大于任何key
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::MaxFence() -> KeyType {
+  KeyType key{};
+  if constexpr (PREFIX_COMPRESSED) {
+    memset(key.data_, 0xFF, sizeof(KeyType));  // 全1，不小于任何key
+  }
+  return key;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetAtIter(int index) -> MappingType & { return array_[index]; }
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::MaxSizeOf(int base_max_size, const KeyType &low_fence, const KeyType &high_fence)
+    -> int {
+  if constexpr (PREFIX_COMPRESSED) {
+    size_t slot_size = sizeof(KeyType) - CommonPrefixSize(low_fence, high_fence);  // 去掉前缀后的槽大小
+    // 按压缩比例放大，但不能超过页面实际能放下的数量
+    int64_t scaled = static_cast<int64_t>(base_max_size) * static_cast<int64_t>(sizeof(MappingType)) /
+                     static_cast<int64_t>(slot_size + sizeof(ValueType));
+    return static_cast<int>(std::min<int64_t>(scaled, SlotCount(slot_size)));
+  }
+  return base_max_size;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetLowFence() const -> KeyType {
+  if constexpr (PREFIX_COMPRESSED) {
+    return Fences()->low_fence_;
+  }
+  return MinFence();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetHighFence() const -> KeyType {
+  if constexpr (PREFIX_COMPRESSED) {
+    return Fences()->high_fence_;
+  }
+  return MaxFence();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::MaxSizeFor(const KeyType &low_fence, const KeyType &high_fence) const -> int {
+  if constexpr (PREFIX_COMPRESSED) {
+    return MaxSizeOf(Fences()->base_max_size_, low_fence, high_fence);
+  }
+  return GetMaxSize();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetFences(const KeyType &low_fence, const KeyType &high_fence) {
+  if constexpr (PREFIX_COMPRESSED) {
+    std::vector<MappingType> entries;  // 按新的前缀重新编码
+    entries.reserve(GetSize());
+    for (int i = 0; i < GetSize(); ++i) {
+      entries.push_back(GetAt(i));
+    }
+    Rebuild(entries.data(), static_cast<int>(entries.size()), low_fence, high_fence);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Rebuild(const MappingType *entries, int count, const KeyType &low_fence,
+                                         const KeyType &high_fence) {
+  if constexpr (PREFIX_COMPRESSED) {
+    Fences()->low_fence_ = low_fence;                                                        // 设置fence
+    Fences()->high_fence_ = high_fence;                                                      // 设置fence
+    Fences()->prefix_size_ = static_cast<int32_t>(CommonPrefixSize(low_fence, high_fence));  // 共同前缀
+    SetMaxSize(MaxSizeOf(Fences()->base_max_size_, low_fence, high_fence));                  // 最大大小随前缀变化
+  }
+  SetSize(0);
+  for (int i = 0; i < count; ++i) {
+    InsertLast(entries[i].first, entries[i].second);  // 插入数据
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::FreeBytes() const -> size_t {
+  size_t used = LEAF_PAGE_HEADER_SIZE + FENCE_HEADER_SIZE + GetSize() * (SlotSize() + sizeof(ValueType));  // 压缩后的大小
+  return BUSTUB_PAGE_SIZE - used;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::CompareAt(int index, const KeyType &key, const KeyComparator &keyComparator) const
+    -> int {
+  if constexpr (PREFIX_COMPRESSED) {
+    return memcmp(Slot(index), key.data_ + PrefixSize(), SlotSize());  // key在fence之间，前缀相同
+  }
+  return keyComparator(keys_[index], key);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveEntries(int dst, int src, int count) {
+  if (count <= 0) {
+    return;
+  }
+  memmove(Slot(dst), Slot(src), count * SlotSize());
+  memmove(static_cast<void *>(Values() + dst), Values() + src, count * sizeof(ValueType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyEntries(int dst, const BPlusTreeLeafPage *other, int src, int count) {
+  if (count <= 0) {
+    return;
+  }
+  memcpy(Slot(dst), other->Slot(src), count * SlotSize());
+  memcpy(static_cast<void *>(Values() + dst), other->Values() + src, count * sizeof(ValueType));
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(MappingType value, int index, const KeyComparator &keyComparator) -> bool {
-  if (index < GetSize() && keyComparator(value.first, array_[index].first) == 0) {  // 如果key相等
+  if (index < GetSize() && CompareAt(index, value.first, keyComparator) == 0) {  // 如果key相等
     return false;
   }
-  for (int i = GetSize() - 1; i >= index; --i) {
-    array_[i + 1] = array_[i];  // 移动数据
-  }
-  array_[index] = value;  // 插入数据
-  IncreaseSize(1);        // 增加大小
+  MoveEntries(index + 1, index, GetSize() - index);  // 移动数据
+  SetAt(index, value);                               // 插入数据
+  IncreaseSize(1);                                   // 增加大小
   return true;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &keyComparator) -> int {
-  int l = 0;
-  int r = GetSize();  // 左右指针
-  while (l < r) {
-    int mid = (l + r) / 2;
-    if (keyComparator(array_[mid].first, key) < 0) {
-      l = mid + 1;
-    } else {
-      r = mid;
+  // 第一个不小于key的位置
+  if constexpr (PREFIX_COMPRESSED) {
+    int l = 0;
+    int r = GetSize();  // 左右指针
+    while (l < r) {
+      int mid = (l + r) / 2;
+      if (CompareAt(mid, key, keyComparator) < 0) {
+        l = mid + 1;
+      } else {
+        r = mid;
+      }
     }
+    return l;
   }
-  return l;
+  return KeySearch<KeyType, KeyComparator>::LowerBound(keys_, 0, GetSize(), key, keyComparator);
 }
 
+/*
+ * Move the upper half into bother_page and return the separator to insert
+ * into the parent, the low fence of bother_page
+ */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::Split(Page *bother_page) -> void {
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::Split(Page *bother_page) -> KeyType {
   int mid = GetSize() / 2;                                                                         // 中间位置
   auto leaf_bother_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(bother_page->GetData());  // 转换为叶子节点
-  for (int i = mid, j = 0; i < GetMaxSize(); ++i, ++j) {
-    leaf_bother_page->array_[j] = array_[i];  // 移动数据
-    IncreaseSize(-1);                         // 减少大小
-    leaf_bother_page->IncreaseSize(1);        // 增加大小
+  KeyType separator = ShortestSeparator(KeyAt(mid - 1), KeyAt(mid));                               // 最短的分隔key
+  if constexpr (PREFIX_COMPRESSED) {
+    std::vector<MappingType> entries;  // 两边的fence都变窄，前缀可能变长，重新编码
+    entries.reserve(GetSize());
+    for (int i = 0; i < GetSize(); ++i) {
+      entries.push_back(GetAt(i));
+    }
+    leaf_bother_page->Rebuild(entries.data() + mid, GetSize() - mid, separator, GetHighFence());
+    Rebuild(entries.data(), mid, GetLowFence(), separator);
+  } else {
+    int count = GetSize() - mid;                         // 移动的数量
+    leaf_bother_page->CopyEntries(0, this, mid, count);  // 移动数据
+    IncreaseSize(-count);                                // 减少大小
+    leaf_bother_page->IncreaseSize(count);               // 增加大小
   }
   leaf_bother_page->next_page_id_ = next_page_id_;  // 设置下一个节点
+  leaf_bother_page->prev_page_id_ = GetPageId();    // 设置上一个节点，原下一个节点的由调用者设置
   SetNextPageId(bother_page->GetPageId());          // 设置下一个节点
+  return separator;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::Remove(const KeyType &key, int index, const KeyComparator &keyComparator) -> bool {
-  if (keyComparator(array_[index].first, key) != 0) {  // 如果key不相等
+  if (CompareAt(index, key, keyComparator) != 0) {  // 如果key不相等
     return false;
   }
-  for (int i = index; i < GetSize() - 1; ++i) {
-    array_[i] = array_[i + 1];  // 移动数据
-  }
-  IncreaseSize(-1);  // 减少大小
+  MoveEntries(index, index + 1, GetSize() - index - 1);  // 移动数据
+  IncreaseSize(-1);                                      // 减少大小
   return true;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::Delete(const KeyType &key, const KeyComparator &keyComparator) -> bool {
-  int index = KeyIndex(key, keyComparator);                           // 获取索引
-  if (index >= GetSize() || keyComparator(KeyAt(index), key) != 0) {  // 如果索引大于等于大小或者key不相等
+  int index = KeyIndex(key, keyComparator);                               // 获取索引
+  if (index >= GetSize() || CompareAt(index, key, keyComparator) != 0) {  // 如果索引大于等于大小或者key不相等
     return false;
   }
-  for (int i = index + 1; i < GetSize(); ++i) {  // 移动数据
-    array_[i - 1] = array_[i];                   // 移动数据
-  }
-  IncreaseSize(-1);  // 减少大小
+  MoveEntries(index, index + 1, GetSize() - index - 1);  // 移动数据
+  IncreaseSize(-1);                                      // 减少大小
   return true;
 }
 
+/*
+ * Append all entries of right_page, the merged page spans both fence ranges
+ * and must fit MaxSizeFor(GetLowFence(), right->GetHighFence())
+ */
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::Merge(Page *right_page, BufferPoolManager *buffer_pool_manager_) -> void {
   auto right = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(right_page->GetData());  // 转换为叶子节点
-  for (int i = GetSize(), j = 0; j < right->GetSize(); ++i, ++j) {
-    array_[i] = std::make_pair(right->KeyAt(j), right->ValueAt(j));  // 插入数据
-    IncreaseSize(1);                                                 // 增加大小
+  if constexpr (PREFIX_COMPRESSED) {
+    std::vector<MappingType> entries;  // 合并后fence变宽，前缀可能变短，重新编码
+    entries.reserve(GetSize() + right->GetSize());
+    for (int i = 0; i < GetSize(); ++i) {
+      entries.push_back(GetAt(i));
+    }
+    for (int i = 0; i < right->GetSize(); ++i) {
+      entries.push_back(right->GetAt(i));
+    }
+    Rebuild(entries.data(), static_cast<int>(entries.size()), GetLowFence(), right->GetHighFence());
+  } else {
+    CopyEntries(GetSize(), right, 0, right->GetSize());  // 插入数据
+    IncreaseSize(right->GetSize());                      // 增加大小
   }
-  right->SetSize(0);                                               // 设置大小
-  buffer_pool_manager_->UnpinPage(right_page->GetPageId(), true);  // 释放
-  buffer_pool_manager_->DeletePage(right_page->GetPageId());       // 删除
+  right->SetSize(0);  // 设置大小，右节点由调用者释放并删除
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::InsertFirst(const KeyType &key, const ValueType &value) -> void {
-  for (int i = GetSize(); i > 0; --i) {
-    array_[i] = array_[i - 1];  // 移动数据
-  }
-  array_[0] = std::make_pair(key, value);  // 插入数据
-  IncreaseSize(1);                         // 增加大小
+  MoveEntries(1, 0, GetSize());  // 移动数据
+  SetKeyAt(0, key);              // 插入数据
+  SetValueAt(0, value);          // 插入数据
+  IncreaseSize(1);               // 增加大小
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::InsertLast(const KeyType &key, const ValueType &value) -> void {
-  array_[GetSize()] = std::make_pair(key, value);  // 插入数据
-  IncreaseSize(1);                                 // 增加大小
+  SetKeyAt(GetSize(), key);      // 插入数据
+  SetValueAt(GetSize(), value);  // 插入数据
+  IncreaseSize(1);               // 增加大小
 }
 
 template class BPlusTreeLeafPage<GenericKey<4>, RID, GenericComparator<4>>;
@@ -180,4 +377,9 @@ template class BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeLeafPage<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTreeLeafPage<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTreeLeafPage<GenericKey<64>, RID, GenericComparator<64>>;
+template class BPlusTreeLeafPage<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class BPlusTreeLeafPage<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class BPlusTreeLeafPage<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class BPlusTreeLeafPage<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class BPlusTreeLeafPage<NormalizedKey<64>, RID, NormalizedComparator<64>>;
 }  // namespace bustub
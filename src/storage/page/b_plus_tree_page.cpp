@@ -23,11 +23,17 @@ void BPlusTreePage::SetPageType(IndexPageType page_type) { page_type_ = page_typ
 
 /*
  * Helper methods to get/set size (number of key/value pairs stored in that
- * page)
+ * page), entries only move when the size changes, so both bump the version
  */
 auto BPlusTreePage::GetSize() const -> int { return size_; }
-void BPlusTreePage::SetSize(int size) { size_ = size; }
-void BPlusTreePage::IncreaseSize(int amount) { size_ += amount; }
+void BPlusTreePage::SetSize(int size) {
+  size_ = size;
+  BumpVersion();
+}
+void BPlusTreePage::IncreaseSize(int amount) {
+  size_ += amount;
+  BumpVersion();
+}
 
 /*
  * Helper methods to get/set max size (capacity) of the page
@@ -59,8 +65,10 @@ auto BPlusTreePage::GetPageId() const -> page_id_t { return page_id_; }
 void BPlusTreePage::SetPageId(page_id_t page_id) { page_id_ = page_id; }
 
 /*
- * Helper methods to set lsn
+ * Helper methods to set lsn and get the version kept in it
  */
 void BPlusTreePage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
+auto BPlusTreePage::GetVersion() const -> lsn_t { return lsn_; }
+void BPlusTreePage::BumpVersion() { lsn_ = static_cast<lsn_t>(static_cast<uint32_t>(lsn_) + 1); }  // 回绕而不溢出
 
 }  // namespace bustub
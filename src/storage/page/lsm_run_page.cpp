@@ -0,0 +1,55 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lsm_run_page.cpp
+//
+// Identification: src/storage/page/lsm_run_page.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "storage/page/lsm_run_page.h"
+
+namespace bustub {
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSM_RUN_PAGE_TYPE::Init() { size_ = 0; }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSM_RUN_PAGE_TYPE::GetSize() const -> int { return size_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSM_RUN_PAGE_TYPE::IsFull() const -> bool { return size_ == CAPACITY; }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSM_RUN_PAGE_TYPE::KeyAt(int index) const -> const KeyType & { return keys_[index]; }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSM_RUN_PAGE_TYPE::ValueAt(int index) const -> const ValueType & { return Values()[index]; }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto LSM_RUN_PAGE_TYPE::IsTombstone(int index) const -> bool { return Flags()[index]; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void LSM_RUN_PAGE_TYPE::Append(const KeyType &key, const ValueType &value, bool tombstone) {
+  BUSTUB_ASSERT(!IsFull(), "append to a full run page");
+  keys_[size_] = key;
+  Values()[size_] = value;
+  Flags()[size_] = tombstone;
+  size_++;
+}
+
+template class LSMRunPage<GenericKey<4>, RID, GenericComparator<4>>;
+template class LSMRunPage<GenericKey<8>, RID, GenericComparator<8>>;
+template class LSMRunPage<GenericKey<16>, RID, GenericComparator<16>>;
+template class LSMRunPage<GenericKey<32>, RID, GenericComparator<32>>;
+template class LSMRunPage<GenericKey<64>, RID, GenericComparator<64>>;
+template class LSMRunPage<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class LSMRunPage<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class LSMRunPage<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class LSMRunPage<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class LSMRunPage<NormalizedKey<64>, RID, NormalizedComparator<64>>;
+
+}  // namespace bustub
@@ -0,0 +1,45 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map.cpp
+//
+// Identification: src/storage/table/free_space_map.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/free_space_map.h"
+
+#include <algorithm>
+
+namespace bustub {
+
+FreeSpaceMap::FreeSpaceMap() : pages_(CATEGORIES) {}
+
+void FreeSpaceMap::Update(page_id_t page_id, uint32_t free_bytes) {
+  uint32_t category = std::min(free_bytes / UNIT, CATEGORIES - 1);
+  std::scoped_lock latch(latch_);
+  auto [it, inserted] = categories_.emplace(page_id, category);
+  if (!inserted) {
+    if (it->second == category) {
+      return;
+    }
+    pages_[it->second].erase(page_id);
+    it->second = category;
+  }
+  pages_[category].insert(page_id);
+}
+
+auto FreeSpaceMap::Find(uint32_t bytes) -> page_id_t {
+  // round up, every page of the category has room for the tuple
+  uint32_t category = (bytes + UNIT - 1) / UNIT;
+  std::scoped_lock latch(latch_);
+  for (; category < CATEGORIES; category++) {
+    if (!pages_[category].empty()) {
+      return *pages_[category].begin();
+    }
+  }
+  return INVALID_PAGE_ID;
+}
+
+}  // namespace bustub
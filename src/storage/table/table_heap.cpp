@@ -41,8 +41,32 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  std::call_once(free_space_map_loaded_, [this] { LoadFreeSpaceMap(); });
 
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+  // Insert into a page the free space map says has enough space. If the page filled up in the meantime, its free
+  // space is corrected in the map and we ask again.
+  uint32_t needed = TablePage::SpaceFor(tuple.size_);
+  for (auto page_id = free_space_map_.Find(needed); page_id != INVALID_PAGE_ID;
+       page_id = free_space_map_.Find(needed)) {
+    auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr) {
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    page->WLatch();
+    bool is_inserted = page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_);
+    free_space_map_.Update(page_id, page->GetFreeSpace());
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, is_inserted);
+    if (is_inserted) {
+      // Update the transaction's write set.
+      txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this);
+      return true;
+    }
+  }
+
+  // No page has room: append a new page after the last one.
+  auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(last_page_id_));
   if (cur_page == nullptr) {
     txn->SetState(TransactionState::ABORTED);
     return false;
@@ -50,38 +74,17 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
 
   cur_page->WLatch();
 
-  // Insert into the first page with enough space. If no such page exists, create a new page and insert into that.
+  // Pages appended since last_page_id_ was read may have room left, otherwise create a new page and insert into that.
   // INVARIANT: cur_page is WLatched if you leave the loop normally.
   while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_)) {
-    auto next_page_id = cur_page->GetNextPageId();
-    // If the next page is a valid page,
-    if (next_page_id != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id));
-      next_page->WLatch();
-      // Unlatch and unpin the current page.
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-    } else {
-      // Otherwise we have run out of valid pages. We need to create a new page.
-      auto new_page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(&next_page_id));
-      // If we could not create a new page,
-      if (new_page == nullptr) {
-        // Then life sucks and we abort the transaction.
-        cur_page->WUnlatch();
-        buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), false);
-        txn->SetState(TransactionState::ABORTED);
-        return false;
-      }
-      // Otherwise we were able to create a new page. We initialize it now.
-      new_page->WLatch();
-      cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, BUSTUB_PAGE_SIZE, cur_page->GetTablePageId(), log_manager_, txn);
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
-      cur_page = new_page;
+    cur_page = NextPage(cur_page, false, txn);
+    // If we could not create a new page, then life sucks and we abort the transaction.
+    if (cur_page == nullptr) {
+      txn->SetState(TransactionState::ABORTED);
+      return false;
     }
   }
+  free_space_map_.Update(cur_page->GetTablePageId(), cur_page->GetFreeSpace());
   // This line has caused most of us to double-take and "whoa double unlatch".
   // We are not, in fact, double unlatching. See the invariant above.
   cur_page->WUnlatch();
@@ -91,6 +94,113 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
   return true;
 }
 
+auto TableHeap::InsertTuples(const std::vector<Tuple> &tuples, std::vector<RID> *rids, Transaction *txn) -> bool {
+  for (const auto &tuple : tuples) {
+    if (tuple.size_ + 32 > BUSTUB_PAGE_SIZE) {  // larger than one page size
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+  }
+  std::call_once(free_space_map_loaded_, [this] { LoadFreeSpaceMap(); });
+  rids->clear();
+  rids->reserve(tuples.size());
+
+  // Fill the pages the free space map says have room for the next tuple first.
+  bool failed = false;
+  while (rids->size() < tuples.size()) {
+    auto page_id = free_space_map_.Find(TablePage::SpaceFor(tuples[rids->size()].size_));
+    if (page_id == INVALID_PAGE_ID) {
+      break;
+    }
+    auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr) {
+      failed = true;
+      break;
+    }
+    page->WLatch();
+    size_t inserted = page->InsertTuples(tuples, rids->size(), rids, txn, log_manager_);
+    free_space_map_.Update(page_id, page->GetFreeSpace());
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, inserted > 0);
+  }
+
+  // Then append pages after the last one for the rest.
+  if (!failed && rids->size() < tuples.size()) {
+    auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(last_page_id_));
+    failed = cur_page == nullptr;
+    if (cur_page != nullptr) {
+      cur_page->WLatch();
+    }
+    while (cur_page != nullptr) {
+      size_t inserted = cur_page->InsertTuples(tuples, rids->size(), rids, txn, log_manager_);
+      free_space_map_.Update(cur_page->GetTablePageId(), cur_page->GetFreeSpace());
+      if (rids->size() == tuples.size()) {
+        cur_page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
+        break;
+      }
+      cur_page = NextPage(cur_page, inserted > 0, txn);
+      failed = cur_page == nullptr;
+    }
+  }
+
+  // Update the transaction's write set, also for the tuples inserted before a failure so that the abort removes them.
+  for (const auto &rid : *rids) {
+    txn->GetWriteSet()->emplace_back(rid, WType::INSERT, Tuple{}, this);
+  }
+  if (failed) {
+    txn->SetState(TransactionState::ABORTED);
+  }
+  return !failed;
+}
+
+auto TableHeap::NextPage(TablePage *cur_page, bool is_dirty, Transaction *txn) -> TablePage * {
+  auto next_page_id = cur_page->GetNextPageId();
+  // If the next page is a valid page,
+  if (next_page_id != INVALID_PAGE_ID) {
+    auto next_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id));
+    if (next_page != nullptr) {
+      next_page->WLatch();
+    }
+    // Unlatch and unpin the current page.
+    cur_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), is_dirty);
+    return next_page;
+  }
+  // Otherwise we have run out of valid pages. We need to create a new page.
+  auto new_page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(&next_page_id));
+  if (new_page == nullptr) {
+    cur_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), is_dirty);
+    return nullptr;
+  }
+  // Otherwise we were able to create a new page. We initialize it now.
+  new_page->WLatch();
+  cur_page->SetNextPageId(next_page_id);
+  new_page->Init(next_page_id, BUSTUB_PAGE_SIZE, cur_page->GetTablePageId(), log_manager_, txn);
+  last_page_id_ = next_page_id;
+  cur_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
+  return new_page;
+}
+
+void TableHeap::LoadFreeSpaceMap() {
+  auto page_id = first_page_id_;
+  while (true) {
+    auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    page->RLatch();
+    free_space_map_.Update(page_id, page->GetFreeSpace());
+    auto next_page_id = page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    if (next_page_id == INVALID_PAGE_ID) {
+      break;
+    }
+    page_id = next_page_id;
+  }
+  last_page_id_ = page_id;
+}
+
 auto TableHeap::MarkDelete(const RID &rid, Transaction *txn) -> bool {
   // TODO(Amadou): remove empty page
   // Find the page which contains the tuple.
@@ -122,6 +232,7 @@ auto TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
   Tuple old_tuple;
   page->WLatch();
   bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  free_space_map_.Update(rid.GetPageId(), page->GetFreeSpace());
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
   // Update the transaction's write set.
@@ -138,6 +249,7 @@ void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   // Delete the tuple from the page.
   page->WLatch();
   page->ApplyDelete(rid, txn, log_manager_);
+  free_space_map_.Update(rid.GetPageId(), page->GetFreeSpace());
   /** Commented out to make compatible with p4; This is called only on commit or delete, which consequently unlocks the
    * tuple; so should be fine */
   // lock_manager_->Unlock(txn, rid);
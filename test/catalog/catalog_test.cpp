@@ -10,15 +10,21 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <chrono>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
 #include <unordered_set>
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "catalog/catalog.h"
 #include "catalog/table_generator.h"
+#include "common/bustub_instance.h"
+#include "common/logger.h"
 #include "execution/executor_context.h"
 #include "gtest/gtest.h"
+#include "storage/page/header_page.h"
 #include "type/value_factory.h"
 
 namespace bustub {
@@ -688,4 +694,1031 @@ TEST(CatalogTest, DISABLED_IndexInteraction3) {
   remove("catalog_test.log");
 }
 
+TEST(CatalogTest, RebuildIndexesTest) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(256, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+
+  // The B+ tree stores its root in the header page
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  const std::string table_name{"foobar"};
+  std::vector<Column> columns{{"A", TypeId::INTEGER}, {"B", TypeId::INTEGER}};
+  Schema table_schema{columns};
+  auto *table_info = catalog->CreateTable(txn.get(), table_name, table_schema);
+  ASSERT_NE(Catalog::NULL_TABLE_INFO, table_info);
+
+  // Both indexes are created on the empty table, so only the rebuild populates them
+  Schema a_schema{std::vector<Column>{{"A", TypeId::INTEGER}}};
+  Schema b_schema{std::vector<Column>{{"B", TypeId::INTEGER}}};
+  auto *a_index = catalog->CreateIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>(
+      txn.get(), "a_index", table_name, table_schema, a_schema, {0}, 4, IntegerHashFunctionType{});
+  auto *b_index = catalog->CreateIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>(
+      txn.get(), "b_index", table_name, table_schema, b_schema, {1}, 4, IntegerHashFunctionType{});
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, a_index);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, b_index);
+
+  // A is a permutation of [0, n), B repeats every 100 rows
+  const int n = 10000;
+  std::vector<int> a_values(n);
+  for (int i = 0; i < n; i++) {
+    a_values[i] = (i * 7919) % n;
+  }
+  std::vector<RID> rids(n);
+  for (int i = 0; i < n; i++) {
+    Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(a_values[i]), ValueFactory::GetIntegerValue(i % 100)},
+                &table_schema};
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rids[i], txn.get()));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(n, catalog->RebuildIndexes(txn.get(), table_name));
+  auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  LOG_INFO("Rebuilt 2 indexes over %d rows in %.2f ms", n, elapsed);
+
+  // Every key of A points at its row, and the index iterates in key order
+  std::vector<RID> result;
+  for (int i = 0; i < n; i++) {
+    Tuple key{std::vector<Value>{ValueFactory::GetIntegerValue(a_values[i])}, &a_schema};
+    result.clear();
+    a_index->index_->ScanKey(key, &result, txn.get());
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(rids[i], result[0]);
+  }
+  auto *a_tree = dynamic_cast<BPlusTreeIndexForOneIntegerColumn *>(a_index->index_.get());
+  int expected = 0;
+  for (auto it = a_tree->GetBeginIterator(); it != a_tree->GetEndIterator(); ++it) {
+    EXPECT_EQ(expected, (*it).first.ToString());
+    expected++;
+  }
+  EXPECT_EQ(n, expected);
+
+  // B only supports unique keys, so each key keeps the first row in scan order
+  for (int i = 0; i < 100; i++) {
+    Tuple key{std::vector<Value>{ValueFactory::GetIntegerValue(i)}, &b_schema};
+    result.clear();
+    b_index->index_->ScanKey(key, &result, txn.get());
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(rids[i], result[0]);
+  }
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, IndexStatsTableTest) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+
+  // The B+ tree stores its root in the header page
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  Schema table_schema{std::vector<Column>{{"A", TypeId::INTEGER}}};
+  auto *table_info = catalog->CreateTable(txn.get(), "foo", table_schema);
+  ASSERT_NE(Catalog::NULL_TABLE_INFO, table_info);
+  const int n = 5000;
+  for (int i = 0; i < n; i++) {
+    RID rid;
+    Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i)}, &table_schema};
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rid, txn.get()));
+  }
+  Schema a_schema = Schema::CopySchema(&table_schema, {0});
+  auto *index_info = catalog->CreateBPlusTreeIndex(txn.get(), "foo_a", "foo", table_schema, a_schema, {0});
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+
+  auto read_rows = [&]() {
+    auto *stats_info = catalog->RefreshIndexStats(txn.get());
+    EXPECT_NE(Catalog::NULL_TABLE_INFO, stats_info);
+    EXPECT_EQ(stats_info, catalog->GetTable(Catalog::INDEX_STATS_TABLE));
+    std::vector<Tuple> rows;
+    for (auto row = stats_info->table_->Begin(txn.get()); row != stats_info->table_->End(); ++row) {
+      rows.push_back(*row);
+    }
+    return rows;
+  };
+  const auto *schema = &Catalog::INDEX_STATS_SCHEMA;
+
+  // One row per index, matching what the tree reports
+  auto rows = read_rows();
+  ASSERT_EQ(1, rows.size());
+  auto stats = index_info->index_->GetTreeStats();
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(index_info->index_oid_, rows[0].GetValue(schema, 0).GetAs<int32_t>());
+  EXPECT_EQ("foo", rows[0].GetValue(schema, 1).ToString());
+  EXPECT_EQ("foo_a", rows[0].GetValue(schema, 2).ToString());
+  EXPECT_EQ(stats->height_, rows[0].GetValue(schema, 3).GetAs<int32_t>());
+  EXPECT_EQ(stats->PageCount(), rows[0].GetValue(schema, 5).GetAs<int64_t>());
+  EXPECT_EQ(n, rows[0].GetValue(schema, 6).GetAs<int64_t>());
+  EXPECT_DOUBLE_EQ(stats->leaf_fill_avg_, rows[0].GetValue(schema, 7).GetAs<double>());
+  EXPECT_DOUBLE_EQ(1, rows[0].GetValue(schema, 12).GetAs<double>());
+
+  // Refreshing replaces the rows
+  for (int i = 0; i < n; i += 2) {
+    Tuple key{std::vector<Value>{ValueFactory::GetIntegerValue(i)}, &a_schema};
+    index_info->index_->DeleteEntry(key, RID(), txn.get());
+  }
+  rows = read_rows();
+  ASSERT_EQ(1, rows.size());
+  EXPECT_EQ(n / 2, rows[0].GetValue(schema, 6).GetAs<int64_t>());
+  EXPECT_LT(rows[0].GetValue(schema, 7).GetAs<double>(), stats->leaf_fill_avg_);
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, CreateIndexOnPopulatedTableTest) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(256, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+
+  // The B+ tree stores its root in the header page
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  const std::string table_name{"foobar"};
+  std::vector<Column> columns{{"A", TypeId::INTEGER}};
+  Schema table_schema{columns};
+  auto *table_info = catalog->CreateTable(txn.get(), table_name, table_schema);
+  ASSERT_NE(Catalog::NULL_TABLE_INFO, table_info);
+
+  // Rows go in descending order, the index is built from them in one bulk load
+  const int n = 10000;
+  std::vector<RID> rids(n);
+  for (int i = n - 1; i >= 0; i--) {
+    Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i)}, &table_schema};
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rids[i], txn.get()));
+  }
+  auto *index_info = catalog->CreateIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>(
+      txn.get(), "a_index", table_name, table_schema, table_schema, {0}, 4, IntegerHashFunctionType{}, 0.7);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+
+  auto *tree = dynamic_cast<BPlusTreeIndexForOneIntegerColumn *>(index_info->index_.get());
+  int expected = 0;
+  for (auto it = tree->GetBeginIterator(); it != tree->GetEndIterator(); ++it) {
+    EXPECT_EQ(expected, (*it).first.ToString());
+    EXPECT_EQ(rids[expected], (*it).second);
+    expected++;
+  }
+  EXPECT_EQ(n, expected);
+
+  // The loaded index keeps taking regular inserts
+  Tuple key{std::vector<Value>{ValueFactory::GetIntegerValue(n)}, &table_schema};
+  index_info->index_->InsertEntry(key, RID(1, 1), txn.get());
+  std::vector<RID> result;
+  index_info->index_->ScanKey(key, &result, txn.get());
+  ASSERT_EQ(1, result.size());
+  EXPECT_EQ(RID(1, 1), result[0]);
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, PersistentCatalogTest) {
+  remove("catalog_test.db");
+  const int n = 100;
+  std::vector<RID> rids(2 * n);
+  table_oid_t foo_oid;
+  table_oid_t bar_oid;
+  index_oid_t index_oid;
+  page_id_t old_root_id;
+  {
+    // A session that ends with a clean shutdown, which writes back its pages
+    auto bustub = std::make_unique<BustubInstance>("catalog_test.db");
+    auto *bpm = bustub->buffer_pool_manager_;
+    auto *catalog = bustub->catalog_;
+    auto txn = std::make_unique<Transaction>(0);
+
+    Schema foo_schema{std::vector<Column>{{"A", TypeId::INTEGER}, {"B", TypeId::VARCHAR, 16}}};
+    auto *foo = catalog->CreateTable(txn.get(), "foo", foo_schema);
+    ASSERT_NE(Catalog::NULL_TABLE_INFO, foo);
+    foo_oid = foo->oid_;
+    for (int i = 0; i < n; i++) {
+      Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue("row")},
+                  &foo_schema};
+      ASSERT_TRUE(foo->table_->InsertTuple(tuple, &rids[i], txn.get()));
+    }
+    Schema key_schema{std::vector<Column>{{"A", TypeId::INTEGER}}};
+    auto *index = catalog->CreateIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>(
+        txn.get(), "foo_a", "foo", foo_schema, key_schema, {0}, INTEGER_SIZE, IntegerHashFunctionType{});
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, index);
+    index_oid = index->index_oid_;
+    // Rows only the heap knows of, like rows recovery replayed: index pages are not covered by the log
+    for (int i = n; i < 2 * n; i++) {
+      Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue("row")},
+                  &foo_schema};
+      ASSERT_TRUE(foo->table_->InsertTuple(tuple, &rids[i], txn.get()));
+    }
+
+    Schema bar_schema{std::vector<Column>{{"C", TypeId::BIGINT}}};
+    auto *bar = catalog->CreateTable(txn.get(), "bar", bar_schema);
+    ASSERT_NE(Catalog::NULL_TABLE_INFO, bar);
+    bar_oid = bar->oid_;
+
+    auto *header_page = reinterpret_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+    ASSERT_TRUE(header_page->GetRootId("__index_" + std::to_string(index_oid), &old_root_id));
+    bpm->UnpinPage(HEADER_PAGE_ID, false);
+  }
+
+  // Reopen the database, tables are only loaded when they are referenced
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+  auto txn = std::make_unique<Transaction>(1);
+
+  auto names = catalog->GetTableNames();
+  std::unordered_set<std::string> name_set(names.begin(), names.end());
+  EXPECT_EQ((std::unordered_set<std::string>{"foo", "bar"}), name_set);
+  EXPECT_EQ(Catalog::NULL_TABLE_INFO, catalog->GetTable("missing"));
+  EXPECT_EQ(Catalog::NULL_INDEX_INFO, catalog->GetIndex(index_oid + 1000));
+  // The name of a table is taken before the table is loaded
+  Schema other_schema{std::vector<Column>{{"A", TypeId::INTEGER}}};
+  EXPECT_EQ(Catalog::NULL_TABLE_INFO, catalog->CreateTable(txn.get(), "foo", other_schema));
+
+  // Concurrent first references load each table once
+  std::vector<TableInfo *> loaded(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < loaded.size(); i++) {
+    threads.emplace_back([&, i] { loaded[i] = i % 2 == 0 ? catalog->GetTable("foo") : catalog->GetTable(bar_oid); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (size_t i = 2; i < loaded.size(); i++) {
+    EXPECT_EQ(loaded[i % 2], loaded[i]);
+  }
+
+  auto *bar = catalog->GetTable(bar_oid);
+  EXPECT_EQ(loaded[1], bar);
+  ASSERT_NE(Catalog::NULL_TABLE_INFO, bar);
+  EXPECT_EQ("bar", bar->name_);
+  EXPECT_EQ(TypeId::BIGINT, bar->schema_.GetColumn(0).GetType());
+
+  auto *foo = catalog->GetTable("foo");
+  ASSERT_NE(Catalog::NULL_TABLE_INFO, foo);
+  EXPECT_EQ(foo_oid, foo->oid_);
+  ASSERT_EQ(2, foo->schema_.GetColumnCount());
+  EXPECT_EQ("B", foo->schema_.GetColumn(1).GetName());
+  EXPECT_EQ(TypeId::VARCHAR, foo->schema_.GetColumn(1).GetType());
+  EXPECT_EQ(16, foo->schema_.GetColumn(1).GetLength());
+
+  // The index comes back with its table, rebuilt from the heap
+  auto *index = catalog->GetIndex(index_oid);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index);
+  EXPECT_EQ(index, catalog->GetIndex("foo_a", "foo"));
+  EXPECT_EQ(1, catalog->GetTableIndexes("foo").size());
+  std::vector<RID> result;
+  for (int i = 0; i < 2 * n; i++) {
+    Tuple key{std::vector<Value>{ValueFactory::GetIntegerValue(i)}, &index->key_schema_};
+    result.clear();
+    index->index_->ScanKey(key, &result, txn.get());
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(rids[i], result[0]);
+  }
+  // The tree left behind was freed, and the header page now records the rebuilt one
+  page_id_t root_id;
+  auto *header_page = reinterpret_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  ASSERT_TRUE(header_page->GetRootId("__index_" + std::to_string(index_oid), &root_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  EXPECT_NE(old_root_id, root_id);
+  Tuple tuple;
+  ASSERT_TRUE(foo->table_->GetTuple(rids[n - 1], &tuple, txn.get()));
+  EXPECT_EQ(n - 1, tuple.GetValue(&foo->schema_, 0).GetAs<int32_t>());
+
+  // OIDs continue where the earlier instance stopped, and existing names are still taken
+  EXPECT_EQ(Catalog::NULL_TABLE_INFO, catalog->CreateTable(txn.get(), "foo", bar->schema_));
+  auto *baz = catalog->CreateTable(txn.get(), "baz", bar->schema_);
+  ASSERT_NE(Catalog::NULL_TABLE_INFO, baz);
+  EXPECT_EQ(std::max(foo_oid, bar_oid) + 1, baz->oid_);
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, PersistentSameIndexNameTest) {
+  remove("catalog_test.db");
+  const int n = 100;
+  Schema schema{std::vector<Column>{{"A", TypeId::INTEGER}}};
+  Schema key_schema = Schema::CopySchema(&schema, {0});
+  {
+    auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+    auto txn = std::make_unique<Transaction>(0);
+    page_id_t header_page_id;
+    auto *header_page = reinterpret_cast<HeaderPage *>(bpm->NewPage(&header_page_id));
+    ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+    header_page->Init();
+    bpm->UnpinPage(header_page_id, true);
+
+    // Index names are only unique within a table
+    auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+    for (const std::string table_name : {"foo", "bar"}) {
+      auto *table = catalog->CreateTable(txn.get(), table_name, schema);
+      ASSERT_NE(Catalog::NULL_TABLE_INFO, table);
+      RID rid;
+      for (int i = 0; i < n; i++) {
+        Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i)}, &schema};
+        ASSERT_TRUE(table->table_->InsertTuple(tuple, &rid, txn.get()));
+      }
+      ASSERT_NE(Catalog::NULL_INDEX_INFO,
+                catalog->CreateBPlusTreeIndex(txn.get(), "idx", table_name, schema, key_schema, {0}));
+    }
+    bpm->FlushAllPages();
+  }
+
+  // Loading bar frees the tree bar's index left behind and records its own, foo's rebuilt tree stays recorded
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+  auto txn = std::make_unique<Transaction>(1);
+  auto *foo_index = catalog->GetIndex("idx", "foo");
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, foo_index);
+  auto *bar_index = catalog->GetIndex("idx", "bar");
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, bar_index);
+  for (auto *index : {foo_index, bar_index}) {
+    std::vector<RID> result;
+    for (int i = 0; i < n; i++) {
+      Tuple key{std::vector<Value>{ValueFactory::GetIntegerValue(i)}, &index->key_schema_};
+      result.clear();
+      index->index_->ScanKey(key, &result, txn.get());
+      EXPECT_EQ(1, result.size()) << index->table_name_ << " " << i;
+    }
+  }
+  page_id_t foo_root_id;
+  page_id_t bar_root_id;
+  auto *header_page = reinterpret_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  ASSERT_TRUE(header_page->GetRootId("__index_" + std::to_string(foo_index->index_oid_), &foo_root_id));
+  ASSERT_TRUE(header_page->GetRootId("__index_" + std::to_string(bar_index->index_oid_), &bar_root_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  EXPECT_NE(INVALID_PAGE_ID, foo_root_id);
+  EXPECT_NE(INVALID_PAGE_ID, bar_root_id);
+  EXPECT_NE(foo_root_id, bar_root_id);
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, PersistentIndexStatsTest) {
+  remove("catalog_test.db");
+  page_id_t stats_page_id = INVALID_PAGE_ID;
+  // Every start refreshes the statistics into the heap the first one created
+  for (int start = 0; start < 3; start++) {
+    auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+    auto txn = std::make_unique<Transaction>(start);
+    if (start == 0) {
+      page_id_t header_page_id;
+      auto *header_page = reinterpret_cast<HeaderPage *>(bpm->NewPage(&header_page_id));
+      ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+      header_page->Init();
+      bpm->UnpinPage(header_page_id, true);
+    }
+    auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+    if (start == 0) {
+      Schema schema{std::vector<Column>{{"A", TypeId::INTEGER}}};
+      ASSERT_NE(Catalog::NULL_TABLE_INFO, catalog->CreateTable(txn.get(), "foo", schema));
+      Schema key_schema = Schema::CopySchema(&schema, {0});
+      ASSERT_NE(Catalog::NULL_INDEX_INFO,
+                catalog->CreateBPlusTreeIndex(txn.get(), "foo_a", "foo", schema, key_schema, {0}));
+    }
+
+    auto *stats_info = catalog->RefreshIndexStats(txn.get());
+    ASSERT_NE(Catalog::NULL_TABLE_INFO, stats_info);
+    if (start == 0) {
+      stats_page_id = stats_info->table_->GetFirstPageId();
+    }
+    EXPECT_EQ(stats_page_id, stats_info->table_->GetFirstPageId());
+    size_t rows = 0;
+    for (auto row = stats_info->table_->Begin(txn.get()); row != stats_info->table_->End(); ++row) {
+      rows++;
+    }
+    EXPECT_EQ(1, rows);
+    bpm->FlushAllPages();
+  }
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, NonUniqueIndexTest) {
+  remove("catalog_test.db");
+  const int n = 1000;
+  std::vector<RID> rids(n);
+  // RIDs of the rows with B = key, in heap order
+  auto rids_of = [&](int key) {
+    std::vector<RID> expected;
+    for (int i = key; i < n; i += 10) {
+      expected.push_back(rids[i]);
+    }
+    std::sort(expected.begin(), expected.end(), [](const RID &a, const RID &b) { return a.Get() < b.Get(); });
+    return expected;
+  };
+  Schema key_schema{std::vector<Column>{{"B", TypeId::INTEGER}}};
+  {
+    auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+    auto txn = std::make_unique<Transaction>(0);
+
+    page_id_t header_page_id;
+    auto *header_page = reinterpret_cast<HeaderPage *>(bpm->NewPage(&header_page_id));
+    ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+    header_page->Init();
+    bpm->UnpinPage(header_page_id, true);
+
+    // B only takes 10 values, every key has 100 rows
+    auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+    Schema foo_schema{std::vector<Column>{{"A", TypeId::INTEGER}, {"B", TypeId::INTEGER}}};
+    auto *foo = catalog->CreateTable(txn.get(), "foo", foo_schema);
+    ASSERT_NE(Catalog::NULL_TABLE_INFO, foo);
+    for (int i = 0; i < n; i++) {
+      Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(i % 10)},
+                  &foo_schema};
+      ASSERT_TRUE(foo->table_->InsertTuple(tuple, &rids[i], txn.get()));
+    }
+    auto *normalized = catalog->CreateIndex<IntegerRidKeyType, IntegerValueType, IntegerRidComparatorType>(
+        txn.get(), "foo_b", "foo", foo_schema, key_schema, {1}, INTEGER_SIZE, IntegerRidHashFunctionType{},
+        INDEX_FILL_FACTOR, false);
+    auto *generic = catalog->CreateIndex<GenericKey<16>, RID, GenericComparator<16>>(
+        txn.get(), "foo_b_generic", "foo", foo_schema, key_schema, {1}, INTEGER_SIZE, HashFunction<GenericKey<16>>{},
+        INDEX_FILL_FACTOR, false);
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, normalized);
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, generic);
+    EXPECT_FALSE(normalized->index_->GetMetadata()->IsUnique());
+
+    // every row is found through its key, in heap order
+    std::vector<RID> result;
+    for (auto *index_info : {normalized, generic}) {
+      for (int key = 0; key < 10; key++) {
+        Tuple key_tuple{std::vector<Value>{ValueFactory::GetIntegerValue(key)}, &key_schema};
+        result.clear();
+        index_info->index_->ScanKey(key_tuple, &result, txn.get());
+        EXPECT_EQ(rids_of(key), result) << index_info->name_ << " key " << key;
+      }
+    }
+
+    // a batch of unsorted keys, a missing and a repeated one included, finds the same rows
+    std::vector<Tuple> batch;
+    for (int key : {7, 2, 10, 2, 0, 9}) {
+      batch.emplace_back(std::vector<Value>{ValueFactory::GetIntegerValue(key)}, &key_schema);
+    }
+    for (auto *index_info : {normalized, generic}) {
+      std::vector<std::vector<RID>> results;
+      index_info->index_->ScanKeys(batch, &results, txn.get());
+      ASSERT_EQ(batch.size(), results.size());
+      EXPECT_EQ(rids_of(7), results[0]) << index_info->name_;
+      EXPECT_EQ(rids_of(2), results[1]) << index_info->name_;
+      EXPECT_TRUE(results[2].empty()) << index_info->name_;
+      EXPECT_EQ(rids_of(2), results[3]) << index_info->name_;
+      EXPECT_EQ(rids_of(0), results[4]) << index_info->name_;
+      EXPECT_EQ(rids_of(9), results[5]) << index_info->name_;
+    }
+
+    // deleting an entry only removes its RID, and a key can be inserted again for a new row
+    Tuple key_tuple{std::vector<Value>{ValueFactory::GetIntegerValue(3)}, &key_schema};
+    for (auto *index_info : {normalized, generic}) {
+      index_info->index_->DeleteEntry(key_tuple, rids[503], txn.get());
+      result.clear();
+      index_info->index_->ScanKey(key_tuple, &result, txn.get());
+      EXPECT_EQ(99, result.size());
+      EXPECT_EQ(result.end(), std::find(result.begin(), result.end(), rids[503]));
+      index_info->index_->InsertEntry(key_tuple, rids[503], txn.get());
+    }
+    Tuple missing{std::vector<Value>{ValueFactory::GetIntegerValue(10)}, &key_schema};
+    result.clear();
+    normalized->index_->ScanKey(missing, &result, txn.get());
+    EXPECT_TRUE(result.empty());
+
+    bpm->FlushAllPages();
+  }
+
+  // the index comes back as a non-unique one
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+  auto txn = std::make_unique<Transaction>(1);
+  for (const auto *name : {"foo_b", "foo_b_generic"}) {
+    auto *index_info = catalog->GetIndex(name, "foo");
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+    EXPECT_FALSE(index_info->index_->GetMetadata()->IsUnique());
+    std::vector<RID> result;
+    for (int key = 0; key < 10; key++) {
+      Tuple key_tuple{std::vector<Value>{ValueFactory::GetIntegerValue(key)}, &key_schema};
+      result.clear();
+      index_info->index_->ScanKey(key_tuple, &result, txn.get());
+      EXPECT_EQ(rids_of(key), result) << name << " key " << key;
+    }
+  }
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, CompositeIndexTest) {
+  remove("catalog_test.db");
+  const int n = 600;
+  std::vector<RID> rids(n);
+  // ids share a 60 character run after a group number, so an inline prefix only tells the groups apart
+  auto id_of = [](int i) { return fmt::format("{:04}-{}-{}", i / 10, std::string(60, 'x'), i); };
+  auto sorted = [](std::vector<RID> expected) {
+    std::sort(expected.begin(), expected.end(), [](const RID &a, const RID &b) { return a.Get() < b.Get(); });
+    return expected;
+  };
+  Schema foo_schema{std::vector<Column>{
+      {"tenant_id", TypeId::INTEGER}, {"ts", TypeId::BIGINT}, {"id", TypeId::VARCHAR, 100}}};
+  Schema tenant_ts_schema = Schema::CopySchema(&foo_schema, {0, 1});
+  Schema id_schema = Schema::CopySchema(&foo_schema, {2});
+  auto id_key = [&](int i) {
+    return Tuple{std::vector<Value>{ValueFactory::GetVarcharValue(id_of(i))}, &id_schema};
+  };
+  {
+    auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+    auto txn = std::make_unique<Transaction>(0);
+
+    page_id_t header_page_id;
+    auto *header_page = reinterpret_cast<HeaderPage *>(bpm->NewPage(&header_page_id));
+    ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+    header_page->Init();
+    bpm->UnpinPage(header_page_id, true);
+
+    auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+    auto *foo = catalog->CreateTable(txn.get(), "foo", foo_schema);
+    ASSERT_NE(Catalog::NULL_TABLE_INFO, foo);
+    for (int i = 0; i < n; i++) {
+      Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i % 6), ValueFactory::GetBigIntValue(i),
+                                     ValueFactory::GetVarcharValue(id_of(i))},
+                  &foo_schema};
+      ASSERT_TRUE(foo->table_->InsertTuple(tuple, &rids[i], txn.get()));
+    }
+
+    // the key size follows from the columns: 4 + 8 bytes fit into 16, the ids only fit as a prefix of 64 bytes,
+    // which cannot tell duplicates apart
+    auto *tenant_ts = catalog->CreateBPlusTreeIndex(txn.get(), "foo_tenant_ts", "foo", foo_schema,
+                                                    tenant_ts_schema, {0, 1});
+    EXPECT_THROW(catalog->CreateBPlusTreeIndex(txn.get(), "foo_id", "foo", foo_schema, id_schema, {2}),
+                 NotImplementedException);
+    auto *id = catalog->CreateBPlusTreeIndex(txn.get(), "foo_id", "foo", foo_schema, id_schema, {2},
+                                             INDEX_FILL_FACTOR, false);
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, tenant_ts);
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, id);
+    EXPECT_EQ(16, tenant_ts->key_size_);
+    EXPECT_FALSE(tenant_ts->index_->IsLossy());
+    EXPECT_EQ(64, id->key_size_);
+    EXPECT_TRUE(id->index_->IsLossy());
+
+    // a full key finds its row, a prefix finds the rows of the tenant in ts order
+    std::vector<RID> result;
+    Tuple key_tuple{std::vector<Value>{ValueFactory::GetIntegerValue(2), ValueFactory::GetBigIntValue(8)},
+                    &tenant_ts_schema};
+    tenant_ts->index_->ScanKey(key_tuple, &result, txn.get());
+    EXPECT_EQ(std::vector<RID>{rids[8]}, result);
+    result.clear();
+    tenant_ts->index_->ScanKeyPrefix({ValueFactory::GetIntegerValue(2)}, &result, txn.get());
+    std::vector<RID> expected;
+    for (int i = 2; i < n; i += 6) {
+      expected.push_back(rids[i]);
+    }
+    EXPECT_EQ(expected, result);
+
+    // a lossy lookup returns the group sharing the prefix, none of the rows is lost as a duplicate
+    for (int i : {0, 57, 599}) {
+      result.clear();
+      id->index_->ScanKey(id_key(i), &result, txn.get());
+      EXPECT_EQ(sorted({rids.begin() + i / 10 * 10, rids.begin() + i / 10 * 10 + 10}), result) << id_of(i);
+    }
+
+    bpm->FlushAllPages();
+  }
+
+  // reopened, the index gets the same key size and is lossy again
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+  auto txn = std::make_unique<Transaction>(1);
+  auto *id = catalog->GetIndex("foo_id", "foo");
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, id);
+  EXPECT_TRUE(id->index_->IsLossy());
+  std::vector<RID> result;
+  id->index_->ScanKey(id_key(123), &result, txn.get());
+  EXPECT_EQ(sorted({rids.begin() + 120, rids.begin() + 130}), result);
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, CoveringIndexTest) {
+  remove("catalog_test.db");
+  const int n = 300;
+  std::vector<RID> rids(n);
+  Schema foo_schema{std::vector<Column>{{"id", TypeId::INTEGER},
+                                        {"name", TypeId::VARCHAR, 12},
+                                        {"score", TypeId::DECIMAL},
+                                        {"note", TypeId::VARCHAR, 100}}};
+  Schema id_schema = Schema::CopySchema(&foo_schema, {0});
+  auto row_of = [&](int i) {
+    // every 7th name is NULL, the ids are negative as well
+    return std::vector<Value>{
+        ValueFactory::GetIntegerValue(i - n / 2),
+        i % 7 == 0 ? ValueFactory::GetNullValueByType(TypeId::VARCHAR)
+                   : ValueFactory::GetVarcharValue(fmt::format("n{}", i)),
+        ValueFactory::GetDecimalValue(i * -1.5), ValueFactory::GetVarcharValue(std::string(80, 'x'))};
+  };
+  auto expect_entries = [&](Index *index, Transaction *txn) {
+    for (int i : {0, 7, 150, 299}) {
+      std::vector<std::pair<Tuple, RID>> entries;
+      index->ScanKeyPrefixEntries({ValueFactory::GetIntegerValue(i - n / 2)}, &entries, txn);
+      ASSERT_EQ(1, entries.size());
+      EXPECT_EQ(rids[i], entries[0].second);
+      auto row = row_of(i);
+      for (uint32_t c = 0; c < 3; c++) {
+        auto value = entries[0].first.GetValue(index->GetEntrySchema(), c);
+        EXPECT_EQ(row[c].IsNull(), value.IsNull()) << i << " column " << c;
+        EXPECT_TRUE(row[c].IsNull() || value.CompareEquals(row[c]) == CmpBool::CmpTrue) << i << " column " << c;
+      }
+    }
+  };
+  {
+    auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+    auto txn = std::make_unique<Transaction>(0);
+
+    page_id_t header_page_id;
+    auto *header_page = reinterpret_cast<HeaderPage *>(bpm->NewPage(&header_page_id));
+    ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+    header_page->Init();
+    bpm->UnpinPage(header_page_id, true);
+
+    auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+    auto *foo = catalog->CreateTable(txn.get(), "foo", foo_schema);
+    ASSERT_NE(Catalog::NULL_TABLE_INFO, foo);
+    for (int i = 0; i < n; i++) {
+      ASSERT_TRUE(foo->table_->InsertTuple(Tuple{row_of(i), &foo_schema}, &rids[i], txn.get()));
+    }
+
+    // 4 + 14 + 8 bytes of id, name and score fit into 32, the long note only as a prefix
+    auto *covering = catalog->CreateBPlusTreeIndex(txn.get(), "foo_id", "foo", foo_schema, id_schema, {0},
+                                                   INDEX_FILL_FACTOR, true, {1, 2});
+    auto *lossy = catalog->CreateBPlusTreeIndex(txn.get(), "foo_id_note", "foo", foo_schema, id_schema, {0},
+                                                INDEX_FILL_FACTOR, true, {3});
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, covering);
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, lossy);
+    EXPECT_EQ(32, covering->key_size_);
+    EXPECT_TRUE(covering->index_->IsCovering());
+    EXPECT_FALSE(lossy->index_->IsCovering());
+    EXPECT_EQ((std::vector<uint32_t>{0, 1, 2}), covering->index_->GetEntryAttrs());
+
+    // lookups only look at the key, the entries decode to the row values
+    std::vector<RID> result;
+    covering->index_->ScanKey(Tuple{{ValueFactory::GetIntegerValue(8 - n / 2)}, &id_schema}, &result, txn.get());
+    EXPECT_EQ(std::vector<RID>{rids[8]}, result);
+    expect_entries(covering->index_.get(), txn.get());
+
+    // the key stays unique whatever the included values
+    auto *index = covering->index_.get();
+    Tuple other_entry{{ValueFactory::GetIntegerValue(8 - n / 2), ValueFactory::GetVarcharValue("other"),
+                       ValueFactory::GetDecimalValue(1.0)},
+                      index->GetEntrySchema()};
+    index->InsertEntry(other_entry, RID(1000, 0), txn.get());
+    result.clear();
+    index->ScanKey(Tuple{{ValueFactory::GetIntegerValue(8 - n / 2)}, &id_schema}, &result, txn.get());
+    EXPECT_EQ(std::vector<RID>{rids[8]}, result);
+
+    bpm->FlushAllPages();
+  }
+
+  // reopened, the index knows its included columns again
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+  auto txn = std::make_unique<Transaction>(1);
+  auto *covering = catalog->GetIndex("foo_id", "foo");
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, covering);
+  EXPECT_EQ((std::vector<uint32_t>{1, 2}), covering->index_->GetMetadata()->GetIncludeAttrs());
+  EXPECT_TRUE(covering->index_->IsCovering());
+  expect_entries(covering->index_.get(), txn.get());
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, LSMTreeIndexTest) {
+  remove("catalog_test.db");
+  const int n = 1000;
+  std::vector<RID> rids(n);
+  index_oid_t index_oid;
+  {
+    auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+    auto txn = std::make_unique<Transaction>(0);
+    page_id_t header_page_id;
+    auto *header_page = reinterpret_cast<HeaderPage *>(bpm->NewPage(&header_page_id));
+    header_page->Init();
+    bpm->UnpinPage(header_page_id, true);
+
+    auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+    Schema foo_schema{std::vector<Column>{{"A", TypeId::INTEGER}, {"B", TypeId::INTEGER}}};
+    auto *foo = catalog->CreateTable(txn.get(), "foo", foo_schema);
+    ASSERT_NE(Catalog::NULL_TABLE_INFO, foo);
+    for (int i = 0; i < n; i++) {
+      Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i % 100), ValueFactory::GetIntegerValue(i)},
+                  &foo_schema};
+      ASSERT_TRUE(foo->table_->InsertTuple(tuple, &rids[i], txn.get()));
+    }
+    Schema ab_schema = Schema::CopySchema(&foo_schema, {0, 1});
+    auto *index = catalog->CreateLSMTreeIndex(txn.get(), "foo_ab", "foo", foo_schema, ab_schema, {0, 1}, false);
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, index);
+    EXPECT_EQ(IndexType::LSMTreeIndex, index->index_type_);
+    EXPECT_EQ(8, index->key_size_);
+    index_oid = index->index_oid_;
+
+    // prefix lookups on the leading column, the rows of A = 7 are every hundredth one
+    std::vector<RID> result;
+    index->index_->ScanKeyPrefix({ValueFactory::GetIntegerValue(7)}, &result, txn.get());
+    ASSERT_EQ(n / 100, result.size());
+    EXPECT_EQ(rids[7], result[0]);
+
+    Tuple key{std::vector<Value>{ValueFactory::GetIntegerValue(7), ValueFactory::GetIntegerValue(107)}, &ab_schema};
+    index->index_->DeleteEntry(key, rids[107], txn.get());
+    result.clear();
+    index->index_->ScanKeyPrefix({ValueFactory::GetIntegerValue(7)}, &result, txn.get());
+    EXPECT_EQ(n / 100 - 1, result.size());
+    bpm->FlushAllPages();
+  }
+
+  // The runs are not persisted, reopening builds the index from the table
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+  auto txn = std::make_unique<Transaction>(1);
+  auto *index = catalog->GetIndex(index_oid);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index);
+  EXPECT_EQ(IndexType::LSMTreeIndex, index->index_type_);
+  for (int i = 0; i < n; i += 37) {
+    Tuple key{std::vector<Value>{ValueFactory::GetIntegerValue(i % 100), ValueFactory::GetIntegerValue(i)},
+              &index->key_schema_};
+    std::vector<RID> result;
+    index->index_->ScanKey(key, &result, txn.get());
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(rids[i], result[0]);
+  }
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, HashIndexTest) {
+  remove("catalog_test.db");
+  const int n = 1000;
+  std::vector<RID> rids(n);
+  index_oid_t a_oid;
+  index_oid_t b_oid;
+  {
+    auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+    auto txn = std::make_unique<Transaction>(0);
+    page_id_t header_page_id;
+    auto *header_page = reinterpret_cast<HeaderPage *>(bpm->NewPage(&header_page_id));
+    header_page->Init();
+    bpm->UnpinPage(header_page_id, true);
+
+    auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+    Schema foo_schema{std::vector<Column>{{"A", TypeId::INTEGER}, {"B", TypeId::INTEGER}}};
+    auto *foo = catalog->CreateTable(txn.get(), "foo", foo_schema);
+    ASSERT_NE(Catalog::NULL_TABLE_INFO, foo);
+    for (int i = 0; i < n; i++) {
+      Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i % 100), ValueFactory::GetIntegerValue(i)},
+                  &foo_schema};
+      ASSERT_TRUE(foo->table_->InsertTuple(tuple, &rids[i], txn.get()));
+    }
+    Schema a_schema = Schema::CopySchema(&foo_schema, {0});
+    auto *a_index = catalog->CreateHashIndex(txn.get(), "foo_a", "foo", foo_schema, a_schema, {0}, false);
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, a_index);
+    EXPECT_EQ(IndexType::HashIndex, a_index->index_type_);
+    EXPECT_EQ(4, a_index->key_size_);
+    a_oid = a_index->index_oid_;
+    Schema b_schema = Schema::CopySchema(&foo_schema, {1});
+    auto *b_index = catalog->CreateHashIndex(txn.get(), "foo_b", "foo", foo_schema, b_schema, {1});
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, b_index);
+    b_oid = b_index->index_oid_;
+
+    // every hundredth row has A = 7
+    std::vector<RID> result;
+    a_index->index_->ScanKey(Tuple({ValueFactory::GetIntegerValue(7)}, &a_schema), &result, txn.get());
+    ASSERT_EQ(n / 100, result.size());
+    a_index->index_->DeleteEntry(Tuple({ValueFactory::GetIntegerValue(7)}, &a_schema), rids[107], txn.get());
+    result.clear();
+    a_index->index_->ScanKey(Tuple({ValueFactory::GetIntegerValue(7)}, &a_schema), &result, txn.get());
+    EXPECT_EQ(n / 100 - 1, result.size());
+    EXPECT_EQ(result.end(), std::find(result.begin(), result.end(), rids[107]));
+
+    // a unique index keeps the first row of a key
+    Tuple b_key({ValueFactory::GetIntegerValue(42)}, &b_schema);
+    b_index->index_->InsertEntry(b_key, rids[0], txn.get());
+    result.clear();
+    b_index->index_->ScanKey(b_key, &result, txn.get());
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(rids[42], result[0]);
+
+    // a hash index cannot look up a key prefix
+    auto *ab_index = catalog->CreateHashIndex(txn.get(), "foo_ab", "foo", foo_schema,
+                                              Schema::CopySchema(&foo_schema, {0, 1}), {0, 1});
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, ab_index);
+    EXPECT_THROW(ab_index->index_->ScanKeyPrefix({ValueFactory::GetIntegerValue(7)}, &result, txn.get()),
+                 NotImplementedException);
+    bpm->FlushAllPages();
+  }
+
+  // The buckets are not persisted, reopening builds the indexes from the table
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr, true);
+  auto txn = std::make_unique<Transaction>(1);
+  auto *a_index = catalog->GetIndex(a_oid);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, a_index);
+  EXPECT_EQ(IndexType::HashIndex, a_index->index_type_);
+  std::vector<RID> result;
+  a_index->index_->ScanKey(Tuple({ValueFactory::GetIntegerValue(7)}, &a_index->key_schema_), &result, txn.get());
+  EXPECT_EQ(n / 100, result.size());
+  auto *b_index = catalog->GetIndex(b_oid);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, b_index);
+  for (int i = 0; i < n; i += 37) {
+    result.clear();
+    b_index->index_->ScanKey(Tuple({ValueFactory::GetIntegerValue(i)}, &b_index->key_schema_), &result, txn.get());
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(rids[i], result[0]);
+  }
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, HashIndexRebuildTest) {
+  remove("catalog_test.db");
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+
+  Schema foo_schema{std::vector<Column>{{"A", TypeId::INTEGER}, {"B", TypeId::INTEGER}}};
+  auto *foo = catalog->CreateTable(txn.get(), "foo", foo_schema);
+  ASSERT_NE(Catalog::NULL_TABLE_INFO, foo);
+  const int n = 1000;
+  std::vector<RID> rids(n);
+  for (int i = 0; i < n; i++) {
+    Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i % 100), ValueFactory::GetIntegerValue(i)},
+                &foo_schema};
+    ASSERT_TRUE(foo->table_->InsertTuple(tuple, &rids[i], txn.get()));
+  }
+  Schema a_schema = Schema::CopySchema(&foo_schema, {0});
+  auto *a_index = catalog->CreateHashIndex(txn.get(), "foo_a", "foo", foo_schema, a_schema, {0}, false);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, a_index);
+
+  // Rows deleted from the heap behind the index's back are gone after a rebuild
+  for (int i = 0; i < n; i += 3) {
+    foo->table_->ApplyDelete(rids[i], txn.get());
+  }
+  EXPECT_EQ(n - (n + 2) / 3, catalog->RebuildIndexes(txn.get(), "foo"));
+  std::vector<RID> result;
+  a_index->index_->ScanKey(Tuple({ValueFactory::GetIntegerValue(7)}, &a_schema), &result, txn.get());
+  ASSERT_EQ(7, result.size());
+  for (const auto &rid : result) {
+    auto pos = std::find(rids.begin(), rids.end(), rid) - rids.begin();
+    ASSERT_LT(pos, n);
+    EXPECT_NE(0, pos % 3);
+  }
+
+  // A bucket overflowing on one thread surfaces as an exception of the rebuild
+  for (int i = 0; i < n; i++) {
+    Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(1000), ValueFactory::GetIntegerValue(i)},
+                &foo_schema};
+    RID rid;
+    ASSERT_TRUE(foo->table_->InsertTuple(tuple, &rid, txn.get()));
+  }
+  EXPECT_THROW(catalog->RebuildIndexes(txn.get(), "foo"), Exception);
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, FailedCreateIndexTest) {
+  remove("catalog_test.db");
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+
+  Schema foo_schema{std::vector<Column>{{"A", TypeId::INTEGER}, {"B", TypeId::INTEGER}}};
+  auto *foo = catalog->CreateTable(txn.get(), "foo", foo_schema);
+  ASSERT_NE(Catalog::NULL_TABLE_INFO, foo);
+  const int n = 1000;
+  std::vector<RID> rids(n);
+  for (int i = 0; i < n; i++) {
+    Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(0), ValueFactory::GetIntegerValue(i)}, &foo_schema};
+    ASSERT_TRUE(foo->table_->InsertTuple(tuple, &rids[i], txn.get()));
+  }
+
+  // More rows of one key than a bucket page holds, the build throws and the index is gone again
+  Schema a_schema = Schema::CopySchema(&foo_schema, {0});
+  EXPECT_THROW(catalog->CreateHashIndex(txn.get(), "foo_a", "foo", foo_schema, a_schema, {0}, false), Exception);
+  EXPECT_EQ(Catalog::NULL_INDEX_INFO, catalog->GetIndex("foo_a", "foo"));
+  EXPECT_TRUE(catalog->GetTableIndexes("foo").empty());
+
+  // The name can be used again, a unique index keeps a single row of the key
+  auto *a_index = catalog->CreateHashIndex(txn.get(), "foo_a", "foo", foo_schema, a_schema, {0});
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, a_index);
+  EXPECT_TRUE(a_index->valid_);
+  ASSERT_EQ(1, catalog->GetTableIndexes("foo").size());
+  std::vector<RID> result;
+  a_index->index_->ScanKey(Tuple({ValueFactory::GetIntegerValue(0)}, &a_schema), &result, txn.get());
+  ASSERT_EQ(1, result.size());
+  EXPECT_EQ(rids[0], result[0]);
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, ConcurrentCreateIndexTest) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(256, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+
+  // The B+ tree stores its root in the header page
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  const std::string table_name{"foobar"};
+  Schema table_schema{std::vector<Column>{{"A", TypeId::INTEGER}}};
+  auto *table_info = catalog->CreateTable(txn.get(), table_name, table_schema);
+  ASSERT_NE(Catalog::NULL_TABLE_INFO, table_info);
+  Schema key_schema{std::vector<Column>{{"A", TypeId::INTEGER}}};
+  auto make_tuple = [&](int a) { return Tuple{std::vector<Value>{ValueFactory::GetIntegerValue(a)}, &table_schema}; };
+
+  const int n = 20000;
+  std::vector<RID> rids(2 * n);
+  for (int i = 0; i < n; i++) {
+    ASSERT_TRUE(table_info->table_->InsertTuple(make_tuple(i), &rids[i], txn.get()));
+  }
+
+  // A writer keeps inserting and deleting rows while the index is built. Like an executor it looks the indexes up
+  // after changing the heap, so each change is either seen by the scan or reaches the index through the catalog.
+  std::thread writer([&] {
+    Transaction writer_txn(1);
+    for (int i = n; i < 2 * n; i++) {
+      auto tuple = make_tuple(i);
+      ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rids[i], &writer_txn));
+      for (auto *index_info : catalog->GetTableIndexes(table_name)) {
+        auto key = tuple.KeyFromTuple(table_schema, *index_info->index_->GetEntrySchema(),
+                                      index_info->index_->GetEntryAttrs());
+        index_info->InsertEntry(key, rids[i], &writer_txn);
+      }
+      // every third row of the table goes away again
+      int victim = i - n;
+      if (victim % 3 == 0) {
+        auto old_tuple = make_tuple(victim);
+        ASSERT_TRUE(table_info->table_->MarkDelete(rids[victim], &writer_txn));
+        table_info->table_->ApplyDelete(rids[victim], &writer_txn);
+        for (auto *index_info : catalog->GetTableIndexes(table_name)) {
+          auto key = old_tuple.KeyFromTuple(table_schema, *index_info->index_->GetEntrySchema(),
+                                            index_info->index_->GetEntryAttrs());
+          index_info->DeleteEntry(key, rids[victim], &writer_txn);
+        }
+      }
+    }
+  });
+  auto *index_info = catalog->CreateBPlusTreeIndex(txn.get(), "foo_index", table_name, table_schema, key_schema, {0});
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+  EXPECT_TRUE(index_info->valid_);
+  writer.join();
+
+  std::vector<RID> result;
+  for (int i = 0; i < 2 * n; i++) {
+    Tuple key{std::vector<Value>{ValueFactory::GetIntegerValue(i)}, &key_schema};
+    result.clear();
+    index_info->index_->ScanKey(key, &result, txn.get());
+    if (i < n && i % 3 == 0) {
+      EXPECT_TRUE(result.empty()) << i;
+    } else {
+      ASSERT_EQ(1, result.size()) << i;
+      EXPECT_EQ(rids[i], result[0]);
+    }
+  }
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
 }  // namespace bustub
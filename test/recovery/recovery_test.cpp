@@ -10,7 +10,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
+#include <filesystem>
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
@@ -29,6 +33,7 @@
 #include "storage/table/table_heap.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -37,19 +42,28 @@ class RecoveryTest : public ::testing::Test {
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLogFiles();
   }
 
   // This function is called after every test.
   void TearDown() override {
     LOG_INFO("Tearing down the system..");
     remove("test.db");
-    remove("test.log");
+    RemoveLogFiles();
   };
+
+  // The log is split into test.log.<n> segment files plus a control file.
+  static void RemoveLogFiles() {
+    remove("test.log");
+    remove("test.log.ctl");
+    for (int i = 0; i < 64; i++) {
+      remove(("test.log." + std::to_string(i)).c_str());
+    }
+  }
 };
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_RedoTest) {
+TEST_F(RecoveryTest, RedoTest) {
   auto *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -89,6 +103,7 @@ TEST_F(RecoveryTest, DISABLED_RedoTest) {
   delete test_table;
 
   LOG_INFO("Shutdown System");
+  bustub_instance->SimulateCrash();
   delete bustub_instance;
 
   LOG_INFO("System restart...");
@@ -138,7 +153,7 @@ TEST_F(RecoveryTest, DISABLED_RedoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_UndoTest) {
+TEST_F(RecoveryTest, UndoTest) {
   auto *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -173,6 +188,7 @@ TEST_F(RecoveryTest, DISABLED_UndoTest) {
   delete test_table;
 
   LOG_INFO("System crash before commit");
+  bustub_instance->SimulateCrash();
   delete bustub_instance;
 
   LOG_INFO("System restarted..");
@@ -216,6 +232,319 @@ TEST_F(RecoveryTest, DISABLED_UndoTest) {
   delete bustub_instance;
 }
 
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, DeltaUpdateTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  ASSERT_FALSE(enable_logging);
+
+  Transaction *txn = bustub_instance->txn_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+
+  std::vector<Column> cols;
+  for (int i = 0; i < 8; i++) {
+    cols.emplace_back(std::string(1, static_cast<char>('a' + i)), TypeId::INTEGER);
+  }
+  Schema schema{cols};
+  std::vector<Value> old_values;
+  for (int i = 0; i < 8; i++) {
+    old_values.emplace_back(ValueFactory::GetIntegerValue(i));
+  }
+  std::vector<Value> new_values = old_values;
+  new_values[5] = ValueFactory::GetIntegerValue(42);
+  const Tuple old_tuple{old_values, &schema};
+  const Tuple new_tuple{new_values, &schema};
+
+  RID rid;
+  ASSERT_TRUE(test_table->InsertTuple(old_tuple, &rid, txn));
+
+  // Only the changed integer is encoded.
+  LogRecord full_record(txn->GetTransactionId(), INVALID_LSN, LogRecordType::UPDATE, rid, old_tuple, new_tuple);
+  LogRecord delta_record(txn->GetTransactionId(), INVALID_LSN, LogRecordType::DELTAUPDATE, rid, old_tuple, new_tuple);
+  ASSERT_EQ(delta_record.GetLogRecordType(), LogRecordType::DELTAUPDATE);
+  ASSERT_LT(delta_record.GetSize(), full_record.GetSize());
+  ASSERT_EQ(delta_record.GetDeltaRanges().size(), 1U);
+  ASSERT_LE(delta_record.GetDeltaRanges()[0].new_bytes_.size(), sizeof(int32_t));
+
+  // Gaps are coalesced only while logging them twice is cheaper than another range header.
+  const char old_bytes[] = "a...b....c";
+  const char new_bytes[] = "A...B....C";
+  auto ranges = LogRecord::ComputeDelta(old_bytes, new_bytes, sizeof(old_bytes) - 1);
+  ASSERT_EQ(ranges.size(), 2U);
+  ASSERT_EQ(ranges[0].offset_, 0U);
+  ASSERT_EQ(ranges[0].new_bytes_, "A...B");
+  ASSERT_EQ(ranges[1].offset_, 9U);
+
+  // A resized tuple falls back to the full image.
+  std::vector<Column> wide_cols{cols};
+  wide_cols.emplace_back("z", TypeId::INTEGER);
+  Schema wide_schema{wide_cols};
+  std::vector<Value> wide_values = new_values;
+  wide_values.emplace_back(ValueFactory::GetIntegerValue(0));
+  const Tuple wide_tuple{wide_values, &wide_schema};
+  LogRecord resized_record(txn->GetTransactionId(), INVALID_LSN, LogRecordType::DELTAUPDATE, rid, old_tuple,
+                           wide_tuple);
+  ASSERT_EQ(resized_record.GetLogRecordType(), LogRecordType::UPDATE);
+
+  // Round trip through the log buffer.
+  bustub_instance->log_manager_->AppendLogRecord(&delta_record);
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  LogRecord read_record;
+  ASSERT_TRUE(log_recovery->DeserializeLogRecord(bustub_instance->log_manager_->GetLogBuffer(), &read_record));
+  ASSERT_EQ(read_record.GetLogRecordType(), LogRecordType::DELTAUPDATE);
+  ASSERT_EQ(read_record.GetSize(), delta_record.GetSize());
+  ASSERT_EQ(read_record.GetUpdateRID(), rid);
+  ASSERT_EQ(read_record.GetDeltaRanges().size(), 1U);
+
+  // Redo and undo the delta on the page.
+  auto *page = reinterpret_cast<TablePage *>(bustub_instance->buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  Tuple result;
+  page->ApplyDelta(rid, read_record.GetDeltaRanges(), false);
+  ASSERT_TRUE(page->GetTuple(rid, &result, txn, nullptr));
+  ASSERT_EQ(result.GetValue(&schema, 5).CompareEquals(ValueFactory::GetIntegerValue(42)), CmpBool::CmpTrue);
+  ASSERT_EQ(result.GetValue(&schema, 4).CompareEquals(ValueFactory::GetIntegerValue(4)), CmpBool::CmpTrue);
+  page->ApplyDelta(rid, read_record.GetDeltaRanges(), true);
+  ASSERT_TRUE(page->GetTuple(rid, &result, txn, nullptr));
+  ASSERT_EQ(result.GetValue(&schema, 5).CompareEquals(ValueFactory::GetIntegerValue(5)), CmpBool::CmpTrue);
+  bustub_instance->buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
+
+  bustub_instance->txn_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete log_recovery;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, LogSegmentRecycleTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  Transaction *txn = bustub_instance->txn_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->txn_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  // Fill a few log segments, mostly with BEGIN/COMMIT records.
+  for (int i = 0; bustub_instance->disk_manager_->GetLogTail() < 2 * LOG_SEGMENT_SIZE; i++) {
+    txn = bustub_instance->txn_manager_->Begin();
+    if (i % 100 == 0) {
+      RID rid;
+      ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+    }
+    bustub_instance->txn_manager_->Commit(txn);
+    delete txn;
+  }
+  ASSERT_TRUE(std::filesystem::exists("test.log.0"));
+
+  // The segments before the checkpoint are recycled as spare segments after the tail.
+  bustub_instance->checkpoint_manager_->BeginCheckpoint();
+  bustub_instance->checkpoint_manager_->EndCheckpoint();
+  int64_t redo_offset = bustub_instance->disk_manager_->GetLogRedoOffset();
+  int64_t redo_segment = redo_offset / LOG_SEGMENT_SIZE;
+  ASSERT_EQ(redo_segment, 2);
+  ASSERT_FALSE(std::filesystem::exists("test.log.0"));
+  ASSERT_FALSE(std::filesystem::exists("test.log.1"));
+  ASSERT_TRUE(std::filesystem::exists("test.log.3"));
+  ASSERT_TRUE(std::filesystem::exists("test.log.4"));
+
+  // One committed insert after the checkpoint, its page never reaches the disk.
+  const Tuple last_tuple = ConstructTuple(&schema);
+  RID last_rid;
+  txn = bustub_instance->txn_manager_->Begin();
+  ASSERT_TRUE(test_table->InsertTuple(last_tuple, &last_rid, txn));
+  bustub_instance->txn_manager_->Commit(txn);
+  delete txn;
+  bustub_instance->log_manager_->Flush();
+  int64_t log_tail = bustub_instance->disk_manager_->GetLogTail();
+  lsn_t next_lsn = bustub_instance->log_manager_->GetNextLSN();
+
+  delete test_table;
+  LOG_INFO("System crash");
+  bustub_instance->SimulateCrash();
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  ASSERT_EQ(bustub_instance->disk_manager_->GetLogRedoOffset(), redo_offset);
+  // The tail is found on open, before recovery ran.
+  ASSERT_EQ(bustub_instance->disk_manager_->GetLogTail(), log_tail);
+  ASSERT_EQ(bustub_instance->disk_manager_->GetLogNextLSN(), next_lsn);
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  ASSERT_EQ(bustub_instance->disk_manager_->GetLogTail(), log_tail);
+  ASSERT_EQ(bustub_instance->disk_manager_->GetLogNextLSN(), next_lsn);
+
+  Tuple result;
+  txn = bustub_instance->txn_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  ASSERT_TRUE(test_table->GetTuple(last_rid, &result, txn));
+  ASSERT_EQ(result.GetValue(&schema, 0).CompareEquals(last_tuple.GetValue(&schema, 0)), CmpBool::CmpTrue);
+  bustub_instance->txn_manager_->Commit(txn);
+
+  delete txn;
+  delete test_table;
+  delete log_recovery;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, BatchInsertTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  Transaction *txn = bustub_instance->txn_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->txn_manager_->Commit(txn);
+  delete txn;
+
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::VARCHAR, 64}}};
+  auto make_batch = [&schema](int begin, int end) {
+    std::vector<Tuple> batch;
+    for (int i = begin; i < end; i++) {
+      batch.emplace_back(
+          std::vector<Value>{ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue(std::string(40, 'x'))},
+          &schema);
+    }
+    return batch;
+  };
+
+  // A committed batch over a few pages takes one record per page, and one per page it appends.
+  const std::vector<Tuple> committed = make_batch(0, 200);
+  std::vector<RID> committed_rids;
+  txn = bustub_instance->txn_manager_->Begin();
+  lsn_t first_lsn = bustub_instance->log_manager_->GetNextLSN();
+  ASSERT_TRUE(test_table->InsertTuples(committed, &committed_rids, txn));
+  std::set<page_id_t> pages;
+  for (const auto &rid : committed_rids) {
+    pages.insert(rid.GetPageId());
+  }
+  ASSERT_GT(pages.size(), 2U);
+  ASSERT_EQ(bustub_instance->log_manager_->GetNextLSN() - first_lsn, static_cast<lsn_t>(2 * pages.size() - 1));
+  bustub_instance->txn_manager_->Commit(txn);
+  delete txn;
+
+  // A batch that never commits, partly on the last page of the committed one.
+  const std::vector<Tuple> uncommitted = make_batch(200, 300);
+  std::vector<RID> uncommitted_rids;
+  txn = bustub_instance->txn_manager_->Begin();
+  ASSERT_TRUE(test_table->InsertTuples(uncommitted, &uncommitted_rids, txn));
+  ASSERT_EQ(uncommitted_rids.front().GetPageId(), committed_rids.back().GetPageId());
+  bustub_instance->log_manager_->Flush();
+  delete txn;
+
+  delete test_table;
+  LOG_INFO("System crash");
+  bustub_instance->SimulateCrash();
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  txn = bustub_instance->txn_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  for (size_t i = 0; i < committed.size(); i++) {
+    ASSERT_TRUE(test_table->GetTuple(committed_rids[i], &result, txn));
+    ASSERT_EQ(result.GetValue(&schema, 0).CompareEquals(committed[i].GetValue(&schema, 0)), CmpBool::CmpTrue);
+  }
+  size_t count = 0;
+  for (auto itr = test_table->Begin(txn); itr != test_table->End(); ++itr) {
+    count++;
+  }
+  ASSERT_EQ(count, committed.size());
+  bustub_instance->txn_manager_->Commit(txn);
+
+  delete txn;
+  delete test_table;
+  delete log_recovery;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, AsyncCommitTest) {
+  auto saved_log_timeout = log_timeout;
+  log_timeout = std::chrono::seconds(1);
+  // The instance starts the flush thread itself, as the shell does with --enable-logging.
+  enable_logging_on_startup = true;
+  auto *bustub_instance = new BustubInstance("test.db");
+  enable_logging_on_startup = false;
+  ASSERT_TRUE(enable_logging);
+
+  NoopWriter writer;
+  ASSERT_TRUE(bustub_instance->IsSynchronousCommit());
+  bustub_instance->ExecuteSql("SET synchronous_commit = off", writer);
+  ASSERT_FALSE(bustub_instance->IsSynchronousCommit());
+  // Transactions begun outside ExecuteSql pick up the session setting too.
+  Transaction *session_txn = bustub_instance->txn_manager_->Begin();
+  ASSERT_FALSE(session_txn->IsSynchronousCommit());
+  bustub_instance->ExecuteSqlTxn("SET synchronous_commit = on", writer, session_txn);
+  ASSERT_TRUE(session_txn->IsSynchronousCommit());
+  bustub_instance->txn_manager_->Commit(session_txn);
+  delete session_txn;
+  ASSERT_TRUE(bustub_instance->IsSynchronousCommit());
+
+  Transaction *txn = bustub_instance->txn_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  bustub_instance->txn_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  const int num_commits = 50;
+  auto run_commits = [&](bool synchronous_commit) -> double {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_commits; i++) {
+      txn = bustub_instance->txn_manager_->Begin();
+      txn->SetSynchronousCommit(synchronous_commit);
+      RID rid;
+      EXPECT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+      bustub_instance->txn_manager_->Commit(txn);
+      if (synchronous_commit) {
+        EXPECT_GE(bustub_instance->log_manager_->GetPersistentLSN(), txn->GetPrevLSN());
+      }
+      delete txn;
+    }
+    auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / num_commits;
+  };
+
+  double sync_latency = run_commits(true);
+  double async_latency = run_commits(false);
+  lsn_t last_lsn = bustub_instance->log_manager_->GetNextLSN() - 1;
+  LOG_INFO("commit latency: synchronous_commit=on %.1fus, synchronous_commit=off %.1fus", sync_latency,
+           async_latency);
+
+  // The flush thread persists asynchronous commits within log_timeout.
+  std::this_thread::sleep_for(2 * log_timeout + std::chrono::milliseconds(100));
+  EXPECT_GE(bustub_instance->log_manager_->GetPersistentLSN(), last_lsn);
+
+  log_timeout = saved_log_timeout;
+  delete test_table;
+  delete bustub_instance;
+}
+
 // NOLINTNEXTLINE
 TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   auto *bustub_instance = new BustubInstance("test.db");
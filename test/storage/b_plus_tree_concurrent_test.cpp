@@ -10,6 +10,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
@@ -333,4 +335,517 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
   remove("test.log");
 }
 
+// helper function to look up keys that no other thread touches
+void LookupHelper(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree, const std::vector<int64_t> &keys,
+                  std::atomic<int64_t> *misses, __attribute__((unused)) uint64_t thread_itr = 0) {
+  GenericKey<8> index_key;
+  std::vector<RID> rids;
+  for (int round = 0; round < 5; round++) {
+    for (auto key : keys) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      if (!tree->GetValue(index_key, &rids) || rids[0].GetSlotNum() != (key & 0xFFFFFFFF)) {
+        ++*misses;
+      }
+    }
+  }
+}
+
+TEST(BPlusTreeConcurrentTest, MixTest2) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // small nodes so that most writes split or merge and take the pessimistic path
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  // even keys stay in the tree, odd keys are inserted and then removed concurrently
+  std::vector<int64_t> stable_keys;
+  std::vector<int64_t> churn_keys;
+  for (int64_t key = 1; key <= 2000; key++) {
+    (key % 2 == 0 ? stable_keys : churn_keys).push_back(key);
+  }
+  InsertHelper(&tree, stable_keys);
+
+  std::atomic<int64_t> misses{0};
+  std::vector<std::thread> threads;
+  for (uint64_t i = 0; i < 4; i++) {
+    threads.emplace_back(InsertHelperSplit, &tree, churn_keys, 4, i);
+    threads.emplace_back(LookupHelper, &tree, stable_keys, &misses, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  for (uint64_t i = 0; i < 4; i++) {
+    threads.emplace_back(DeleteHelperSplit, &tree, churn_keys, 4, i);
+    threads.emplace_back(LookupHelper, &tree, stable_keys, &misses, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(misses, 0);
+
+  int64_t current_key = 2;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).first.ToString(), current_key);
+    current_key += 2;
+  }
+  EXPECT_EQ(current_key, 2002);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// helper function to scan the whole tree and check that every stable (even) key is returned once and in order
+void ScanHelper(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree, std::atomic<int64_t> *misses,
+                __attribute__((unused)) uint64_t thread_itr = 0) {
+  for (int round = 0; round < 5; round++) {
+    int64_t expected_key = 2;
+    int64_t last_key = 0;
+    for (auto iterator = tree->Begin(); !iterator.IsEnd(); ++iterator) {
+      int64_t key = (*iterator).first.ToString();
+      if (key <= last_key) {
+        ++*misses;  // 重复或倒退
+      }
+      last_key = key;
+      if (key % 2 == 0) {
+        if (key != expected_key) {
+          ++*misses;  // 漏掉了稳定的key
+        }
+        expected_key = key + 2;
+      }
+    }
+    if (expected_key != 2002) {
+      ++*misses;
+    }
+  }
+}
+
+TEST(BPlusTreeConcurrentTest, IteratorTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // small nodes so that the leaves under the iterators keep splitting and merging
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  std::vector<int64_t> stable_keys;
+  std::vector<int64_t> churn_keys;
+  for (int64_t key = 1; key <= 2000; key++) {
+    (key % 2 == 0 ? stable_keys : churn_keys).push_back(key);
+  }
+  InsertHelper(&tree, stable_keys);
+
+  {
+    // split the leaf under an open iterator, then merge it away, between every two steps
+    auto iterator = tree.Begin();
+    int64_t current_key = 2;
+    for (; !iterator.IsEnd(); ++iterator) {
+      EXPECT_EQ((*iterator).first.ToString(), current_key);
+      std::vector<int64_t> around;
+      for (int64_t key = current_key - 9; key <= current_key + 9; key += 2) {
+        around.push_back(key);
+      }
+      InsertHelper(&tree, around);
+      EXPECT_EQ((*iterator).first.ToString(), current_key);
+      DeleteHelper(&tree, around);
+      current_key += 2;
+    }
+    EXPECT_EQ(current_key, 2002);
+
+    // the removal of the returned key does not make the iterator skip the next one
+    auto it = tree.Begin();
+    EXPECT_EQ((*it).first.ToString(), 2);
+    DeleteHelper(&tree, {2});
+    ++it;
+    EXPECT_EQ((*it).first.ToString(), 4);
+    InsertHelper(&tree, {2});
+  }
+
+  // scans running while other threads insert and remove the keys in between
+  std::atomic<int64_t> misses{0};
+  std::vector<std::thread> threads;
+  for (uint64_t i = 0; i < 4; i++) {
+    threads.emplace_back(InsertHelperSplit, &tree, churn_keys, 4, i);
+    threads.emplace_back(ScanHelper, &tree, &misses, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  for (uint64_t i = 0; i < 4; i++) {
+    threads.emplace_back(DeleteHelperSplit, &tree, churn_keys, 4, i);
+    threads.emplace_back(ScanHelper, &tree, &misses, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(misses, 0);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, IteratorMergeTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // sparse stable keys with small leaves, so that the leaves around them keep emptying, merging and borrowing
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 4);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  std::vector<int64_t> stable_keys;
+  std::vector<int64_t> churn_keys;
+  for (int64_t key = 1; key <= 2000; key++) {
+    (key % 10 == 0 ? stable_keys : churn_keys).push_back(key);
+  }
+  InsertHelper(&tree, stable_keys);
+
+  // scans hopping between leaves while the leaves are merged and redistributed, every stable key is returned once
+  std::atomic<bool> done{false};
+  std::atomic<int64_t> misses{0};
+  auto scan = [&tree, &done, &misses](bool batched) {
+    while (!done) {
+      std::vector<int64_t> keys;
+      auto iterator = tree.Begin();
+      if (batched) {
+        std::vector<std::pair<GenericKey<8>, RID>> batch;
+        while (iterator.NextBatch(7, &batch) > 0) {
+        }
+        for (const auto &entry : batch) {
+          keys.push_back(entry.first.ToString());
+        }
+      } else {
+        for (; !iterator.IsEnd(); ++iterator) {
+          keys.push_back((*iterator).first.ToString());
+        }
+      }
+      int64_t expected_key = 10;
+      for (size_t i = 0; i < keys.size(); i++) {
+        if (i > 0 && keys[i] <= keys[i - 1]) {
+          ++misses;  // 重复或倒退
+        }
+        if (keys[i] % 10 == 0) {
+          if (keys[i] != expected_key) {
+            ++misses;  // 漏掉了稳定的key
+          }
+          expected_key = keys[i] + 10;
+        }
+      }
+      if (expected_key != 2010) {
+        ++misses;
+      }
+    }
+  };
+  std::vector<std::thread> scanners;
+  for (int i = 0; i < 4; i++) {
+    scanners.emplace_back(scan, i % 2 == 1);
+  }
+  std::vector<std::thread> writers;
+  for (uint64_t i = 0; i < 4; i++) {
+    writers.emplace_back([&tree, &churn_keys, i] {
+      for (int round = 0; round < 5; round++) {
+        InsertHelperSplit(&tree, churn_keys, 4, i);
+        DeleteHelperSplit(&tree, churn_keys, 4, i);
+      }
+    });
+  }
+  for (auto &thread : writers) {
+    thread.join();
+  }
+  done = true;
+  for (auto &thread : scanners) {
+    thread.join();
+  }
+  EXPECT_EQ(misses, 0);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// helper function to scan the whole tree backwards, like ScanHelper
+void ReverseScanHelper(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree, std::atomic<int64_t> *misses,
+                       __attribute__((unused)) uint64_t thread_itr = 0) {
+  for (int round = 0; round < 5; round++) {
+    int64_t expected_key = 2000;
+    int64_t last_key = 2001;
+    for (auto iterator = tree->RBegin(); !iterator.IsEnd(); ++iterator) {
+      int64_t key = (*iterator).first.ToString();
+      if (key >= last_key) {
+        ++*misses;  // 重复或倒退
+      }
+      last_key = key;
+      if (key % 2 == 0) {
+        if (key != expected_key) {
+          ++*misses;  // 漏掉了稳定的key
+        }
+        expected_key = key - 2;
+      }
+    }
+    if (expected_key != 0) {
+      ++*misses;
+    }
+  }
+}
+
+TEST(BPlusTreeConcurrentTest, ReverseIteratorTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // small nodes so that the leaves under the iterators keep splitting and merging
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  std::vector<int64_t> stable_keys;
+  std::vector<int64_t> churn_keys;
+  for (int64_t key = 1; key <= 2000; key++) {
+    (key % 2 == 0 ? stable_keys : churn_keys).push_back(key);
+  }
+  InsertHelper(&tree, stable_keys);
+
+  {
+    // split the leaf under an open iterator, then merge it away, between every two steps
+    auto iterator = tree.RBegin();
+    int64_t current_key = 2000;
+    for (; !iterator.IsEnd(); ++iterator) {
+      EXPECT_EQ((*iterator).first.ToString(), current_key);
+      std::vector<int64_t> around;
+      for (int64_t key = current_key - 9; key <= current_key + 9; key += 2) {
+        around.push_back(key);
+      }
+      InsertHelper(&tree, around);
+      EXPECT_EQ((*iterator).first.ToString(), current_key);
+      DeleteHelper(&tree, around);
+      current_key -= 2;
+    }
+    EXPECT_EQ(current_key, 0);
+
+    // the removal of the returned key does not make the iterator skip the next one
+    auto it = tree.RBegin();
+    EXPECT_EQ((*it).first.ToString(), 2000);
+    DeleteHelper(&tree, {2000});
+    ++it;
+    EXPECT_EQ((*it).first.ToString(), 1998);
+    InsertHelper(&tree, {2000});
+  }
+
+  // scans running while other threads insert and remove the keys in between
+  std::atomic<int64_t> misses{0};
+  std::vector<std::thread> threads;
+  for (uint64_t i = 0; i < 4; i++) {
+    threads.emplace_back(InsertHelperSplit, &tree, churn_keys, 4, i);
+    threads.emplace_back(ReverseScanHelper, &tree, &misses, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  for (uint64_t i = 0; i < 4; i++) {
+    threads.emplace_back(DeleteHelperSplit, &tree, churn_keys, 4, i);
+    threads.emplace_back(ReverseScanHelper, &tree, &misses, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(misses, 0);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, ReverseIteratorMergeTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // sparse stable keys with small leaves, so that the leaves around them keep emptying, merging and borrowing
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 4);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  std::vector<int64_t> stable_keys;
+  std::vector<int64_t> churn_keys;
+  for (int64_t key = 1; key <= 2000; key++) {
+    (key % 10 == 0 ? stable_keys : churn_keys).push_back(key);
+  }
+  InsertHelper(&tree, stable_keys);
+
+  // backward scans hopping between leaves while the leaves are merged and redistributed, every stable key is returned once
+  std::atomic<bool> done{false};
+  std::atomic<int64_t> misses{0};
+  auto scan = [&tree, &done, &misses](bool batched) {
+    while (!done) {
+      std::vector<int64_t> keys;
+      auto iterator = tree.RBegin();
+      if (batched) {
+        std::vector<std::pair<GenericKey<8>, RID>> batch;
+        while (iterator.NextBatch(7, &batch) > 0) {
+        }
+        for (const auto &entry : batch) {
+          keys.push_back(entry.first.ToString());
+        }
+      } else {
+        for (; !iterator.IsEnd(); ++iterator) {
+          keys.push_back((*iterator).first.ToString());
+        }
+      }
+      int64_t expected_key = 2000;
+      for (size_t i = 0; i < keys.size(); i++) {
+        if (i > 0 && keys[i] >= keys[i - 1]) {
+          ++misses;  // 重复或倒退
+        }
+        if (keys[i] % 10 == 0) {
+          if (keys[i] != expected_key) {
+            ++misses;  // 漏掉了稳定的key
+          }
+          expected_key = keys[i] - 10;
+        }
+      }
+      if (expected_key != 0) {
+        ++misses;
+      }
+    }
+  };
+  std::vector<std::thread> scanners;
+  for (int i = 0; i < 4; i++) {
+    scanners.emplace_back(scan, i % 2 == 1);
+  }
+  std::vector<std::thread> writers;
+  for (uint64_t i = 0; i < 4; i++) {
+    writers.emplace_back([&tree, &churn_keys, i] {
+      for (int round = 0; round < 5; round++) {
+        InsertHelperSplit(&tree, churn_keys, 4, i);
+        DeleteHelperSplit(&tree, churn_keys, 4, i);
+      }
+    });
+  }
+  for (auto &thread : writers) {
+    thread.join();
+  }
+  done = true;
+  for (auto &thread : scanners) {
+    thread.join();
+  }
+  EXPECT_EQ(misses, 0);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// helper function to look up the stable (even) keys in sorted batches, each range also covering the odd key after it
+void RangeLookupHelper(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree, const std::vector<int64_t> &keys,
+                       std::atomic<int64_t> *misses, __attribute__((unused)) uint64_t thread_itr = 0) {
+  std::vector<std::vector<RID>> results;
+  for (int round = 0; round < 5; round++) {
+    for (size_t begin = 0; begin < keys.size(); begin += 64) {
+      std::vector<std::pair<GenericKey<8>, GenericKey<8>>> ranges;
+      for (size_t i = begin; i < std::min(keys.size(), begin + 64); i++) {
+        GenericKey<8> low;
+        GenericKey<8> high;
+        low.SetFromInteger(keys[i]);
+        high.SetFromInteger(keys[i] + 1);
+        ranges.emplace_back(low, high);
+      }
+      tree->GetValueRanges(ranges, &results);
+      for (size_t i = 0; i < ranges.size(); i++) {
+        if (results[i].empty() || results[i][0].GetSlotNum() != (keys[begin + i] & 0xFFFFFFFF) ||
+            results[i].size() > 2) {
+          ++*misses;
+        }
+      }
+    }
+  }
+}
+
+TEST(BPlusTreeConcurrentTest, RangeLookupTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // small nodes so that the pages a batch remembers keep splitting and merging
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  std::vector<int64_t> stable_keys;
+  std::vector<int64_t> churn_keys;
+  for (int64_t key = 1; key <= 2000; key++) {
+    (key % 2 == 0 ? stable_keys : churn_keys).push_back(key);
+  }
+  InsertHelper(&tree, stable_keys);
+
+  std::atomic<int64_t> misses{0};
+  std::vector<std::thread> threads;
+  for (uint64_t i = 0; i < 4; i++) {
+    threads.emplace_back(InsertHelperSplit, &tree, churn_keys, 4, i);
+    threads.emplace_back(RangeLookupHelper, &tree, stable_keys, &misses, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  for (uint64_t i = 0; i < 4; i++) {
+    threads.emplace_back(DeleteHelperSplit, &tree, churn_keys, 4, i);
+    threads.emplace_back(RangeLookupHelper, &tree, stable_keys, &misses, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(misses, 0);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
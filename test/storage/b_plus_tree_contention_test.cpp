@@ -6,7 +6,9 @@
 #include <cstdio>
 #include <functional>
 #include <future>  // NOLINT
+#include <iomanip>
 #include <iostream>
+#include <random>
 #include <thread>  // NOLINT
 
 #include "buffer/buffer_pool_manager_instance.h"
@@ -14,144 +16,204 @@
 #include "storage/disk/disk_manager_memory.h"
 #include "storage/index/b_plus_tree.h"
 #include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
 
 namespace bustub {
 
-bool BPlusTreeLockBenchmarkCall(size_t num_threads, int leaf_node_size, bool with_global_mutex) {
-  bool success = true;
-  std::vector<int64_t> insert_keys;
-
+/**
+ * Run a fixed number of operations split across num_threads threads against a
+ * preloaded tree and return the throughput in operations per second. Every
+ * thread inserts its own keys and removes half of them again, the remaining
+ * operations are point lookups (read_percent of all operations). With
+ * with_global_mutex every operation is serialized, which is the baseline
+ * latch crabbing has to beat.
+ */
+auto BPlusTreeThroughputBenchmarkCall(size_t num_threads, int leaf_node_size, int internal_node_size, int read_percent,
+                                      bool with_global_mutex) -> double {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
   auto *disk_manager = new DiskManagerMemory(256 << 10);  // 1GB
-  BufferPoolManager *bpm = new BufferPoolManagerInstance(64, disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(1024, disk_manager);
   // create b+ tree
-  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, leaf_node_size, 10);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, leaf_node_size,
+                                                          internal_node_size);
   // create and fetch header_page
   page_id_t page_id;
   auto *header_page = bpm->NewPage(&page_id);
   (void)header_page;
 
-  std::vector<std::thread> threads;
+  // preload even keys, odd keys are left for the writers
+  const int64_t preload_keys = 50000;
+  const int64_t total_ops = 200000;
+  GenericKey<8> index_key;
+  RID rid;
+  for (int64_t key = 0; key < preload_keys; key++) {
+    index_key.SetFromInteger(key * 2);
+    rid.Set(0, static_cast<uint32_t>(key * 2));
+    tree.Insert(index_key, rid);
+  }
 
-  const int keys_per_thread = 20000 / num_threads;
-  const int keys_stride = 100000;
+  std::vector<std::thread> threads;
   std::mutex mtx;
-
+  const int64_t ops_per_thread = total_ops / num_threads;
+  auto clock_start = std::chrono::steady_clock::now();
   for (size_t i = 0; i < num_threads; i++) {
-    auto func = [&tree, &mtx, i, keys_per_thread, with_global_mutex]() {
+    auto func = [&tree, &mtx, i, num_threads, ops_per_thread, preload_keys, read_percent, with_global_mutex]() {
       GenericKey<8> index_key;
       RID rid;
+      std::vector<RID> result;
+      std::mt19937 gen(i);
+      std::uniform_int_distribution<int64_t> key_dist(0, preload_keys - 1);
+      std::uniform_int_distribution<int> op_dist(0, 99);
       auto *transaction = new Transaction(static_cast<txn_id_t>(i + 1));
-      const auto end_key = keys_stride * i + keys_per_thread;
-      for (auto key = i * keys_stride; key < end_key; key++) {
-        int64_t value = key & 0xFFFFFFFF;
-        rid.Set(static_cast<int32_t>(key >> 32), value);
-        index_key.SetFromInteger(key);
+      int64_t next_write = 0;  // index of this thread's next odd key
+      for (int64_t op = 0; op < ops_per_thread; op++) {
         if (with_global_mutex) {
           mtx.lock();
         }
-        tree.Insert(index_key, rid, transaction);
+        if (op_dist(gen) < read_percent) {
+          result.clear();
+          index_key.SetFromInteger(key_dist(gen) * 2);
+          tree.GetValue(index_key, &result, transaction);
+        } else {
+          // odd keys owned by this thread: (next_write * num_threads + i) * 2 + 1
+          int64_t slot = next_write / 2;
+          int64_t key = (slot * static_cast<int64_t>(num_threads) + static_cast<int64_t>(i)) * 2 + 1;
+          index_key.SetFromInteger(key);
+          if (next_write % 2 == 0) {
+            rid.Set(0, static_cast<uint32_t>(key));
+            tree.Insert(index_key, rid, transaction);
+          } else if (slot % 2 == 0) {
+            tree.Remove(index_key, transaction);
+          }
+          next_write++;
+        }
         if (with_global_mutex) {
           mtx.unlock();
         }
       }
       delete transaction;
     };
-    auto t = std::thread(std::move(func));
-    threads.emplace_back(std::move(t));
+    threads.emplace_back(std::move(func));
   }
 
   for (auto &thread : threads) {
     thread.join();
   }
+  auto clock_end = std::chrono::steady_clock::now();
+  auto dur = std::chrono::duration_cast<std::chrono::microseconds>(clock_end - clock_start).count();
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete disk_manager;
   delete bpm;
 
-  return success;
+  return static_cast<double>(ops_per_thread * num_threads) * 1000000 / std::max<int64_t>(dur, 1);
 }
 
-TEST(BPlusTreeTest, DISABLED_BPlusTreeContentionBenchmark) {  // NOLINT
-  std::vector<size_t> time_ms_with_mutex;
-  std::vector<size_t> time_ms_wo_mutex;
-  for (size_t iter = 0; iter < 20; iter++) {
-    bool enable_mutex = iter % 2 == 0;
-    auto clock_start = std::chrono::system_clock::now();
-    ASSERT_TRUE(BPlusTreeLockBenchmarkCall(32, 2, enable_mutex));
-    auto clock_end = std::chrono::system_clock::now();
-    auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(clock_end - clock_start);
-    if (enable_mutex) {
-      time_ms_with_mutex.push_back(dur.count());
-    } else {
-      time_ms_wo_mutex.push_back(dur.count());
-    }
-  }
-  std::cout << "This test will see how your B+ tree performance differs with and without contention." << std::endl;
+void BPlusTreeThroughputBenchmark(int leaf_node_size, int internal_node_size, int read_percent) {
+  std::cout << "This test will see how your B+ tree throughput scales with threads, with and without contention."
+            << std::endl;
+  std::cout << "leaf size " << leaf_node_size << ", internal size " << internal_node_size << ", " << read_percent
+            << "% lookups" << std::endl;
   std::cout << "<<< BEGIN" << std::endl;
-  std::cout << "Normal Access Time: ";
-  double ratio_1 = 0;
-  double ratio_2 = 0;
-  for (auto x : time_ms_wo_mutex) {
-    std::cout << x << " ";
-    ratio_1 += x;
-  }
-  std::cout << std::endl;
-
-  std::cout << "Serialized Access Time: ";
-  for (auto x : time_ms_with_mutex) {
-    std::cout << x << " ";
-    ratio_2 += x;
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "crabbing ops/s" << std::setw(16) << "mutex ops/s"
+            << std::setw(12) << "scaling" << std::setw(12) << "vs mutex" << std::endl;
+  double single_thread = 0;
+  for (size_t num_threads : {1, 2, 4, 8, 16, 32}) {
+    double crabbing = BPlusTreeThroughputBenchmarkCall(num_threads, leaf_node_size, internal_node_size, read_percent,
+                                                       false);
+    double serialized = BPlusTreeThroughputBenchmarkCall(num_threads, leaf_node_size, internal_node_size,
+                                                         read_percent, true);
+    if (num_threads == 1) {
+      single_thread = crabbing;
+    }
+    std::cout << std::setw(8) << num_threads << std::setw(16) << static_cast<int64_t>(crabbing) << std::setw(16)
+              << static_cast<int64_t>(serialized) << std::setw(11) << std::fixed << std::setprecision(2)
+              << crabbing / single_thread << "x" << std::setw(11) << crabbing / serialized << "x" << std::endl;
   }
-  std::cout << std::endl;
-  std::cout << "Ratio: " << ratio_1 / ratio_2 << std::endl;
   std::cout << ">>> END" << std::endl;
-  std::cout << "If your above data is an outlier in all submissions (based on statistics and probably some "
-               "machine-learning), TAs will manually inspect your code to ensure you are implementing lock crabbing "
-               "correctly."
-            << std::endl;
+  std::cout << "hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+}
+
+TEST(BPlusTreeTest, DISABLED_BPlusTreeContentionBenchmark) {  // NOLINT
+  // read mostly workload on roughly page sized nodes
+  BPlusTreeThroughputBenchmark(200, 200, 90);
 }
 
 TEST(BPlusTreeTest, DISABLED_BPlusTreeContentionBenchmark2) {  // NOLINT
-  std::vector<size_t> time_ms_with_mutex;
-  std::vector<size_t> time_ms_wo_mutex;
-  for (size_t iter = 0; iter < 20; iter++) {
-    bool enable_mutex = iter % 2 == 0;
-    auto clock_start = std::chrono::system_clock::now();
-    ASSERT_TRUE(BPlusTreeLockBenchmarkCall(32, 10, enable_mutex));
-    auto clock_end = std::chrono::system_clock::now();
-    auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(clock_end - clock_start);
-    if (enable_mutex) {
-      time_ms_with_mutex.push_back(dur.count());
-    } else {
-      time_ms_wo_mutex.push_back(dur.count());
-    }
+  // write heavy workload on small pages, most writes split or merge and restart pessimistically
+  BPlusTreeThroughputBenchmark(10, 10, 50);
+}
+
+/**
+ * Bulk load num_keys INTEGER keys, half of them negative, and time num_lookups
+ * single threaded point lookups of random present keys. Returns the average
+ * nanoseconds per lookup.
+ */
+template <typename KeyType, typename KeyComparator>
+auto BPlusTreePointLookupBenchmarkCall(int32_t num_keys, int64_t num_lookups) -> double {
+  auto key_schema = ParseCreateStatement("a integer");
+  KeyComparator comparator(key_schema.get());
+  auto *disk_manager = new DiskManagerMemory(256 << 10);  // 1GB
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(4096, disk_manager);
+  // create b+ tree with page sized nodes
+  BPlusTree<KeyType, RID, KeyComparator> tree("foo_pk", bpm, comparator);
+  // create and fetch header_page
+  page_id_t page_id;
+  auto *header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  auto make_key = [&key_schema](int32_t key) {
+    KeyType index_key;
+    index_key.SetFromKey(Tuple{{ValueFactory::GetIntegerValue(key)}, key_schema.get()}, key_schema.get());
+    return index_key;
+  };
+  std::vector<std::pair<KeyType, RID>> entries;
+  for (int32_t i = 0; i < num_keys; i++) {
+    entries.emplace_back(make_key(i * 2 - num_keys), RID(0, i));
   }
-  std::cout << "This test will see how your B+ tree performance differs with and without contention." << std::endl;
-  std::cout << "<<< BEGIN2" << std::endl;
-  std::cout << "Normal Access Time: ";
-  double ratio_1 = 0;
-  double ratio_2 = 0;
-  for (auto x : time_ms_wo_mutex) {
-    std::cout << x << " ";
-    ratio_1 += x;
+  tree.BulkLoad(entries);
+
+  std::mt19937 gen(15445);
+  std::uniform_int_distribution<int32_t> key_dist(0, num_keys - 1);
+  std::vector<KeyType> probes;
+  for (int64_t i = 0; i < num_lookups; i++) {
+    probes.push_back(entries[key_dist(gen)].first);
   }
-  std::cout << std::endl;
 
-  std::cout << "Serialized Access Time: ";
-  for (auto x : time_ms_with_mutex) {
-    std::cout << x << " ";
-    ratio_2 += x;
+  std::vector<RID> result;
+  int64_t found = 0;
+  auto clock_start = std::chrono::steady_clock::now();
+  for (const auto &probe : probes) {
+    result.clear();
+    found += static_cast<int64_t>(tree.GetValue(probe, &result));
   }
-  std::cout << std::endl;
-  std::cout << "Ratio: " << ratio_1 / ratio_2 << std::endl;
-  std::cout << ">>> END2" << std::endl;
-  std::cout << "If your above data is an outlier in all submissions (based on statistics and probably some "
-               "machine-learning), TAs will manually inspect your code to ensure you are implementing lock crabbing "
-               "correctly."
-            << std::endl;
+  auto clock_end = std::chrono::steady_clock::now();
+  auto dur = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_end - clock_start).count();
+  EXPECT_EQ(num_lookups, found);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+
+  return static_cast<double>(dur) / static_cast<double>(num_lookups);
+}
+
+TEST(BPlusTreeTest, DISABLED_BPlusTreePointLookupBenchmark) {  // NOLINT
+  // GenericKey compares through Value, NormalizedKey<8> with a memcmp binary search,
+  // NormalizedKey<4> is the INTEGER index key searched with the linear SIMD scan
+  const int32_t num_keys = 1000000;
+  const int64_t num_lookups = 2000000;
+  std::cout << "<<< BEGIN" << std::endl;
+  double generic = BPlusTreePointLookupBenchmarkCall<GenericKey<4>, GenericComparator<4>>(num_keys, num_lookups);
+  double memcmp = BPlusTreePointLookupBenchmarkCall<NormalizedKey<8>, NormalizedComparator<8>>(num_keys, num_lookups);
+  double simd = BPlusTreePointLookupBenchmarkCall<NormalizedKey<4>, NormalizedComparator<4>>(num_keys, num_lookups);
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << std::setw(20) << "GenericKey<4>" << std::setw(10) << generic << " ns/lookup" << std::endl;
+  std::cout << std::setw(20) << "NormalizedKey<8>" << std::setw(10) << memcmp << " ns/lookup" << std::endl;
+  std::cout << std::setw(20) << "NormalizedKey<4>" << std::setw(10) << simd << " ns/lookup" << std::endl;
+  std::cout << ">>> END" << std::endl;
 }
 
 }  // namespace bustub
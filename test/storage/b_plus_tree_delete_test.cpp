@@ -11,12 +11,19 @@
 //===----------------------------------------------------------------------===//
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "gtest/gtest.h"
 #include "storage/index/b_plus_tree.h"
 #include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -163,4 +170,495 @@ TEST(BPlusTreeTests, DeleteTest2) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(BPlusTreeTests, PrefixCompressionTest) {
+  auto key_schema = ParseCreateStatement("a varchar(30)");
+  NormalizedComparator<32> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree, small sizes so that leaves split, merge and borrow a lot
+  BPlusTree<NormalizedKey<32>, RID, NormalizedComparator<32>> tree("foo_pk", bpm, comparator, 4, 5);
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  ASSERT_EQ(page_id, HEADER_PAGE_ID);
+  (void)header_page;
+
+  // keys share long prefixes, key i is stored with slot number i
+  std::vector<std::string> names;
+  for (int tenant = 0; tenant < 4; tenant++) {
+    for (int user = 0; user < 300; user++) {
+      names.push_back(fmt::format("tenant-{:02}/user-{:05}", tenant, user * 7));
+    }
+  }
+  auto make_key = [&](int i) {
+    NormalizedKey<32> index_key;
+    index_key.SetFromKey(Tuple{std::vector<Value>{ValueFactory::GetVarcharValue(names[i])}, key_schema.get()},
+                         key_schema.get());
+    return index_key;
+  };
+  auto check = [&](const std::set<std::string> &expected) {
+    std::vector<RID> rids;
+    for (int i = 0; i < static_cast<int>(names.size()); i++) {
+      rids.clear();
+      bool found = tree.GetValue(make_key(i), &rids);
+      ASSERT_EQ(found, expected.count(names[i]) == 1) << names[i];
+      if (found) {
+        EXPECT_EQ(rids[0].GetSlotNum(), i);
+      }
+    }
+    auto name = expected.begin();
+    for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator, ++name) {
+      ASSERT_NE(name, expected.end());
+      EXPECT_EQ(names[(*iterator).second.GetSlotNum()], *name);
+    }
+    EXPECT_EQ(name, expected.end());
+  };
+
+  std::vector<int> order(names.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(15445));
+  std::set<std::string> expected;
+  for (int i : order) {
+    EXPECT_TRUE(tree.Insert(make_key(i), RID(0, i), transaction));
+    expected.insert(names[i]);
+  }
+  EXPECT_FALSE(tree.Insert(make_key(order[0]), RID(0, order[0]), transaction));
+  check(expected);
+
+  // the leaves only store the suffixes, so they hold more than the 4 entries asked for
+  Page *page = bpm->FetchPage(tree.GetRootPageId());
+  auto node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  while (!node->IsLeafPage()) {
+    page_id_t child_id = reinterpret_cast<BPlusTreeInternalPage<NormalizedKey<32>, page_id_t,
+                                                                 NormalizedComparator<32>> *>(node)->ValueAt(1);
+    bpm->UnpinPage(page->GetPageId(), false);
+    page = bpm->FetchPage(child_id);
+    node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  }
+  EXPECT_GT(node->GetMaxSize(), 4);
+  bpm->UnpinPage(page->GetPageId(), false);
+
+  std::shuffle(order.begin(), order.end(), std::mt19937(15645));
+  for (size_t j = 0; j < order.size() * 3 / 4; j++) {
+    tree.Remove(make_key(order[j]), transaction);
+    expected.erase(names[order[j]]);
+  }
+  check(expected);
+
+  // wasted bytes count what a compressed leaf actually stores, a lone root leaf has no prefix to strip but keeps
+  // its fences
+  BPlusTree<NormalizedKey<32>, RID, NormalizedComparator<32>> small_tree("bar_pk", bpm, comparator);
+  for (int i = 0; i < 10; i++) {
+    small_tree.Insert(make_key(i), RID(0, i), transaction);
+  }
+  size_t fence_size = 2 * sizeof(int32_t) + 2 * sizeof(NormalizedKey<32>);
+  EXPECT_EQ(small_tree.GetStats().wasted_bytes_, BUSTUB_PAGE_SIZE - LEAF_PAGE_HEADER_SIZE - fence_size -
+                                                     10 * (sizeof(NormalizedKey<32>) + sizeof(RID)));
+
+  // a bulk loaded tree packs leaves by their prefix and keeps working with removes
+  std::vector<std::pair<NormalizedKey<32>, RID>> entries;
+  for (int i = 0; i < static_cast<int>(names.size()); i++) {
+    entries.emplace_back(make_key(i), RID(0, i));
+    expected.insert(names[i]);
+  }
+  tree.BulkLoad(entries, transaction, 0.8);
+  check(expected);
+  for (int i : order) {
+    tree.Remove(make_key(i), transaction);
+    expected.erase(names[i]);
+    if (expected.size() % 300 == 0) {
+      check(expected);
+    }
+  }
+  EXPECT_TRUE(tree.IsEmpty());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, ReverseIteratorTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree, small sizes so that the leaf links change on every split and merge
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 5);
+  GenericKey<8> index_key;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  ASSERT_EQ(page_id, HEADER_PAGE_ID);
+  (void)header_page;
+
+  // walking backwards from a key gives the keys not greater than it in descending order
+  auto check = [&](const std::set<int64_t> &expected) {
+    std::vector<int64_t> keys;
+    for (auto iterator = tree.RBegin(); iterator != tree.REnd(); ++iterator) {
+      keys.push_back((*iterator).second.GetSlotNum());
+    }
+    EXPECT_EQ(keys, std::vector<int64_t>(expected.rbegin(), expected.rend()));
+
+    for (int64_t high : {-1L, 0L, 1L, 250L, 499L, 1000L}) {
+      index_key.SetFromInteger(high);
+      keys.clear();
+      std::vector<std::pair<GenericKey<8>, RID>> batch;
+      auto iterator = tree.RBegin(index_key);
+      for (size_t count; (count = iterator.NextBatch(7, &batch)) > 0;) {
+        EXPECT_LE(count, 7);
+      }
+      for (const auto &[key, rid] : batch) {
+        keys.push_back(rid.GetSlotNum());
+      }
+      EXPECT_TRUE(iterator.IsEnd());
+      std::vector<int64_t> expected_keys(std::make_reverse_iterator(expected.upper_bound(high)), expected.rend());
+      EXPECT_EQ(keys, expected_keys) << "from " << high;
+    }
+  };
+
+  std::vector<int64_t> order(500);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(15445));
+  std::set<int64_t> expected;
+  for (int64_t key : order) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key), transaction);
+    expected.insert(key);
+  }
+  check(expected);
+
+  // merges and redistributions relink the leaves
+  std::shuffle(order.begin(), order.end(), std::mt19937(15645));
+  for (size_t i = 0; i < order.size() * 3 / 4; i++) {
+    index_key.SetFromInteger(order[i]);
+    tree.Remove(index_key, transaction);
+    expected.erase(order[i]);
+  }
+  check(expected);
+
+  // bulk loaded leaves are linked both ways too
+  std::vector<std::pair<GenericKey<8>, RID>> entries;
+  for (int64_t key = 0; key < 500; key += 3) {
+    index_key.SetFromInteger(key);
+    entries.emplace_back(index_key, RID(0, key));
+  }
+  tree.BulkLoad(entries, transaction);
+  expected.clear();
+  for (int64_t key = 0; key < 500; key += 3) {
+    expected.insert(key);
+  }
+  check(expected);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, StatsTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 16, 16);
+  GenericKey<8> index_key;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  auto empty = tree.GetStats();
+  EXPECT_EQ(empty.height_, 0);
+  EXPECT_EQ(empty.PageCount(), 0);
+  EXPECT_EQ(empty.entries_, 0);
+
+  // the shape has to add up, whatever the tree went through
+  auto check = [&](const BPlusTreeStats &stats, uint64_t entries) {
+    EXPECT_EQ(stats.entries_, entries);
+    EXPECT_EQ(stats.height_, stats.level_pages_.size());
+    EXPECT_EQ(stats.level_pages_.front(), 1);
+    for (size_t level = 1; level < stats.level_pages_.size(); level++) {
+      EXPECT_GT(stats.level_pages_[level], stats.level_pages_[level - 1]);
+    }
+    EXPECT_LE(stats.leaf_fill_p10_, stats.leaf_fill_p50_);
+    EXPECT_LE(stats.leaf_fill_p50_, stats.leaf_fill_p90_);
+    EXPECT_GT(stats.leaf_fill_avg_, 0);
+    EXPECT_LT(stats.leaf_fill_avg_, 1);
+    EXPECT_GE(stats.leaf_contiguity_, 0);
+    EXPECT_LE(stats.leaf_contiguity_, 1);
+    EXPECT_LT(stats.wasted_bytes_, stats.PageCount() * BUSTUB_PAGE_SIZE);
+  };
+
+  // bulk loading writes full leaves one after another
+  std::vector<std::pair<GenericKey<8>, RID>> entries;
+  for (int64_t key = 0; key < 1000; key++) {
+    index_key.SetFromInteger(key);
+    entries.emplace_back(index_key, RID(0, key));
+  }
+  tree.BulkLoad(entries, transaction);
+  auto loaded = tree.GetStats();
+  check(loaded, 1000);
+  EXPECT_EQ(loaded.height_, 3);
+  EXPECT_DOUBLE_EQ(loaded.leaf_contiguity_, 1);
+  EXPECT_GT(loaded.leaf_fill_p10_, 0.9);
+
+  // deleting most keys leaves half empty pages behind
+  for (int64_t key = 0; key < 1000; key++) {
+    if (key % 10 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+  }
+  auto deleted = tree.GetStats();
+  check(deleted, 100);
+  EXPECT_LT(deleted.leaf_fill_avg_, loaded.leaf_fill_avg_);
+  EXPECT_GT(deleted.wasted_bytes_ / deleted.PageCount(), loaded.wasted_bytes_ / loaded.PageCount());
+
+  // splits in random order link leaves all over the file
+  for (int64_t key = 0; key < 1000; key++) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, transaction);
+  }
+  std::vector<int64_t> order(1000);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(15445));
+  for (int64_t key : order) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key), transaction);
+  }
+  auto inserted = tree.GetStats();
+  check(inserted, 1000);
+  EXPECT_LT(inserted.leaf_contiguity_, 0.5);
+  EXPECT_LT(inserted.leaf_fill_avg_, loaded.leaf_fill_avg_);
+
+  // a single leaf wastes exactly the bytes its entries leave free
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> small_tree("bar_pk", bpm, comparator);
+  for (int64_t key = 0; key < 10; key++) {
+    index_key.SetFromInteger(key);
+    small_tree.Insert(index_key, RID(0, key), transaction);
+  }
+  EXPECT_EQ(small_tree.GetStats().wasted_bytes_,
+            BUSTUB_PAGE_SIZE - LEAF_PAGE_HEADER_SIZE - 10 * (sizeof(GenericKey<8>) + sizeof(RID)));
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+TEST(BPlusTreeTests, RebuildTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 16, 16);
+  GenericKey<8> index_key;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // rebuilding an empty tree leaves it empty
+  tree.Rebuild();
+  EXPECT_TRUE(tree.IsEmpty());
+
+  // random inserts and heavy deletes leave sparse leaves all over the file
+  std::vector<int64_t> order(2000);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(15445));
+  for (int64_t key : order) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key), transaction);
+  }
+  for (int64_t key = 0; key < 2000; key++) {
+    if (key % 5 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+  }
+  auto sparse = tree.GetStats();
+  EXPECT_EQ(sparse.entries_, 400);
+
+  // lookups keep running while the tree is rebuilt, writers wait for it
+  std::atomic<bool> done{false};
+  std::thread reader([&tree, &done] {
+    GenericKey<8> key;
+    while (!done) {
+      for (int64_t i = 0; i < 2000; i += 5) {
+        key.SetFromInteger(i);
+        std::vector<RID> rids;
+        ASSERT_TRUE(tree.GetValue(key, &rids)) << i;
+        EXPECT_EQ(i, rids[0].GetSlotNum());
+      }
+    }
+  });
+  std::thread writer([&tree] {
+    GenericKey<8> key;
+    for (int64_t i = 2000; i < 2200; i++) {
+      key.SetFromInteger(i);
+      tree.Insert(key, RID(0, i));
+    }
+  });
+  tree.Rebuild();
+  writer.join();
+  done = true;
+  reader.join();
+
+  // the tree shrinks into full, contiguous leaves holding the same entries
+  tree.Rebuild();
+  auto rebuilt = tree.GetStats();
+  EXPECT_EQ(rebuilt.entries_, 600);
+  EXPECT_LT(rebuilt.PageCount(), sparse.PageCount());
+  EXPECT_DOUBLE_EQ(rebuilt.leaf_contiguity_, 1);
+  EXPECT_GT(rebuilt.leaf_fill_avg_, sparse.leaf_fill_avg_);
+  int64_t expected = 0;
+  for (auto it = tree.Begin(); it != tree.End(); ++it) {
+    EXPECT_EQ(expected, (*it).second.GetSlotNum());
+    expected += expected < 2000 ? 5 : 1;
+  }
+  EXPECT_EQ(expected, 2200);
+
+  // Rebuild returns while a scan is still open on the old leaves, even in the scan's own thread, and the scan reads
+  // the old leaves to the end; the old pages are deleted once it closes
+  {
+    auto it = tree.Begin();
+    tree.Rebuild();
+    expected = 0;
+    for (; !it.IsEnd(); ++it) {
+      EXPECT_EQ(expected, (*it).second.GetSlotNum());
+      expected += expected < 2000 ? 5 : 1;
+    }
+    EXPECT_EQ(expected, 2200);
+  }
+  EXPECT_EQ(tree.GetStats().entries_, 600);
+
+  // the rebuilt tree takes inserts and deletes like any other
+  for (int64_t key = 0; key < 2000; key++) {
+    index_key.SetFromInteger(key);
+    if (key % 5 == 0) {
+      tree.Remove(index_key, transaction);
+    } else {
+      tree.Insert(index_key, RID(0, key), transaction);
+    }
+  }
+  EXPECT_EQ(tree.GetStats().entries_, 1800);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, AdaptiveHashIndexTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // small pages, so that deletes merge plenty of them
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 5);
+  GenericKey<8> index_key;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  for (int64_t key = 0; key < 1000; key++) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key), transaction);
+  }
+
+  // repeated lookups turn the first keys hot, every lookup has to return the same as a descent
+  auto check = [&](int64_t key, bool exists, int32_t page) {
+    index_key.SetFromInteger(key);
+    std::vector<RID> rids;
+    ASSERT_EQ(exists, tree.GetValue(index_key, &rids)) << key;
+    if (exists) {
+      ASSERT_EQ(1, rids.size());
+      EXPECT_EQ(page, rids[0].GetPageId());
+      EXPECT_EQ(key, rids[0].GetSlotNum());
+    }
+  };
+  for (int round = 0; round < 20; round++) {
+    for (int64_t key = 0; key < 50; key++) {
+      check(key, true, 0);
+    }
+  }
+
+  // merges free the leaves the hot keys were cached at
+  for (int64_t key = 0; key < 1000; key++) {
+    if (key % 7 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+  }
+  for (int round = 0; round < 5; round++) {
+    for (int64_t key = 0; key < 50; key++) {
+      check(key, key % 7 == 0, 0);
+    }
+  }
+
+  // reinserted keys land in new slots and carry new values
+  for (int64_t key = 0; key < 50; key++) {
+    if (key % 7 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, RID(1, key), transaction);
+    }
+  }
+  for (int round = 0; round < 5; round++) {
+    for (int64_t key = 0; key < 50; key++) {
+      check(key, true, key % 7 == 0 ? 0 : 1);
+    }
+  }
+
+  // bulk loading replaces every page of the tree
+  std::vector<std::pair<GenericKey<8>, RID>> entries;
+  for (int64_t key = 0; key < 100; key++) {
+    index_key.SetFromInteger(key);
+    entries.emplace_back(index_key, RID(2, key));
+  }
+  tree.BulkLoad(entries, transaction);
+  for (int64_t key = 0; key < 50; key++) {
+    check(key, true, 2);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
 }  // namespace bustub
@@ -12,11 +12,15 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <functional>
+#include <random>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "gtest/gtest.h"
 #include "storage/index/b_plus_tree.h"
+#include "storage/page/b_plus_tree_key_search.h"
 #include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -195,4 +199,476 @@ TEST(BPlusTreeTests, InsertTest3) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(BPlusTreeTests, BulkLoadTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 3);
+  GenericKey<8> index_key;
+  RID rid;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  ASSERT_EQ(page_id, HEADER_PAGE_ID);
+  (void)header_page;
+
+  // even keys with every key repeated once; only the first copy is loaded
+  std::vector<std::pair<GenericKey<8>, RID>> entries;
+  for (int64_t key = 0; key < 1000; key += 2) {
+    index_key.SetFromInteger(key);
+    entries.emplace_back(index_key, RID(0, key));
+    entries.emplace_back(index_key, RID(1, key));
+  }
+  tree.BulkLoad(entries, transaction);
+
+  int64_t current_key = 0;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    auto location = (*iterator).second;
+    EXPECT_EQ(location.GetPageId(), 0);
+    EXPECT_EQ(location.GetSlotNum(), current_key);
+    current_key = current_key + 2;
+  }
+  EXPECT_EQ(current_key, 1000);
+
+  // the loaded tree must keep working with regular inserts and removes
+  for (int64_t key = 1; key < 1000; key += 2) {
+    index_key.SetFromInteger(key);
+    rid.Set(0, key);
+    EXPECT_TRUE(tree.Insert(index_key, rid, transaction));
+  }
+  for (int64_t key = 0; key < 1000; key += 3) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, transaction);
+  }
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < 1000; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(tree.GetValue(index_key, &rids), key % 3 != 0);
+  }
+  for (int64_t key = 999; key >= 0; key--) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, transaction);
+  }
+  EXPECT_TRUE(tree.IsEmpty());
+
+  // loading replaces the contents, loading nothing empties the tree
+  entries.resize(2);
+  tree.BulkLoad(entries, transaction);
+  current_key = 0;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    current_key++;
+  }
+  EXPECT_EQ(current_key, 1);
+  tree.BulkLoad({}, transaction);
+  EXPECT_TRUE(tree.IsEmpty());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, BulkLoadFillFactorTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  GenericKey<8> index_key;
+  RID rid;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  ASSERT_EQ(page_id, HEADER_PAGE_ID);
+  (void)header_page;
+
+  std::vector<std::pair<GenericKey<8>, RID>> entries;
+  for (int64_t key = 0; key < 2000; key++) {
+    index_key.SetFromInteger(key);
+    entries.emplace_back(index_key, RID(0, key));
+  }
+  // number of pages a build allocates, measured by the page ids handed out around it
+  auto count_pages = [&](const std::function<void()> &build) {
+    page_id_t before;
+    bpm->NewPage(&before);
+    bpm->UnpinPage(before, false);
+    build();
+    page_id_t after;
+    bpm->NewPage(&after);
+    bpm->UnpinPage(after, false);
+    return after - before - 1;
+  };
+
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> inserted("inserted", bpm, comparator, 8, 8);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> full("full", bpm, comparator, 8, 8);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> half("half", bpm, comparator, 8, 8);
+  int inserted_pages = count_pages([&] {
+    for (const auto &[key, value] : entries) {
+      inserted.Insert(key, value, transaction);
+    }
+  });
+  int full_pages = count_pages([&] { full.BulkLoad(entries, transaction); });
+  int half_pages = count_pages([&] { half.BulkLoad(entries, transaction, 0.5); });
+  // ascending inserts leave every split leaf half full, a full load packs 7 entries per leaf
+  EXPECT_LT(full_pages, inserted_pages);
+  EXPECT_LT(full_pages, half_pages);
+  EXPECT_LE(full_pages, 2000 / 7 + 2000 / 7 / 7 + 10);
+
+  for (auto *tree : {&inserted, &full, &half}) {
+    int64_t current_key = 0;
+    for (auto iterator = tree->Begin(); iterator != tree->End(); ++iterator) {
+      EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+      current_key++;
+    }
+    EXPECT_EQ(current_key, 2000);
+    // a half full tree takes inserts without splitting, a full one still splits correctly
+    for (int64_t key = 2000; key < 2500; key++) {
+      index_key.SetFromInteger(key);
+      rid.Set(0, key);
+      EXPECT_TRUE(tree->Insert(index_key, rid, transaction));
+    }
+    for (int64_t key = 0; key < 2500; key += 2) {
+      index_key.SetFromInteger(key);
+      tree->Remove(index_key, transaction);
+    }
+    std::vector<RID> rids;
+    for (int64_t key = 0; key < 2500; key++) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      EXPECT_EQ(tree->GetValue(index_key, &rids), key % 2 == 1);
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, NormalizedKeyOrderTest) {
+  auto key_schema = ParseCreateStatement("a integer,b varchar(8)");
+  NormalizedComparator<16> comparator(key_schema.get());
+
+  auto make_key = [&](const Value &a, const Value &b) {
+    NormalizedKey<16> index_key;
+    index_key.SetFromKey(Tuple{std::vector<Value>{a, b}, key_schema.get()}, key_schema.get());
+    return index_key;
+  };
+  auto null_int = ValueFactory::GetNullValueByType(TypeId::INTEGER);
+  auto null_str = ValueFactory::GetNullValueByType(TypeId::VARCHAR);
+
+  // every key sorts strictly before the next one, the first column decides first
+  std::vector<NormalizedKey<16>> keys{
+      make_key(null_int, ValueFactory::GetVarcharValue("a")),
+      make_key(ValueFactory::GetIntegerValue(-100000), ValueFactory::GetVarcharValue("a")),
+      make_key(ValueFactory::GetIntegerValue(-1), null_str),
+      make_key(ValueFactory::GetIntegerValue(-1), ValueFactory::GetVarcharValue("")),
+      make_key(ValueFactory::GetIntegerValue(-1), ValueFactory::GetVarcharValue("ab")),
+      make_key(ValueFactory::GetIntegerValue(-1), ValueFactory::GetVarcharValue("abc")),
+      make_key(ValueFactory::GetIntegerValue(-1), ValueFactory::GetVarcharValue("b")),
+      make_key(ValueFactory::GetIntegerValue(0), ValueFactory::GetVarcharValue("a")),
+      make_key(ValueFactory::GetIntegerValue(256), ValueFactory::GetVarcharValue("a")),
+      make_key(ValueFactory::GetIntegerValue(65536), ValueFactory::GetVarcharValue("a")),
+  };
+  for (size_t i = 0; i + 1 < keys.size(); i++) {
+    EXPECT_LT(comparator(keys[i], keys[i + 1]), 0) << "key " << i;
+    EXPECT_GT(comparator(keys[i + 1], keys[i]), 0) << "key " << i;
+  }
+  auto same = make_key(ValueFactory::GetIntegerValue(-1), ValueFactory::GetVarcharValue("ab"));
+  EXPECT_EQ(comparator(keys[4], same), 0);
+
+  // decimals, including negative ones, sort numerically
+  auto decimal_schema = ParseCreateStatement("a double");
+  std::vector<double> decimals{-1e10, -2.5, -0.5, 0.0, 0.5, 2.5, 1e10};
+  std::vector<NormalizedKey<8>> decimal_keys(decimals.size());
+  for (size_t i = 0; i < decimals.size(); i++) {
+    decimal_keys[i].SetFromKey(
+        Tuple{std::vector<Value>{ValueFactory::GetDecimalValue(decimals[i])}, decimal_schema.get()},
+        decimal_schema.get());
+  }
+  NormalizedComparator<8> decimal_comparator(decimal_schema.get());
+  for (size_t i = 0; i + 1 < decimal_keys.size(); i++) {
+    EXPECT_LT(decimal_comparator(decimal_keys[i], decimal_keys[i + 1]), 0) << decimals[i];
+  }
+}
+
+TEST(BPlusTreeTests, NormalizedKeyInsertTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  NormalizedComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree
+  BPlusTree<NormalizedKey<8>, RID, NormalizedComparator<8>> tree("foo_pk", bpm, comparator, 3, 5);
+  NormalizedKey<8> index_key;
+  RID rid;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  ASSERT_EQ(page_id, HEADER_PAGE_ID);
+  (void)header_page;
+
+  // negative keys must come out before positive ones
+  std::vector<int64_t> keys;
+  for (int64_t key = -500; key < 500; key++) {
+    keys.push_back(key * 1000003);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  for (auto key : keys) {
+    rid.Set(static_cast<int32_t>(key >> 32), static_cast<uint32_t>(key));
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, rid, transaction));
+  }
+
+  std::vector<RID> rids;
+  for (auto key : keys) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    tree.GetValue(index_key, &rids);
+    ASSERT_EQ(rids.size(), 1);
+    EXPECT_EQ(rids[0].GetSlotNum(), static_cast<uint32_t>(key));
+  }
+
+  std::sort(keys.begin(), keys.end());
+  size_t i = 0;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator, ++i) {
+    ASSERT_LT(i, keys.size());
+    EXPECT_EQ((*iterator).first.ToString(), keys[i]);
+  }
+  EXPECT_EQ(i, keys.size());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, KeySearchTest) {
+  // the scanning search of the INTEGER key must agree with std::lower_bound/upper_bound
+  auto key_schema = ParseCreateStatement("a integer");
+  NormalizedComparator<4> comparator(key_schema.get());
+  using Search = KeySearch<NormalizedKey<4>, NormalizedComparator<4>>;
+  auto make_key = [&key_schema](int32_t key) {
+    NormalizedKey<4> index_key;
+    index_key.SetFromKey(Tuple{{ValueFactory::GetIntegerValue(key)}, key_schema.get()}, key_schema.get());
+    return index_key;
+  };
+
+  std::mt19937 gen(15445);
+  std::uniform_int_distribution<int32_t> value_dist(-1000, 1000);
+  for (int n : {0, 1, 7, 8, 9, 31, 32, 33, 64, 100, 339}) {
+    std::vector<int32_t> values(n);
+    for (auto &value : values) {
+      value = value_dist(gen) * 3;
+    }
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    std::vector<NormalizedKey<4>> keys;
+    for (auto value : values) {
+      keys.push_back(make_key(value));
+    }
+
+    std::vector<int32_t> probes{INT32_MIN + 1, INT32_MAX, 0};
+    for (auto value : values) {
+      probes.insert(probes.end(), {value - 1, value, value + 1});
+    }
+    int size = static_cast<int>(values.size());
+    for (int l = 0; l <= std::min(1, size); l++) {
+      for (auto probe : probes) {
+        auto key = make_key(probe);
+        auto lower = std::lower_bound(values.begin() + l, values.end(), probe) - values.begin();
+        auto upper = std::upper_bound(values.begin() + l, values.end(), probe) - values.begin();
+        EXPECT_EQ(lower, Search::LowerBound(keys.data(), l, size, key, comparator)) << "probe " << probe;
+        EXPECT_EQ(upper, Search::UpperBound(keys.data(), l, size, key, comparator)) << "probe " << probe;
+      }
+    }
+  }
+}
+
+TEST(BPlusTreeTests, IndexIteratorBatchTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 5);
+  GenericKey<8> index_key;
+  GenericKey<8> end_key;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  ASSERT_EQ(page_id, HEADER_PAGE_ID);
+  (void)header_page;
+
+  // even keys only
+  for (int64_t key = 0; key < 1000; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key), transaction);
+  }
+
+  // batches cross leaves, begin at a missing key starts at the next one
+  auto collect = [&](int64_t begin, int64_t end, bool inclusive, size_t max_n) {
+    std::vector<int64_t> keys;
+    std::vector<std::pair<GenericKey<8>, RID>> batch;
+    index_key.SetFromInteger(begin);
+    end_key.SetFromInteger(end);
+    auto iterator = tree.Begin(index_key);
+    while (true) {
+      batch.clear();
+      size_t count = iterator.NextBatch(end_key, inclusive, comparator, max_n, &batch);
+      EXPECT_EQ(count, batch.size());
+      EXPECT_LE(count, max_n);
+      if (count == 0) {
+        break;
+      }
+      for (const auto &[key, rid] : batch) {
+        keys.push_back(rid.GetSlotNum());
+      }
+    }
+    return keys;
+  };
+  auto expected = [](int64_t begin, int64_t end) {
+    std::vector<int64_t> keys;
+    for (int64_t key = begin; key <= end; key += 2) {
+      keys.push_back(key);
+    }
+    return keys;
+  };
+  EXPECT_EQ(collect(101, 500, true, 7), expected(102, 500));
+  EXPECT_EQ(collect(101, 500, false, 7), expected(102, 498));
+  EXPECT_EQ(collect(0, 501, false, 1), expected(0, 500));
+  EXPECT_EQ(collect(600, 500, true, 7), expected(600, 500));
+  EXPECT_EQ(collect(900, 5000, true, 1000), expected(900, 998));
+
+  // without a bound the batches run up to the end, and the iterator ends up at End()
+  {
+    std::vector<std::pair<GenericKey<8>, RID>> batch;
+    auto iterator = tree.Begin();
+    size_t total = 0;
+    for (size_t count; (count = iterator.NextBatch(64, &batch)) > 0;) {
+      total += count;
+    }
+    EXPECT_EQ(total, 500);
+    EXPECT_EQ(batch.size(), 500);
+    EXPECT_TRUE(iterator == tree.End());
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, GetValuesTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 5);
+  GenericKey<8> index_key;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  ASSERT_EQ(page_id, HEADER_PAGE_ID);
+  (void)header_page;
+
+  std::vector<std::vector<RID>> results;
+  tree.GetValues({index_key}, &results, transaction);
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_TRUE(results[0].empty());
+
+  // even keys only
+  for (int64_t key = 0; key < 1000; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key), transaction);
+  }
+
+  // a batch of sorted keys, missing and repeated ones included, gives the same values as one lookup per key
+  std::vector<GenericKey<8>> keys;
+  for (int64_t key : {-1, 0, 0, 1, 2, 57, 58, 300, 301, 302, 998, 999, 5000}) {
+    index_key.SetFromInteger(key);
+    keys.push_back(index_key);
+  }
+  tree.GetValues(keys, &results, transaction);
+  ASSERT_EQ(results.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::vector<RID> expected;
+    tree.GetValue(keys[i], &expected, transaction);
+    EXPECT_EQ(results[i], expected) << "key " << i;
+  }
+
+  // ranges run across leaves and may overlap the previous one
+  std::vector<std::pair<GenericKey<8>, GenericKey<8>>> ranges;
+  std::vector<std::pair<int64_t, int64_t>> bounds{{-5, 3}, {1, 101}, {50, 60}, {700, 650}, {901, 5000}};
+  for (auto [low, high] : bounds) {
+    GenericKey<8> low_key;
+    GenericKey<8> high_key;
+    low_key.SetFromInteger(low);
+    high_key.SetFromInteger(high);
+    ranges.emplace_back(low_key, high_key);
+  }
+  tree.GetValueRanges(ranges, &results, transaction);
+  ASSERT_EQ(results.size(), ranges.size());
+  auto expected = [](int64_t low, int64_t high) {
+    std::vector<RID> rids;
+    for (int64_t key = std::max<int64_t>(0, low + low % 2); key <= std::min<int64_t>(998, high); key += 2) {
+      rids.emplace_back(0, key);
+    }
+    return rids;
+  };
+  EXPECT_EQ(results[0], expected(-5, 3));
+  EXPECT_EQ(results[1], expected(1, 101));
+  EXPECT_EQ(results[2], expected(50, 60));
+  EXPECT_TRUE(results[3].empty());
+  EXPECT_EQ(results[4], expected(901, 5000));
+
+  // every page is unpinned again
+  for (int i = 0; i < 49; i++) {
+    EXPECT_NE(bpm->NewPage(&page_id), nullptr);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include <cstring>
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -23,13 +24,15 @@ class DiskManagerTest : public ::testing::Test {
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    remove("test.log.0");
+    remove("test.log.1");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
-    remove("test.log");
+    remove("test.log.0");
+    remove("test.log.1");
   };
 };
 
@@ -72,6 +75,36 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ReadWriteLogAcrossSegmentsTest) {
+  std::vector<char> buf(LOG_BUFFER_SIZE);
+  std::vector<char> data(LOG_BUFFER_SIZE);
+  std::vector<char> other_data(LOG_BUFFER_SIZE);
+  for (int i = 0; i < LOG_BUFFER_SIZE; i++) {
+    data[i] = static_cast<char>(i % 127);
+    other_data[i] = static_cast<char>(i % 113 + 1);
+  }
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  // the last write straddles the boundary between segment 0 and 1, log buffers must alternate
+  int full_buffers = LOG_SEGMENT_SIZE / LOG_BUFFER_SIZE - 1;
+  for (int i = 0; i < full_buffers; i++) {
+    dm.WriteLog(i % 2 == 0 ? data.data() : other_data.data(), LOG_BUFFER_SIZE);
+  }
+  char *half_buffer = full_buffers % 2 == 0 ? data.data() : other_data.data();
+  char *straddle_buffer = full_buffers % 2 == 0 ? other_data.data() : data.data();
+  dm.WriteLog(half_buffer, LOG_BUFFER_SIZE / 2);
+  dm.WriteLog(straddle_buffer, LOG_BUFFER_SIZE);
+  EXPECT_EQ(dm.GetLogTail(), LOG_SEGMENT_SIZE + LOG_BUFFER_SIZE / 2);
+
+  EXPECT_TRUE(dm.ReadLog(buf.data(), LOG_BUFFER_SIZE, LOG_SEGMENT_SIZE - LOG_BUFFER_SIZE / 2));
+  EXPECT_EQ(std::memcmp(buf.data(), straddle_buffer, LOG_BUFFER_SIZE), 0);
+  EXPECT_FALSE(dm.ReadLog(buf.data(), LOG_BUFFER_SIZE, 2 * LOG_SEGMENT_SIZE));
+
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
@@ -0,0 +1,192 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lsm_tree_test.cpp
+//
+// Identification: test/storage/lsm_tree_test.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/lsm_tree.h"
+
+namespace bustub {
+
+using LSMTreeType = LSMTree<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+
+static auto KeyOf(int64_t key) -> NormalizedKey<8> {
+  NormalizedKey<8> index_key;
+  index_key.SetFromInteger(key);
+  return index_key;
+}
+
+static auto ScanAll(LSMTreeType *tree, int64_t low, int64_t high) -> std::vector<std::pair<int64_t, RID>> {
+  std::vector<std::pair<int64_t, RID>> entries;
+  tree->Scan(KeyOf(low), KeyOf(high),
+             [&](const NormalizedKey<8> &key, const RID &rid) { entries.emplace_back(key.ToString(), rid); });
+  return entries;
+}
+
+TEST(LSMTreeTests, InsertFlushCompactTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  NormalizedComparator<8> comparator(nullptr);
+  {
+    // a tiny memtable makes every few inserts a run, and runs compact into deeper levels
+    LSMTreeType tree(bpm, comparator, 16);
+    std::vector<int64_t> keys(2000);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+    for (auto key : keys) {
+      EXPECT_TRUE(tree.Insert(KeyOf(key), RID(static_cast<page_id_t>(key), 0)));
+      // a second row of every even key
+      if (key % 2 == 0) {
+        EXPECT_TRUE(tree.Insert(KeyOf(key), RID(static_cast<page_id_t>(key), 1)));
+      }
+    }
+    tree.Flush();
+    tree.WaitForCompaction();
+    auto level_runs = tree.GetLevelRuns();
+    EXPECT_LT(level_runs[0], LSM_LEVEL0_RUNS);
+    EXPECT_GT(level_runs.size(), 2);
+    for (size_t level = 1; level < level_runs.size(); level++) {
+      EXPECT_LE(level_runs[level], 1);
+    }
+
+    std::vector<RID> rids;
+    for (int64_t key = 0; key < 2000; key++) {
+      rids.clear();
+      EXPECT_TRUE(tree.GetValue(KeyOf(key), &rids));
+      ASSERT_EQ(rids.size(), key % 2 == 0 ? 2 : 1);
+      EXPECT_EQ(rids[0], RID(static_cast<page_id_t>(key), 0));
+    }
+    rids.clear();
+    EXPECT_FALSE(tree.GetValue(KeyOf(2000), &rids));
+
+    // a scan returns the entries in key order, then in RID order
+    auto entries = ScanAll(&tree, 100, 199);
+    ASSERT_EQ(entries.size(), 150);
+    EXPECT_EQ(entries.front().first, 100);
+    EXPECT_EQ(entries.back().first, 199);
+    EXPECT_TRUE(std::is_sorted(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+      return a.first < b.first || (a.first == b.first && a.second.Get() < b.second.Get());
+    }));
+    EXPECT_TRUE(ScanAll(&tree, 3000, 4000).empty());
+  }
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(LSMTreeTests, RemoveTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  NormalizedComparator<8> comparator(nullptr);
+  {
+    LSMTreeType tree(bpm, comparator, 16);
+    for (int64_t key = 0; key < 500; key++) {
+      tree.Insert(KeyOf(key), RID(static_cast<page_id_t>(key), 0));
+    }
+    tree.Flush();
+    // the tombstones land in newer runs than the entries they hide
+    for (int64_t key = 0; key < 500; key += 3) {
+      tree.Remove(KeyOf(key), RID(static_cast<page_id_t>(key), 0));
+    }
+    // removing an entry that does not exist hides nothing
+    tree.Remove(KeyOf(1), RID(1, 1));
+    std::vector<RID> rids;
+    EXPECT_FALSE(tree.GetValue(KeyOf(0), &rids));
+    EXPECT_TRUE(tree.GetValue(KeyOf(1), &rids));
+    EXPECT_EQ(ScanAll(&tree, 0, 499).size(), 500 - 167);
+
+    tree.Flush();
+    tree.WaitForCompaction();
+    EXPECT_EQ(ScanAll(&tree, 0, 499).size(), 500 - 167);
+
+    // a unique insert only succeeds for a key without a row, a removed one included
+    EXPECT_FALSE(tree.Insert(KeyOf(1), RID(1, 2), true));
+    EXPECT_TRUE(tree.Insert(KeyOf(3), RID(3, 2), true));
+    rids.clear();
+    EXPECT_TRUE(tree.GetValue(KeyOf(3), &rids));
+    ASSERT_EQ(rids.size(), 1);
+    EXPECT_EQ(rids[0], RID(3, 2));
+  }
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(LSMTreeTests, BulkLoadTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  NormalizedComparator<8> comparator(nullptr);
+  {
+    LSMTreeType tree(bpm, comparator, 16);
+    tree.Insert(KeyOf(-1), RID(0, 0));
+    std::vector<std::pair<NormalizedKey<8>, RID>> entries;
+    for (int64_t key = 0; key < 1000; key++) {
+      entries.emplace_back(KeyOf(key), RID(static_cast<page_id_t>(key), 0));
+    }
+    tree.BulkLoad(entries);
+    // the load replaces what was there, as a single run
+    std::vector<RID> rids;
+    EXPECT_FALSE(tree.GetValue(KeyOf(-1), &rids));
+    EXPECT_TRUE(tree.GetValue(KeyOf(999), &rids));
+    auto level_runs = tree.GetLevelRuns();
+    EXPECT_EQ(std::accumulate(level_runs.begin(), level_runs.end(), size_t{0}), 1);
+    EXPECT_EQ(ScanAll(&tree, 0, 999).size(), 1000);
+  }
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(LSMTreeTests, ConcurrentInsertTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  NormalizedComparator<8> comparator(nullptr);
+  {
+    LSMTreeType tree(bpm, comparator, 64);
+    const int64_t keys_per_thread = 2000;
+    std::vector<std::thread> threads;
+    for (int64_t t = 0; t < 4; t++) {
+      threads.emplace_back([&, t] {
+        for (int64_t key = t; key < 4 * keys_per_thread; key += 4) {
+          tree.Insert(KeyOf(key), RID(static_cast<page_id_t>(key), 0));
+          if (key % 10 == 0) {
+            std::vector<RID> rids;
+            EXPECT_TRUE(tree.GetValue(KeyOf(key), &rids));
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    tree.Flush();
+    tree.WaitForCompaction();
+    auto entries = ScanAll(&tree, 0, 4 * keys_per_thread);
+    ASSERT_EQ(entries.size(), 4 * keys_per_thread);
+    for (int64_t key = 0; key < 4 * keys_per_thread; key++) {
+      EXPECT_EQ(entries[key].first, key);
+    }
+  }
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
@@ -11,16 +11,19 @@
 //===----------------------------------------------------------------------===//
 
 #include <algorithm>
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <iostream>
 #include <string>
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include "common/logger.h"
 #include "gtest/gtest.h"
 #include "logging/common.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/tuple.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 // NOLINTNEXTLINE
@@ -71,4 +74,177 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(TupleTest, FreeSpaceMapTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::BIGINT}, Column{"b", TypeId::VARCHAR, 64}}};
+  std::string padding(64, 'x');
+  int64_t next = 0;
+  auto make_tuple = [&] {
+    return Tuple{std::vector<Value>{ValueFactory::GetBigIntValue(next++), ValueFactory::GetVarcharValue(padding)},
+                 &schema};
+  };
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManagerInstance(50, disk_manager);
+  auto *table = new TableHeap(buffer_pool_manager, nullptr, nullptr, transaction);
+
+  // a fresh heap is filled page after page
+  std::vector<RID> rid_v;
+  for (int i = 0; i < 5000; i++) {
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(make_tuple(), &rid, transaction));
+    if (!rid_v.empty()) {
+      ASSERT_GE(rid.GetPageId(), rid_v.back().GetPageId());
+    }
+    rid_v.push_back(rid);
+  }
+  page_id_t last_page_id = rid_v.back().GetPageId();
+  ASSERT_GT(last_page_id, rid_v.front().GetPageId() + 10);
+
+  int64_t deleted = 0;
+  auto empty_page = [&](page_id_t page_id) {
+    int64_t rows = 0;
+    for (const auto &rid : rid_v) {
+      if (rid.GetPageId() == page_id) {
+        EXPECT_TRUE(table->MarkDelete(rid, transaction));
+        table->ApplyDelete(rid, transaction);
+        rows++;
+      }
+    }
+    deleted += rows;
+    return rows;
+  };
+  // the rows fit into the emptied page and what is left of the last one, so the heap must not grow
+  auto refill = [&](TableHeap *heap, int64_t rows, page_id_t hole) {
+    bool reused = false;
+    for (int64_t i = 0; i < rows; i++) {
+      RID rid;
+      ASSERT_TRUE(heap->InsertTuple(make_tuple(), &rid, transaction));
+      EXPECT_LE(rid.GetPageId(), last_page_id);
+      reused = reused || rid.GetPageId() == hole;
+    }
+    EXPECT_TRUE(reused);
+  };
+
+  // space freed on an early page is used again before the heap grows
+  page_id_t hole = rid_v[1000].GetPageId();
+  refill(table, empty_page(hole), hole);
+
+  // a heap opened on the same pages finds the free space too
+  hole = rid_v[2000].GetPageId();
+  int64_t rows = empty_page(hole);
+  auto *reopened = new TableHeap(buffer_pool_manager, nullptr, nullptr, table->GetFirstPageId());
+  refill(reopened, rows, hole);
+
+  // once the free space is used up the heap grows at its end again
+  RID rid;
+  for (int i = 0; i < 200; i++) {
+    ASSERT_TRUE(reopened->InsertTuple(make_tuple(), &rid, transaction));
+  }
+  EXPECT_GT(rid.GetPageId(), last_page_id);
+
+  int64_t count = 0;
+  for (auto itr = reopened->Begin(transaction); itr != reopened->End(); ++itr) {
+    count++;
+  }
+  EXPECT_EQ(next - deleted, count);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete reopened;
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, BatchInsertTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::BIGINT}, Column{"b", TypeId::VARCHAR, 64}}};
+  const size_t num_rows = 30000;
+  std::vector<std::vector<Tuple>> batches;
+  for (size_t i = 0; i < num_rows; i++) {
+    if (i % INSERT_BATCH_SIZE == 0) {
+      batches.emplace_back();
+    }
+    batches.back().emplace_back(std::vector<Value>{ValueFactory::GetBigIntValue(static_cast<int64_t>(i)),
+                                                   ValueFactory::GetVarcharValue(std::string(32, 'x'))},
+                                &schema);
+  }
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManagerInstance(50, disk_manager);
+
+  // the same rows, one InsertTuple call each
+  auto *row_table = new TableHeap(buffer_pool_manager, nullptr, nullptr, transaction);
+  auto start = std::chrono::steady_clock::now();
+  for (const auto &batch : batches) {
+    for (const auto &tuple : batch) {
+      RID rid;
+      ASSERT_TRUE(row_table->InsertTuple(tuple, &rid, transaction));
+    }
+  }
+  std::chrono::duration<double> row_time = std::chrono::steady_clock::now() - start;
+
+  // and a page at a time
+  auto *batch_table = new TableHeap(buffer_pool_manager, nullptr, nullptr, transaction);
+  std::vector<std::vector<RID>> batch_rids(batches.size());
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < batches.size(); i++) {
+    ASSERT_TRUE(batch_table->InsertTuples(batches[i], &batch_rids[i], transaction));
+  }
+  std::chrono::duration<double> batch_time = std::chrono::steady_clock::now() - start;
+  LOG_INFO("insert throughput: one row at a time %.0f rows/s, a page at a time %.0f rows/s",
+           num_rows / row_time.count(), num_rows / batch_time.count());
+  EXPECT_EQ(2 * num_rows, transaction->GetWriteSet()->size());
+
+  // the rows are laid out the same way, page after page
+  auto row_itr = row_table->Begin(transaction);
+  RID last_rid;
+  for (size_t i = 0; i < batches.size(); i++) {
+    ASSERT_EQ(batches[i].size(), batch_rids[i].size());
+    for (size_t j = 0; j < batches[i].size(); j++) {
+      const RID &rid = batch_rids[i][j];
+      ASSERT_TRUE(i + j == 0 || rid.GetPageId() > last_rid.GetPageId() ||
+                  (rid.GetPageId() == last_rid.GetPageId() && rid.GetSlotNum() == last_rid.GetSlotNum() + 1));
+      last_rid = rid;
+      Tuple tuple;
+      ASSERT_TRUE(batch_table->GetTuple(rid, &tuple, transaction));
+      ASSERT_EQ(tuple.GetValue(&schema, 0).CompareEquals(batches[i][j].GetValue(&schema, 0)), CmpBool::CmpTrue);
+      ASSERT_EQ(tuple.GetValue(&schema, 0).CompareEquals(row_itr->GetValue(&schema, 0)), CmpBool::CmpTrue);
+      ASSERT_EQ(rid.GetSlotNum(), row_itr->GetRid().GetSlotNum());
+      ++row_itr;
+    }
+  }
+  ASSERT_TRUE(row_itr == row_table->End());
+
+  // a batch goes into the free space of earlier pages before the heap grows
+  page_id_t hole = batch_rids[3][0].GetPageId();
+  std::vector<Tuple> refill;
+  for (const auto &rid : batch_rids[3]) {
+    if (rid.GetPageId() == hole) {
+      ASSERT_TRUE(batch_table->MarkDelete(rid, transaction));
+      batch_table->ApplyDelete(rid, transaction);
+      refill.push_back(batches[3][refill.size()]);
+    }
+  }
+  std::vector<RID> refill_rids;
+  ASSERT_TRUE(batch_table->InsertTuples(refill, &refill_rids, transaction));
+  ASSERT_EQ(refill.size(), refill_rids.size());
+  EXPECT_TRUE(std::any_of(refill_rids.begin(), refill_rids.end(),
+                          [hole](const RID &rid) { return rid.GetPageId() == hole; }));
+  EXPECT_TRUE(std::all_of(refill_rids.begin(), refill_rids.end(),
+                          [&](const RID &rid) { return rid.GetPageId() <= last_rid.GetPageId(); }));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete batch_table;
+  delete row_table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
 }  // namespace bustub
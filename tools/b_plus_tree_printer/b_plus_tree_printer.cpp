@@ -39,6 +39,7 @@ auto UsageMessage() -> std::string {
       "\td <k>  -- Delete key <k> and its associated value.\n"
       "\tg <filename>.dot  -- Output the tree in graph format to a dot file\n"
       "\tp -- Print the B+ tree.\n"
+      "\ts -- Print the height, fill factors, leaf contiguity and wasted bytes of the B+ tree.\n"
       "\tq -- Quit. (Or use Ctl-D.)\n"
       "\t? -- Print this help message.\n\n"
       "Please Enter Leaf node max size and Internal node max size:\n"
@@ -113,6 +114,9 @@ auto main(int argc, char **argv) -> int {
       case 'p':
         tree.Print(bpm);
         break;
+      case 's':
+        std::cout << tree.GetStats().ToString();
+        break;
       case 'g':
         std::cin >> filename;
         tree.Draw(bpm, filename);
@@ -0,0 +1,206 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_bench.cpp
+//
+// Identification: tools/index_bench/index_bench.cpp
+//
+// Compares the B+ tree with the LSM tree and the extendible hash table: insert
+// throughput, then the latency of point lookups and of short range scans over
+// the loaded keys. The hash table cannot scan ranges.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "argparse/argparse.hpp"
+#include "buffer/buffer_pool_manager_instance.h"
+#include "container/disk/hash/disk_extendible_hash_table.h"
+#include "fmt/core.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/lsm_tree.h"
+
+using bustub::BPlusTree;
+using bustub::BufferPoolManagerInstance;
+using bustub::DiskExtendibleHashTable;
+using bustub::DiskManager;
+using bustub::LSMTree;
+using bustub::page_id_t;
+using bustub::RID;
+
+using KeyType = bustub::NormalizedKey<8>;
+using ComparatorType = bustub::NormalizedComparator<8>;
+
+static auto KeyOf(int64_t key) -> KeyType {
+  KeyType index_key;
+  index_key.SetFromInteger(key);
+  return index_key;
+}
+
+static auto RidOf(int64_t key) -> RID { return RID(static_cast<page_id_t>(key >> 32), static_cast<uint32_t>(key)); }
+
+/** Seconds f takes to run */
+template <typename F>
+static auto Time(F f) -> double {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct BenchResult {
+  double insert_seconds_;
+  double lookup_seconds_;
+  double scan_seconds_;
+  size_t scanned_;
+};
+
+static void Report(const std::string &name, const BenchResult &result, size_t keys, size_t lookups,
+                   bool scans = true) {
+  fmt::print("{:<8} insert {:>12.0f} keys/s   point lookup {:>8.2f} us", name,
+             static_cast<double>(keys) / result.insert_seconds_,
+             result.lookup_seconds_ * 1e6 / static_cast<double>(lookups));
+  if (!scans) {
+    fmt::print("\n");
+    return;
+  }
+  fmt::print("   range scan {:>8.2f} us\n", result.scan_seconds_ * 1e6 / static_cast<double>(lookups));
+  fmt::print("{:<8} {} entries found by the range scans\n", "", result.scanned_);
+}
+
+// NOLINTNEXTLINE
+auto main(int argc, char **argv) -> int {
+  argparse::ArgumentParser program("bustub-index-bench");
+  program.add_argument("--keys").help("number of keys to insert").default_value(200000).scan<'i', int>();
+  program.add_argument("--lookups")
+      .help("number of point lookups and range scans")
+      .default_value(20000)
+      .scan<'i', int>();
+  program.add_argument("--range").help("keys per range scan").default_value(100).scan<'i', int>();
+  program.add_argument("--pool-size").help("buffer pool size in pages").default_value(4096).scan<'i', int>();
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+  auto keys = static_cast<size_t>(program.get<int>("--keys"));
+  auto lookups = static_cast<size_t>(program.get<int>("--lookups"));
+  auto range = program.get<int>("--range");
+  auto pool_size = static_cast<size_t>(program.get<int>("--pool-size"));
+
+  std::mt19937_64 rng(15445);
+  std::vector<int64_t> insert_keys(keys);
+  std::iota(insert_keys.begin(), insert_keys.end(), 0);
+  std::shuffle(insert_keys.begin(), insert_keys.end(), rng);
+  std::vector<int64_t> lookup_keys(lookups);
+  std::uniform_int_distribution<int64_t> dist(0, static_cast<int64_t>(keys) - 1);
+  for (auto &key : lookup_keys) {
+    key = dist(rng);
+  }
+  ComparatorType comparator(nullptr);
+
+  fmt::print("{} keys inserted in random order, {} lookups, {} keys per range scan\n", keys, lookups, range);
+  {
+    auto disk_manager = std::make_unique<DiskManager>("index_bench_bplus.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(pool_size, disk_manager.get());
+    page_id_t header_page_id;
+    bpm->NewPage(&header_page_id);
+    BPlusTree<KeyType, RID, ComparatorType> tree("index_bench", bpm.get(), comparator);
+    BenchResult result{};
+    result.insert_seconds_ = Time([&] {
+      for (auto key : insert_keys) {
+        tree.Insert(KeyOf(key), RidOf(key));
+      }
+    });
+    result.lookup_seconds_ = Time([&] {
+      std::vector<RID> rids;
+      for (auto key : lookup_keys) {
+        rids.clear();
+        tree.GetValue(KeyOf(key), &rids);
+      }
+    });
+    result.scan_seconds_ = Time([&] {
+      for (auto key : lookup_keys) {
+        auto end = tree.End();
+        int n = 0;
+        for (auto it = tree.Begin(KeyOf(key)); it != end && n < range; ++it) {
+          n++;
+        }
+        result.scanned_ += n;
+      }
+    });
+    Report("b+tree", result, keys, lookups);
+  }
+  {
+    auto disk_manager = std::make_unique<DiskManager>("index_bench_lsm.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(pool_size, disk_manager.get());
+    LSMTree<KeyType, RID, ComparatorType> tree(bpm.get(), comparator);
+    BenchResult result{};
+    result.insert_seconds_ = Time([&] {
+      for (auto key : insert_keys) {
+        tree.Insert(KeyOf(key), RidOf(key));
+      }
+    });
+    // lookups run against the settled tree, like they do against the finished B+ tree
+    tree.WaitForCompaction();
+    result.lookup_seconds_ = Time([&] {
+      std::vector<RID> rids;
+      for (auto key : lookup_keys) {
+        rids.clear();
+        tree.GetValue(KeyOf(key), &rids);
+      }
+    });
+    result.scan_seconds_ = Time([&] {
+      for (auto key : lookup_keys) {
+        tree.Scan(KeyOf(key), KeyOf(key + range - 1), [&result](const KeyType &, const RID &) { result.scanned_++; });
+      }
+    });
+    Report("lsm", result, keys, lookups);
+    std::string runs;
+    for (auto level_runs : tree.GetLevelRuns()) {
+      runs += (runs.empty() ? "" : " ") + std::to_string(level_runs);
+    }
+    fmt::print("lsm runs per level: {}\n", runs);
+  }
+  {
+    auto disk_manager = std::make_unique<DiskManager>("index_bench_hash.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(pool_size, disk_manager.get());
+    DiskExtendibleHashTable<KeyType, RID, ComparatorType> table("index_bench", bpm.get(), comparator,
+                                                               bustub::HashFunction<KeyType>());
+    BenchResult result{};
+    size_t rejected = 0;
+    result.insert_seconds_ = Time([&] {
+      for (auto key : insert_keys) {
+        rejected += table.Insert(nullptr, KeyOf(key), RidOf(key)) ? 0 : 1;
+      }
+    });
+    result.lookup_seconds_ = Time([&] {
+      std::vector<RID> rids;
+      for (auto key : lookup_keys) {
+        rids.clear();
+        table.GetValue(nullptr, KeyOf(key), &rids);
+      }
+    });
+    Report("hash", result, keys, lookups, false);
+    fmt::print("hash global depth: {}\n", table.GetGlobalDepth());
+    if (rejected > 0) {
+      // the directory is a single page, it cannot point to more buckets than that
+      fmt::print("hash table full, {} keys rejected\n", rejected);
+    }
+  }
+  remove("index_bench_bplus.db");
+  remove("index_bench_lsm.db");
+  remove("index_bench_hash.db");
+  return 0;
+}
@@ -1,3 +1,4 @@
+#include <cstdio>
 #include <fstream>
 #include <ios>
 #include <iostream>
@@ -176,6 +177,8 @@ auto main(int argc, char **argv) -> int {  // NOLINT
   if (program.get<bool>("--in-memory")) {
     bustub = std::make_unique<bustub::BustubInstance>();
   } else {
+    // Every run starts from an empty database, the catalog of an earlier run would be reopened otherwise
+    std::remove("test.db");
     bustub = std::make_unique<bustub::BustubInstance>("test.db");
   }
 
@@ -195,6 +195,7 @@ auto main(int argc, char **argv) -> int {
   {
     std::stringstream ss;
     auto writer = bustub::SimpleStreamWriter(ss, true);
+    auto start = std::chrono::steady_clock::now();
     auto txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ);
     bustub->ExecuteSqlTxn(query, writer, txn);
     bustub->txn_manager_->Commit(txn);
@@ -203,6 +204,10 @@ auto main(int argc, char **argv) -> int {
       fmt::print("unexpected result \"{}\" when insert\n", ss.str());
       exit(1);
     }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << fmt::format("x: inserted {} rows in {:.3f}s, {:.0f} rows/s", BUSTUB_NFT_NUM, elapsed,
+                             BUSTUB_NFT_NUM / elapsed)
+              << std::endl;
   }
 
   std::cerr << "x: benchmark start" << std::endl;